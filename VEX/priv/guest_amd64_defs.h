@@ -58,6 +58,12 @@ DisResult disInstr_AMD64 ( IRSB*        irsb_IN,
                            VexEndness   host_endness_IN,
                            Bool         sigill_diag_IN );
 
+/* Used by bb_to_IR to find out whether the flags thunk is dead at
+   the start of a successor block.  This conforms to the type
+   CCDeadFn in guest_generic_bb_to_IR.h. */
+extern
+UInt guest_amd64_cc_dead_at ( const UChar* guest_code_IN, Long delta );
+
 /* Used by the optimiser to specialise calls to helpers. */
 extern
 IRExpr* guest_amd64_spechelper ( const HChar* function_name,
@@ -214,6 +214,12 @@ static IRSB* irsb;
 static Addr64 guest_RIP_next_assumed;
 static Bool   guest_RIP_next_mustcheck;
 
+/* The factor by which disAMode multiplies an 8-bit displacement.  It
+   is 1, except for EVEX-encoded insns, whose "compressed" disp8 is in
+   units of the size of the memory operand.  Set to 1 at the start of
+   each insn decode. */
+static Int disp8_scale;
+
 
 /*------------------------------------------------------------*/
 /*--- Helpers for constructing IR.                         ---*/
@@ -2627,7 +2633,7 @@ IRTemp disAMode ( /*OUT*/Int* len,
       case 0x08: case 0x09: case 0x0A: case 0x0B: 
       /* ! 0C */ case 0x0D: case 0x0E: case 0x0F:
          { UChar rm = toUChar(mod_reg_rm & 7);
-           Long d   = getSDisp8(delta);
+           Long d   = getSDisp8(delta) * disp8_scale;
            if (d == 0) {
               DIS(buf, "%s(%s)", segRegTxt(pfx), nameIRegRexB(8,pfx,rm));
            } else {
@@ -2771,7 +2777,7 @@ IRTemp disAMode ( /*OUT*/Int* len,
          UChar scale   = toUChar((sib >> 6) & 3);
          UChar index_r = toUChar((sib >> 3) & 7);
          UChar base_r  = toUChar(sib & 7);
-         Long d        = getSDisp8(delta+1);
+         Long d        = getSDisp8(delta+1) * disp8_scale;
 
          if (index_r == R_RSP && 0==getRexX(pfx)) {
             DIS(buf, "%s%lld(%s)", segRegTxt(pfx), 
@@ -26032,6 +26038,8 @@ Long dis_ESC_0F__VEX (
       break;
 
    case 0x6F:
+      /* The unmasked EVEX forms of VMOVDQA32/64 and VMOVDQU32/64 come
+         here too, as VEX insns; see disInstr_AMD64_WRK. */
       /* VMOVDQA ymm2/m256, ymm1 = VEX.256.66.0F.WIG 6F */
       /* VMOVDQU ymm2/m256, ymm1 = VEX.256.F3.0F.WIG 6F */
       if ((have66noF2noF3(pfx) || haveF3no66noF2(pfx))
@@ -26594,6 +26602,8 @@ Long dis_ESC_0F__VEX (
       break;
 
    case 0x7F:
+      /* The unmasked EVEX forms of VMOVDQA32/64 and VMOVDQU32/64 come
+         here too, as VEX insns; see disInstr_AMD64_WRK. */
       /* VMOVDQA ymm1, ymm2/m256 = VEX.256.66.0F.WIG 7F */
       /* VMOVDQU ymm1, ymm2/m256 = VEX.256.F3.0F.WIG 7F */
       if ((have66noF2noF3(pfx) || haveF3no66noF2(pfx))
@@ -32252,6 +32262,9 @@ DisResult disInstr_AMD64_WRK (
    /* Holds the computed opcode-escape indication. */
    Escape esc = ESC_NONE;
 
+   /* Set if the insn has an EVEX prefix, for the decode failure message. */
+   Bool isEVEX = False;
+
    /* Set result defaults. */
    dres.whatNext    = Dis_Continue;
    dres.len         = 0;
@@ -32378,9 +32391,64 @@ DisResult disInstr_AMD64_WRK (
    }
 
    not_a_legacy_prefix:
+   /* 0x62 is invalid in 64-bit mode, except as the first byte of an
+      EVEX prefix, which introduces an AVX-512 instruction.  We don't
+      claim AVX-512 in CPUID, and only handle the EVEX forms which are
+      equivalent to a VEX insn: for now, VMOVDQA32/64 and VMOVDQU32/64
+      (0F 6F and 0F 7F) at 128 and 256 bits, without masking and using
+      only registers 0 to 15.  Those are turned into the equivalent VEX
+      prefix, except that the disp8 is scaled by the vector length.
+      Any other EVEX insn is rejected here, saying why. */
+   if (getUChar(delta) == 0x62) {
+      UChar evex1 = getUChar(delta+1);
+      UChar evex2 = getUChar(delta+2);
+      UChar evex3 = getUChar(delta+3);
+      UChar opc   = getUChar(delta+4);
+      UChar modrm = getUChar(delta+5);
+      isEVEX = True;
+      if (!(archinfo->hwcaps & VEX_HWCAPS_AMD64_AVX))
+         goto decode_failure;
+      /* EVEX can't be combined with REX or a 66/F2/F3 prefix. */
+      if (pfx & (PFX_REX | PFX_66 | PFX_F2 | PFX_F3))
+         goto decode_failure;
+      /* Byte 1: R X B R' 0 0 m m.  The map must be 0F.  ~R' set
+         means a register above 15, as does ~X with a register
+         E part. */
+      if ((evex1 & 0x1F) != 0x11)
+         goto decode_failure;
+      if (epartIsReg(modrm) && !(evex1 & (1<<6)))
+         goto decode_failure;
+      /* Byte 2: W ~v3 ~v2 ~v1 ~v0 1 p p.  pp must be 66 or F3. */
+      if (!(evex2 & (1<<2)))
+         goto decode_failure;
+      if ((evex2 & 3) != 1 && (evex2 & 3) != 2)
+         goto decode_failure;
+      /* Byte 3: z L' L b ~V' a a a.  No zeroing, no broadcast or
+         rounding control, no mask, ~V' set, and 128 or 256 bits. */
+      if ((evex3 & 0xDF) != 0x08)
+         goto decode_failure;
+      if (opc != 0x6F && opc != 0x7F)
+         goto decode_failure;
+      pfx |= PFX_VEX;
+      /* R */    pfx |= (evex1 & (1<<7)) ? 0 : PFX_REXR;
+      /* X */    pfx |= (evex1 & (1<<6)) ? 0 : PFX_REXX;
+      /* B */    pfx |= (evex1 & (1<<5)) ? 0 : PFX_REXB;
+      /* W */    pfx |= (evex2 & (1<<7)) ? PFX_REXW : 0;
+      /* ~v3 */  pfx |= (evex2 & (1<<6)) ? 0 : PFX_VEXnV3;
+      /* ~v2 */  pfx |= (evex2 & (1<<5)) ? 0 : PFX_VEXnV2;
+      /* ~v1 */  pfx |= (evex2 & (1<<4)) ? 0 : PFX_VEXnV1;
+      /* ~v0 */  pfx |= (evex2 & (1<<3)) ? 0 : PFX_VEXnV0;
+      /* L */    pfx |= (evex3 & (1<<5)) ? PFX_VEXL : 0;
+      /* pp */   pfx |= (evex2 & 3) == 1 ? PFX_66 : PFX_F3;
+      esc = ESC_0F;
+      /* The full vector is the memory operand. */
+      disp8_scale = (evex3 & (1<<5)) ? 32 : 16;
+      delta += 4;
+   }
+
    /* We've used up all the non-VEX prefixes.  Parse and validate a
       VEX prefix if that's appropriate. */
-   if (archinfo->hwcaps & VEX_HWCAPS_AMD64_AVX) {
+   if ((archinfo->hwcaps & VEX_HWCAPS_AMD64_AVX) && !isEVEX) {
       /* Used temporarily for holding VEX prefixes. */
       UChar vex0 = getUChar(delta);
       if (vex0 == 0xC4) {
@@ -32607,6 +32675,9 @@ DisResult disInstr_AMD64_WRK (
       vex_printf("vex amd64->IR:   PFX.66=%d PFX.F2=%d PFX.F3=%d\n",
                  have66(pfx) ? 1 : 0, haveF2(pfx) ? 1 : 0,
                  haveF3(pfx) ? 1 : 0);
+      if (isEVEX)
+         vex_printf("vex amd64->IR:   EVEX prefix: this AVX-512 "
+                    "instruction is not supported\n");
    }
 
    /* Tell the dispatcher that this insn cannot be decoded, and so has
@@ -32681,6 +32752,8 @@ DisResult disInstr_AMD64 ( IRSB*        irsb_IN,
    guest_RIP_next_assumed   = 0;
    guest_RIP_next_mustcheck = False;
 
+   disp8_scale = 1;
+
    x1 = irsb_IN->stmts_used;
    expect_CAS = False;
    dres = disInstr_AMD64_WRK ( &expect_CAS,
@@ -32751,6 +32824,155 @@ DisResult disInstr_AMD64 ( IRSB*        irsb_IN,
    return dres;
 }
 
+/*------------------------------------------------------------*/
+/*--- Condition code liveness at a block entry             ---*/
+/*------------------------------------------------------------*/
+
+/* Length of the modrm byte at p, plus any following SIB byte and
+   displacement. */
+static UInt lengthModRM ( const UChar* p )
+{
+   UChar mod = toUChar(p[0] >> 6);
+   UChar rm  = toUChar(p[0] & 7);
+   UInt  len = 1;
+   if (mod != 3 && rm == 4) {
+      /* SIB byte; base 5 with mod 0 means disp32 and no base */
+      if (mod == 0 && (p[1] & 7) == 5)
+         len += 4;
+      len++;
+   }
+   if (mod == 0 && rm == 5)
+      len += 4; /* %rip-relative */
+   else if (mod == 1)
+      len += 1;
+   else if (mod == 2)
+      len += 4;
+   return len;
+}
+
+/* Decide whether the flags thunk is dead on entry to the code at
+   &guest_code_IN[delta], which is to say that all four thunk fields are
+   overwritten before any of them are read, and before anything happens
+   that could need them to be valid.  If so, return the number of bytes
+   that had to be examined, else zero.  See CCDeadFn in
+   guest_generic_bb_to_IR.h.
+
+   This is deliberately simple-minded.  It skips a few instructions which
+   neither touch the flags nor access memory, and then must find an
+   add/or/and/sub/xor/cmp/test with register or immediate operands, all of
+   which write the full thunk without reading it.  Anything else, including
+   any prefix other than 0x66 and REX, makes it give up. */
+UInt guest_amd64_cc_dead_at ( const UChar* guest_code_IN, Long delta )
+{
+   const UChar* start = &guest_code_IN[delta];
+   const UChar* p     = start;
+   Int i;
+
+   for (i = 0; i < 8; i++) {
+      Bool  sz16 = False;
+      Bool  rexW = False;
+      UChar opc;
+
+      /* No insn accepted below is longer than 15 bytes.  Don't read
+         beyond the end of the page containing the block entry. */
+      if ((((HWord)start) & ~(HWord)4095) != (((HWord)p + 15) & ~(HWord)4095))
+         return 0;
+
+      if (*p == 0x66) {
+         sz16 = True;
+         p++;
+      }
+      if ((*p & 0xF0) == 0x40) {
+         rexW = toBool((*p & 8) != 0);
+         p++;
+      }
+      opc = *p++;
+
+      switch (opc) {
+         /* add/or/and/sub/xor/cmp Gb,Eb / Gv,Ev / Eb,Gb / Ev,Gv and
+            test Eb,Gb / Ev,Gv, with register operands */
+         case 0x00: case 0x01: case 0x02: case 0x03:
+         case 0x08: case 0x09: case 0x0A: case 0x0B:
+         case 0x20: case 0x21: case 0x22: case 0x23:
+         case 0x28: case 0x29: case 0x2A: case 0x2B:
+         case 0x30: case 0x31: case 0x32: case 0x33:
+         case 0x38: case 0x39: case 0x3A: case 0x3B:
+         case 0x84: case 0x85:
+            if (!epartIsReg(*p))
+               return 0;
+            return (UInt)(p + 1 - start);
+
+         /* the same, on %al and an imm8 */
+         case 0x04: case 0x0C: case 0x24: case 0x2C: case 0x34:
+         case 0x3C: case 0xA8:
+            return (UInt)(p + 1 - start);
+
+         /* the same, on %ax/%eax/%rax and an imm16/imm32 */
+         case 0x05: case 0x0D: case 0x25: case 0x2D: case 0x35:
+         case 0x3D: case 0xA9:
+            return (UInt)(p + (sz16 ? 2 : 4) - start);
+
+         /* Grp1 with a register operand, except for adc and sbb,
+            which read the carry flag */
+         case 0x80: case 0x81: case 0x83:
+            if (!epartIsReg(*p)
+                || gregLO3ofRM(*p) == 2 || gregLO3ofRM(*p) == 3)
+               return 0;
+            p++;
+            return (UInt)(p + (opc == 0x81 ? (sz16 ? 2 : 4) : 1) - start);
+
+         /* mov Gb,Eb / Gv,Ev / Eb,Gb / Ev,Gv with register operands */
+         case 0x88: case 0x89: case 0x8A: case 0x8B:
+            if (!epartIsReg(*p))
+               return 0;
+            p++;
+            break;
+
+         /* lea, which doesn't access memory */
+         case 0x8D:
+            if (epartIsReg(*p))
+               return 0;
+            p += lengthModRM(p);
+            break;
+
+         /* nop */
+         case 0x90:
+            break;
+
+         /* mov imm8 to a byte register */
+         case 0xB0: case 0xB1: case 0xB2: case 0xB3:
+         case 0xB4: case 0xB5: case 0xB6: case 0xB7:
+            p += 1;
+            break;
+
+         /* mov imm16/imm32/imm64 to a register */
+         case 0xB8: case 0xB9: case 0xBA: case 0xBB:
+         case 0xBC: case 0xBD: case 0xBE: case 0xBF:
+            p += rexW ? 8 : sz16 ? 2 : 4;
+            break;
+
+         case 0x0F:
+            opc = *p++;
+            switch (opc) {
+               /* movzb, movzw, movsb, movsw with register operands */
+               case 0xB6: case 0xB7: case 0xBE: case 0xBF:
+                  if (!epartIsReg(*p))
+                     return 0;
+                  p++;
+                  break;
+               default:
+                  return 0;
+            }
+            break;
+
+         default:
+            return 0;
+      }
+   }
+
+   return 0;
+}
+
 
 /*------------------------------------------------------------*/
 /*--- Unused stuff                                         ---*/
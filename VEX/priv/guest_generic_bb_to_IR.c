@@ -1185,6 +1185,220 @@ static void add_extent ( /*MOD*/VexGuestExtents* vge, Addr base, UShort len )
 }
 
 
+/*--------------------------------------------------------------*/
+/*--- Removal of dead condition code writes                  ---*/
+/*--------------------------------------------------------------*/
+
+/* On guests with a lazily computed condition code (the x86-style "flags
+   thunk"), almost every instruction writes the condition code state to
+   the guest state, and iropt can only remove those writes when a later
+   one in the same superblock overwrites them.  At the superblock's exits
+   they must be kept, since the code jumped to might read them.  But very
+   often the code jumped to overwrites the condition code before reading
+   it, and in that case the writes are dead after all.
+
+   So, for each exit whose destination is known and which we would be
+   allowed to chase into, we ask the front end (via a CCDeadFn) whether
+   the condition code is dead at the destination.  Then a backwards pass
+   over the superblock removes PUTs to the condition code state for as
+   long as all later exits lead to such destinations and nothing in
+   between reads it.  The bytes examined at each destination relied on
+   are added to the extents, so that the translation is discarded, or
+   self-checked, if they change.  Hence this is limited by the number of
+   free extent slots. */
+
+typedef
+   struct {
+      UInt   n_used;  // # destinations examined
+      UInt   limit;   // max # destinations to examine
+      Addr   base[3]; // the destinations
+      UShort len[3];  // # bytes examined if CC dead there, else 0
+   }
+   CCDests;
+
+static Bool expr_reads_cc ( const IRExpr* e, Int offB_GUEST_CC,
+                            Int szB_GUEST_CC )
+{
+   switch (e->tag) {
+      case Iex_RdTmp:
+      case Iex_Const:
+         return False;
+      case Iex_Get:
+         return any_overlap(e->Iex.Get.offset, sizeofIRType(e->Iex.Get.ty),
+                            offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_Unop:
+         return expr_reads_cc(e->Iex.Unop.arg, offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_Binop:
+         return expr_reads_cc(e->Iex.Binop.arg1, offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Binop.arg2,
+                                 offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_Triop:
+         return expr_reads_cc(e->Iex.Triop.details->arg1,
+                              offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Triop.details->arg2,
+                                 offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Triop.details->arg3,
+                                 offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_Qop:
+         return expr_reads_cc(e->Iex.Qop.details->arg1,
+                              offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Qop.details->arg2,
+                                 offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Qop.details->arg3,
+                                 offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.Qop.details->arg4,
+                                 offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_ITE:
+         return expr_reads_cc(e->Iex.ITE.cond, offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.ITE.iftrue,
+                                 offB_GUEST_CC, szB_GUEST_CC)
+                || expr_reads_cc(e->Iex.ITE.iffalse,
+                                 offB_GUEST_CC, szB_GUEST_CC);
+      case Iex_CCall:
+         for (Int i = 0; e->Iex.CCall.args[i]; i++) {
+            if (expr_reads_cc(e->Iex.CCall.args[i],
+                              offB_GUEST_CC, szB_GUEST_CC))
+               return True;
+         }
+         return False;
+      case Iex_Load:
+         return expr_reads_cc(e->Iex.Load.addr, offB_GUEST_CC, szB_GUEST_CC);
+      default:
+         // GetI, and anything we don't know about.
+         return True;
+   }
+}
+
+// Is the condition code dead at the destination of an exit to |dst| with
+// jump kind |jk|?  If so, returns the index of the destination in |dests|,
+// else -1.
+static Int cc_dead_at_dest ( /*MOD*/CCDests* dests,
+                             const IRConst* dst, IRJumpKind jk,
+                             const UChar* guest_code,
+                             const Addr guest_IP_sbstart,
+                             const IRType guest_word_type,
+                             Bool (*chase_into_ok)(void*,Addr),
+                             void* callback_opaque,
+                             CCDeadFn cc_dead_fn )
+{
+   if (jk != Ijk_Boring && jk != Ijk_Call)
+      return -1;
+
+   Addr dst_ga = irconst_to_Addr(dst, guest_word_type);
+   for (UInt i = 0; i < dests->n_used; i++) {
+      if (dests->base[i] == dst_ga)
+         return dests->len[i] > 0 ? (Int)i : -1;
+   }
+   if (dests->n_used == dests->limit)
+      return -1;
+
+   Long delta = 0;
+   UInt len   = 0;
+   if (irconst_to_maybe_delta(&delta, dst, guest_IP_sbstart, guest_word_type,
+                              chase_into_ok, callback_opaque)) {
+      len = cc_dead_fn(guest_code, delta);
+   }
+   vassert(len <= 0xFF);
+
+   UInt i = dests->n_used++;
+   dests->base[i] = dst_ga;
+   dests->len[i]  = (UShort)len;
+   return len > 0 ? (Int)i : -1;
+}
+
+// Scan |irsb| backwards, finding PUTs to the condition code state which are
+// dead because every following exit goes to a destination in which the
+// condition code is dead.  If |doRemove|, replace them with no-ops.  Returns
+// the number of such PUTs, and in |destsUsed| a bitmask of the entries in
+// |dests| relied on.
+static UInt remove_dead_cc_PUTs ( /*MOD*/IRSB* irsb, Bool doRemove,
+                                  /*MOD*/CCDests* dests,
+                                  /*OUT*/UInt* destsUsed,
+                                  const UChar* guest_code,
+                                  const Addr guest_IP_sbstart,
+                                  const IRType guest_word_type,
+                                  Bool (*chase_into_ok)(void*,Addr),
+                                  void* callback_opaque,
+                                  CCDeadFn cc_dead_fn,
+                                  Int offB_GUEST_CC, Int szB_GUEST_CC )
+{
+   UInt n_removed = 0;
+   UInt deps      = 0; // the destinations that |dead| depends on
+   Int  dest      = -1;
+
+   *destsUsed = 0;
+
+   if (irsb->next->tag == Iex_Const) {
+      dest = cc_dead_at_dest(dests, irsb->next->Iex.Const.con, irsb->jumpkind,
+                             guest_code, guest_IP_sbstart, guest_word_type,
+                             chase_into_ok, callback_opaque, cc_dead_fn);
+   }
+   if (dest < 0)
+      return 0;
+   deps |= 1 << dest;
+
+   for (Int i = irsb->stmts_used - 1; i >= 0; i--) {
+      IRStmt* st   = irsb->stmts[i];
+      Bool    dead = True;
+      switch (st->tag) {
+         case Ist_NoOp: case Ist_IMark: case Ist_AbiHint: case Ist_MBE:
+            break;
+         case Ist_Put: {
+            Int offB = st->Ist.Put.offset;
+            Int szB  = sizeofIRType(typeOfIRExpr(irsb->tyenv,
+                                                 st->Ist.Put.data));
+            if (offB >= offB_GUEST_CC
+                && offB + szB <= offB_GUEST_CC + szB_GUEST_CC) {
+               if (doRemove)
+                  irsb->stmts[i] = IRStmt_NoOp();
+               n_removed++;
+               *destsUsed = deps;
+               break;
+            }
+            dead = !expr_reads_cc(st->Ist.Put.data,
+                                  offB_GUEST_CC, szB_GUEST_CC);
+            break;
+         }
+         case Ist_WrTmp:
+            dead = !expr_reads_cc(st->Ist.WrTmp.data,
+                                  offB_GUEST_CC, szB_GUEST_CC);
+            break;
+         case Ist_Store:
+            dead = !expr_reads_cc(st->Ist.Store.addr,
+                                  offB_GUEST_CC, szB_GUEST_CC)
+                   && !expr_reads_cc(st->Ist.Store.data,
+                                     offB_GUEST_CC, szB_GUEST_CC);
+            break;
+         case Ist_Exit:
+            if (expr_reads_cc(st->Ist.Exit.guard,
+                              offB_GUEST_CC, szB_GUEST_CC)) {
+               dead = False;
+               break;
+            }
+            dest = cc_dead_at_dest(dests, st->Ist.Exit.dst, st->Ist.Exit.jk,
+                                   guest_code, guest_IP_sbstart,
+                                   guest_word_type, chase_into_ok,
+                                   callback_opaque, cc_dead_fn);
+            if (dest < 0)
+               dead = False;
+            else
+               deps |= 1 << dest;
+            break;
+         default:
+            // PutI, dirty calls, guarded loads and stores, CAS, LL/SC.
+            // Possibly we could do better with some of these, but they
+            // are rare enough that it isn't worth it.
+            dead = False;
+            break;
+      }
+      if (!dead)
+         break;
+   }
+
+   return n_removed;
+}
+
+
 /*--------------------------------------------------------------*/
 /*--- Disassembly of traces: main function                   ---*/
 /*--------------------------------------------------------------*/
@@ -1223,6 +1437,16 @@ static void add_extent ( /*MOD*/VexGuestExtents* vge, Addr base, UShort len )
    guest_CMLEN.  Since this routine has to work for any guest state,
    without knowing what it is, those offsets have to passed in.
 
+   cc_dead_fn, if not NULL, is used to find out whether the guest's
+   condition code state, at offB_GUEST_CC for szB_GUEST_CC bytes, is
+   dead at the known destinations of the block's exits.  If so, writes
+   to it before those exits can be removed.
+
+   chase_cond_hint, if not NULL, is asked about each conditional branch
+   which could be chased.  If it names one of the two destinations,
+   that one is chased as if the branch were unconditional, and the
+   other stays a side exit.
+
    callback_opaque is a caller-supplied pointer to data which the
    callbacks may want to see.  Vex has no idea what it is.
    (In fact it's a VgInstrumentClosure.)
@@ -1276,6 +1500,7 @@ IRSB* bb_to_IR (
          /*IN*/ const UChar*     guest_code,
          /*IN*/ Addr             guest_IP_sbstart,
          /*IN*/ Bool             (*chase_into_ok)(void*,Addr),
+         /*IN*/ Addr             (*chase_cond_hint)(void*,Addr,Addr),
          /*IN*/ VexEndness       host_endness,
          /*IN*/ Bool             sigill_diag,
          /*IN*/ VexArch          arch_guest,
@@ -1289,7 +1514,10 @@ IRSB* bb_to_IR (
          /*IN*/ Int              offB_GUEST_CMSTART,
          /*IN*/ Int              offB_GUEST_CMLEN,
          /*IN*/ Int              offB_GUEST_IP,
-         /*IN*/ Int              szB_GUEST_IP
+         /*IN*/ Int              szB_GUEST_IP,
+         /*IN*/ CCDeadFn         cc_dead_fn,
+         /*IN*/ Int              offB_GUEST_CC,
+         /*IN*/ Int              szB_GUEST_CC
       )
 {
    Bool debug_print = toBool(vex_traceflags & VEX_TRACE_FE);
@@ -1468,6 +1696,56 @@ IRSB* bb_to_IR (
                              bb_instrs_used, bb_verbose_seen);
          *n_uncond_in_trace += 1;
       } // if (be.tag == Be_Uncond)
+
+      // If the client has observed that one destination of a conditional
+      // branch is taken nearly all of the time, follow that one, leaving the
+      // other as a side exit.  This is not speculative in the sense described
+      // above, so |sigill_diag| is used as is.
+      if (irsb_be.tag == Be_Cond && chase_cond_hint != NULL
+          && irsb_be.Be.Cond.deltaSX != irsb_be.Be.Cond.deltaFT) {
+         Addr ga_SX = (Addr)((Long)guest_IP_sbstart + irsb_be.Be.Cond.deltaSX);
+         Addr ga_FT = (Addr)((Long)guest_IP_sbstart + irsb_be.Be.Cond.deltaFT);
+         Addr ga_hot = chase_cond_hint(callback_opaque, ga_SX, ga_FT);
+         if (ga_hot != 0 && (ga_hot == ga_SX || ga_hot == ga_FT)) {
+            if (ga_hot == ga_SX)
+               swap_sx_and_ft(irsb, &irsb_be);
+            if (debug_print) {
+               vex_printf("\n-+-+ Profiled follow (ext# %d) to 0x%llx, "
+                          "side exit to 0x%llx -+-+\n\n",
+                          (Int)vge->n_used,
+                          (ULong)((Long)guest_IP_sbstart
+                                  + irsb_be.Be.Cond.deltaFT),
+                          (ULong)((Long)guest_IP_sbstart
+                                  + irsb_be.Be.Cond.deltaSX));
+            }
+            Int    bb_instrs_used  = 0;
+            Bool   bb_verbose_seen = False;
+            Addr   bb_base         = 0;
+            UShort bb_len          = 0;
+            IRSB*  bb
+               = disassemble_basic_block_till_stop(
+                    /*OUT*/ &bb_instrs_used, &bb_verbose_seen, &bb_base,
+                            &bb_len,
+                    /*MOD*/ emptyIRSB(),
+                    /*IN*/  irsb_be.Be.Cond.deltaFT,
+                    instrs_avail, guest_IP_sbstart, host_endness, sigill_diag,
+                    arch_guest, archinfo_guest, abiinfo_both, guest_word_type,
+                    debug_print, dis_instr_fn, guest_code, offB_GUEST_IP
+                 );
+            vassert(bb_instrs_used <= instrs_avail);
+
+            /* The side exit stays where it is; 'bb' continues the fall
+               through path. */
+            concatenate_irsbs(irsb, bb);
+
+            instrs_used += bb_instrs_used;
+            add_extent(vge, bb_base, bb_len);
+            update_instr_budget(&instrs_avail, &verbose_mode,
+                                bb_instrs_used, bb_verbose_seen);
+            *n_cond_in_trace += 1;
+            continue;
+         }
+      }
    
       // Try for an extend based on a conditional branch, specifically in the
       // hope of identifying and recovering, an "A && B" condition spread across
@@ -1674,6 +1952,34 @@ IRSB* bb_to_IR (
 
    } // while (True)
 
+   /* See if any condition code writes are dead because of what happens at
+      the exits.  This is done in two steps: find out whether it is worth
+      doing and which destinations it depends on, and add those to the
+      extents; then, once we know the final value of *pxControl, remove the
+      writes, unless the guest state has to be precise at memory accesses.
+      Since the guest state is then not quite up to date at the exits, this
+      is only done if asked for. */
+   CCDests cc_dests;
+   UInt    n_cc_dead = 0;
+   vex_bzero(&cc_dests, sizeof(cc_dests));
+   if (cc_dead_fn != NULL
+       && vex_control.guest_remove_dead_cc
+       && vex_control.iropt_level > 0
+       && *pxControl < VexRegUpdAllregsAtMemAccess) {
+      UInt cc_dests_used = 0;
+      cc_dests.limit = sizeof(vge->base) / sizeof(vge->base[0]) - vge->n_used;
+      n_cc_dead = remove_dead_cc_PUTs(
+                     irsb, False/*!doRemove*/, &cc_dests, &cc_dests_used,
+                     guest_code, guest_IP_sbstart, guest_word_type,
+                     chase_into_ok, callback_opaque, cc_dead_fn,
+                     offB_GUEST_CC, szB_GUEST_CC
+                  );
+      for (UInt i = 0; i < cc_dests.n_used; i++) {
+         if (cc_dests_used & (1 << i))
+            add_extent(vge, cc_dests.base[i], cc_dests.len[i]);
+      }
+   }
+
    /* We're almost done.  The only thing that might need attending to is that
       a self-checking preamble may need to be created.  If so it gets placed
       in the 21 slots reserved above. */
@@ -1683,6 +1989,21 @@ IRSB* bb_to_IR (
       offB_GUEST_CMLEN, offB_GUEST_IP, guest_IP_sbstart
    );
 
+   if (n_cc_dead > 0 && *pxControl < VexRegUpdAllregsAtMemAccess) {
+      UInt cc_dests_used = 0;
+      UInt n_removed = remove_dead_cc_PUTs(
+                          irsb, True/*doRemove*/, &cc_dests, &cc_dests_used,
+                          guest_code, guest_IP_sbstart, guest_word_type,
+                          chase_into_ok, callback_opaque, cc_dead_fn,
+                          offB_GUEST_CC, szB_GUEST_CC
+                       );
+      vassert(n_removed == n_cc_dead);
+      if (debug_print) {
+         vex_printf("\n-+-+ Removed %u dead condition code PUTs -+-+\n\n",
+                    n_removed);
+      }
+   }
+
    *n_guest_instrs = instrs_used;
    return irsb;
 }
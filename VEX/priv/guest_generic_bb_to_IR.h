@@ -133,6 +133,35 @@ typedef
    );
 
 
+/* ---------------------------------------------------------------
+   The type of a function which checks condition code liveness.
+   --------------------------------------------------------------- */
+
+/* A function of this type (CCDeadFn) examines the code at host address
+   &guest_code[delta] and decides whether the guest's condition code
+   state -- the part of the guest state passed to bb_to_IR as
+   offB_GUEST_CC and szB_GUEST_CC -- is dead there.  That is, it is
+   completely overwritten before any of it is read, and before anything
+   happens that might require it to be valid.  If so, the function
+   returns the number of bytes it had to examine to decide, which must
+   be greater than zero.  Otherwise, or in case of doubt, it returns
+   zero.  It must not read beyond the end of the page containing
+   &guest_code[delta].
+*/
+
+typedef
+
+   UInt (*CCDeadFn) ( 
+
+      /* Where is the guest code? */
+      /*IN*/  const UChar* guest_code,
+
+      /* Where does the block start?  Note: it's at &guest_code[delta] */
+      /*IN*/  Long         delta
+
+   );
+
+
 /* ---------------------------------------------------------------
    Top-level BB to IR conversion fn.
    --------------------------------------------------------------- */
@@ -151,6 +180,7 @@ IRSB* bb_to_IR (
          /*IN*/ const UChar*     guest_code,
          /*IN*/ Addr             guest_IP_bbstart,
          /*IN*/ Bool             (*chase_into_ok)(void*,Addr),
+         /*IN*/ Addr             (*chase_cond_hint)(void*,Addr,Addr),
          /*IN*/ VexEndness       host_endness,
          /*IN*/ Bool             sigill_diag,
          /*IN*/ VexArch          arch_guest,
@@ -164,7 +194,10 @@ IRSB* bb_to_IR (
          /*IN*/ Int              offB_GUEST_CMSTART,
          /*IN*/ Int              offB_GUEST_CMLEN,
          /*IN*/ Int              offB_GUEST_IP,
-         /*IN*/ Int              szB_GUEST_IP
+         /*IN*/ Int              szB_GUEST_IP,
+         /*IN*/ CCDeadFn         cc_dead_fn,
+         /*IN*/ Int              offB_GUEST_CC,
+         /*IN*/ Int              szB_GUEST_CC
       );
 
 
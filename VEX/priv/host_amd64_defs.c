@@ -588,6 +588,19 @@ const HChar* showAMD64SseOp ( AMD64SseOp op ) {
       case Asse_UNPCKLQ:  return "punpcklq";
       case Asse_PSHUFB:   return "pshufb";
       case Asse_PMADDUBSW: return "pmaddubsw";
+      case Asse_MUL32:    return "pmulld";
+      case Asse_MAX32S:   return "pmaxsd";
+      case Asse_MAX32U:   return "pmaxud";
+      case Asse_MAX16U:   return "pmaxuw";
+      case Asse_MAX8S:    return "pmaxsb";
+      case Asse_MIN32S:   return "pminsd";
+      case Asse_MIN32U:   return "pminud";
+      case Asse_MIN16U:   return "pminuw";
+      case Asse_MIN8S:    return "pminsb";
+      case Asse_CMPEQ64:  return "pcmpeqq";
+      case Asse_PACKUSD:  return "packusdw";
+      case Asse_CMPGT64S: return "pcmpgtq";
+      case Asse_PERMILPS: return "vpermilps";
       case Asse_F32toF16: return "vcvtps2ph(rm_field=$0x4).";
       case Asse_F16toF32: return "vcvtph2ps.";
       case Asse_VFMADD213: return "vfmadd213";
@@ -1079,6 +1092,18 @@ AMD64Instr* AMD64Instr_Avx64FLo ( AMD64SseOp op, HReg src1, HReg src2, HReg dst
    return i;
 }
 
+AMD64Instr* AMD64Instr_Avx128ReRg ( AMD64SseOp op,
+                                   HReg src1, HReg src2, HReg dst ) {
+   AMD64Instr* i          = LibVEX_Alloc_inline(sizeof(AMD64Instr));
+   i->tag                 = Ain_Avx128ReRg;
+   i->Ain.Avx128ReRg.op   = op;
+   i->Ain.Avx128ReRg.src1 = src1;
+   i->Ain.Avx128ReRg.src2 = src2;
+   i->Ain.Avx128ReRg.dst  = dst;
+   vassert(op != Asse_MOV);
+   return i;
+}
+
 AMD64Instr* AMD64Instr_EvCheck ( AMD64AMode* amCounter,
                                  AMD64AMode* amFailAddr ) {
    AMD64Instr* i             = LibVEX_Alloc_inline(sizeof(AMD64Instr));
@@ -1473,6 +1498,14 @@ void ppAMD64Instr ( const AMD64Instr* i, Bool mode64 )
          vex_printf(",");
          ppHRegAMD64(i->Ain.Avx64FLo.dst);
          return;
+      case Ain_Avx128ReRg:
+         vex_printf("%s ", showAMD64SseOp(i->Ain.Avx128ReRg.op));
+         ppHRegAMD64(i->Ain.Avx128ReRg.src2);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx128ReRg.src1);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx128ReRg.dst);
+         return;
       case Ain_EvCheck:
          vex_printf("(evCheck) decl ");
          ppAMD64AMode(i->Ain.EvCheck.amCounter);
@@ -1841,6 +1874,12 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, const AMD64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead, i->Ain.Avx64FLo.src2);
          addHRegUse(u, HRmModify, i->Ain.Avx64FLo.dst);
          return;
+      case Ain_Avx128ReRg:
+         vassert(i->Ain.Avx128ReRg.op != Asse_MOV);
+         addHRegUse(u, HRmRead, i->Ain.Avx128ReRg.src1);
+         addHRegUse(u, HRmRead, i->Ain.Avx128ReRg.src2);
+         addHRegUse(u, HRmWrite, i->Ain.Avx128ReRg.dst);
+         return;
       case Ain_EvCheck:
          /* We expect both amodes only to mention %rbp, so this is in
             fact pointless, since %rbp isn't allocatable, but anyway.. */
@@ -2060,6 +2099,11 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.Avx64FLo.src2);
          mapReg(m, &i->Ain.Avx64FLo.dst);
          return;
+      case Ain_Avx128ReRg:
+         mapReg(m, &i->Ain.Avx128ReRg.src1);
+         mapReg(m, &i->Ain.Avx128ReRg.src2);
+         mapReg(m, &i->Ain.Avx128ReRg.dst);
+         return;
       case Ain_EvCheck:
          /* We expect both amodes only to mention %rbp, so this is in
             fact pointless, since %rbp isn't allocatable, but anyway.. */
@@ -2136,6 +2180,47 @@ AMD64Instr* genMove_AMD64(HReg from, HReg to, Bool mode64)
    }
 }
 
+/* Generate an instruction writing to |dst| the value that |i| writes,
+   for rematerialisation by the register allocator, or NULL if |i| is
+   not a constant load, a load of a guest state address or a vector
+   zeroing idiom.  Like spills and reloads, these must not write the
+   condition codes. */
+AMD64Instr* genRemat_AMD64 ( const AMD64Instr* i, HReg dst, Bool mode64 )
+{
+   vassert(mode64 == True);
+   switch (i->tag) {
+      case Ain_Imm64:
+         return AMD64Instr_Imm64(i->Ain.Imm64.imm64, dst);
+      case Ain_Alu64R:
+         if (i->Ain.Alu64R.op == Aalu_MOV
+             && i->Ain.Alu64R.src->tag == Armi_Imm) {
+            return AMD64Instr_Alu64R(
+                      Aalu_MOV, AMD64RMI_Imm(i->Ain.Alu64R.src->Armi.Imm.imm32),
+                      dst);
+         }
+         break;
+      case Ain_Lea64: {
+         const AMD64AMode* am = i->Ain.Lea64.am;
+         if (am->tag == Aam_IR
+             && sameHReg(am->Aam.IR.reg, hregAMD64_RBP())) {
+            return AMD64Instr_Lea64(
+                      AMD64AMode_IR(am->Aam.IR.imm, hregAMD64_RBP()), dst);
+         }
+         break;
+      }
+      case Ain_SseReRg:
+         if ((i->Ain.SseReRg.op == Asse_XOR
+              || i->Ain.SseReRg.op == Asse_CMPEQ32)
+             && sameHReg(i->Ain.SseReRg.src, i->Ain.SseReRg.dst)) {
+            return AMD64Instr_SseReRg(i->Ain.SseReRg.op, dst, dst);
+         }
+         break;
+      default:
+         break;
+   }
+   return NULL;
+}
+
 AMD64Instr* directReload_AMD64( AMD64Instr* i, HReg vreg, Short spill_off )
 {
    vassert(spill_off >= 0 && spill_off < 10000); /* let's say */
@@ -2173,6 +2258,74 @@ AMD64Instr* directReload_AMD64( AMD64Instr* i, HReg vreg, Short spill_off )
    return NULL;
 }
 
+/* Hot/cold splitting.  If |i| is a conditional exit, or a conditional
+   helper call that needs no fixup when not taken, return an
+   unconditional copy of it, to be emitted out of line in the cold
+   part of the translation, and set *needsJumpBack if control returns
+   from it to the instruction following |i|.  Otherwise return NULL,
+   and |i| is emitted inline as usual. */
+AMD64Instr* genColdPart_AMD64 ( const AMD64Instr* i,
+                                /*OUT*/Bool* needsJumpBack, Bool mode64 )
+{
+   vassert(mode64 == True);
+   *needsJumpBack = False;
+   switch (i->tag) {
+      case Ain_Call:
+         if (i->Ain.Call.cond == Acc_ALWAYS
+             || i->Ain.Call.rloc.pri != RLPri_None)
+            break;
+         *needsJumpBack = True;
+         return AMD64Instr_Call(Acc_ALWAYS, i->Ain.Call.target,
+                                i->Ain.Call.regparms, i->Ain.Call.rloc);
+      case Ain_XDirect:
+         if (i->Ain.XDirect.cond == Acc_ALWAYS)
+            break;
+         return AMD64Instr_XDirect(i->Ain.XDirect.dstGA, i->Ain.XDirect.amRIP,
+                                   Acc_ALWAYS, i->Ain.XDirect.toFastEP);
+      case Ain_XIndir:
+         if (i->Ain.XIndir.cond == Acc_ALWAYS)
+            break;
+         return AMD64Instr_XIndir(i->Ain.XIndir.dstGA, i->Ain.XIndir.amRIP,
+                                  Acc_ALWAYS);
+      case Ain_XAssisted:
+         if (i->Ain.XAssisted.cond == Acc_ALWAYS)
+            break;
+         return AMD64Instr_XAssisted(i->Ain.XAssisted.dstGA,
+                                     i->Ain.XAssisted.amRIP,
+                                     Acc_ALWAYS, i->Ain.XAssisted.jk);
+      default:
+         break;
+   }
+   return NULL;
+}
+
+/* Emit the jump between the hot and cold parts of a translation:
+   "jcc rel32" on the condition of |i|, an instruction for which
+   genColdPart_AMD64 returned non-NULL, or "jmp rel32" if |i| is NULL.
+   The displacement is left as zero; it is the last four bytes of the
+   instruction, little-endian and relative to the end of it. */
+Int emitColdJump_AMD64 ( UChar* buf, const AMD64Instr* i )
+{
+   UChar* p = &buf[0];
+   AMD64CondCode cond = Acc_ALWAYS;
+   if (i) {
+      switch (i->tag) {
+         case Ain_Call:      cond = i->Ain.Call.cond;      break;
+         case Ain_XDirect:   cond = i->Ain.XDirect.cond;   break;
+         case Ain_XIndir:    cond = i->Ain.XIndir.cond;    break;
+         case Ain_XAssisted: cond = i->Ain.XAssisted.cond; break;
+         default: vpanic("emitColdJump_AMD64");
+      }
+      vassert(cond != Acc_ALWAYS);
+      *p++ = 0x0F;
+      *p++ = toUChar(0x80 + (0xF & cond));
+   } else {
+      *p++ = 0xE9;
+   }
+   *p++ = 0; *p++ = 0; *p++ = 0; *p++ = 0;
+   return p - &buf[0];
+}
+
 
 /* --------- The amd64 assembler (bleh.) --------- */
 
@@ -4023,6 +4176,30 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
                              XX(0x0F); XX(0x38); XX(0x00); break;
          case Asse_PMADDUBSW:XX(0x66); XX(rex);
                              XX(0x0F); XX(0x38); XX(0x04); break;
+         case Asse_MIN8S:    XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x38); break;
+         case Asse_MIN32S:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x39); break;
+         case Asse_MIN16U:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3A); break;
+         case Asse_MIN32U:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3B); break;
+         case Asse_MAX8S:    XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3C); break;
+         case Asse_MAX32S:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3D); break;
+         case Asse_MAX16U:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3E); break;
+         case Asse_MAX32U:   XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x3F); break;
+         case Asse_MUL32:    XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x40); break;
+         case Asse_CMPEQ64:  XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x29); break;
+         case Asse_PACKUSD:  XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x2B); break;
+         case Asse_CMPGT64S: XX(0x66); XX(rex);
+                             XX(0x0F); XX(0x38); XX(0x37); break;
          default: goto bad;
       }
       p = doAMode_R_enc_enc(p, vregEnc3210(i->Ain.SseReRg.dst),
@@ -4168,6 +4345,29 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       *p++ = (1<<7) | (1<<6) | ((d&7) << 3) | ((s&7) << 0);
       goto done;
    }
+   case Ain_Avx128ReRg: {
+      UInt d = vregEnc3210(i->Ain.Avx128ReRg.dst);
+      UInt v = vregEnc3210(i->Ain.Avx128ReRg.src1);
+      UInt s = vregEnc3210(i->Ain.Avx128ReRg.src2);
+      UInt m = 2, pp = 1;
+      UInt opcode;
+      switch (i->Ain.Avx128ReRg.op) {
+         case Asse_PERMILPS:
+            // VPERMILPS %xmmS2, %xmmS1, %xmmD (xmm regs range 0 .. 15)
+            opcode = 0x0c;
+            break;
+         default:
+            goto bad;
+      }
+      // 0xC4 : ~d3 1 ~s3 o4 o3 o2 o1 o0 : 0 ~v3 ~v2 ~v1 ~v0 0 p1 p0 : opcode_byte
+      //      :   1 1  d2 d1 d0 s2 s1 s0
+      *p++ = 0xC4; // 3-byte VEX
+      *p++ = ((((~d)>>3)&1)<<7) | (1<<6) | ((((~s)>>3)&1)<<5) | m;
+      *p++ = ((~v&0x0f) << 3) | pp;
+      *p++ = opcode;
+      *p++ = (1<<7) | (1<<6) | ((d&7) << 3) | ((s&7) << 0);
+      goto done;
+   }
 
    case Ain_EvCheck: {
       /* We generate:
@@ -4248,6 +4448,104 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
 }
 
 
+/* Indirect-branch inline caches.  An XIndir may instead be emitted as
+   a short list of (guest address, host address) entries, each of
+   which is compared against the destination, followed by a call to
+   disp_cp_xindir_miss.  The miss handler fills in the first empty
+   entry with the translation for the destination, and once all are
+   full, the call is patched into a jump to disp_cp_xindir.  An empty
+   entry has guest address zero and jumps to disp_cp_xindir, so that
+   it is harmless even if it matches.  Everything after the store of
+   the destination to the guest RIP has a fixed size, so the entries
+   can be found from the return address of the miss call:
+
+      entry, AMD64_IC_N_ENTRIES times:
+        movabsq $guest_addr, %r11      49 BB <8 bytes>
+        cmpq    %r11, dstGA            4C/4D 39 <modrm>
+        jne     next entry             75 0D
+        movabsq $host_addr, %r11       49 BB <8 bytes>
+        jmpq    *%r11                  41 FF E3
+      miss:
+        movabsq $disp_cp_xindir_miss, %r11
+        call    *%r11                  41 FF D3
+*/
+#define AMD64_IC_N_ENTRIES 2
+#define AMD64_IC_ENTRY_SZB 28
+#define AMD64_IC_MISS_SZB  13
+
+/* Emit |i| with an inline cache, if it is an XIndir, and return the
+   number of bytes emitted.  Return zero for anything else. */
+Int emitXIndirIC_AMD64 ( UChar* buf, Int nbuf, const AMD64Instr* i,
+                         const void* disp_cp_xindir,
+                         const void* disp_cp_xindir_miss )
+{
+   UChar* p    = &buf[0];
+   UChar* ptmp = NULL;
+   Int    k;
+
+   if (i->tag != Ain_XIndir)
+      return 0;
+
+   vassert(nbuf >= 128);
+   vassert(disp_cp_xindir != NULL);
+   vassert(disp_cp_xindir_miss != NULL);
+
+   if (i->Ain.XIndir.cond != Acc_ALWAYS) {
+      /* jmp fwds if !condition */
+      *p++ = toUChar(0x70 + (0xF & (i->Ain.XIndir.cond ^ 1)));
+      ptmp = p; /* fill in this bit later */
+      *p++ = 0;
+   }
+
+   /* movq dstGA(a reg), amRIP -- as for the plain XIndir */
+   *p++ = rexAMode_M(i->Ain.XIndir.dstGA, i->Ain.XIndir.amRIP);
+   *p++ = 0x89;
+   p = doAMode_M(p, i->Ain.XIndir.dstGA, i->Ain.XIndir.amRIP);
+
+   for (k = 0; k < AMD64_IC_N_ENTRIES; k++) {
+      UChar* entry = p;
+      /* movabsq $0, %r11 */
+      *p++ = 0x49;
+      *p++ = 0xBB;
+      p = emit64(p, 0);
+      /* cmpq %r11, dstGA */
+      *p++ = rexAMode_R(hregAMD64_R11(), i->Ain.XIndir.dstGA);
+      *p++ = 0x39;
+      p = doAMode_R(p, hregAMD64_R11(), i->Ain.XIndir.dstGA);
+      /* jne next entry */
+      *p++ = 0x75;
+      *p++ = 13;
+      /* movabsq $disp_cp_xindir, %r11 */
+      *p++ = 0x49;
+      *p++ = 0xBB;
+      p = emit64(p, (Addr)disp_cp_xindir);
+      /* jmp *%r11 */
+      *p++ = 0x41;
+      *p++ = 0xFF;
+      *p++ = 0xE3;
+      vassert(p - entry == AMD64_IC_ENTRY_SZB);
+   }
+
+   /* movabsq $disp_cp_xindir_miss, %r11 */
+   *p++ = 0x49;
+   *p++ = 0xBB;
+   p = emit64(p, (Addr)disp_cp_xindir_miss);
+   /* call *%r11 */
+   *p++ = 0x41;
+   *p++ = 0xFF;
+   *p++ = 0xD3;
+
+   /* Fix up the conditional jump, if there was one. */
+   if (i->Ain.XIndir.cond != Acc_ALWAYS) {
+      Int delta = p - ptmp;
+      vassert(delta > 0 && delta < 128);
+      *ptmp = toUChar(delta-1);
+   }
+   vassert(p - &buf[0] <= nbuf);
+   return p - &buf[0];
+}
+
+
 /* How big is an event check?  See case for Ain_EvCheck in
    emit_AMD64Instr just above.  That crosschecks what this returns, so
    we can tell if we're inconsistent. */
@@ -4411,6 +4709,107 @@ VexInvalRange unchainXDirect_AMD64 ( VexEndness endness_host,
 }
 
 
+/* Is |p| an inline cache entry, as emitted by emitXIndirIC_AMD64? */
+static Bool isXIndirICEntry_AMD64 ( const UChar* p )
+{
+   return p[0] == 0x49 && p[1] == 0xBB
+          && (p[10] == 0x4C || p[10] == 0x4D) && p[11] == 0x39
+          && p[13] == 0x75 && p[14] == 13
+          && p[15] == 0x49 && p[16] == 0xBB
+          && p[25] == 0x41 && p[26] == 0xFF && p[27] == 0xE3;
+}
+
+/* NB: what goes on here has to be very closely coordinated with
+   emitXIndirIC_AMD64, above.  |place_to_patch| is the miss call of an
+   inline cache that has at least one empty entry.  Fill the first
+   empty one, so that |guest_addr| goes to |place_to_jump_to|, and
+   return its address in *entry.  If no empty entries are left, turn
+   the miss call into a jump to disp_cp_xindir. */
+VexInvalRange patchXIndirIC_AMD64 ( VexEndness endness_host,
+                                    void* place_to_patch,
+                                    const void* disp_cp_xindir_miss_EXPECTED,
+                                    const void* disp_cp_xindir,
+                                    Addr guest_addr,
+                                    const void* place_to_jump_to,
+                                    /*OUT*/void** entry )
+{
+   vassert(endness_host == VexEndnessLE);
+
+   UChar* m = (UChar*)place_to_patch;
+   vassert(m[0] == 0x49);
+   vassert(m[1] == 0xBB);
+   vassert(read_misaligned_ULong_LE(&m[2])
+           == (Addr)disp_cp_xindir_miss_EXPECTED);
+   vassert(m[10] == 0x41);
+   vassert(m[11] == 0xFF);
+   vassert(m[12] == 0xD3);
+
+   UChar* first = m - AMD64_IC_N_ENTRIES * AMD64_IC_ENTRY_SZB;
+   UChar* e     = NULL;
+   Int    n_empty = 0;
+   Int    k;
+   for (k = 0; k < AMD64_IC_N_ENTRIES; k++) {
+      UChar* p = first + k * AMD64_IC_ENTRY_SZB;
+      vassert(isXIndirICEntry_AMD64(p));
+      if (read_misaligned_ULong_LE(&p[17]) == (Addr)disp_cp_xindir) {
+         if (e == NULL)
+            e = p;
+         n_empty++;
+      }
+   }
+   vassert(e != NULL);
+
+   write_misaligned_ULong_LE(&e[2], (ULong)guest_addr);
+   write_misaligned_ULong_LE(&e[17], (ULong)(Addr)place_to_jump_to);
+   if (n_empty == 1) {
+      /* movabsq $disp_cp_xindir, %r11; jmpq *%r11 */
+      write_misaligned_ULong_LE(&m[2], (ULong)(Addr)disp_cp_xindir);
+      m[12] = 0xE3;
+   }
+   *entry = e;
+   VexInvalRange vir = { (HWord)e, (HWord)(m + AMD64_IC_MISS_SZB - e) };
+   return vir;
+}
+
+
+/* Empty the inline cache entry at |place_to_unpatch|, which must
+   currently jump to |place_to_jump_to_EXPECTED|, and make sure the
+   cache's miss path calls disp_cp_xindir_miss again, so that the
+   entry can be refilled. */
+VexInvalRange unpatchXIndirIC_AMD64 ( VexEndness endness_host,
+                                      void* place_to_unpatch,
+                                      const void* place_to_jump_to_EXPECTED,
+                                      const void* disp_cp_xindir,
+                                      const void* disp_cp_xindir_miss )
+{
+   vassert(endness_host == VexEndnessLE);
+
+   UChar* e = (UChar*)place_to_unpatch;
+   vassert(isXIndirICEntry_AMD64(e));
+   vassert(read_misaligned_ULong_LE(&e[17])
+           == (Addr)place_to_jump_to_EXPECTED);
+
+   /* Find the miss path, which follows the last entry. */
+   UChar* m = e + AMD64_IC_ENTRY_SZB;
+   while (isXIndirICEntry_AMD64(m))
+      m += AMD64_IC_ENTRY_SZB;
+   vassert(m - e <= AMD64_IC_N_ENTRIES * AMD64_IC_ENTRY_SZB);
+   vassert(m[0] == 0x49);
+   vassert(m[1] == 0xBB);
+   vassert(m[10] == 0x41);
+   vassert(m[11] == 0xFF);
+   vassert(m[12] == 0xD3 || m[12] == 0xE3);
+
+   write_misaligned_ULong_LE(&e[2], 0);
+   write_misaligned_ULong_LE(&e[17], (ULong)(Addr)disp_cp_xindir);
+   /* movabsq $disp_cp_xindir_miss, %r11; call *%r11 */
+   write_misaligned_ULong_LE(&m[2], (ULong)(Addr)disp_cp_xindir_miss);
+   m[12] = 0xD3;
+   VexInvalRange vir = { (HWord)e, (HWord)(m + AMD64_IC_MISS_SZB - e) };
+   return vir;
+}
+
+
 /* Patch the counter address into a profile inc point, as previously
    created by the Ain_ProfInc case for emit_AMD64Instr. */
 VexInvalRange patchProfInc_AMD64 ( VexEndness endness_host,
@@ -344,6 +344,16 @@ typedef
       // Only for SSSE3 capable hosts:
       Asse_PSHUFB,
       Asse_PMADDUBSW,
+      // Only for SSE4.1 capable hosts:
+      Asse_MUL32,
+      Asse_MAX32S, Asse_MAX32U, Asse_MAX16U, Asse_MAX8S,
+      Asse_MIN32S, Asse_MIN32U, Asse_MIN16U, Asse_MIN8S,
+      Asse_CMPEQ64,
+      Asse_PACKUSD,
+      // Only for SSE4.2 capable hosts:
+      Asse_CMPGT64S,
+      // Only for AVX capable hosts:
+      Asse_PERMILPS, // variable dword permute, aka vpermilps
       // Only for F16C capable hosts:
       Asse_F32toF16, // F32 to F16 conversion, aka vcvtps2ph
       Asse_F16toF32, // F16 to F32 conversion, aka vcvtph2ps
@@ -416,6 +426,7 @@ typedef
       //uu Ain_AvxReRg,     /* AVX binary general reg-reg, Re, Rg */
       Ain_Avx32FLo,    /* AVX binary 3 operand, 32F in lowest lane only */
       Ain_Avx64FLo,    /* AVX binary 3 operand, 64F in lowest lane only */
+      Ain_Avx128ReRg,  /* AVX binary 3 operand, 128 bit, dst is written */
       Ain_EvCheck,     /* Event check */
       Ain_ProfInc      /* 64-bit profile counter increment */
    }
@@ -745,6 +756,12 @@ typedef
             HReg       src2;
             HReg       dst;
          } Avx64FLo;
+         struct {
+            AMD64SseOp op;
+            HReg       src1;
+            HReg       src2;
+            HReg       dst;
+         } Avx128ReRg;
          struct {
             AMD64AMode* amCounter;
             AMD64AMode* amFailAddr;
@@ -821,6 +838,7 @@ extern AMD64Instr* AMD64Instr_SseMOVQ    ( HReg gpr, HReg xmm, Bool toXMM );
 //uu extern AMD64Instr* AMD64Instr_AvxReRg    ( AMD64SseOp, HReg, HReg );
 extern AMD64Instr* AMD64Instr_Avx32FLo   ( AMD64SseOp, HReg, HReg, HReg );
 extern AMD64Instr* AMD64Instr_Avx64FLo   ( AMD64SseOp, HReg, HReg, HReg );
+extern AMD64Instr* AMD64Instr_Avx128ReRg ( AMD64SseOp, HReg, HReg, HReg );
 extern AMD64Instr* AMD64Instr_EvCheck    ( AMD64AMode* amCounter,
                                            AMD64AMode* amFailAddr );
 extern AMD64Instr* AMD64Instr_ProfInc    ( void );
@@ -849,6 +867,10 @@ extern void genReload_AMD64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
 extern AMD64Instr* genMove_AMD64(HReg from, HReg to, Bool);
 extern AMD64Instr* directReload_AMD64 ( AMD64Instr* i,
                                         HReg vreg, Short spill_off );
+extern AMD64Instr* genRemat_AMD64 ( const AMD64Instr* i, HReg dst, Bool );
+extern AMD64Instr* genColdPart_AMD64 ( const AMD64Instr* i,
+                                       /*OUT*/Bool* needsJumpBack, Bool );
+extern Int         emitColdJump_AMD64 ( UChar* buf, const AMD64Instr* i );
 
 extern const RRegUniverse* getRRegUniverse_AMD64 ( void );
 
@@ -880,6 +902,26 @@ extern VexInvalRange unchainXDirect_AMD64 ( VexEndness endness_host,
                                             const void* place_to_jump_to_EXPECTED,
                                             const void* disp_cp_chain_me );
 
+/* Emit an XIndir with an inline cache, and fill in and empty entries
+   of the cache. */
+extern Int emitXIndirIC_AMD64 ( UChar* buf, Int nbuf, const AMD64Instr* i,
+                                const void* disp_cp_xindir,
+                                const void* disp_cp_xindir_miss );
+
+extern VexInvalRange patchXIndirIC_AMD64 ( VexEndness endness_host,
+                                           void* place_to_patch,
+                                           const void* disp_cp_xindir_miss_EXPECTED,
+                                           const void* disp_cp_xindir,
+                                           Addr guest_addr,
+                                           const void* place_to_jump_to,
+                                           /*OUT*/void** entry );
+
+extern VexInvalRange unpatchXIndirIC_AMD64 ( VexEndness endness_host,
+                                             void* place_to_unpatch,
+                                             const void* place_to_jump_to_EXPECTED,
+                                             const void* disp_cp_xindir,
+                                             const void* disp_cp_xindir_miss );
+
 /* Patch the counter location into an existing ProfInc point. */
 extern VexInvalRange patchProfInc_AMD64 ( VexEndness endness_host,
                                           void*  place_to_patch,
@@ -3873,39 +3873,92 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, const IRExpr* e )
          return dst;
       }
 
-      case Iop_Mul32x4:    fn = (HWord)h_generic_calc_Mul32x4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max32Sx4:   fn = (HWord)h_generic_calc_Max32Sx4;
-                           goto do_SseAssistedBinary;
-      case Iop_Min32Sx4:   fn = (HWord)h_generic_calc_Min32Sx4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max32Ux4:   fn = (HWord)h_generic_calc_Max32Ux4;
-                           goto do_SseAssistedBinary;
-      case Iop_Min32Ux4:   fn = (HWord)h_generic_calc_Min32Ux4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max16Ux8:   fn = (HWord)h_generic_calc_Max16Ux8;
-                           goto do_SseAssistedBinary;
-      case Iop_Min16Ux8:   fn = (HWord)h_generic_calc_Min16Ux8;
-                           goto do_SseAssistedBinary;
-      case Iop_Max8Sx16:   fn = (HWord)h_generic_calc_Max8Sx16;
-                           goto do_SseAssistedBinary;
-      case Iop_Min8Sx16:   fn = (HWord)h_generic_calc_Min8Sx16;
-                           goto do_SseAssistedBinary;
-      case Iop_CmpEQ64x2:  fn = (HWord)h_generic_calc_CmpEQ64x2;
-                           goto do_SseAssistedBinary;
-      case Iop_CmpGT64Sx2: fn = (HWord)h_generic_calc_CmpGT64Sx2;
-                           goto do_SseAssistedBinary;
-      case Iop_Perm32x4:   fn = (HWord)h_generic_calc_Perm32x4;
-                           goto do_SseAssistedBinary;
+      /* These have single instructions on SSE4.1 capable hosts, and
+         otherwise need a helper call. */
+      case Iop_Mul32x4:    op = Asse_MUL32;
+                           fn = (HWord)h_generic_calc_Mul32x4;
+                           goto do_Sse41Binary;
+      case Iop_Max32Sx4:   op = Asse_MAX32S;
+                           fn = (HWord)h_generic_calc_Max32Sx4;
+                           goto do_Sse41Binary;
+      case Iop_Min32Sx4:   op = Asse_MIN32S;
+                           fn = (HWord)h_generic_calc_Min32Sx4;
+                           goto do_Sse41Binary;
+      case Iop_Max32Ux4:   op = Asse_MAX32U;
+                           fn = (HWord)h_generic_calc_Max32Ux4;
+                           goto do_Sse41Binary;
+      case Iop_Min32Ux4:   op = Asse_MIN32U;
+                           fn = (HWord)h_generic_calc_Min32Ux4;
+                           goto do_Sse41Binary;
+      case Iop_Max16Ux8:   op = Asse_MAX16U;
+                           fn = (HWord)h_generic_calc_Max16Ux8;
+                           goto do_Sse41Binary;
+      case Iop_Min16Ux8:   op = Asse_MIN16U;
+                           fn = (HWord)h_generic_calc_Min16Ux8;
+                           goto do_Sse41Binary;
+      case Iop_Max8Sx16:   op = Asse_MAX8S;
+                           fn = (HWord)h_generic_calc_Max8Sx16;
+                           goto do_Sse41Binary;
+      case Iop_Min8Sx16:   op = Asse_MIN8S;
+                           fn = (HWord)h_generic_calc_Min8Sx16;
+                           goto do_Sse41Binary;
+      case Iop_CmpEQ64x2:  op = Asse_CMPEQ64;
+                           fn = (HWord)h_generic_calc_CmpEQ64x2;
+                           goto do_Sse41Binary;
       case Iop_QNarrowBin32Sto16Ux8:
+                           op = Asse_PACKUSD; arg1isEReg = True;
                            fn = (HWord)h_generic_calc_QNarrowBin32Sto16Ux8;
-                           goto do_SseAssistedBinary;
+                           goto do_Sse41Binary;
+      do_Sse41Binary:
+         if (env->hwcaps & VEX_HWCAPS_AMD64_SSE41)
+            goto do_SseReRg;
+         goto do_SseAssistedBinary;
+
+      case Iop_CmpGT64Sx2:
+         /* pcmpgtq is SSE4.2.  We don't have a capability for that, but
+            every AVX capable host has it. */
+         if (env->hwcaps & VEX_HWCAPS_AMD64_AVX) {
+            op = Asse_CMPGT64S;
+            goto do_SseReRg;
+         }
+         fn = (HWord)h_generic_calc_CmpGT64Sx2;
+         goto do_SseAssistedBinary;
+
+      case Iop_Perm32x4:
+         if (env->hwcaps & VEX_HWCAPS_AMD64_AVX) {
+            HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
+            HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+            HReg dst  = newVRegV(env);
+            addInstr(env, AMD64Instr_Avx128ReRg(Asse_PERMILPS,
+                                                argL, argR, dst));
+            return dst;
+         }
+         fn = (HWord)h_generic_calc_Perm32x4;
+         goto do_SseAssistedBinary;
+
+      /* Truncating narrows: sign-extend the low half of each lane in
+         place, so that a saturating narrow gives the truncated value. */
       case Iop_NarrowBin16to8x16:
-                           fn = (HWord)h_generic_calc_NarrowBin16to8x16;
-                           goto do_SseAssistedBinary;
+         laneBits = 16; op = Asse_PACKSSW; goto do_SseNarrowBin;
       case Iop_NarrowBin32to16x8:
-                           fn = (HWord)h_generic_calc_NarrowBin32to16x8;
-                           goto do_SseAssistedBinary;
+         laneBits = 32; op = Asse_PACKSSD; goto do_SseNarrowBin;
+      do_SseNarrowBin: {
+         AMD64SseOp shl = laneBits == 16 ? Asse_SHL16 : Asse_SHL32;
+         AMD64SseOp sar = laneBits == 16 ? Asse_SAR16 : Asse_SAR32;
+         HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
+         HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+         HReg tmp  = newVRegV(env);
+         HReg dst  = newVRegV(env);
+         addInstr(env, mk_vMOVsd_RR(argL, tmp));
+         addInstr(env, AMD64Instr_SseShiftN(shl, laneBits / 2, tmp));
+         addInstr(env, AMD64Instr_SseShiftN(sar, laneBits / 2, tmp));
+         addInstr(env, mk_vMOVsd_RR(argR, dst));
+         addInstr(env, AMD64Instr_SseShiftN(shl, laneBits / 2, dst));
+         addInstr(env, AMD64Instr_SseShiftN(sar, laneBits / 2, dst));
+         addInstr(env, AMD64Instr_SseReRg(op, tmp, dst));
+         return dst;
+      }
+
       do_SseAssistedBinary: {
          /* RRRufff!  RRRufff code is what we're generating here.  Oh
             well. */
@@ -4445,28 +4498,52 @@ static void iselDVecExpr_wrk ( /*OUT*/HReg* rHi, /*OUT*/HReg* rLo,
          return;
       }
 
-      case Iop_Mul32x8:    fn = (HWord)h_generic_calc_Mul32x4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max32Sx8:   fn = (HWord)h_generic_calc_Max32Sx4;
-                           goto do_SseAssistedBinary;
-      case Iop_Min32Sx8:   fn = (HWord)h_generic_calc_Min32Sx4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max32Ux8:   fn = (HWord)h_generic_calc_Max32Ux4;
-                           goto do_SseAssistedBinary;
-      case Iop_Min32Ux8:   fn = (HWord)h_generic_calc_Min32Ux4;
-                           goto do_SseAssistedBinary;
-      case Iop_Max16Ux16:  fn = (HWord)h_generic_calc_Max16Ux8;
-                           goto do_SseAssistedBinary;
-      case Iop_Min16Ux16:  fn = (HWord)h_generic_calc_Min16Ux8;
-                           goto do_SseAssistedBinary;
-      case Iop_Max8Sx32:   fn = (HWord)h_generic_calc_Max8Sx16;
-                           goto do_SseAssistedBinary;
-      case Iop_Min8Sx32:   fn = (HWord)h_generic_calc_Min8Sx16;
-                           goto do_SseAssistedBinary;
-      case Iop_CmpEQ64x4:  fn = (HWord)h_generic_calc_CmpEQ64x2;
-                           goto do_SseAssistedBinary;
-      case Iop_CmpGT64Sx4: fn = (HWord)h_generic_calc_CmpGT64Sx2;
-                           goto do_SseAssistedBinary;
+      /* As in iselVecExpr_wrk, these have single instructions on SSE4.1
+         capable hosts, and otherwise need a helper call. */
+      case Iop_Mul32x8:    op = Asse_MUL32;
+                           fn = (HWord)h_generic_calc_Mul32x4;
+                           goto do_Sse41Binary;
+      case Iop_Max32Sx8:   op = Asse_MAX32S;
+                           fn = (HWord)h_generic_calc_Max32Sx4;
+                           goto do_Sse41Binary;
+      case Iop_Min32Sx8:   op = Asse_MIN32S;
+                           fn = (HWord)h_generic_calc_Min32Sx4;
+                           goto do_Sse41Binary;
+      case Iop_Max32Ux8:   op = Asse_MAX32U;
+                           fn = (HWord)h_generic_calc_Max32Ux4;
+                           goto do_Sse41Binary;
+      case Iop_Min32Ux8:   op = Asse_MIN32U;
+                           fn = (HWord)h_generic_calc_Min32Ux4;
+                           goto do_Sse41Binary;
+      case Iop_Max16Ux16:  op = Asse_MAX16U;
+                           fn = (HWord)h_generic_calc_Max16Ux8;
+                           goto do_Sse41Binary;
+      case Iop_Min16Ux16:  op = Asse_MIN16U;
+                           fn = (HWord)h_generic_calc_Min16Ux8;
+                           goto do_Sse41Binary;
+      case Iop_Max8Sx32:   op = Asse_MAX8S;
+                           fn = (HWord)h_generic_calc_Max8Sx16;
+                           goto do_Sse41Binary;
+      case Iop_Min8Sx32:   op = Asse_MIN8S;
+                           fn = (HWord)h_generic_calc_Min8Sx16;
+                           goto do_Sse41Binary;
+      case Iop_CmpEQ64x4:  op = Asse_CMPEQ64;
+                           fn = (HWord)h_generic_calc_CmpEQ64x2;
+                           goto do_Sse41Binary;
+      do_Sse41Binary:
+         if (env->hwcaps & VEX_HWCAPS_AMD64_SSE41)
+            goto do_SseReRg;
+         goto do_SseAssistedBinary;
+
+      case Iop_CmpGT64Sx4:
+         /* pcmpgtq is SSE4.2, which every AVX capable host has. */
+         if (env->hwcaps & VEX_HWCAPS_AMD64_AVX) {
+            op = Asse_CMPGT64S;
+            goto do_SseReRg;
+         }
+         fn = (HWord)h_generic_calc_CmpGT64Sx2;
+         goto do_SseAssistedBinary;
+
       do_SseAssistedBinary: {
          /* RRRufff!  RRRufff code is what we're generating here.  Oh
             well. */
@@ -4543,8 +4620,40 @@ static void iselDVecExpr_wrk ( /*OUT*/HReg* rHi, /*OUT*/HReg* rLo,
          return;
       }
 
-      case Iop_Perm32x8:   fn = (HWord)h_generic_calc_Perm32x8;
-                           goto do_SseAssistedBinary256;
+      case Iop_Perm32x8:
+         if (env->hwcaps & VEX_HWCAPS_AMD64_AVX) {
+            /* vpermd needs 256 bit registers, which we don't use.  Instead,
+               permute both halves of the data with vpermilps, using the
+               low two bits of each index, and select between the results
+               with a mask made from the third bit. */
+            HReg argLhi, argLlo, argRhi, argRlo;
+            iselDVecExpr(&argLhi, &argLlo, env, e->Iex.Binop.arg1);
+            iselDVecExpr(&argRhi, &argRlo, env, e->Iex.Binop.arg2);
+            HReg dst[2];
+            HReg idx[2] = { argRhi, argRlo };
+            UInt j;
+            for (j = 0; j < 2; j++) {
+               HReg fromLo = newVRegV(env);
+               HReg fromHi = newVRegV(env);
+               HReg mask   = newVRegV(env);
+               addInstr(env, AMD64Instr_Avx128ReRg(Asse_PERMILPS,
+                                                   argLlo, idx[j], fromLo));
+               addInstr(env, AMD64Instr_Avx128ReRg(Asse_PERMILPS,
+                                                   argLhi, idx[j], fromHi));
+               addInstr(env, mk_vMOVsd_RR(idx[j], mask));
+               addInstr(env, AMD64Instr_SseShiftN(Asse_SHL32, 29, mask));
+               addInstr(env, AMD64Instr_SseShiftN(Asse_SAR32, 31, mask));
+               addInstr(env, AMD64Instr_SseReRg(Asse_AND, mask, fromHi));
+               addInstr(env, AMD64Instr_SseReRg(Asse_ANDN, fromLo, mask));
+               addInstr(env, AMD64Instr_SseReRg(Asse_OR, fromHi, mask));
+               dst[j] = mask;
+            }
+            *rHi = dst[0];
+            *rLo = dst[1];
+            return;
+         }
+         fn = (HWord)h_generic_calc_Perm32x8;
+         goto do_SseAssistedBinary256;
       do_SseAssistedBinary256: {
          /* RRRufff!  RRRufff code is what we're generating here.  Oh
             well. */
@@ -5414,6 +5523,7 @@ HInstrArray* iselSB_AMD64 ( const IRSB* bb,
    vassert(0 == (hwcaps_host
                  & ~(VEX_HWCAPS_AMD64_SSE3
                      | VEX_HWCAPS_AMD64_SSSE3
+                     | VEX_HWCAPS_AMD64_SSE41
                      | VEX_HWCAPS_AMD64_CX16
                      | VEX_HWCAPS_AMD64_LZCNT
                      | VEX_HWCAPS_AMD64_AVX
@@ -1157,6 +1157,7 @@ HInstrArray* doRegisterAllocation_v2 (
                      EMIT_INSTR(spill1);
                   if (spill2)
                      EMIT_INSTR(spill2);
+                  con->stats->n_spills++;
                }
                rreg_state[k].eq_spill_slot = True;
             }
@@ -1243,6 +1244,7 @@ HInstrArray* doRegisterAllocation_v2 (
                instrs_in->arr[ii] = reloaded;
                con->getRegUsage(&reg_usage_arr[ii], instrs_in->arr[ii],
                                 con->mode64);
+               con->stats->n_reloads++;
                if (debug_direct_reload && !reloaded) {
                   vex_printf("  -->  ");
                   con->ppInstr(reloaded, con->mode64);
@@ -1333,6 +1335,7 @@ HInstrArray* doRegisterAllocation_v2 (
                   EMIT_INSTR(reload1);
                if (reload2)
                   EMIT_INSTR(reload2);
+               con->stats->n_reloads++;
                /* This rreg is read or modified by the instruction.
                   If it's merely read we can claim it now equals the
                   spill slot, but not so if it is modified. */
@@ -1418,6 +1421,7 @@ HInstrArray* doRegisterAllocation_v2 (
                EMIT_INSTR(spill1);
             if (spill2)
                EMIT_INSTR(spill2);
+            con->stats->n_spills++;
          }
 
          /* Update the rreg_state to reflect the new assignment for this
@@ -1444,6 +1448,7 @@ HInstrArray* doRegisterAllocation_v2 (
                EMIT_INSTR(reload1);
             if (reload2)
                EMIT_INSTR(reload2);
+            con->stats->n_reloads++;
             /* This rreg is read or modified by the instruction.
                If it's merely read we can claim it now equals the
                spill slot, but not so if it is modified. */
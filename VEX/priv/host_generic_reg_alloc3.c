@@ -83,6 +83,12 @@ typedef
       /* If this vregS is coalesced to another vregD, what is the combined
          dead_before for vregS+vregD. Used to effectively allocate registers. */
       Short effective_dead_before;
+
+      /* v4 only: if not NULL, an instruction computing this vreg's value
+         from scratch, made by RegAllocControl.genRemat. Such a vreg is not
+         stored to its spill slot when spilled; instead of being reloaded,
+         its value is computed again. */
+      HInstr* remat;
    }
    VRegState;
 
@@ -227,7 +233,11 @@ static inline void print_state(
          written += con->ppReg(vreg->rreg);
          break;
       case Spilled:
-         written = vex_printf("spilled at offset %u", vreg->spill_offset);
+         if (vreg->remat != NULL) {
+            written = vex_printf("spilled, rematerialisable");
+         } else {
+            written = vex_printf("spilled at offset %u", vreg->spill_offset);
+         }
          break;
       default:
          vassert(0);
@@ -316,7 +326,8 @@ static inline void mark_vreg_spilled(
 }
 
 /* Spills a vreg assigned to some rreg.
-   The vreg is spilled and the rreg is freed.
+   The vreg is spilled and the rreg is freed. No store is needed if the vreg
+   can be rematerialised.
    Returns rreg's index. */
 static inline UInt spill_vreg(
    HReg vreg, UInt v_idx, UInt current_ii, VRegState* vreg_state, UInt n_vregs,
@@ -333,17 +344,20 @@ static inline UInt spill_vreg(
    vassert(vreg_state[v_idx].dead_before > (Short) current_ii);
    vassert(vreg_state[v_idx].reg_class != HRcINVALID);
 
-   /* Generate spill. */
-   HInstr* spill1 = NULL;
-   HInstr* spill2 = NULL;
-   con->genSpill(&spill1, &spill2, rreg, vreg_state[v_idx].spill_offset,
-                 con->mode64);
-   vassert(spill1 != NULL || spill2 != NULL); /* cannot be both NULL */
-   if (spill1 != NULL) {
-      emit_instr(spill1, instrs_out, con, "spill1");
-   }
-   if (spill2 != NULL) {
-      emit_instr(spill2, instrs_out, con, "spill2");
+   if (vreg_state[v_idx].remat == NULL) {
+      /* Generate spill. */
+      HInstr* spill1 = NULL;
+      HInstr* spill2 = NULL;
+      con->genSpill(&spill1, &spill2, rreg, vreg_state[v_idx].spill_offset,
+                    con->mode64);
+      vassert(spill1 != NULL || spill2 != NULL); /* cannot be both NULL */
+      if (spill1 != NULL) {
+         emit_instr(spill1, instrs_out, con, "spill1");
+      }
+      if (spill2 != NULL) {
+         emit_instr(spill2, instrs_out, con, "spill2");
+      }
+      con->stats->n_spills += 1;
    }
 
    mark_vreg_spilled(v_idx, vreg_state, n_vregs, rreg_state, n_rregs);
@@ -352,7 +366,9 @@ static inline UInt spill_vreg(
 
 /* Chooses a vreg to be spilled based on various criteria.
    The vreg must not be from the instruction being processed, that is, it must
-   not be listed in reg_usage->vRegs. */
+   not be listed in reg_usage->vRegs.
+   Vregs which can be rematerialised are preferred, unless needed by the next
+   instruction, since spilling them costs no store and the reload is cheap. */
 static inline HReg find_vreg_to_spill(
    VRegState* vreg_state, UInt n_vregs,
    RRegState* rreg_state, UInt n_rregs,
@@ -385,6 +401,10 @@ static inline HReg find_vreg_to_spill(
                   break;
                }
             }
+            if (vreg_state[hregIndex(vreg)].remat != NULL
+                && ii > scan_forward_from) {
+               ii = scan_forward_end;
+            }
 
             if (ii >= distance_so_far) {
                distance_so_far = ii;
@@ -464,6 +484,73 @@ static Int find_free_rreg(
    return r_idx_found;
 }
 
+/* Find a free rreg of the correct class which stays free for the rest of
+   the vreg's live range, that is, one which does not enter a hard live range
+   before the vreg dies. Returns INVALID_INDEX if there is no such rreg. Used
+   by v4 to move a vreg out of the way of a hard live range, typically of a
+   caller-saved register around a helper call, instead of spilling it. This
+   effectively splits the vreg's live range between two rregs. */
+static Int find_free_rreg_for_rest_of_lr(
+   const VRegState* vreg_state, UInt n_vregs,
+   const RRegState* rreg_state, UInt n_rregs,
+   const RRegLRState* rreg_lr_state,
+   UInt v_idx, UInt current_ii, HRegClass target_hregclass,
+   const RegAllocControl* con)
+{
+   const VRegState* vreg = &vreg_state[v_idx];
+
+   /* Scan from callee-save registers first, as they are the ones which
+      survive helper calls. */
+   for (UInt r_idx = con->univ->allocable_start[target_hregclass];
+        r_idx <= con->univ->allocable_end[target_hregclass]; r_idx++) {
+      const RRegState*   rreg     = &rreg_state[r_idx];
+      const RRegLRState* rreg_lrs = &rreg_lr_state[r_idx];
+      if (rreg->disp != Free) {
+         continue;
+      }
+      if (rreg_lrs->lrs_used == 0) {
+         return r_idx;
+      }
+      const RRegLR* lr = rreg_lrs->lr_current;
+      if ((Short) current_ii >= lr->dead_before) {
+         return r_idx; /* The last hard live range is over. */
+      }
+      if (lr->live_after > (Short) current_ii
+          && vreg->effective_dead_before <= lr->live_after) {
+         return r_idx;
+      }
+   }
+
+   return INVALID_INDEX;
+}
+
+/* Moves a vreg from the rreg it is assigned to, to a free rreg. */
+static inline void move_vreg(
+   UInt v_idx, UInt r_free_idx, VRegState* vreg_state, UInt n_vregs,
+   RRegState* rreg_state, UInt n_rregs, HInstrArray* instrs_out,
+   const RegAllocControl* con)
+{
+   vassert(vreg_state[v_idx].disp == Assigned);
+   HReg vreg = rreg_state[hregIndex(vreg_state[v_idx].rreg)].vreg;
+   UInt r_idx = hregIndex(vreg_state[v_idx].rreg);
+   RRegState* rreg = &rreg_state[r_idx];
+   vassert(rreg_state[r_free_idx].disp == Free);
+
+   /* Generate "move" between real registers. */
+   HInstr* move = con->genMove(con->univ->regs[r_idx],
+                               con->univ->regs[r_free_idx], con->mode64);
+   vassert(move != NULL);
+   emit_instr(move, instrs_out, con, "move");
+   con->stats->n_moves += 1;
+
+   /* Update the register allocator state. */
+   vreg_state[v_idx].rreg = con->univ->regs[r_free_idx];
+   rreg_state[r_free_idx].disp          = Bound;
+   rreg_state[r_free_idx].vreg          = vreg;
+   rreg_state[r_free_idx].eq_spill_slot = rreg->eq_spill_slot;
+   FREE_RREG(rreg);
+}
+
 /* A target-independent register allocator (v3). Requires various functions
    which it uses to deal abstractly with instructions and registers, since it
    cannot have any target-specific knowledge.
@@ -476,13 +563,24 @@ static Int find_free_rreg(
    run-time error.
 
    Takes unallocated instructions and returns allocated instructions.
+
+   If |split_and_remat| is set (v4), then, in addition:
+   - vregs whose value can be recomputed, as determined by con->genRemat,
+     are never stored to their spill slot; instead of reloading them, their
+     value is computed again;
+   - a vreg whose rreg enters a hard live range, typically a caller-saved
+     register around a helper call, is moved to an rreg which is free for the
+     rest of its live range, if there is one, instead of being spilled.
 */
-HInstrArray* doRegisterAllocation_v3(
+static HInstrArray* doRegisterAllocation_WRK(
    /* Incoming virtual-registerised code. */
    HInstrArray* instrs_in,
 
    /* Register allocator controls to use. */
-   const RegAllocControl* con
+   const RegAllocControl* con,
+
+   /* Do live range splitting and rematerialisation? */
+   Bool split_and_remat
 )
 {
    vassert((con->guest_sizeB % LibVEX_GUEST_STATE_ALIGN) == 0);
@@ -584,6 +682,7 @@ HInstrArray* doRegisterAllocation_v3(
       vreg_state[v_idx].coalescedTo           = INVALID_HREG;
       vreg_state[v_idx].coalescedFirst        = INVALID_HREG;
       vreg_state[v_idx].effective_dead_before = INVALID_INSTRNO;
+      vreg_state[v_idx].remat                 = NULL;
    }
 
    for (UInt r_idx = 0; r_idx < n_rregs; r_idx++) {
@@ -652,12 +751,22 @@ HInstrArray* doRegisterAllocation_v3(
          case HRmWrite:
             if (vreg_state[v_idx].live_after == INVALID_INSTRNO) {
                vreg_state[v_idx].live_after = toShort(ii);
+               /* Can the value be recomputed? Only if this is the sole
+                  write to the vreg, which is checked below. */
+               if (split_and_remat && con->genRemat != NULL
+                   && reg_usage[ii].n_vRegs == 1) {
+                  vreg_state[v_idx].remat
+                     = con->genRemat(instr, vreg, con->mode64);
+               }
+            } else {
+               vreg_state[v_idx].remat = NULL;
             }
             break;
          case HRmModify:
             if (vreg_state[v_idx].live_after == INVALID_INSTRNO) {
                OFFENDING_VREG(v_idx, instr, "Modify");
             }
+            vreg_state[v_idx].remat = NULL;
             break;
          default:
             vassert(0);
@@ -802,6 +911,17 @@ HInstrArray* doRegisterAllocation_v3(
       }
    }
 
+   /* Coalesced vregs share a spill slot, and one of them being spilled means
+      all of them are. So the value must really be in the spill slot. */
+   if (split_and_remat && coalesce_happened) {
+      for (UInt v_idx = 0; v_idx < n_vregs; v_idx++) {
+         if (! hregIsInvalid(vreg_state[v_idx].coalescedTo)
+             || ! hregIsInvalid(vreg_state[v_idx].coalescedFirst)) {
+            vreg_state[v_idx].remat = NULL;
+         }
+      }
+   }
+
    /* --- Stage 3. Allocate spill slots. --- */
 
    /* Each spill slot is 8 bytes long. For vregs which take more than 64 bits
@@ -1129,7 +1249,21 @@ HInstrArray* doRegisterAllocation_v3(
                   HReg vreg = rreg->vreg;
                   UInt v_idx = hregIndex(vreg);
 
-                  if (! HRegUsage__contains(&reg_usage[ii], vreg)) {
+                  Int r_split_idx = INVALID_INDEX;
+                  if (split_and_remat && !rreg->eq_spill_slot
+                      && vreg_state[v_idx].remat == NULL) {
+                     r_split_idx = find_free_rreg_for_rest_of_lr(
+                                      vreg_state, n_vregs, rreg_state, n_rregs,
+                                      rreg_lr_state, v_idx, ii,
+                                      vreg_state[v_idx].reg_class, con);
+                  }
+
+                  if (r_split_idx != INVALID_INDEX) {
+                     /* Split the live range: move the vreg to an rreg where
+                        it can stay, rather than spill it. */
+                     move_vreg(v_idx, r_split_idx, vreg_state, n_vregs,
+                               rreg_state, n_rregs, instrs_out, con);
+                  } else if (! HRegUsage__contains(&reg_usage[ii], vreg)) {
                      if (rreg->eq_spill_slot) {
                         mark_vreg_spilled(v_idx, vreg_state, n_vregs,
                                           rreg_state, n_rregs);
@@ -1142,20 +1276,8 @@ HInstrArray* doRegisterAllocation_v3(
                      /* Find or make a free rreg where to move this vreg to. */
                      UInt r_free_idx = FIND_OR_MAKE_FREE_RREG(
                                   ii, v_idx, vreg_state[v_idx].reg_class, True);
-
-                     /* Generate "move" between real registers. */
-                     HInstr* move = con->genMove(con->univ->regs[r_idx],
-                                      con->univ->regs[r_free_idx], con->mode64);
-                     vassert(move != NULL);
-                     emit_instr(move, instrs_out, con, "move");
-
-                     /* Update the register allocator state. */
-                     vassert(vreg_state[v_idx].disp == Assigned);
-                     vreg_state[v_idx].rreg = con->univ->regs[r_free_idx];
-                     rreg_state[r_free_idx].disp          = Bound;
-                     rreg_state[r_free_idx].vreg          = vreg;
-                     rreg_state[r_free_idx].eq_spill_slot = rreg->eq_spill_slot;
-                     FREE_RREG(rreg);
+                     move_vreg(v_idx, r_free_idx, vreg_state, n_vregs,
+                               rreg_state, n_rregs, instrs_out, con);
                   }
                   break;
                }
@@ -1201,7 +1323,8 @@ HInstrArray* doRegisterAllocation_v3(
                nreads++;
                UInt v_idx = hregIndex(vreg);
                vassert(IS_VALID_VREGNO(v_idx));
-               if (vreg_state[v_idx].disp == Spilled) {
+               if (vreg_state[v_idx].disp == Spilled
+                   && vreg_state[v_idx].remat == NULL) {
                   /* Is this its last use? */
                   vassert(vreg_state[v_idx].dead_before >= (Short) (ii + 1));
                   if ((vreg_state[v_idx].dead_before == (Short) (ii + 1))
@@ -1233,6 +1356,7 @@ HInstrArray* doRegisterAllocation_v3(
                instr = reloaded;
                instrs_in->arr[ii] = reloaded;
                con->getRegUsage(&reg_usage[ii], instr, con->mode64);
+               con->stats->n_reloads += 1;
                if (debug_direct_reload) {
                   vex_printf("  -->  ");
                   con->ppInstr(reloaded, con->mode64);
@@ -1288,19 +1412,27 @@ HInstrArray* doRegisterAllocation_v3(
             if ((vreg_state[v_idx].disp == Spilled)
                 && (reg_usage[ii].vMode[j] != HRmWrite)) {
 
-               HInstr* reload1 = NULL;
-               HInstr* reload2 = NULL;
-               con->genReload(&reload1, &reload2, rreg,
-                         vreg_state[v_idx].spill_offset, con->mode64);
-               vassert(reload1 != NULL || reload2 != NULL);
-               if (reload1 != NULL) {
-                  emit_instr(reload1, instrs_out, con, "reload1");
-               }
-               if (reload2 != NULL) {
-                  emit_instr(reload2, instrs_out, con, "reload2");
+               if (vreg_state[v_idx].remat != NULL) {
+                  /* Compute the value again rather than reload it. */
+                  HInstr* remat = con->genRemat(vreg_state[v_idx].remat, rreg,
+                                                con->mode64);
+                  vassert(remat != NULL);
+                  emit_instr(remat, instrs_out, con, "remat");
+                  con->stats->n_remats += 1;
+               } else {
+                  HInstr* reload1 = NULL;
+                  HInstr* reload2 = NULL;
+                  con->genReload(&reload1, &reload2, rreg,
+                            vreg_state[v_idx].spill_offset, con->mode64);
+                  vassert(reload1 != NULL || reload2 != NULL);
+                  if (reload1 != NULL) {
+                     emit_instr(reload1, instrs_out, con, "reload1");
+                  }
+                  if (reload2 != NULL) {
+                     emit_instr(reload2, instrs_out, con, "reload2");
+                  }
+                  con->stats->n_reloads += 1;
                }
-
-
             }
 
             rreg_state[r_idx].disp          = Bound;
@@ -1367,6 +1499,24 @@ HInstrArray* doRegisterAllocation_v3(
    return instrs_out;
 }
 
+HInstrArray* doRegisterAllocation_v3(
+   HInstrArray* instrs_in,
+   const RegAllocControl* con
+)
+{
+   return doRegisterAllocation_WRK(instrs_in, con, False);
+}
+
+/* v4 is v3 with live range splitting around hard live ranges and
+   rematerialisation; see doRegisterAllocation_WRK. */
+HInstrArray* doRegisterAllocation_v4(
+   HInstrArray* instrs_in,
+   const RegAllocControl* con
+)
+{
+   return doRegisterAllocation_WRK(instrs_in, con, True);
+}
+
 /*----------------------------------------------------------------------------*/
 /*---                                            host_generic_reg_alloc3.c ---*/
 /*----------------------------------------------------------------------------*/
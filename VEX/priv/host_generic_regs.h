@@ -473,6 +473,17 @@ static inline Bool is_RetLoc_INVALID ( RetLoc rl ) {
 /*--- Reg alloc: TODO: move somewhere else              ---*/
 /*---------------------------------------------------------*/
 
+/* Statistics about the spilling done by the register allocator, for
+   one translation. */
+typedef
+   struct {
+      UInt n_spills;  /* stores to a spill slot */
+      UInt n_reloads; /* loads from a spill slot, including direct reloads */
+      UInt n_remats;  /* values recomputed instead of reloaded */
+      UInt n_moves;   /* moves between real registers, instead of a spill */
+   }
+   RegAllocStats;
+
 /* Control of the VEX register allocator. */
 typedef
    struct {
@@ -496,6 +507,16 @@ typedef
       HInstr* (*directReload)(HInstr*, HReg, Short);
       UInt    guest_sizeB;
 
+      /* Optionally, a function which, given an insn that writes a value to
+         a register without reading any other register, memory or state
+         the insn stream might change (for example a constant load), returns
+         a copy writing the value to a different register.  Used by v4 to
+         recompute values instead of spilling and reloading them. */
+      HInstr* (*genRemat)(const HInstr*, HReg, Bool);
+
+      /* Where to accumulate spilling statistics. */
+      RegAllocStats* stats;
+
       /* For debug printing only. */
       void (*ppInstr)(const HInstr*, Bool);
       UInt (*ppReg)(HReg);
@@ -513,6 +534,10 @@ extern HInstrArray* doRegisterAllocation_v3(
    HInstrArray* instrs_in,
    const RegAllocControl* con
 );
+extern HInstrArray* doRegisterAllocation_v4(
+   HInstrArray* instrs_in,
+   const RegAllocControl* con
+);
 
 
 #endif /* ndef __VEX_HOST_GENERIC_REGS_H */
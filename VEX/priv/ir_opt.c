@@ -608,6 +608,26 @@ static void invalidateOverlaps ( HashHW* h, UInt k_lo, UInt k_hi )
    }
 }
 
+/* Might the dirty call d write any part of the guest state in (k_lo
+   .. k_hi)?  This relies on the effects declared in d->fxState, which
+   every helper that writes the guest state must supply. */
+static Bool dirtyWritesOverlap ( const IRDirty* d, UInt k_lo, UInt k_hi )
+{
+   Int i, r;
+   vassert(k_lo <= k_hi);
+   for (i = 0; i < d->nFxState; i++) {
+      if (d->fxState[i].fx == Ifx_Read)
+         continue;
+      for (r = 0; r <= d->fxState[i].nRepeats; r++) {
+         UInt e_lo = d->fxState[i].offset + r * d->fxState[i].repeatLen;
+         UInt e_hi = e_lo + d->fxState[i].size - 1;
+         if (!(e_hi < k_lo || k_hi < e_lo))
+            return True;
+      }
+   }
+   return False;
+}
+
 
 static void redundant_get_removal_BB ( IRSB* bb )
 {
@@ -675,20 +695,18 @@ static void redundant_get_removal_BB ( IRSB* bb )
       else
       if (st->tag == Ist_Dirty) {
          /* Deal with dirty helpers which write or modify guest state.
-            Invalidate the entire env.  We could do a lot better
-            here. */
-         IRDirty* d      = st->Ist.Dirty.details;
-         Bool     writes = False;
-         for (j = 0; j < d->nFxState; j++) {
-            if (d->fxState[j].fx == Ifx_Modify 
-                || d->fxState[j].fx == Ifx_Write)
-            writes = True;
-         }
-         if (writes) {
-            /* dump the entire env (not clever, but correct ...) */
-            for (j = 0; j < env->used; j++)
+            Invalidate only the env entries which overlap the declared
+            effects, so that Gets of other state are still forwarded
+            across the call. */
+         IRDirty* d = st->Ist.Dirty.details;
+         for (j = 0; j < env->used; j++) {
+            if (!env->inuse[j])
+               continue;
+            if (dirtyWritesOverlap(d, (((UInt)env->key[j]) >> 16) & 0xFFFF,
+                                      ((UInt)env->key[j]) & 0xFFFF)) {
                env->inuse[j] = False;
-            if (0) vex_printf("rGET: trash env due to dirty helper\n");
+               if (0) vex_printf("rGET: invalidate due to dirty helper\n");
+            }
          }
       }
 
@@ -1098,6 +1116,8 @@ static Bool sameIRExprs_aux2 ( IRExpr** env, const IRExpr* e1, const IRExpr* e2
             case Ico_U16:  return toBool( c1->Ico.U16 == c2->Ico.U16 );
             case Ico_U32:  return toBool( c1->Ico.U32 == c2->Ico.U32 );
             case Ico_U64:  return toBool( c1->Ico.U64 == c2->Ico.U64 );
+            case Ico_V128: return toBool( c1->Ico.V128 == c2->Ico.V128 );
+            case Ico_V256: return toBool( c1->Ico.V256 == c2->Ico.V256 );
             default: break;
          }
          return False;
@@ -1403,22 +1423,403 @@ static UInt fold_PopCount32 ( UInt value )
 }
 
 
-/* V64 holds 8 summary-constant bits in V128/V256 style.  Convert to
-   the corresponding real constant. */
-//XXX re-check this before use
-//static ULong de_summarise_V64 ( UChar v64 )
-//{
-//   ULong r = 0;
-//   if (v64 & (1<<0)) r |= 0x00000000000000FFULL;
-//   if (v64 & (1<<1)) r |= 0x000000000000FF00ULL;
-//   if (v64 & (1<<2)) r |= 0x0000000000FF0000ULL;
-//   if (v64 & (1<<3)) r |= 0x00000000FF000000ULL;
-//   if (v64 & (1<<4)) r |= 0x000000FF00000000ULL;
-//   if (v64 & (1<<5)) r |= 0x0000FF0000000000ULL;
-//   if (v64 & (1<<6)) r |= 0x00FF000000000000ULL;
-//   if (v64 & (1<<7)) r |= 0xFF00000000000000ULL;
-//   return r;
-//}
+/* Helpers for folding SIMD operations.  V128 and V256 constants are
+   held in summarised form: bit i of the summary says whether byte i
+   of the value is 0x00 or 0xFF.  To fold an operation on such
+   constants, expand the arguments into bytes, compute the result
+   lane by lane, and summarise the result again.  The last step fails
+   if the result contains a byte which is neither 0x00 nor 0xFF, since
+   there is then no way to write the result as an IR constant. */
+
+/* Expand 'con' into its bytes, least significant first.  Returns the
+   number of bytes, or 0 if 'con' has a type not handled here. */
+static UInt constToBytes ( /*OUT*/UChar* bytes, const IRConst* con )
+{
+   UInt  i, n;
+   ULong u64;
+   switch (con->tag) {
+      case Ico_V128:
+         for (i = 0; i < 16; i++)
+            bytes[i] = ((con->Ico.V128 >> i) & 1) ? 0xFF : 0x00;
+         return 16;
+      case Ico_V256:
+         for (i = 0; i < 32; i++)
+            bytes[i] = ((con->Ico.V256 >> i) & 1) ? 0xFF : 0x00;
+         return 32;
+      case Ico_U8:  u64 = con->Ico.U8;  n = 1; break;
+      case Ico_U16: u64 = con->Ico.U16; n = 2; break;
+      case Ico_U32: u64 = con->Ico.U32; n = 4; break;
+      case Ico_U64: u64 = con->Ico.U64; n = 8; break;
+      default: return 0;
+   }
+   for (i = 0; i < n; i++)
+      bytes[i] = toUChar(u64 >> (8 * i));
+   return n;
+}
+
+/* The inverse of constToBytes: make a constant of type 'ty' from
+   'bytes', or return NULL if that isn't possible. */
+static IRExpr* bytesToConst ( IRType ty, const UChar* bytes )
+{
+   UInt  i, summary = 0;
+   ULong u64 = 0;
+   switch (ty) {
+      case Ity_V128:
+      case Ity_V256: {
+         UInt n = ty == Ity_V128 ? 16 : 32;
+         for (i = 0; i < n; i++) {
+            if (bytes[i] == 0xFF)
+               summary |= 1U << i;
+            else if (bytes[i] != 0x00)
+               return NULL;
+         }
+         return IRExpr_Const(ty == Ity_V128
+                                ? IRConst_V128(toUShort(summary))
+                                : IRConst_V256(summary));
+      }
+      case Ity_I8: case Ity_I16: case Ity_I32: case Ity_I64:
+         for (i = 0; i < sizeofIRType(ty); i++)
+            u64 |= ((ULong)bytes[i]) << (8 * i);
+         break;
+      default:
+         return NULL;
+   }
+   switch (ty) {
+      case Ity_I8:  return IRExpr_Const(IRConst_U8(toUChar(u64)));
+      case Ity_I16: return IRExpr_Const(IRConst_U16(toUShort(u64)));
+      case Ity_I32: return IRExpr_Const(IRConst_U32((UInt)u64));
+      default:      return IRExpr_Const(IRConst_U64(u64));
+   }
+}
+
+/* Get and set lane 'ix' of a vector held as bytes, where each lane is
+   'szB' bytes.  Lanes are zero extended when read. */
+static ULong getLane ( const UChar* v, UInt szB, UInt ix )
+{
+   UInt  i;
+   ULong x = 0;
+   for (i = 0; i < szB; i++)
+      x |= ((ULong)v[ix * szB + i]) << (8 * i);
+   return x;
+}
+
+static void putLane ( /*MOD*/UChar* v, UInt szB, UInt ix, ULong x )
+{
+   UInt i;
+   for (i = 0; i < szB; i++)
+      v[ix * szB + i] = toUChar(x >> (8 * i));
+}
+
+/* Sign extend a lane of 'szB' bytes. */
+static Long sxLane ( ULong x, UInt szB )
+{
+   UInt sh = 64 - 8 * szB;
+   return ((Long)(x << sh)) >> sh;
+}
+
+/* Fold a SIMD unary operation on a constant.  Returns NULL if 'op'
+   isn't handled here or the result can't be expressed in IR. */
+static IRExpr* fold_SIMD_Unop ( IROp op, const IRConst* con )
+{
+   UChar  a[32], r[32];
+   UInt   nA, nR, szB = 0, offB = 0, i;
+   IRType tyR, ty1, ty2, ty3, ty4;
+   enum { SF_CmpNEZ, SF_Abs, SF_Dup, SF_Extract, SF_ZeroHI } kind;
+
+   switch (op) {
+      case Iop_CmpNEZ8x16: case Iop_CmpNEZ8x32:
+         kind = SF_CmpNEZ; szB = 1; break;
+      case Iop_CmpNEZ16x8: case Iop_CmpNEZ16x16:
+         kind = SF_CmpNEZ; szB = 2; break;
+      case Iop_CmpNEZ32x4: case Iop_CmpNEZ32x8:
+         kind = SF_CmpNEZ; szB = 4; break;
+      case Iop_CmpNEZ64x2: case Iop_CmpNEZ64x4:
+         kind = SF_CmpNEZ; szB = 8; break;
+      case Iop_Abs8x16:  kind = SF_Abs; szB = 1; break;
+      case Iop_Abs16x8:  kind = SF_Abs; szB = 2; break;
+      case Iop_Abs32x4:  kind = SF_Abs; szB = 4; break;
+      case Iop_Abs64x2:  kind = SF_Abs; szB = 8; break;
+      case Iop_Dup8x16:  kind = SF_Dup; szB = 1; break;
+      case Iop_Dup16x8:  kind = SF_Dup; szB = 2; break;
+      case Iop_Dup32x4:  kind = SF_Dup; szB = 4; break;
+      case Iop_V128to32:
+      case Iop_V128to64:
+      case Iop_V256to64_0:
+      case Iop_V256toV128_0: kind = SF_Extract; offB = 0;  break;
+      case Iop_V128HIto64:
+      case Iop_V256to64_1:   kind = SF_Extract; offB = 8;  break;
+      case Iop_V256to64_2:
+      case Iop_V256toV128_1: kind = SF_Extract; offB = 16; break;
+      case Iop_V256to64_3:   kind = SF_Extract; offB = 24; break;
+      case Iop_32UtoV128:
+      case Iop_64UtoV128:         kind = SF_ZeroHI; szB = 8; break;
+      case Iop_ZeroHI64ofV128:    kind = SF_ZeroHI; szB = 8; break;
+      case Iop_ZeroHI96ofV128:    kind = SF_ZeroHI; szB = 4; break;
+      case Iop_ZeroHI112ofV128:   kind = SF_ZeroHI; szB = 2; break;
+      case Iop_ZeroHI120ofV128:   kind = SF_ZeroHI; szB = 1; break;
+      default:
+         return NULL;
+   }
+
+   nA = constToBytes(a, con);
+   if (nA == 0)
+      return NULL;
+   typeOfPrimop(op, &tyR, &ty1, &ty2, &ty3, &ty4);
+   nR = sizeofIRType(tyR);
+   vassert(nR <= 32);
+
+   switch (kind) {
+      case SF_CmpNEZ:
+         for (i = 0; i < nR / szB; i++)
+            putLane(r, szB, i, getLane(a, szB, i) != 0 ? ~0ULL : 0);
+         break;
+      case SF_Abs:
+         for (i = 0; i < nR / szB; i++) {
+            Long x = sxLane(getLane(a, szB, i), szB);
+            putLane(r, szB, i, x < 0 ? -(ULong)x : (ULong)x);
+         }
+         break;
+      case SF_Dup:
+         for (i = 0; i < nR / szB; i++)
+            putLane(r, szB, i, getLane(a, szB, 0));
+         break;
+      case SF_Extract:
+         for (i = 0; i < nR; i++)
+            r[i] = a[offB + i];
+         break;
+      case SF_ZeroHI:
+         for (i = 0; i < nR; i++)
+            r[i] = i < szB && i < nA ? a[i] : 0;
+         break;
+   }
+   return bytesToConst(tyR, r);
+}
+
+/* Fold a SIMD binary operation on two constants.  Returns NULL if
+   'op' isn't handled here or the result can't be expressed in IR. */
+static IRExpr* fold_SIMD_Binop ( IROp op, const IRConst* con1,
+                                 const IRConst* con2 )
+{
+   UChar  a[32], b[32], r[32];
+   UInt   nA, nB, nR, szB, n, i;
+   IRType tyR, ty1, ty2, ty3, ty4;
+   enum { SF_Add, SF_Sub, SF_Mul, SF_CmpEQ, SF_CmpGTS, SF_CmpGTU,
+          SF_MaxS, SF_MaxU, SF_MinS, SF_MinU, SF_ShlN, SF_ShrN, SF_SarN,
+          SF_InterleaveLO, SF_InterleaveHI, SF_CatOdd, SF_CatEven,
+          SF_Narrow, SF_QNarrowSS, SF_QNarrowSU, SF_QNarrowUU,
+          SF_Concat, SF_SetLo } kind;
+
+   switch (op) {
+      case Iop_Add8x16:  case Iop_Add8x32:   kind = SF_Add; szB = 1; break;
+      case Iop_Add16x8:  case Iop_Add16x16:  kind = SF_Add; szB = 2; break;
+      case Iop_Add32x4:  case Iop_Add32x8:   kind = SF_Add; szB = 4; break;
+      case Iop_Add64x2:  case Iop_Add64x4:   kind = SF_Add; szB = 8; break;
+      case Iop_Sub8x16:  case Iop_Sub8x32:   kind = SF_Sub; szB = 1; break;
+      case Iop_Sub16x8:  case Iop_Sub16x16:  kind = SF_Sub; szB = 2; break;
+      case Iop_Sub32x4:  case Iop_Sub32x8:   kind = SF_Sub; szB = 4; break;
+      case Iop_Sub64x2:  case Iop_Sub64x4:   kind = SF_Sub; szB = 8; break;
+      case Iop_Mul8x16:                      kind = SF_Mul; szB = 1; break;
+      case Iop_Mul16x8:  case Iop_Mul16x16:  kind = SF_Mul; szB = 2; break;
+      case Iop_Mul32x4:  case Iop_Mul32x8:   kind = SF_Mul; szB = 4; break;
+
+      case Iop_CmpEQ8x16:  case Iop_CmpEQ8x32:  kind = SF_CmpEQ; szB = 1; break;
+      case Iop_CmpEQ16x8:  case Iop_CmpEQ16x16: kind = SF_CmpEQ; szB = 2; break;
+      case Iop_CmpEQ32x4:  case Iop_CmpEQ32x8:  kind = SF_CmpEQ; szB = 4; break;
+      case Iop_CmpEQ64x2:  case Iop_CmpEQ64x4:  kind = SF_CmpEQ; szB = 8; break;
+      case Iop_CmpGT8Sx16: case Iop_CmpGT8Sx32:  kind = SF_CmpGTS; szB = 1; break;
+      case Iop_CmpGT16Sx8: case Iop_CmpGT16Sx16: kind = SF_CmpGTS; szB = 2; break;
+      case Iop_CmpGT32Sx4: case Iop_CmpGT32Sx8:  kind = SF_CmpGTS; szB = 4; break;
+      case Iop_CmpGT64Sx2: case Iop_CmpGT64Sx4:  kind = SF_CmpGTS; szB = 8; break;
+      case Iop_CmpGT8Ux16: kind = SF_CmpGTU; szB = 1; break;
+      case Iop_CmpGT16Ux8: kind = SF_CmpGTU; szB = 2; break;
+      case Iop_CmpGT32Ux4: kind = SF_CmpGTU; szB = 4; break;
+      case Iop_CmpGT64Ux2: kind = SF_CmpGTU; szB = 8; break;
+
+      case Iop_Max8Sx16: case Iop_Max8Sx32:  kind = SF_MaxS; szB = 1; break;
+      case Iop_Max16Sx8: case Iop_Max16Sx16: kind = SF_MaxS; szB = 2; break;
+      case Iop_Max32Sx4: case Iop_Max32Sx8:  kind = SF_MaxS; szB = 4; break;
+      case Iop_Max64Sx2:                     kind = SF_MaxS; szB = 8; break;
+      case Iop_Max8Ux16: case Iop_Max8Ux32:  kind = SF_MaxU; szB = 1; break;
+      case Iop_Max16Ux8: case Iop_Max16Ux16: kind = SF_MaxU; szB = 2; break;
+      case Iop_Max32Ux4: case Iop_Max32Ux8:  kind = SF_MaxU; szB = 4; break;
+      case Iop_Max64Ux2:                     kind = SF_MaxU; szB = 8; break;
+      case Iop_Min8Sx16: case Iop_Min8Sx32:  kind = SF_MinS; szB = 1; break;
+      case Iop_Min16Sx8: case Iop_Min16Sx16: kind = SF_MinS; szB = 2; break;
+      case Iop_Min32Sx4: case Iop_Min32Sx8:  kind = SF_MinS; szB = 4; break;
+      case Iop_Min64Sx2:                     kind = SF_MinS; szB = 8; break;
+      case Iop_Min8Ux16: case Iop_Min8Ux32:  kind = SF_MinU; szB = 1; break;
+      case Iop_Min16Ux8: case Iop_Min16Ux16: kind = SF_MinU; szB = 2; break;
+      case Iop_Min32Ux4: case Iop_Min32Ux8:  kind = SF_MinU; szB = 4; break;
+      case Iop_Min64Ux2:                     kind = SF_MinU; szB = 8; break;
+
+      case Iop_ShlN8x16:                       kind = SF_ShlN; szB = 1; break;
+      case Iop_ShlN16x8: case Iop_ShlN16x16:   kind = SF_ShlN; szB = 2; break;
+      case Iop_ShlN32x4: case Iop_ShlN32x8:    kind = SF_ShlN; szB = 4; break;
+      case Iop_ShlN64x2: case Iop_ShlN64x4:    kind = SF_ShlN; szB = 8; break;
+      case Iop_ShrN8x16:                       kind = SF_ShrN; szB = 1; break;
+      case Iop_ShrN16x8: case Iop_ShrN16x16:   kind = SF_ShrN; szB = 2; break;
+      case Iop_ShrN32x4: case Iop_ShrN32x8:    kind = SF_ShrN; szB = 4; break;
+      case Iop_ShrN64x2: case Iop_ShrN64x4:    kind = SF_ShrN; szB = 8; break;
+      case Iop_SarN8x16:                       kind = SF_SarN; szB = 1; break;
+      case Iop_SarN16x8: case Iop_SarN16x16:   kind = SF_SarN; szB = 2; break;
+      case Iop_SarN32x4: case Iop_SarN32x8:    kind = SF_SarN; szB = 4; break;
+      case Iop_SarN64x2:                       kind = SF_SarN; szB = 8; break;
+
+      case Iop_InterleaveLO8x16: kind = SF_InterleaveLO; szB = 1; break;
+      case Iop_InterleaveLO16x8: kind = SF_InterleaveLO; szB = 2; break;
+      case Iop_InterleaveLO32x4: kind = SF_InterleaveLO; szB = 4; break;
+      case Iop_InterleaveLO64x2: kind = SF_InterleaveLO; szB = 8; break;
+      case Iop_InterleaveHI8x16: kind = SF_InterleaveHI; szB = 1; break;
+      case Iop_InterleaveHI16x8: kind = SF_InterleaveHI; szB = 2; break;
+      case Iop_InterleaveHI32x4: kind = SF_InterleaveHI; szB = 4; break;
+      case Iop_InterleaveHI64x2: kind = SF_InterleaveHI; szB = 8; break;
+      case Iop_CatOddLanes8x16:  kind = SF_CatOdd;  szB = 1; break;
+      case Iop_CatOddLanes16x8:  kind = SF_CatOdd;  szB = 2; break;
+      case Iop_CatOddLanes32x4:  kind = SF_CatOdd;  szB = 4; break;
+      case Iop_CatEvenLanes8x16: kind = SF_CatEven; szB = 1; break;
+      case Iop_CatEvenLanes16x8: kind = SF_CatEven; szB = 2; break;
+      case Iop_CatEvenLanes32x4: kind = SF_CatEven; szB = 4; break;
+
+      /* For the narrowing ops, szB is the size of the source lanes. */
+      case Iop_NarrowBin16to8x16:      kind = SF_Narrow;    szB = 2; break;
+      case Iop_NarrowBin32to16x8:      kind = SF_Narrow;    szB = 4; break;
+      case Iop_NarrowBin64to32x4:      kind = SF_Narrow;    szB = 8; break;
+      case Iop_QNarrowBin16Sto8Sx16:   kind = SF_QNarrowSS; szB = 2; break;
+      case Iop_QNarrowBin32Sto16Sx8:   kind = SF_QNarrowSS; szB = 4; break;
+      case Iop_QNarrowBin64Sto32Sx4:   kind = SF_QNarrowSS; szB = 8; break;
+      case Iop_QNarrowBin16Sto8Ux16:   kind = SF_QNarrowSU; szB = 2; break;
+      case Iop_QNarrowBin32Sto16Ux8:   kind = SF_QNarrowSU; szB = 4; break;
+      case Iop_QNarrowBin16Uto8Ux16:   kind = SF_QNarrowUU; szB = 2; break;
+      case Iop_QNarrowBin32Uto16Ux8:   kind = SF_QNarrowUU; szB = 4; break;
+      case Iop_QNarrowBin64Uto32Ux4:   kind = SF_QNarrowUU; szB = 8; break;
+
+      case Iop_64HLtoV128:
+      case Iop_V128HLtoV256:   kind = SF_Concat; szB = 0; break;
+      case Iop_SetV128lo32:
+      case Iop_SetV128lo64:    kind = SF_SetLo;  szB = 0; break;
+
+      default:
+         return NULL;
+   }
+
+   nA = constToBytes(a, con1);
+   nB = constToBytes(b, con2);
+   if (nA == 0 || nB == 0)
+      return NULL;
+   typeOfPrimop(op, &tyR, &ty1, &ty2, &ty3, &ty4);
+   nR = sizeofIRType(tyR);
+   vassert(nR <= 32);
+   n = szB == 0 ? 0 : nR / szB;
+
+   switch (kind) {
+      case SF_Add: case SF_Sub: case SF_Mul:
+      case SF_CmpEQ: case SF_CmpGTS: case SF_CmpGTU:
+      case SF_MaxS: case SF_MaxU: case SF_MinS: case SF_MinU:
+         for (i = 0; i < n; i++) {
+            ULong x  = getLane(a, szB, i);
+            ULong y  = getLane(b, szB, i);
+            Long  sx = sxLane(x, szB);
+            Long  sy = sxLane(y, szB);
+            ULong z  = 0;
+            switch (kind) {
+               case SF_Add:    z = x + y; break;
+               case SF_Sub:    z = x - y; break;
+               case SF_Mul:    z = x * y; break;
+               case SF_CmpEQ:  z = x == y ? ~0ULL : 0; break;
+               case SF_CmpGTS: z = sx > sy ? ~0ULL : 0; break;
+               case SF_CmpGTU: z = x > y ? ~0ULL : 0; break;
+               case SF_MaxS:   z = sx > sy ? x : y; break;
+               case SF_MaxU:   z = x > y ? x : y; break;
+               case SF_MinS:   z = sx < sy ? x : y; break;
+               case SF_MinU:   z = x < y ? x : y; break;
+               default: vassert(0);
+            }
+            putLane(r, szB, i, z);
+         }
+         break;
+
+      case SF_ShlN: case SF_ShrN: case SF_SarN: {
+         /* The shift amount is an I8.  Out of range amounts are
+            handled differently by each front end, so leave them
+            alone. */
+         UInt amt = b[0];
+         if (nB != 1 || amt >= 8 * szB)
+            return NULL;
+         for (i = 0; i < n; i++) {
+            ULong x = getLane(a, szB, i);
+            ULong z = kind == SF_ShlN ? x << amt
+                      : kind == SF_ShrN ? x >> amt
+                      : (ULong)(sxLane(x, szB) >> amt);
+            putLane(r, szB, i, z);
+         }
+         break;
+      }
+
+      /* In the interleave and concatenation ops the most significant
+         result lane comes from the first argument. */
+      case SF_InterleaveLO: case SF_InterleaveHI: {
+         UInt base = kind == SF_InterleaveLO ? 0 : n / 2;
+         for (i = 0; i < n / 2; i++) {
+            putLane(r, szB, 2 * i,     getLane(b, szB, base + i));
+            putLane(r, szB, 2 * i + 1, getLane(a, szB, base + i));
+         }
+         break;
+      }
+      case SF_CatOdd: case SF_CatEven: {
+         UInt odd = kind == SF_CatOdd ? 1 : 0;
+         for (i = 0; i < n / 2; i++) {
+            putLane(r, szB, i,         getLane(b, szB, 2 * i + odd));
+            putLane(r, szB, n / 2 + i, getLane(a, szB, 2 * i + odd));
+         }
+         break;
+      }
+
+      /* The high half of the result comes from the first argument. */
+      case SF_Narrow: case SF_QNarrowSS:
+      case SF_QNarrowSU: case SF_QNarrowUU: {
+         UInt  dszB = szB / 2;
+         UInt  nSrc = nA / szB;
+         ULong umax = (1ULL << (8 * dszB)) - 1;
+         Long  smax = (Long)(umax >> 1);
+         Long  smin = -smax - 1;
+         for (i = 0; i < 2 * nSrc; i++) {
+            const UChar* src = i < nSrc ? b : a;
+            ULong x  = getLane(src, szB, i % nSrc);
+            Long  sx = sxLane(x, szB);
+            ULong z  = x;
+            switch (kind) {
+               case SF_Narrow:
+                  break;
+               case SF_QNarrowSS:
+                  z = sx > smax ? smax : sx < smin ? smin : sx;
+                  break;
+               case SF_QNarrowSU:
+                  z = sx < 0 ? 0 : sx > (Long)umax ? umax : (ULong)sx;
+                  break;
+               case SF_QNarrowUU:
+                  z = x > umax ? umax : x;
+                  break;
+               default: vassert(0);
+            }
+            putLane(r, dszB, i, z);
+         }
+         break;
+      }
+
+      case SF_Concat:
+         /* The first argument is the most significant half. */
+         for (i = 0; i < nB; i++)
+            r[i] = b[i];
+         for (i = 0; i < nA; i++)
+            r[nB + i] = a[i];
+         break;
+      case SF_SetLo:
+         for (i = 0; i < nR; i++)
+            r[i] = i < nB ? b[i] : a[i];
+         break;
+   }
+   return bytesToConst(tyR, r);
+}
 
 /* Helper for arbitrary expression pattern matching in flat IR.  If
    'e' is a reference to a tmp, look it up in env -- repeatedly, if
@@ -1448,6 +1849,17 @@ static IRExpr* chase1 ( IRExpr** env, IRExpr* e )
       return env[(Int)e->Iex.RdTmp.tmp];
 }
 
+/* Helper for the absorption rules: does 'e' resolve to a binary 'op'
+   one of whose arguments is the atom 'a'? */
+static Bool isBinopWithArg ( IRExpr** env, IRExpr* e, IROp op,
+                             const IRExpr* a )
+{
+   IRExpr* d = chase(env, e);
+   return d != NULL && d->tag == Iex_Binop && d->Iex.Binop.op == op
+          && (eqIRAtom(d->Iex.Binop.arg1, a)
+              || eqIRAtom(d->Iex.Binop.arg2, a));
+}
+
 __attribute__((noinline))
 static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
 {
@@ -1577,6 +1989,10 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
             e2 = IRExpr_Const(IRConst_V128(
                     ~ (e->Iex.Unop.arg->Iex.Const.con->Ico.V128)));
             break;
+         case Iop_NotV256:
+            e2 = IRExpr_Const(IRConst_V256(
+                    ~ (e->Iex.Unop.arg->Iex.Const.con->Ico.V256)));
+            break;
          case Iop_Not64:
             e2 = IRExpr_Const(IRConst_U64(
                     ~ (e->Iex.Unop.arg->Iex.Const.con->Ico.U64)));
@@ -1763,84 +2179,14 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
             break;
          }
 
-         /* For these vector ones, can't fold all cases, but at least
-            do the most obvious one.  Could do better here using
-            summarise/desummarise of vector constants, but too
-            difficult to verify; hence just handle the zero cases. */
-         case Iop_32UtoV128: {
-            UInt u32 = e->Iex.Unop.arg->Iex.Const.con->Ico.U32;
-            if (0 == u32) {
-               e2 = IRExpr_Const(IRConst_V128(0x0000));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-         case Iop_V128to64: {
-            UShort v128 = e->Iex.Unop.arg->Iex.Const.con->Ico.V128;
-            if (0 == ((v128 >> 0) & 0xFF)) {
-               e2 = IRExpr_Const(IRConst_U64(0));
-            } else {
+         default: {
+            IRExpr* folded = fold_SIMD_Unop(e->Iex.Unop.op,
+                                            e->Iex.Unop.arg->Iex.Const.con);
+            if (folded == NULL)
                goto unhandled;
-            }
+            e2 = folded;
             break;
          }
-         case Iop_V128HIto64: {
-            UShort v128 = e->Iex.Unop.arg->Iex.Const.con->Ico.V128;
-            if (0 == ((v128 >> 8) & 0xFF)) {
-               e2 = IRExpr_Const(IRConst_U64(0));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-         case Iop_64UtoV128: {
-            ULong u64 = e->Iex.Unop.arg->Iex.Const.con->Ico.U64;
-            if (0 == u64) {
-               e2 = IRExpr_Const(IRConst_V128(0x0000));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-
-         /* Even stupider (although still correct ..) */
-         case Iop_V256to64_0: case Iop_V256to64_1:
-         case Iop_V256to64_2: case Iop_V256to64_3: {
-            UInt v256 = e->Iex.Unop.arg->Iex.Const.con->Ico.V256;
-            if (v256 == 0x00000000) {
-               e2 = IRExpr_Const(IRConst_U64(0));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-
-         /* Similarly .. */
-         case Iop_V256toV128_0: case Iop_V256toV128_1: {
-            UInt v256 = e->Iex.Unop.arg->Iex.Const.con->Ico.V256;
-            if (v256 == 0x00000000) {
-               e2 = IRExpr_Const(IRConst_V128(0x0000));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-
-         case Iop_ZeroHI64ofV128: {
-            /* Could do better here -- only need to look at the bottom 64 bits
-               of the argument, really. */
-            UShort v128 = e->Iex.Unop.arg->Iex.Const.con->Ico.V128;
-            if (v128 == 0x0000) {
-               e2 = IRExpr_Const(IRConst_V128(0x0000));
-            } else {
-               goto unhandled;
-            }
-            break;
-         }
-
-         default: 
-            goto unhandled;
          } // switch (e->Iex.Unop.op)
 
       } else {
@@ -1886,6 +2232,69 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
            nomatch:
             break;
          }
+         case Iop_NotV128:
+         case Iop_NotV256:
+         case Iop_CmpNEZ8x16: case Iop_CmpNEZ16x8:
+         case Iop_CmpNEZ32x4: case Iop_CmpNEZ64x2:
+         case Iop_CmpNEZ8x32: case Iop_CmpNEZ16x16:
+         case Iop_CmpNEZ32x8: case Iop_CmpNEZ64x4: {
+            /* NotV128(NotV128(x)) ==> x, and similarly for V256.
+               CmpNEZ32x4(CmpNEZ32x4(x)) ==> CmpNEZ32x4(x), and similarly
+               for the other lane sizes.  Memcheck's shadow computations
+               for vector code produce the latter. */
+            IRExpr* a1 = chase(env, e->Iex.Unop.arg);
+            if (a1 && a1->tag == Iex_Unop
+                && a1->Iex.Unop.op == e->Iex.Unop.op) {
+               if (e->Iex.Unop.op == Iop_NotV128
+                   || e->Iex.Unop.op == Iop_NotV256)
+                  e2 = a1->Iex.Unop.arg;
+               else
+                  e2 = e->Iex.Unop.arg;
+            }
+            break;
+         }
+         case Iop_V128to64:
+         case Iop_V128HIto64: {
+            /* Taking a half of a vector which was made from halves:
+                 V128to64(64HLtoV128(h,l))          ==> l
+                 V128HIto64(64HLtoV128(h,l))        ==> h
+                 V128to64(InterleaveLO64x2(a,b))    ==> V128to64(b)
+                 V128HIto64(InterleaveLO64x2(a,b))  ==> V128to64(a)
+                 V128to64(InterleaveHI64x2(a,b))    ==> V128HIto64(b)
+                 V128HIto64(InterleaveHI64x2(a,b))  ==> V128HIto64(a) */
+            Bool    hi = e->Iex.Unop.op == Iop_V128HIto64;
+            IRExpr* a1 = chase(env, e->Iex.Unop.arg);
+            if (!a1 || a1->tag != Iex_Binop)
+               break;
+            switch (a1->Iex.Binop.op) {
+               case Iop_64HLtoV128:
+                  e2 = hi ? a1->Iex.Binop.arg1 : a1->Iex.Binop.arg2;
+                  break;
+               case Iop_InterleaveLO64x2:
+                  e2 = IRExpr_Unop(Iop_V128to64, hi ? a1->Iex.Binop.arg1
+                                                    : a1->Iex.Binop.arg2);
+                  break;
+               case Iop_InterleaveHI64x2:
+                  e2 = IRExpr_Unop(Iop_V128HIto64, hi ? a1->Iex.Binop.arg1
+                                                      : a1->Iex.Binop.arg2);
+                  break;
+               default:
+                  break;
+            }
+            break;
+         }
+         case Iop_V256toV128_0:
+         case Iop_V256toV128_1: {
+            /* V256toV128_0(V128HLtoV256(h,l)) ==> l
+               V256toV128_1(V128HLtoV256(h,l)) ==> h */
+            IRExpr* a1 = chase(env, e->Iex.Unop.arg);
+            if (a1 && a1->tag == Iex_Binop
+                && a1->Iex.Binop.op == Iop_V128HLtoV256) {
+               e2 = e->Iex.Unop.op == Iop_V256toV128_1 ? a1->Iex.Binop.arg1
+                                                       : a1->Iex.Binop.arg2;
+            }
+            break;
+         }
          default:
             break;
          } // switch (e->Iex.Unop.op)
@@ -1931,6 +2340,11 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                        (e->Iex.Binop.arg1->Iex.Const.con->Ico.V128
                         | e->Iex.Binop.arg2->Iex.Const.con->Ico.V128)));
                break;
+            case Iop_OrV256:
+               e2 = IRExpr_Const(IRConst_V256(
+                       (e->Iex.Binop.arg1->Iex.Const.con->Ico.V256
+                        | e->Iex.Binop.arg2->Iex.Const.con->Ico.V256)));
+               break;
 
             /* -- Xor -- */
             case Iop_Xor8:
@@ -1958,6 +2372,11 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                        (e->Iex.Binop.arg1->Iex.Const.con->Ico.V128
                         ^ e->Iex.Binop.arg2->Iex.Const.con->Ico.V128)));
                break;
+            case Iop_XorV256:
+               e2 = IRExpr_Const(IRConst_V256(
+                       (e->Iex.Binop.arg1->Iex.Const.con->Ico.V256
+                        ^ e->Iex.Binop.arg2->Iex.Const.con->Ico.V256)));
+               break;
 
             /* -- And -- */
             case Iop_And1:
@@ -1990,6 +2409,11 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                        (e->Iex.Binop.arg1->Iex.Const.con->Ico.V128
                         & e->Iex.Binop.arg2->Iex.Const.con->Ico.V128)));
                break;
+            case Iop_AndV256:
+               e2 = IRExpr_Const(IRConst_V256(
+                       (e->Iex.Binop.arg1->Iex.Const.con->Ico.V256
+                        & e->Iex.Binop.arg2->Iex.Const.con->Ico.V256)));
+               break;
 
             /* -- Add -- */
             case Iop_Add8:
@@ -2551,51 +2975,16 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                   handle it, so as to stop getting blasted with
                   no-rule-for-this-primop messages. */
                break;
-            /* For this vector one, can't fold all cases, but at
-               least do the most obvious one.  Could do better here
-               using summarise/desummarise of vector constants, but
-               too difficult to verify; hence just handle the zero
-               cases. */
-            case Iop_64HLtoV128: {
-               ULong argHi = e->Iex.Binop.arg1->Iex.Const.con->Ico.U64;
-               ULong argLo = e->Iex.Binop.arg2->Iex.Const.con->Ico.U64;
-               if (0 == argHi && 0 == argLo) {
-                  e2 = IRExpr_Const(IRConst_V128(0));
-               } else {
+            default: {
+               IRExpr* folded
+                  = fold_SIMD_Binop(e->Iex.Binop.op,
+                                    e->Iex.Binop.arg1->Iex.Const.con,
+                                    e->Iex.Binop.arg2->Iex.Const.con);
+               if (folded == NULL)
                   goto unhandled;
-               }
-               break;
-            }
-            /* Same reasoning for the 256-bit version. */
-            case Iop_V128HLtoV256: {
-               IRExpr* argHi = e->Iex.Binop.arg1;
-               IRExpr* argLo = e->Iex.Binop.arg2;
-               if (isZeroV128(argHi) && isZeroV128(argLo)) {
-                  e2 = IRExpr_Const(IRConst_V256(0));
-               } else {
-                  goto unhandled;
-               }
-               break;
-            }
-
-            /* -- V128 stuff -- */
-            case Iop_InterleaveLO64x2: // This, and the HI64, are created
-            case Iop_InterleaveHI64x2: // by the amd64 PTEST translation
-            case Iop_InterleaveLO8x16: {
-               /* This turns up a lot in Memcheck instrumentation of
-                  Icc generated code.  I don't know why. */
-               UShort arg1 =  e->Iex.Binop.arg1->Iex.Const.con->Ico.V128;
-               UShort arg2 =  e->Iex.Binop.arg2->Iex.Const.con->Ico.V128;
-               if (0 == arg1 && 0 == arg2) {
-                  e2 = IRExpr_Const(IRConst_V128(0));
-               } else {
-                  goto unhandled;
-               }
+               e2 = folded;
                break;
             }
-
-            default:
-               goto unhandled;
          }
 
       } else {
@@ -2846,6 +3235,27 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                      }
                   }
                }
+               /* Absorption, and the commuted forms of these:
+                    AndV128(a, OrV128(a,b))  ==> a
+                    AndV128(a, AndV128(a,b)) ==> AndV128(a,b)
+                  and similarly for V256. */
+               if (e->Iex.Binop.op == Iop_AndV128
+                   || e->Iex.Binop.op == Iop_AndV256) {
+                  IROp opOr = e->Iex.Binop.op == Iop_AndV128 ? Iop_OrV128
+                                                             : Iop_OrV256;
+                  IRExpr* a1 = e->Iex.Binop.arg1;
+                  IRExpr* a2 = e->Iex.Binop.arg2;
+                  if (isBinopWithArg(env, a2, opOr, a1)
+                      || isBinopWithArg(env, a1, e->Iex.Binop.op, a2)) {
+                     e2 = a1;
+                     break;
+                  }
+                  if (isBinopWithArg(env, a1, opOr, a2)
+                      || isBinopWithArg(env, a2, e->Iex.Binop.op, a1)) {
+                     e2 = a2;
+                     break;
+                  }
+               }
                break;
 
             case Iop_OrV128:
@@ -2878,6 +3288,33 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                   //   break;
                   //}
                }
+               /* OrV128(t,1...1) ==> 1...1 */
+               if (e->Iex.Binop.op == Iop_OrV128
+                   && (isOnesV128(e->Iex.Binop.arg1)
+                       || isOnesV128(e->Iex.Binop.arg2))) {
+                  e2 = IRExpr_Const(IRConst_V128(0xFFFF));
+                  break;
+               }
+               /* Absorption, and the commuted forms of these:
+                    OrV128(a, AndV128(a,b)) ==> a
+                    OrV128(a, OrV128(a,b))  ==> OrV128(a,b)
+                  and similarly for V256. */
+               {
+                  IROp opAnd = e->Iex.Binop.op == Iop_OrV128 ? Iop_AndV128
+                                                             : Iop_AndV256;
+                  IRExpr* a1 = e->Iex.Binop.arg1;
+                  IRExpr* a2 = e->Iex.Binop.arg2;
+                  if (isBinopWithArg(env, a2, opAnd, a1)
+                      || isBinopWithArg(env, a1, e->Iex.Binop.op, a2)) {
+                     e2 = a1;
+                     break;
+                  }
+                  if (isBinopWithArg(env, a1, opAnd, a2)
+                      || isBinopWithArg(env, a2, e->Iex.Binop.op, a1)) {
+                     e2 = a2;
+                     break;
+                  }
+               }
                break;
 
             case Iop_Xor8:
@@ -2981,6 +3418,57 @@ static IRExpr* fold_Expr_WRK ( IRExpr** env, IRExpr* e )
                }
                break;
 
+            case Iop_Max8Sx16: case Iop_Max16Sx8: case Iop_Max32Sx4:
+            case Iop_Max8Ux16: case Iop_Max16Ux8: case Iop_Max32Ux4:
+            case Iop_Min8Sx16: case Iop_Min16Sx8: case Iop_Min32Sx4:
+            case Iop_Min8Ux16: case Iop_Min16Ux8: case Iop_Min32Ux4:
+            case Iop_Max8Sx32: case Iop_Max16Sx16: case Iop_Max32Sx8:
+            case Iop_Max8Ux32: case Iop_Max16Ux16: case Iop_Max32Ux8:
+            case Iop_Min8Sx32: case Iop_Min16Sx16: case Iop_Min32Sx8:
+            case Iop_Min8Ux32: case Iop_Min16Ux16: case Iop_Min32Ux8:
+               /* Max/Min(t,t) ==> t, for some IRTemp t */
+               if (sameIRExprs(env, e->Iex.Binop.arg1, e->Iex.Binop.arg2)) {
+                  e2 = e->Iex.Binop.arg1;
+                  break;
+               }
+               break;
+
+            case Iop_InterleaveLO64x2:
+            case Iop_InterleaveHI64x2: {
+               /* An interleave of two interleaves of the same kind picks
+                  its halves directly from the inner arguments:
+                    InterleaveLO64x2(P(a,b), P(c,d)) ==> P(b,d)
+                    InterleaveHI64x2(P(a,b), P(c,d)) ==> P(a,c)
+                  where P is InterleaveLO64x2 or InterleaveHI64x2. */
+               IRExpr* a1 = chase(env, e->Iex.Binop.arg1);
+               IRExpr* a2 = chase(env, e->Iex.Binop.arg2);
+               if (a1 && a2 && a1->tag == Iex_Binop && a2->tag == Iex_Binop
+                   && a1->Iex.Binop.op == a2->Iex.Binop.op
+                   && (a1->Iex.Binop.op == Iop_InterleaveLO64x2
+                       || a1->Iex.Binop.op == Iop_InterleaveHI64x2)) {
+                  if (e->Iex.Binop.op == Iop_InterleaveLO64x2)
+                     e2 = IRExpr_Binop(a1->Iex.Binop.op,
+                                       a1->Iex.Binop.arg2, a2->Iex.Binop.arg2);
+                  else
+                     e2 = IRExpr_Binop(a1->Iex.Binop.op,
+                                       a1->Iex.Binop.arg1, a2->Iex.Binop.arg1);
+               }
+               break;
+            }
+
+            case Iop_64HLtoV128: {
+               /* 64HLtoV128(V128HIto64(x), V128to64(x)) ==> x */
+               IRExpr* a1 = chase(env, e->Iex.Binop.arg1);
+               IRExpr* a2 = chase(env, e->Iex.Binop.arg2);
+               if (a1 && a2 && a1->tag == Iex_Unop && a2->tag == Iex_Unop
+                   && a1->Iex.Unop.op == Iop_V128HIto64
+                   && a2->Iex.Unop.op == Iop_V128to64
+                   && eqIRAtom(a1->Iex.Unop.arg, a2->Iex.Unop.arg)) {
+                  e2 = a1->Iex.Unop.arg;
+               }
+               break;
+            }
+
             default:
                break;
          }
@@ -4518,7 +5006,7 @@ static AvailExpr* irExpr_to_AvailExpr ( IRExpr* e, Bool allowLoadsToBeCSEd )
    is something of a dodgy proposition if the guest program is doing
    some screwy stuff to do with races and spinloops. */
 
-static Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
+Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
 {
    Int        i, j, paranoia;
    IRTemp     t, q;
@@ -4557,18 +5045,25 @@ static Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
       /* This is critical: remove from aenv any E' -> .. bindings
          which might be invalidated by this statement.  The only
          vulnerable kind of bindings are the GetI and Load kinds.
-            Dirty call - dump (paranoia level -> 2) 
-            Store      - dump (ditto) 
+            Store      - dump (paranoia level -> 2)
             Put, PutI  - dump unless no-overlap is proven (.. -> 1)
+            Dirty call - dump unless its declared effects show it
+                         writes neither the array nor memory (.. -> 1)
          Uses getAliasingRelation_IC and getAliasingRelation_II
          to do the no-overlap assessments needed for Put/PutI.
+
+         A dirty call also trashes the caller-saved registers, so
+         anything still available after it must either be kept in a
+         callee-saved register or spilled.  For the cheap forms -- all
+         but CCall, GetIt and Load -- recomputing the value is cheaper
+         than that, so forget them at dirty calls too.
       */
       switch (st->tag) {
-         case Ist_Dirty: case Ist_Store: case Ist_MBE:
+         case Ist_Store: case Ist_MBE:
          case Ist_CAS: case Ist_LLSC:
          case Ist_StoreG:
             paranoia = 2; break;
-         case Ist_Put: case Ist_PutI: 
+         case Ist_Put: case Ist_PutI: case Ist_Dirty:
             paranoia = 1; break;
          case Ist_NoOp: case Ist_IMark: case Ist_AbiHint: 
          case Ist_WrTmp: case Ist_Exit: case Ist_LoadG:
@@ -4582,6 +5077,12 @@ static Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
             if (!aenv->inuse[j])
                continue;
             ae = (AvailExpr*)aenv->key[j];
+            if (st->tag == Ist_Dirty
+                && ae->tag != CCall && ae->tag != GetIt && ae->tag != Load) {
+               aenv->inuse[j] = False;
+               aenv->key[j]   = (HWord)NULL;
+               continue;
+            }
             if (ae->tag != GetIt && ae->tag != Load) 
                continue;
             invalidate = False;
@@ -4589,6 +5090,22 @@ static Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
                invalidate = True;
             } else {
                vassert(paranoia == 1);
+               if (st->tag == Ist_Dirty) {
+                  /* Tool instrumentation adds many dirty calls which
+                     touch neither memory nor the guest state, so
+                     believe what the call says about itself. */
+                  IRDirty* d = st->Ist.Dirty.details;
+                  if (ae->tag == Load) {
+                     if (d->mFx == Ifx_Write || d->mFx == Ifx_Modify)
+                        invalidate = True;
+                  } else {
+                     UInt minoff, maxoff;
+                     getArrayBounds( ae->u.GetIt.descr, &minoff, &maxoff );
+                     if (dirtyWritesOverlap( d, minoff, maxoff ))
+                        invalidate = True;
+                  }
+               }
+               else
                if (ae->tag == Load) {
                   /* Loads can be invalidated by anything that could
                      possibly touch memory.  But in that case we
@@ -5992,6 +6509,31 @@ static IRExpr* fold_IRExpr_Unop ( IROp op, IRExpr* aa )
       if (is_Unop(aa, Iop_Left64))
          return IRExpr_Unop( Iop_Left64, aa->Iex.Unop.arg );
       break;
+   case Iop_CmpNEZ8x16: case Iop_CmpNEZ16x8:
+   case Iop_CmpNEZ32x4: case Iop_CmpNEZ64x2:
+   case Iop_CmpNEZ8x32: case Iop_CmpNEZ16x16:
+   case Iop_CmpNEZ32x8: case Iop_CmpNEZ64x4: {
+      /* CmpNEZ32x4( OrV128( CmpNEZ32x4(x), y ) )
+            --> CmpNEZ32x4( OrV128( x, y ) ),
+         likewise with the Or operands swapped, and for the other lane
+         sizes and V256.  Memcheck builds these when it pessimises the
+         shadow of a value which was itself pessimised. */
+      IROp opOr = (op == Iop_CmpNEZ8x32 || op == Iop_CmpNEZ16x16
+                   || op == Iop_CmpNEZ32x8 || op == Iop_CmpNEZ64x4)
+                     ? Iop_OrV256 : Iop_OrV128;
+      if (is_Binop(aa, opOr) && is_Unop(aa->Iex.Binop.arg1, op))
+         return fold_IRExpr_Unop(
+                   op, IRExpr_Binop(opOr, aa->Iex.Binop.arg1->Iex.Unop.arg,
+                                          aa->Iex.Binop.arg2));
+      if (is_Binop(aa, opOr) && is_Unop(aa->Iex.Binop.arg2, op))
+         return fold_IRExpr_Unop(
+                   op, IRExpr_Binop(opOr, aa->Iex.Binop.arg1,
+                                          aa->Iex.Binop.arg2->Iex.Unop.arg));
+      /* CmpNEZ32x4( CmpNEZ32x4(x) ) --> CmpNEZ32x4(x) */
+      if (is_Unop(aa, op))
+         return aa;
+      break;
+   }
    case Iop_ZeroHI64ofV128:
       /* ZeroHI64ofV128( ZeroHI64ofV128(x) ) --> ZeroHI64ofV128(x) */
       if (is_Unop(aa, Iop_ZeroHI64ofV128))
@@ -59,6 +59,11 @@ IRSB* cprop_BB ( IRSB* );
 extern
 void do_deadcode_BB ( IRSB* bb );
 
+/* Do a common subexpression elimination pass.  bb is destructively
+   modified.  Returns True if any changes were made. */
+extern
+Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd );
+
 /* The tree-builder.  Make (approximately) maximal safe trees.  bb is
    destructively modified.  Returns (unrelatedly, but useful later on)
    the guest address of the highest addressed byte from any insn in
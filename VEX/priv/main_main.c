@@ -203,7 +203,9 @@ void LibVEX_default_VexControl ( /*OUT*/ VexControl* vcon )
    vcon->iropt_unroll_thresh            = 120;
    vcon->guest_max_insns                = 60;
    vcon->guest_chase                    = True;
+   vcon->guest_remove_dead_cc           = False;
    vcon->regalloc_version               = 3;
+   vcon->hot_cold_split                 = False;
    vcon->iropt_fold_expr                = True;
 }
 
@@ -246,7 +248,10 @@ void LibVEX_Init (
    vassert(vcon->guest_max_insns >= 1);
    vassert(vcon->guest_max_insns <= 100);
    vassert(vcon->guest_chase == False || vcon->guest_chase == True);
-   vassert(vcon->regalloc_version == 2 || vcon->regalloc_version == 3);
+   vassert(vcon->guest_remove_dead_cc == False
+           || vcon->guest_remove_dead_cc == True);
+   vassert(vcon->regalloc_version >= 2 && vcon->regalloc_version <= 4);
+   vassert(vcon->hot_cold_split == False || vcon->hot_cold_split == True);
 
    /* Check that Vex has been built with sizes of basic types as
       stated in priv/libvex_basictypes.h.  Failure of any of these is
@@ -337,17 +342,20 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    IRExpr*      (*specHelper)   ( const HChar*, IRExpr**, IRStmt**, Int );
    Bool (*preciseMemExnsFn) ( Int, Int, VexRegisterUpdates );
    DisOneInstrFn disInstrFn;
+   CCDeadFn      ccDeadFn;
 
    VexGuestLayout* guest_layout;
    IRSB*           irsb;
    Int             i;
    Int             offB_CMSTART, offB_CMLEN, offB_GUEST_IP, szB_GUEST_IP;
+   Int             offB_GUEST_CC, szB_GUEST_CC;
    IRType          guest_word_type;
    IRType          host_word_type;
 
    guest_layout            = NULL;
    specHelper              = NULL;
    disInstrFn              = NULL;
+   ccDeadFn                = NULL;
    preciseMemExnsFn        = NULL;
    guest_word_type         = arch_word_size(vta->arch_guest);
    host_word_type          = arch_word_size(vta->arch_host);
@@ -355,6 +363,8 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    offB_CMLEN              = 0;
    offB_GUEST_IP           = 0;
    szB_GUEST_IP            = 0;
+   offB_GUEST_CC           = 0;
+   szB_GUEST_CC            = 0;
 
    vassert(vex_initdone);
    vassert(vta->needs_self_check  != NULL);
@@ -410,11 +420,16 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
          offB_CMLEN              = offsetof(VexGuestAMD64State,guest_CMLEN);
          offB_GUEST_IP           = offsetof(VexGuestAMD64State,guest_RIP);
          szB_GUEST_IP            = sizeof( ((VexGuestAMD64State*)0)->guest_RIP );
+         ccDeadFn                = AMD64FN(guest_amd64_cc_dead_at);
+         offB_GUEST_CC           = offsetof(VexGuestAMD64State,guest_CC_OP);
+         szB_GUEST_CC            = offsetof(VexGuestAMD64State,guest_CC_NDEP)
+                                   + 8 - offB_GUEST_CC;
          vassert(vta->archinfo_guest.endness == VexEndnessLE);
          vassert(0 == sizeof(VexGuestAMD64State) % LibVEX_GUEST_STATE_ALIGN);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_CMSTART ) == 8);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_CMLEN   ) == 8);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_NRADDR  ) == 8);
+         vassert(szB_GUEST_CC == 4 * 8);
          break;
 
       case VexArchPPC32:
@@ -590,6 +605,11 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    res->n_guest_instrs = 0;
    res->n_uncond_in_trace = 0;
    res->n_cond_in_trace = 0;
+   res->n_spills = 0;
+   res->n_reloads = 0;
+   res->n_remats = 0;
+   res->n_moves = 0;
+   res->n_hot_bytes = 0;
 
 #ifndef VEXMULTIARCH
    /* yet more sanity checks ... */
@@ -625,6 +645,7 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
                      vta->guest_bytes, 
                      vta->guest_bytes_addr,
                      vta->chase_into_ok,
+                     vta->chase_cond_hint,
                      vta->archinfo_host.endness,
                      vta->sigill_diag,
                      vta->arch_guest,
@@ -636,7 +657,10 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
                      offB_CMSTART,
                      offB_CMLEN,
                      offB_GUEST_IP,
-                     szB_GUEST_IP );
+                     szB_GUEST_IP,
+                     ccDeadFn,
+                     offB_GUEST_CC,
+                     szB_GUEST_CC );
 
    vexAllocSanityCheck();
 
@@ -735,10 +759,17 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    //    sanityCheckIRSB( irsb, "after instrumentation",
    //                     True/*must be flat*/, guest_word_type );
 
-   /* Do a post-instrumentation cleanup pass. */
+   /* Do a post-instrumentation cleanup pass.  The instrumentation
+      often recomputes values, such as shadow values of the same guest
+      value, which were already computed before a dirty call; CSE them
+      away, relying on the effects declared by the dirty calls. */
    if (vta->instrument1 || vta->instrument2) {
       do_deadcode_BB( irsb );
       irsb = cprop_BB( irsb );
+      if (vex_control.iropt_level > 0
+          && do_cse_BB( irsb, False/*!allowLoadsToBeCSEd*/ )) {
+         irsb = cprop_BB( irsb );
+      }
       do_deadcode_BB( irsb );
       sanityCheckIRSB( irsb, "after post-instrumentation cleanup",
                        True/*must be flat*/, guest_word_type );
@@ -774,6 +805,11 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
    void         (*genReload)    ( HInstr**, HInstr**, HReg, Int, Bool );
    HInstr*      (*genMove)      ( HReg, HReg, Bool );
    HInstr*      (*directReload) ( HInstr*, HReg, Short );
+   HInstr*      (*genRemat)     ( const HInstr*, HReg, Bool );
+   HInstr*      (*genColdPart)  ( const HInstr*, Bool*, Bool );
+   Int          (*emitColdJump) ( UChar*, const HInstr* );
+   Int          (*emitXIndirIC) ( UChar*, Int, const HInstr*,
+                                  const void*, const void* );
    void         (*ppInstr)      ( const HInstr*, Bool );
    UInt         (*ppReg)        ( HReg );
    HInstrArray* (*iselSB)       ( const IRSB*, VexArch, const VexArchInfo*,
@@ -803,6 +839,10 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
    genReload               = NULL;
    genMove                 = NULL;
    directReload            = NULL;
+   genRemat                = NULL;
+   genColdPart             = NULL;
+   emitColdJump            = NULL;
+   emitXIndirIC            = NULL;
    ppInstr                 = NULL;
    ppReg                   = NULL;
    iselSB                  = NULL;
@@ -828,6 +868,7 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
    } else {
       vassert(vta->disp_cp_chain_me_to_fastEP == NULL);
       vassert(vta->disp_cp_xindir             == NULL);
+      vassert(vta->disp_cp_xindir_miss        == NULL);
    }
 
    switch (vta->arch_guest) {
@@ -954,6 +995,13 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
          genReload    = CAST_TO_TYPEOF(genReload) AMD64FN(genReload_AMD64);
          genMove      = CAST_TO_TYPEOF(genMove) AMD64FN(genMove_AMD64);
          directReload = CAST_TO_TYPEOF(directReload) AMD64FN(directReload_AMD64);
+         genRemat     = CAST_TO_TYPEOF(genRemat) AMD64FN(genRemat_AMD64);
+         genColdPart
+            = CAST_TO_TYPEOF(genColdPart) AMD64FN(genColdPart_AMD64);
+         emitColdJump
+            = CAST_TO_TYPEOF(emitColdJump) AMD64FN(emitColdJump_AMD64);
+         emitXIndirIC
+            = CAST_TO_TYPEOF(emitXIndirIC) AMD64FN(emitXIndirIC_AMD64);
          ppInstr      = CAST_TO_TYPEOF(ppInstr) AMD64FN(ppAMD64Instr);
          ppReg        = CAST_TO_TYPEOF(ppReg) AMD64FN(ppHRegAMD64);
          iselSB       = AMD64FN(iselSB_AMD64);
@@ -1178,10 +1226,13 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
    }
 
    /* Register allocate. */
+   RegAllocStats ra_stats;
+   vex_bzero(&ra_stats, sizeof(ra_stats));
    RegAllocControl con = {
       .univ = rRegUniv, .getRegUsage = getRegUsage, .mapRegs = mapRegs,
       .genSpill = genSpill, .genReload = genReload, .genMove = genMove,
       .directReload = directReload, .guest_sizeB = guest_sizeB,
+      .genRemat = genRemat, .stats = &ra_stats,
       .ppInstr = ppInstr, .ppReg = ppReg, .mode64 = mode64};
    switch (vex_control.regalloc_version) {
    case 2:
@@ -1190,9 +1241,16 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
    case 3:
       rcode = doRegisterAllocation_v3(vcode, &con);
       break;
+   case 4:
+      rcode = doRegisterAllocation_v4(vcode, &con);
+      break;
    default:
       vassert(0);
    }
+   res->n_spills  = ra_stats.n_spills;
+   res->n_reloads = ra_stats.n_reloads;
+   res->n_remats  = ra_stats.n_remats;
+   res->n_moves   = ra_stats.n_moves;
 
    vexAllocSanityCheck();
 
@@ -1222,21 +1280,79 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
                    "------------------------\n\n");
    }
 
+   /* Hot/cold splitting.  Conditional side exits and conditional
+      helper calls are rarely taken, so where the host supports it,
+      each is emitted as a single "jump if taken" in the main line of
+      code, and the exit or call itself is emitted after the end of
+      the main line, in the cold part of the translation.  That keeps
+      the frequently executed code dense.  The last conditional exit
+      is not moved, since that is usually the block-ending guest
+      branch, which may well be taken as often as not. */
+   Int     n_cold    = 0;
+   Int     last_exit = -1;
+   HInstr** cold_of  = NULL; /* the cold part of each insn, if any */
+   Bool*   cold_jb   = NULL; /* and whether it jumps back */
+   HInstr** cold_hi  = NULL;
+   Int*    cold_from = NULL;
+   Int*    cold_back = NULL;
+   if (genColdPart && vex_control.hot_cold_split) {
+      cold_of = LibVEX_Alloc_inline(rcode->arr_used * sizeof(HInstr*));
+      cold_jb = LibVEX_Alloc_inline(rcode->arr_used * sizeof(Bool));
+      for (i = 0; i < rcode->arr_used; i++) {
+         cold_jb[i] = False;
+         cold_of[i] = genColdPart(rcode->arr[i], &cold_jb[i], mode64);
+         if (cold_of[i] != NULL) {
+            if (!cold_jb[i])
+               last_exit = i;
+            n_cold++;
+         }
+      }
+      if (last_exit >= 0) {
+         cold_of[last_exit] = NULL;
+         n_cold--;
+      }
+      if (n_cold > 0) {
+         cold_hi   = LibVEX_Alloc_inline(n_cold * sizeof(HInstr*));
+         cold_from = LibVEX_Alloc_inline(n_cold * sizeof(Int));
+         cold_back = LibVEX_Alloc_inline(n_cold * sizeof(Int));
+      }
+      n_cold = 0;
+   }
+
    out_used = 0; /* tracks along the host_bytes array */
    for (i = 0; i < rcode->arr_used; i++) {
       HInstr* hi           = rcode->arr[i];
+      HInstr* hi_cold      = NULL;
       Bool    hi_isProfInc = False;
+      Bool    back         = False;
       if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
          ppInstr(hi, mode64);
          vex_printf("\n");
       }
-      j = emit( &hi_isProfInc,
-                insn_bytes, sizeof insn_bytes, hi,
-                mode64, vta->archinfo_host.endness,
-                vta->disp_cp_chain_me_to_slowEP,
-                vta->disp_cp_chain_me_to_fastEP,
-                vta->disp_cp_xindir,
-                vta->disp_cp_xassisted );
+      if (cold_hi) {
+         hi_cold = cold_of[i];
+         back    = cold_jb[i];
+      }
+      if (hi_cold) {
+         j = emitColdJump(insn_bytes, hi);
+         cold_hi[n_cold]   = hi_cold;
+         cold_from[n_cold] = out_used + j;
+         cold_back[n_cold] = back ? out_used + j : -1;
+         n_cold++;
+      } else {
+         j = 0;
+         if (emitXIndirIC && vta->disp_cp_xindir_miss)
+            j = emitXIndirIC(insn_bytes, sizeof insn_bytes, hi,
+                             vta->disp_cp_xindir, vta->disp_cp_xindir_miss);
+         if (j == 0)
+            j = emit( &hi_isProfInc,
+                      insn_bytes, sizeof insn_bytes, hi,
+                      mode64, vta->archinfo_host.endness,
+                      vta->disp_cp_chain_me_to_slowEP,
+                      vta->disp_cp_chain_me_to_fastEP,
+                      vta->disp_cp_xindir,
+                      vta->disp_cp_xassisted );
+      }
       if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
          for (k = 0; k < j; k++)
             vex_printf("%02x ", (UInt)insn_bytes[k]);
@@ -1261,6 +1377,70 @@ static void libvex_BackEnd ( const VexTranslateArgs *vta,
         out_used += j;
       }
    }
+
+   /* Now the cold part.  Emit each moved exit or call, followed for
+      calls by a jump back to the main line, and point the main line's
+      jump at it.  Jump displacements are relative to the end of the
+      jump instruction and are stored little-endian in its last four
+      bytes. */
+   if (n_cold > 0) {
+      res->n_hot_bytes = out_used;
+      if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+         vex_printf("------ cold part ------\n\n");
+      }
+   }
+   for (i = 0; i < n_cold; i++) {
+      Int   disp, n;
+      Bool  hi_isProfInc = False;
+      if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+         ppInstr(cold_hi[i], mode64);
+         vex_printf("\n");
+      }
+      j = 0;
+      if (emitXIndirIC && vta->disp_cp_xindir_miss)
+         j = emitXIndirIC(insn_bytes, sizeof insn_bytes, cold_hi[i],
+                          vta->disp_cp_xindir, vta->disp_cp_xindir_miss);
+      if (j == 0)
+         j = emit( &hi_isProfInc,
+                   insn_bytes, sizeof insn_bytes, cold_hi[i],
+                   mode64, vta->archinfo_host.endness,
+                   vta->disp_cp_chain_me_to_slowEP,
+                   vta->disp_cp_chain_me_to_fastEP,
+                   vta->disp_cp_xindir,
+                   vta->disp_cp_xassisted );
+      vassert(!hi_isProfInc);
+      if (cold_back[i] >= 0) {
+         n    = emitColdJump(&insn_bytes[j], NULL);
+         j   += n;
+         disp = cold_back[i] - (out_used + j);
+         insn_bytes[j-4] = toUChar(disp);
+         insn_bytes[j-3] = toUChar(disp >> 8);
+         insn_bytes[j-2] = toUChar(disp >> 16);
+         insn_bytes[j-1] = toUChar(disp >> 24);
+      }
+      if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+         for (k = 0; k < j; k++)
+            vex_printf("%02x ", (UInt)insn_bytes[k]);
+         vex_printf("\n\n");
+      }
+      if (UNLIKELY(out_used + j > vta->host_bytes_size)) {
+         vexSetAllocModeTEMP_and_clear();
+         vex_traceflags = 0;
+         res->status = VexTransOutputFull;
+         return;
+      }
+      disp = out_used - cold_from[i];
+      vta->host_bytes[cold_from[i]-4] = toUChar(disp);
+      vta->host_bytes[cold_from[i]-3] = toUChar(disp >> 8);
+      vta->host_bytes[cold_from[i]-2] = toUChar(disp >> 16);
+      vta->host_bytes[cold_from[i]-1] = toUChar(disp >> 24);
+      { UChar* dst = &vta->host_bytes[out_used];
+        for (k = 0; k < j; k++) {
+           dst[k] = insn_bytes[k];
+        }
+        out_used += j;
+      }
+   }
    *(vta->host_bytes_used) = out_used;
 
    vexAllocSanityCheck();
@@ -1432,6 +1612,47 @@ VexInvalRange LibVEX_UnChain ( VexArch     arch_host,
    }
 }
 
+VexInvalRange LibVEX_PatchXIndirIC ( VexArch     arch_host,
+                                     VexEndness  endness_host,
+                                     void*       place_to_patch,
+                                     const void* disp_cp_xindir_miss_EXPECTED,
+                                     const void* disp_cp_xindir,
+                                     Addr        guest_addr,
+                                     const void* place_to_jump_to,
+                                     /*OUT*/void** entry )
+{
+   switch (arch_host) {
+      case VexArchAMD64:
+         AMD64ST(return patchXIndirIC_AMD64(endness_host,
+                                            place_to_patch,
+                                            disp_cp_xindir_miss_EXPECTED,
+                                            disp_cp_xindir,
+                                            guest_addr, place_to_jump_to,
+                                            entry));
+      default:
+         vassert(0);
+   }
+}
+
+VexInvalRange LibVEX_UnPatchXIndirIC ( VexArch     arch_host,
+                                       VexEndness  endness_host,
+                                       void*       place_to_unpatch,
+                                       const void* place_to_jump_to_EXPECTED,
+                                       const void* disp_cp_xindir,
+                                       const void* disp_cp_xindir_miss )
+{
+   switch (arch_host) {
+      case VexArchAMD64:
+         AMD64ST(return unpatchXIndirIC_AMD64(endness_host,
+                                              place_to_unpatch,
+                                              place_to_jump_to_EXPECTED,
+                                              disp_cp_xindir,
+                                              disp_cp_xindir_miss));
+      default:
+         vassert(0);
+   }
+}
+
 Int LibVEX_evCheckSzB ( VexArch    arch_host )
 {
    static Int cached = 0; /* DO NOT MAKE NON-STATIC */
@@ -1764,6 +1985,7 @@ static const HChar* show_hwcaps_amd64 ( UInt hwcaps )
       { VEX_HWCAPS_AMD64_RDTSCP, "rdtscp" },
       { VEX_HWCAPS_AMD64_SSE3,   "sse3"   },
       { VEX_HWCAPS_AMD64_SSSE3,  "ssse3"  },
+      { VEX_HWCAPS_AMD64_SSE41,  "sse4_1" },
       { VEX_HWCAPS_AMD64_AVX,    "avx"    },
       { VEX_HWCAPS_AMD64_AVX2,   "avx2"   },
       { VEX_HWCAPS_AMD64_BMI,    "bmi"    },
@@ -2123,6 +2345,7 @@ static void check_hwcaps ( VexArch arch, UInt hwcaps )
          /* Throw out obviously stupid cases: */
          Bool have_sse3  = (hwcaps & VEX_HWCAPS_AMD64_SSE3)  != 0;
          Bool have_ssse3 = (hwcaps & VEX_HWCAPS_AMD64_SSSE3) != 0;
+         Bool have_sse41 = (hwcaps & VEX_HWCAPS_AMD64_SSE41) != 0;
          Bool have_avx   = (hwcaps & VEX_HWCAPS_AMD64_AVX)   != 0;
          Bool have_bmi   = (hwcaps & VEX_HWCAPS_AMD64_BMI)   != 0;
          Bool have_avx2  = (hwcaps & VEX_HWCAPS_AMD64_AVX2)  != 0;
@@ -2131,6 +2354,10 @@ static void check_hwcaps ( VexArch arch, UInt hwcaps )
          if (have_ssse3 && !have_sse3)
             invalid_hwcaps(arch, hwcaps,
                            "Support for SSSE3 requires SSE3 capabilities\n");
+         /* SSE4.1 without SSSE3 */
+         if (have_sse41 && !have_ssse3)
+            invalid_hwcaps(arch, hwcaps,
+                           "Support for SSE4.1 requires SSSE3 capabilities\n");
          /* AVX without SSSE3 */
          if (have_avx && !have_ssse3)
             invalid_hwcaps(arch, hwcaps,
@@ -104,6 +104,7 @@ typedef
 #define VEX_HWCAPS_AMD64_RDSEED (1<<15) /* RDSEED instructions */
 #define VEX_HWCAPS_AMD64_FMA3   (1<<16) /* FMA3 instructions */
 #define VEX_HWCAPS_AMD64_FMA4   (1<<17) /* FMA4 instructions */
+#define VEX_HWCAPS_AMD64_SSE41  (1<<18) /* SSE4.1 instructions */
 
 /* ppc32: baseline capability is integer only */
 #define VEX_HWCAPS_PPC32_F     (1<<8)  /* basic (non-optional) FP */
@@ -512,6 +513,11 @@ void LibVEX_default_VexAbiInfo ( /*OUT*/VexAbiInfo* vbi );
      SP is described by the arch specific functions
      guest_<arch>_state_requires_precise_mem_exns.
 
+     With this and VexRegUpdUnwindregsAtMemAccess, if
+     VexControl::guest_remove_dead_cc is set, the condition code is an
+     exception: it may not be updated at an exit whose destination
+     overwrites it before reading it.
+
      VexRegUpdUnwindregsAtMemAccess: registers needed to make a stack
      trace are up to date at memory exception points.  Typically,
      these are PC/SP/FP.  The minimal registers are described by the
@@ -568,11 +574,27 @@ typedef
          improves performance a bit, and also is important for avoiding certain
          kinds of false positives in Memcheck.  Default=True.  */
       Bool guest_chase;
+      /* Should the front end leave out writes of the condition code
+         at superblock exits, when the code at the destination
+         overwrites the condition code before reading it?  Only done
+         for amd64 guests, and not when the guest state has to be
+         precise at memory accesses or at each insn.  The condition
+         code is then stale if the guest state is looked at between
+         superblocks, for example in the context given to a signal
+         handler, or by a debugger.  Default=False. */
+      Bool guest_remove_dead_cc;
       /* Register allocator version. Allowed values are:
          - '2': previous, good and slow implementation.
          - '3': current, faster implementation; perhaps producing slightly worse
-                spilling decisions. */
+                spilling decisions.
+         - '4': '3' plus live range splitting around helper calls and
+                rematerialisation of constants instead of spilling them. */
       UInt regalloc_version;
+      /* Should the back end move rarely taken conditional exits and
+         helper calls out of the main line of the generated code, to
+         the end of the translation?  Only done on amd64 hosts.
+         Default=False. */
+      Bool hot_cold_split;
       /* When false constant folding and algebric simplification is disabled.
          This is used in the iropt tester. */
       Bool iropt_fold_expr;
@@ -712,6 +734,16 @@ typedef
       /* Stats only: the number of conditional branches incorporated into the
          trace. */
       UShort n_cond_in_trace;
+      /* Stats only: the number of spill stores, reloads, rematerialisations
+         and register-register moves done instead of spills, generated by the
+         register allocator. */
+      UInt n_spills;
+      UInt n_reloads;
+      UInt n_remats;
+      UInt n_moves;
+      /* Stats only: the size of the main line of the generated code, if
+         conditional exits and calls were moved out of it, else zero. */
+      UInt n_hot_bytes;
    }
    VexTranslateResult;
 
@@ -764,6 +796,14 @@ typedef
 	 NULL. */
       Bool    (*chase_into_ok) ( /*callback_opaque*/void*, Addr );
 
+      /* Optionally, which destination of a conditional branch with
+         destinations SX (side exit) and FT (fall through) is taken
+         nearly all of the time, as observed by the client?  Returns
+         that destination, which is then chased as if the branch were
+         unconditional, or zero if neither should be.  May be NULL. */
+      Addr    (*chase_cond_hint) ( /*callback_opaque*/void*,
+                                   Addr guest_addr_SX, Addr guest_addr_FT );
+
       /* OUT: which bits of guest code actually got translated */
       VexGuestExtents* guest_extents;
 
@@ -869,6 +909,14 @@ typedef
       const void* disp_cp_chain_me_to_fastEP;
       const void* disp_cp_xindir;
       const void* disp_cp_xassisted;
+
+      /* If non-NULL, and the host supports it (currently amd64 only),
+         indirect transfers are emitted with a small inline cache of
+         destinations, which calls here when it misses and has room for
+         another entry.  The call's return address identifies the cache,
+         to be filled in by LibVEX_PatchXIndirIC.  Must be NULL if
+         disp_cp_xindir is. */
+      const void* disp_cp_xindir_miss;
    }
    VexTranslateArgs;
 
@@ -935,6 +983,34 @@ VexInvalRange LibVEX_UnChain ( VexArch     arch_host,
                                const void* place_to_jump_to_EXPECTED,
                                const void* disp_cp_chain_me );
 
+/* Fill in the first empty entry of the inline cache of an indirect
+   transfer, so that a transfer to guest_addr jumps directly to
+   place_to_jump_to.  place_to_patch is the miss call of the cache,
+   which is checked to be a call to disp_cp_xindir_miss_EXPECTED.  When
+   the last entry is filled, the miss call is changed to a jump to
+   disp_cp_xindir.  The address of the entry is returned in *entry,
+   for later use with LibVEX_UnPatchXIndirIC. */
+extern
+VexInvalRange LibVEX_PatchXIndirIC ( VexArch     arch_host,
+                                     VexEndness  endness_host,
+                                     void*       place_to_patch,
+                                     const void* disp_cp_xindir_miss_EXPECTED,
+                                     const void* disp_cp_xindir,
+                                     Addr        guest_addr,
+                                     const void* place_to_jump_to,
+                                     /*OUT*/void** entry );
+
+/* Empty the inline cache entry at place_to_unpatch, which is checked
+   to jump to place_to_jump_to_EXPECTED, and make the cache's miss path
+   call disp_cp_xindir_miss again. */
+extern
+VexInvalRange LibVEX_UnPatchXIndirIC ( VexArch     arch_host,
+                                       VexEndness  endness_host,
+                                       void*       place_to_unpatch,
+                                       const void* place_to_jump_to_EXPECTED,
+                                       const void* disp_cp_xindir,
+                                       const void* disp_cp_xindir_miss );
+
 /* Returns a constant -- the size of the event check that is put at
    the start of every translation.  This makes it possible to
    calculate the fast entry point address if the slow entry point
@@ -587,6 +587,7 @@ void make_translation ( Addr guest_addr, Bool verbose )
    vta.guest_bytes      = (UChar*)guest_addr;
    vta.guest_bytes_addr = guest_addr;
    vta.chase_into_ok    = chase_into_ok;
+   vta.chase_cond_hint  = NULL;
 //   vta.guest_extents    = &vge;
    vta.guest_extents    = &trans_table[trans_table_used];
    vta.host_bytes       = transbuf;
@@ -601,6 +602,7 @@ void make_translation ( Addr guest_addr, Bool verbose )
    vta.disp_cp_chain_me_to_fastEP = NULL; //disp_chain_slow;
    vta.disp_cp_xindir             = NULL; //disp_chain_indir;
    vta.disp_cp_xassisted          = disp_chain_assisted;
+   vta.disp_cp_xindir_miss        = NULL;
 
    vta.addProfInc       = False;
 
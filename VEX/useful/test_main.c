@@ -279,6 +279,7 @@ int main ( int argc, char** argv )
       vta.disp_cp_chain_me_to_fastEP = (void*)0x12345679;
       vta.disp_cp_xindir             = (void*)0x1234567A;
       vta.disp_cp_xassisted          = (void*)0x1234567B;
+      vta.disp_cp_xindir_miss        = NULL;
 
       vta.finaltidy = NULL;
 
@@ -84,8 +84,8 @@ static const HChar* check_cache(cache_t* cache)
 }
 
 
-static void parse_cache_opt ( cache_t* cache, const HChar* opt,
-                              const HChar* optval )
+void VG_(parse_cache_opt) ( cache_t* cache, const HChar* opt,
+                           const HChar* optval )
 {
    Long i1, i2, i3;
    HChar* endptr;
@@ -129,14 +129,14 @@ Bool VG_(str_clo_cache_opt)(const HChar *arg,
    const HChar* tmp_str;
 
    if      VG_STR_CLO(arg, "--I1", tmp_str) {
-      parse_cache_opt(clo_I1c, arg, tmp_str);
+      VG_(parse_cache_opt)(clo_I1c, arg, tmp_str);
       return True;
    } else if VG_STR_CLO(arg, "--D1", tmp_str) {
-      parse_cache_opt(clo_D1c, arg, tmp_str);
+      VG_(parse_cache_opt)(clo_D1c, arg, tmp_str);
       return True;
    } else if (VG_STR_CLO(arg, "--L2", tmp_str) || // for backwards compatibility
               VG_STR_CLO(arg, "--LL", tmp_str)) {
-      parse_cache_opt(clo_LLc, arg, tmp_str);
+      VG_(parse_cache_opt)(clo_LLc, arg, tmp_str);
       return True;
    } else
       return False;
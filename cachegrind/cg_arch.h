@@ -50,6 +50,12 @@ Bool VG_(str_clo_cache_opt)(const HChar *arg,
                             cache_t* clo_D1c,
                             cache_t* clo_LLc);
 
+// Parses optval, which looks like "65536,2,64", to set the cache_t
+// elements, for a cache option not handled by VG_(str_clo_cache_opt).
+// opt is the whole option, for error messages.
+void VG_(parse_cache_opt)(cache_t* cache, const HChar* opt,
+                          const HChar* optval);
+
 // Checks the correctness of the auto-detected caches.
 // If a cache has been configured by command line options, it
 // replaces the equivalent auto-detected cache.
@@ -42,6 +42,7 @@
 #include "pub_tool_xarray.h"
 #include "pub_tool_clientstate.h"
 #include "pub_tool_machine.h"      // VG_(fnptr_to_fnentry)
+#include "pub_tool_threadstate.h"  // VG_N_THREADS
 
 #include "cachegrind.h"
 #include "cg_arch.h"
@@ -62,13 +63,22 @@
 static Bool  clo_cache_sim  = False; /* do cache simulation? */
 static Bool  clo_branch_sim = False; /* do branch simulation? */
 static Bool  clo_instr_at_start = True; /* instrument at startup? */
+static ReplPolicy clo_replacement_policy = Repl_LRU;
+static Bool  clo_multi_core = False; /* a core and L1 caches per thread? */
+static PrefetchKind clo_prefetch = Prefetch_None;
+static ULong clo_sample_window   = 0;        /* 0: no sampling */
+static ULong clo_sample_interval = 10000000;
+static ULong clo_sample_warmup   = 1000000;
 static const HChar* clo_cachegrind_out_file = "cachegrind.out.%p";
 
 /*------------------------------------------------------------*/
 /*--- Cachesim configuration                               ---*/
 /*------------------------------------------------------------*/
 
-static Int min_line_size = 0; /* min of L1 and LL cache line sizes */
+static Int min_line_size = 0; /* min of L1, L2 and LL cache line sizes */
+
+/* Do data accesses need the log_0Ir_1D*_ext_access helpers? */
+static Bool D_ext_helpers = False;
 
 /*------------------------------------------------------------*/
 /*--- Types and Data Structures                            ---*/
@@ -78,7 +88,8 @@ typedef
    struct {
       ULong a;  /* total # memory accesses of this kind */
       ULong m1; /* misses in the first level cache */
-      ULong mL; /* misses in the second level cache */
+      ULong m2; /* misses in the L2 cache, if there is one */
+      ULong mL; /* misses in the last level cache */
    }
    CacheCC;
 
@@ -89,6 +100,21 @@ typedef
    }
    BranchCC;
 
+typedef
+   struct {
+      ULong m;   /* D1 misses on lines invalidated by another thread */
+      ULong inv; /* lines invalidated in other threads' D1s */
+   }
+   CoherenceCC;
+
+typedef
+   struct {
+      ULong a;  /* lines prefetched into D1 */
+      ULong m2; /* ... which missed in L2, if there is one */
+      ULong mL; /* ... which missed in the last level cache */
+   }
+   PrefetchCC;
+
 //------------------------------------------------------------
 // Primary data structure #1: CC table
 // - Holds the per-source-line hit/miss stats, grouped by file/function/line.
@@ -110,8 +136,16 @@ typedef struct {
    CacheCC  Dw;  /* Data write/modify counts */
    BranchCC Bc;  /* Conditional branch counts */
    BranchCC Bi;  /* Indirect branch counts */
+   CoherenceCC Co; /* D1 coherence counts, if --multi-core=yes */
+   PrefetchCC  Pf; /* Prefetches triggered, if --prefetch is used */
+   ULong*   saved; /* Counts when first touched in the current sampling
+                     epoch, if sampling; allocated with the node */
+   UInt     sample_epoch; /* Sampling epoch 'saved' belongs to */
 } LineCC;
 
+// The number of counts in a LineCC, and so in its 'saved' array.
+#define N_CC_COUNTS 21
+
 // First compare file, then fn, then line.
 static Word cmp_CodeLoc_LineCC(const void *vloc, const void *vcc)
 {
@@ -152,6 +186,7 @@ typedef struct _SB_info SB_info;
 struct _SB_info {
    Addr      SB_addr;      // key;  MUST BE FIRST
    Int       n_instrs;
+   UInt      sample_epoch; // last sampling epoch the SB ran in
    InstrInfo instrs[0];
 };
 
@@ -174,6 +209,7 @@ static Int  distinct_fns        = 0;
 static Int  distinct_lines      = 0;
 static Int  distinct_instrsGen  = 0;
 static Int  distinct_instrsNoX  = 0;
+static Int  distinct_instrsSame = 0;
 
 static Int  full_debugs         = 0;
 static Int  file_line_debugs    = 0;
@@ -267,24 +303,38 @@ static LineCC* get_lineCC(Addr origAddr)
 
    lineCC = VG_(OSetGen_Lookup)(CC_table, &loc);
    if (!lineCC) {
-      // Allocate and zero a new node.
-      lineCC           = VG_(OSetGen_AllocNode)(CC_table, sizeof(LineCC));
+      // Allocate and zero a new node.  When sampling, the saved counts
+      // go at the end of the node, so that they are freed with it.
+      SizeT szB        = sizeof(LineCC);
+      if (clo_sample_window > 0)
+         szB += N_CC_COUNTS * sizeof(ULong);
+      lineCC           = VG_(OSetGen_AllocNode)(CC_table, szB);
       lineCC->loc.file = get_perm_string(loc.file);
       lineCC->loc.fn   = get_perm_string(loc.fn);
       lineCC->loc.line = loc.line;
       lineCC->Ir.a     = 0;
       lineCC->Ir.m1    = 0;
+      lineCC->Ir.m2    = 0;
       lineCC->Ir.mL    = 0;
       lineCC->Dr.a     = 0;
       lineCC->Dr.m1    = 0;
+      lineCC->Dr.m2    = 0;
       lineCC->Dr.mL    = 0;
       lineCC->Dw.a     = 0;
       lineCC->Dw.m1    = 0;
+      lineCC->Dw.m2    = 0;
       lineCC->Dw.mL    = 0;
       lineCC->Bc.b     = 0;
       lineCC->Bc.mp    = 0;
       lineCC->Bi.b     = 0;
       lineCC->Bi.mp    = 0;
+      lineCC->Co.m     = 0;
+      lineCC->Co.inv   = 0;
+      lineCC->Pf.a     = 0;
+      lineCC->Pf.m2    = 0;
+      lineCC->Pf.mL    = 0;
+      lineCC->saved    = clo_sample_window > 0 ? (ULong*)(lineCC + 1) : NULL;
+      lineCC->sample_epoch = 0;
       VG_(OSetGen_Insert)(CC_table, lineCC);
    }
 
@@ -339,7 +389,8 @@ void log_1IrGen_0D_cache_access(InstrInfo* n)
    //VG_(printf)("1IrGen_0D :  CCaddr=0x%010lx,  iaddr=0x%010lx,  isize=%lu\n",
    //             n, n->instr_addr, n->instr_len);
    cachesim_I1_doref_Gen(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 }
 
@@ -349,7 +400,8 @@ void log_1IrNoX_0D_cache_access(InstrInfo* n)
    //VG_(printf)("1IrNoX_0D :  CCaddr=0x%010lx,  iaddr=0x%010lx,  isize=%lu\n",
    //             n, n->instr_addr, n->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 }
 
@@ -361,10 +413,12 @@ void log_2IrNoX_0D_cache_access(InstrInfo* n, InstrInfo* n2)
    //            n,  n->instr_addr,  n->instr_len,
    //            n2, n2->instr_addr, n2->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
    cachesim_I1_doref_NoX(n2->instr_addr, n2->instr_len,
-			 &n2->parent->Ir.m1, &n2->parent->Ir.mL);
+			 &n2->parent->Ir.m1, &n2->parent->Ir.m2,
+			 &n2->parent->Ir.mL);
    n2->parent->Ir.a++;
 }
 
@@ -378,13 +432,16 @@ void log_3IrNoX_0D_cache_access(InstrInfo* n, InstrInfo* n2, InstrInfo* n3)
    //            n2, n2->instr_addr, n2->instr_len,
    //            n3, n3->instr_addr, n3->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
    cachesim_I1_doref_NoX(n2->instr_addr, n2->instr_len,
-			 &n2->parent->Ir.m1, &n2->parent->Ir.mL);
+			 &n2->parent->Ir.m1, &n2->parent->Ir.m2,
+			 &n2->parent->Ir.mL);
    n2->parent->Ir.a++;
    cachesim_I1_doref_NoX(n3->instr_addr, n3->instr_len,
-			 &n3->parent->Ir.m1, &n3->parent->Ir.mL);
+			 &n3->parent->Ir.m1, &n3->parent->Ir.m2,
+			 &n3->parent->Ir.mL);
    n3->parent->Ir.a++;
 }
 
@@ -395,11 +452,13 @@ void log_1IrNoX_1Dr_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //            "                               daddr=0x%010lx,  dsize=%lu\n",
    //            n, n->instr_addr, n->instr_len, data_addr, data_size);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 
    cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dr.m1, &n->parent->Dr.mL);
+                     &n->parent->Dr.m1, &n->parent->Dr.m2,
+                     &n->parent->Dr.mL);
    n->parent->Dr.a++;
 }
 
@@ -410,11 +469,13 @@ void log_1IrNoX_1Dw_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //            "                               daddr=0x%010lx,  dsize=%lu\n",
    //            n, n->instr_addr, n->instr_len, data_addr, data_size);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.m2,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 
    cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dw.m1, &n->parent->Dw.mL);
+                     &n->parent->Dw.m1, &n->parent->Dw.m2,
+                     &n->parent->Dw.mL);
    n->parent->Dw.a++;
 }
 
@@ -427,7 +488,8 @@ void log_0Ir_1Dr_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //VG_(printf)("0Ir_1Dr:  CCaddr=0x%010lx,  daddr=0x%010lx,  dsize=%lu\n",
    //            n, data_addr, data_size);
    cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dr.m1, &n->parent->Dr.mL);
+                     &n->parent->Dr.m1, &n->parent->Dr.m2,
+                     &n->parent->Dr.mL);
    n->parent->Dr.a++;
 }
 
@@ -438,10 +500,59 @@ void log_0Ir_1Dw_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //VG_(printf)("0Ir_1Dw:  CCaddr=0x%010lx,  daddr=0x%010lx,  dsize=%lu\n",
    //            n, data_addr, data_size);
    cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dw.m1, &n->parent->Dw.mL);
+                     &n->parent->Dw.m1, &n->parent->Dw.m2,
+                     &n->parent->Dw.mL);
    n->parent->Dw.a++;
 }
 
+/* With --multi-core=yes or a prefetcher, data accesses go through
+   these instead, and aren't merged with the Ir.  A modify counts as a
+   read, as above, but invalidates the line in the other threads' D1s
+   as a write does.  They have the same prototype as
+   log_0Ir_1Dr_cache_access. */
+static void D_ext_access(InstrInfo* n, Addr data_addr, Word data_size,
+                         Bool is_write, CacheCC* cc)
+{
+   LineCC* lineCC    = n->parent;
+   Bool    coherence = False;
+   Bool    miss;
+
+   if (clo_multi_core)
+      miss = cachesim_D1_coherent_ref_is_miss(data_addr, data_size, is_write,
+                                              &coherence, &lineCC->Co.inv);
+   else
+      miss = cachesim_ref_is_miss(&D1, data_addr, data_size);
+
+   if (miss) {
+      cc->m1++;
+      if (coherence)
+         lineCC->Co.m++;
+      cachesim_L1_miss(data_addr, data_size, &cc->m2, &cc->mL);
+   }
+   if (clo_prefetch != Prefetch_None)
+      cachesim_D1_prefetch(n->instr_addr, data_addr, data_size, miss,
+                           &lineCC->Pf.a, &lineCC->Pf.m2, &lineCC->Pf.mL);
+   cc->a++;
+}
+
+static VG_REGPARM(3)
+void log_0Ir_1Dr_ext_access(InstrInfo* n, Addr data_addr, Word data_size)
+{
+   D_ext_access(n, data_addr, data_size, /*is_write*/False, &n->parent->Dr);
+}
+
+static VG_REGPARM(3)
+void log_0Ir_1Dm_ext_access(InstrInfo* n, Addr data_addr, Word data_size)
+{
+   D_ext_access(n, data_addr, data_size, /*is_write*/True, &n->parent->Dr);
+}
+
+static VG_REGPARM(3)
+void log_0Ir_1Dw_ext_access(InstrInfo* n, Addr data_addr, Word data_size)
+{
+   D_ext_access(n, data_addr, data_size, /*is_write*/True, &n->parent->Dw);
+}
+
 /* For branches, we consult two different predictors, one which
    predicts taken/untaken for conditional branches, and the other
    which predicts the branch target address for indirect branches
@@ -468,6 +579,286 @@ void log_ind_branch(InstrInfo* n, UWord actual_dst)
 }
 
 
+/*------------------------------------------------------------*/
+/*--- Sampling                                             ---*/
+/*------------------------------------------------------------*/
+
+/* With --sample-window=N, execution is divided into intervals of
+   --sample-interval instructions.  Each interval starts with a
+   warm-up of --sample-warmup instructions, then N instructions are
+   sampled, and the rest of the interval is fast-forwarded: the
+   helpers doing the simulation and counting aren't called.  The cache
+   and branch predictor state is carried over from one interval to the
+   next.  The first interval has no warm-up.
+
+   The warm-up and the window each start a new sampling epoch.  The
+   first time an SB runs in an epoch, the counts of its lines are saved
+   and the lines are put on the dirty list, so that only the lines
+   which can have changed are visited at the end of the phase.  The
+   events counted during the warm-up are thrown away by restoring the
+   dirty lines' saved counts, and a window's totals are the sums of
+   their differences.  At the end, all counts are scaled up by the
+   ratio of executed to sampled instructions.  The spread of the
+   per-window event rates gives a confidence interval for each
+   estimated total.
+
+   Instructions are counted by the generated code each time the event
+   queue is flushed, which is also where it checks whether the next
+   phase is due and whether the SB has to be marked dirty (see
+   addStmts_sample). */
+
+typedef
+   enum { Sample_FastForward, Sample_Warmup, Sample_Window }
+   SamplePhase;
+
+// In the order of the output file's columns.
+static const HChar* const CC_count_names[N_CC_COUNTS] = {
+   "Ir", "I1mr", "I2mr", "ILmr", "Dr", "D1mr", "D2mr", "DLmr",
+   "Dw", "D1mw", "D2mw", "DLmw", "D1mc", "D1inv", "D1pf", "D2pf",
+   "DLpf", "Bc", "Bcm", "Bi", "Bim"
+};
+
+// Is count i collected (and written to the output file)?
+static Bool CC_count_is_used(Int i)
+{
+   switch (i) {
+      case 0:
+         return True;
+      case 2: case 6: case 10:
+         return have_L2;
+      case 12: case 13:
+         return clo_multi_core;
+      case 14: case 16:
+         return clo_prefetch != Prefetch_None;
+      case 15:
+         return have_L2 && clo_prefetch != Prefetch_None;
+      case 17: case 18: case 19: case 20:
+         return clo_branch_sim;
+      default:
+         return clo_cache_sim;
+   }
+}
+
+// Updated by the generated code.
+static ULong sample_insns   = 0; /* instructions executed */
+static ULong sample_next    = 0; /* sample_insns at the next phase change */
+static UChar sample_running = 1; /* are the helpers being called? */
+
+// The first interval has no warm-up: the caches start cold in a full
+// run too.
+static SamplePhase sample_phase = Sample_Warmup;
+static UInt   sample_epoch = 1; /* also read by the generated code */
+static XArray* sample_dirty;    /* LineCC*s touched in sample_epoch */
+static ULong  sample_interval_start = 0;
+static ULong  sample_window_start   = 0;
+static ULong  sampled_insns = 0;
+static UInt   n_sample_windows = 0;
+static Double sample_rate_sum [N_CC_COUNTS];  /* sum of per-window rates */
+static Double sample_rate_sum2[N_CC_COUNTS];  /* ... and of their squares */
+
+static void get_LineCC_counts(const LineCC* lineCC, ULong* counts)
+{
+   counts[0]  = lineCC->Ir.a;
+   counts[1]  = lineCC->Ir.m1;
+   counts[2]  = lineCC->Ir.m2;
+   counts[3]  = lineCC->Ir.mL;
+   counts[4]  = lineCC->Dr.a;
+   counts[5]  = lineCC->Dr.m1;
+   counts[6]  = lineCC->Dr.m2;
+   counts[7]  = lineCC->Dr.mL;
+   counts[8]  = lineCC->Dw.a;
+   counts[9]  = lineCC->Dw.m1;
+   counts[10] = lineCC->Dw.m2;
+   counts[11] = lineCC->Dw.mL;
+   counts[12] = lineCC->Co.m;
+   counts[13] = lineCC->Co.inv;
+   counts[14] = lineCC->Pf.a;
+   counts[15] = lineCC->Pf.m2;
+   counts[16] = lineCC->Pf.mL;
+   counts[17] = lineCC->Bc.b;
+   counts[18] = lineCC->Bc.mp;
+   counts[19] = lineCC->Bi.b;
+   counts[20] = lineCC->Bi.mp;
+}
+
+static void set_LineCC_counts(LineCC* lineCC, const ULong* counts)
+{
+   lineCC->Ir.a   = counts[0];
+   lineCC->Ir.m1  = counts[1];
+   lineCC->Ir.m2  = counts[2];
+   lineCC->Ir.mL  = counts[3];
+   lineCC->Dr.a   = counts[4];
+   lineCC->Dr.m1  = counts[5];
+   lineCC->Dr.m2  = counts[6];
+   lineCC->Dr.mL  = counts[7];
+   lineCC->Dw.a   = counts[8];
+   lineCC->Dw.m1  = counts[9];
+   lineCC->Dw.m2  = counts[10];
+   lineCC->Dw.mL  = counts[11];
+   lineCC->Co.m   = counts[12];
+   lineCC->Co.inv = counts[13];
+   lineCC->Pf.a   = counts[14];
+   lineCC->Pf.m2  = counts[15];
+   lineCC->Pf.mL  = counts[16];
+   lineCC->Bc.b   = counts[17];
+   lineCC->Bc.mp  = counts[18];
+   lineCC->Bi.b   = counts[19];
+   lineCC->Bi.mp  = counts[20];
+}
+
+// Start a new sampling epoch, with no dirty lines.
+static void sample_new_epoch(void)
+{
+   sample_epoch++;
+   VG_(dropTailXA)(sample_dirty, VG_(sizeXA)(sample_dirty));
+}
+
+// Called from generated code the first time an SB runs in an epoch,
+// before any of its counts are updated.  During fast-forwarding
+// nothing is counted, so there is nothing to save.
+static VG_REGPARM(1) void sample_touch_SB(SB_info* sbInfo)
+{
+   LineCC* lineCC;
+   Int     i;
+
+   sbInfo->sample_epoch = sample_epoch;
+   if (!sample_running)
+      return;
+   for (i = 0; i < sbInfo->n_instrs; i++) {
+      lineCC = sbInfo->instrs[i].parent;
+      if (lineCC->sample_epoch == sample_epoch)
+         continue;
+      lineCC->sample_epoch = sample_epoch;
+      get_LineCC_counts(lineCC, lineCC->saved);
+      VG_(addToXA)(sample_dirty, &lineCC);
+   }
+}
+
+// Undo the counting done since the current epoch started.
+static void restore_dirty_lines(void)
+{
+   Word    i, n = VG_(sizeXA)(sample_dirty);
+   LineCC* lineCC;
+
+   for (i = 0; i < n; i++) {
+      lineCC = *(LineCC**)VG_(indexXA)(sample_dirty, i);
+      set_LineCC_counts(lineCC, lineCC->saved);
+   }
+}
+
+static void end_sample_window(void)
+{
+   ULong   totals[N_CC_COUNTS];
+   ULong   counts[N_CC_COUNTS];
+   ULong   n_insns = sample_insns - sample_window_start;
+   LineCC* lineCC;
+   Double  rate;
+   Word    j;
+   Int     i;
+
+   if (n_insns == 0)
+      return;
+   // What was counted in the window.
+   for (i = 0; i < N_CC_COUNTS; i++)
+      totals[i] = 0;
+   for (j = 0; j < VG_(sizeXA)(sample_dirty); j++) {
+      lineCC = *(LineCC**)VG_(indexXA)(sample_dirty, j);
+      get_LineCC_counts(lineCC, counts);
+      for (i = 0; i < N_CC_COUNTS; i++)
+         totals[i] += counts[i] - lineCC->saved[i];
+   }
+   for (i = 0; i < N_CC_COUNTS; i++) {
+      rate = (Double)totals[i] / (Double)n_insns;
+      sample_rate_sum[i]  += rate;
+      sample_rate_sum2[i] += rate * rate;
+   }
+   sampled_insns += n_insns;
+   n_sample_windows++;
+}
+
+// Called from generated code when sample_insns reaches sample_next.
+static void sample_next_phase(void)
+{
+   switch (sample_phase) {
+      case Sample_FastForward:
+         sample_interval_start = sample_insns;
+         sample_new_epoch();
+         sample_phase   = Sample_Warmup;
+         sample_next    = sample_insns + clo_sample_warmup;
+         sample_running = 1;
+         break;
+      case Sample_Warmup:
+         restore_dirty_lines();
+         sample_new_epoch();
+         sample_window_start = sample_insns;
+         sample_phase = Sample_Window;
+         sample_next  = sample_insns + clo_sample_window;
+         break;
+      case Sample_Window:
+         end_sample_window();
+         sample_phase   = Sample_FastForward;
+         sample_next    = sample_interval_start + clo_sample_interval;
+         sample_running = 0;
+         break;
+      default:
+         tl_assert(0);
+   }
+}
+
+// Finish the current phase and scale all counts up.
+static void sample_finish(void)
+{
+   ULong   counts[N_CC_COUNTS];
+   LineCC* lineCC;
+   Double  scale;
+   Int     i;
+
+   if (sample_phase == Sample_Warmup)
+      restore_dirty_lines();
+   else if (sample_phase == Sample_Window)
+      end_sample_window();
+   sample_phase   = Sample_FastForward;
+   sample_running = 0;
+   VG_(deleteXA)(sample_dirty);
+   sample_dirty = NULL;
+
+   if (sampled_insns == 0)
+      return;
+   scale = (Double)sample_insns / (Double)sampled_insns;
+   VG_(OSetGen_ResetIter)(CC_table);
+   while ( (lineCC = VG_(OSetGen_Next)(CC_table)) ) {
+      get_LineCC_counts(lineCC, counts);
+      for (i = 0; i < N_CC_COUNTS; i++)
+         counts[i] = (ULong)((Double)counts[i] * scale + 0.5);
+      set_LineCC_counts(lineCC, counts);
+   }
+}
+
+static Double sample_sqrt(Double x)
+{
+   Double r = x;
+   Int    i;
+
+   if (x <= 0.0)
+      return 0.0;
+   for (i = 0; i < 64; i++)
+      r = (r + x / r) / 2;
+   return r;
+}
+
+// Half width of the 95% confidence interval of an estimated total.
+static ULong sample_error(Int i)
+{
+   Double n = n_sample_windows;
+   Double var;
+
+   if (n_sample_windows < 2)
+      return 0;
+   var = (sample_rate_sum2[i] - sample_rate_sum[i] * sample_rate_sum[i] / n)
+         / (n - 1);
+   return (ULong)(1.96 * sample_sqrt(var / n) * (Double)sample_insns + 0.5);
+}
+
 /*------------------------------------------------------------*/
 /*--- Instrumentation types and structures                 ---*/
 /*------------------------------------------------------------*/
@@ -509,6 +900,7 @@ typedef
    enum { 
       Ev_IrNoX,  // Instruction read not crossing cache lines
       Ev_IrGen,  // Generic Ir, not being detected as IrNoX
+      Ev_IrSame, // IrNoX in the I1 line just fetched by the previous insn
       Ev_Dr,     // Data read
       Ev_Dw,     // Data write
       Ev_Dm,     // Data modify (read then write)
@@ -526,6 +918,8 @@ typedef
          } IrGen;
          struct {
          } IrNoX;
+         struct {
+         } IrSame;
          struct {
             IRAtom* ea;
             Int     szB;
@@ -594,6 +988,11 @@ typedef
 
       /* The output SB being constructed. */
       IRSB* sbOut;
+
+      /* The I1 line holding the last byte of the previous insn in the
+         SB, if last_I1_block_valid.  See addEvent_Ir. */
+      UWord last_I1_block;
+      Bool  last_I1_block_valid;
    }
    CgState;
 
@@ -631,6 +1030,7 @@ SB_info* get_SB_info(IRSB* sbIn, Addr origAddr)
                                 sizeof(SB_info) + n_instrs*sizeof(InstrInfo)); 
    sbInfo->SB_addr  = origAddr;
    sbInfo->n_instrs = n_instrs;
+   sbInfo->sample_epoch = 0;
    VG_(OSetGen_Insert)( instrInfoTable, sbInfo );
 
    return sbInfo;
@@ -646,6 +1046,9 @@ static void showEvent ( Event* ev )
       case Ev_IrNoX:
          VG_(printf)("IrNoX %p\n", ev->inode);
          break;
+      case Ev_IrSame:
+         VG_(printf)("IrSame %p\n", ev->inode);
+         break;
       case Ev_Dr:
          VG_(printf)("Dr %p %d EA=", ev->inode, ev->Ev.Dr.szB);
          ppIRExpr(ev->Ev.Dr.ea); 
@@ -693,6 +1096,125 @@ InstrInfo* setup_InstrInfo ( CgState* cgs, Addr instr_addr, UInt instr_len )
 }
 
 
+#if defined(VG_BIGENDIAN)
+#  define CG_ENDNESS Iend_BE
+#else
+#  define CG_ENDNESS Iend_LE
+#endif
+
+/* Generate IR to increment the Ir.a count of inode's line, without
+   calling a helper.  The increment is skipped if guard is false. */
+static void addStmts_inc_Ir ( IRSB* sbOut, InstrInfo* inode, IRAtom* guard )
+{
+   IRExpr* addr = mkIRExpr_HWord( (HWord)&inode->parent->Ir.a );
+   IRTemp  old  = newIRTemp(sbOut->tyenv, Ity_I64);
+   IRTemp  new  = newIRTemp(sbOut->tyenv, Ity_I64);
+
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(old, IRExpr_Load(CG_ENDNESS, Ity_I64, addr)) );
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(new, IRExpr_Binop(Iop_Add64,
+                                                 IRExpr_RdTmp(old),
+                                                 IRExpr_Const(IRConst_U64(1)))) );
+   if (guard)
+      addStmtToIRSB( sbOut, IRStmt_StoreG(CG_ENDNESS, addr,
+                                          IRExpr_RdTmp(new), guard) );
+   else
+      addStmtToIRSB( sbOut, IRStmt_Store(CG_ENDNESS, addr, IRExpr_RdTmp(new)) );
+}
+
+/* Generate IR computing whether the helpers are to be called, when
+   sampling.  Returns an Ity_I1 atom. */
+static IRAtom* addStmts_sample_running ( IRSB* sbOut )
+{
+   IRTemp running = newIRTemp(sbOut->tyenv, Ity_I8);
+   IRTemp guard   = newIRTemp(sbOut->tyenv, Ity_I1);
+
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(running,
+                               IRExpr_Load(CG_ENDNESS, Ity_I8,
+                                           mkIRExpr_HWord( (HWord)&sample_running ))) );
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(guard, IRExpr_Binop(Iop_CmpNE8,
+                                                   IRExpr_RdTmp(running),
+                                                   IRExpr_Const(IRConst_U8(0)))) );
+   return IRExpr_RdTmp(guard);
+}
+
+/* Generate IR to move on to the next sampling phase if it is due, and
+   then to add the insns of the events about to be flushed to
+   sample_insns, so that they count towards the phase in which their
+   helpers are called, if any.  Also call sample_touch_SB if the SB has
+   not run yet in the current epoch.  Returns whether the helpers are
+   called, as for addStmts_sample_running. */
+static IRAtom* addStmts_sample ( CgState* cgs )
+{
+   IRSB*    sbOut   = cgs->sbOut;
+   IRExpr*  insns_p = mkIRExpr_HWord( (HWord)&sample_insns );
+   Int      i, n_insns = 0;
+   IRTemp   old, new, next, due;
+   IRDirty* di;
+
+   for (i = 0; i < cgs->events_used; i++) {
+      if (cgs->events[i].tag == Ev_IrNoX
+          || cgs->events[i].tag == Ev_IrGen
+          || cgs->events[i].tag == Ev_IrSame)
+         n_insns++;
+   }
+
+   if (n_insns > 0) {
+      old  = newIRTemp(sbOut->tyenv, Ity_I64);
+      new  = newIRTemp(sbOut->tyenv, Ity_I64);
+      next = newIRTemp(sbOut->tyenv, Ity_I64);
+      due  = newIRTemp(sbOut->tyenv, Ity_I1);
+      addStmtToIRSB( sbOut,
+                     IRStmt_WrTmp(old, IRExpr_Load(CG_ENDNESS, Ity_I64,
+                                                   insns_p)) );
+      addStmtToIRSB( sbOut,
+                     IRStmt_WrTmp(next,
+                                  IRExpr_Load(CG_ENDNESS, Ity_I64,
+                                              mkIRExpr_HWord( (HWord)&sample_next ))) );
+      addStmtToIRSB( sbOut,
+                     IRStmt_WrTmp(due, IRExpr_Binop(Iop_CmpLE64U,
+                                                    IRExpr_RdTmp(next),
+                                                    IRExpr_RdTmp(old))) );
+      di = unsafeIRDirty_0_N( 0, "sample_next_phase",
+                              VG_(fnptr_to_fnentry)( &sample_next_phase ),
+                              mkIRExprVec_0() );
+      di->guard = IRExpr_RdTmp(due);
+      addStmtToIRSB( sbOut, IRStmt_Dirty(di) );
+      addStmtToIRSB( sbOut,
+                     IRStmt_WrTmp(new, IRExpr_Binop(Iop_Add64,
+                                                    IRExpr_RdTmp(old),
+                                                    IRExpr_Const(IRConst_U64(n_insns)))) );
+      addStmtToIRSB( sbOut, IRStmt_Store(CG_ENDNESS, insns_p,
+                                         IRExpr_RdTmp(new)) );
+   }
+
+   old  = newIRTemp(sbOut->tyenv, Ity_I32);
+   next = newIRTemp(sbOut->tyenv, Ity_I32);
+   due  = newIRTemp(sbOut->tyenv, Ity_I1);
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(old,
+                               IRExpr_Load(CG_ENDNESS, Ity_I32,
+                                           mkIRExpr_HWord( (HWord)&cgs->sbInfo->sample_epoch ))) );
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(next,
+                               IRExpr_Load(CG_ENDNESS, Ity_I32,
+                                           mkIRExpr_HWord( (HWord)&sample_epoch ))) );
+   addStmtToIRSB( sbOut,
+                  IRStmt_WrTmp(due, IRExpr_Binop(Iop_CmpNE32,
+                                                 IRExpr_RdTmp(old),
+                                                 IRExpr_RdTmp(next))) );
+   di = unsafeIRDirty_0_N( 1, "sample_touch_SB",
+                           VG_(fnptr_to_fnentry)( &sample_touch_SB ),
+                           mkIRExprVec_1( mkIRExpr_HWord( (HWord)cgs->sbInfo ) ) );
+   di->guard = IRExpr_RdTmp(due);
+   addStmtToIRSB( sbOut, IRStmt_Dirty(di) );
+
+   return addStmts_sample_running( sbOut );
+}
+
 /* Generate code for all outstanding memory events, and mark the queue
    empty.  Code is generated into cgs->bbOut, and this activity
    'consumes' slots in cgs->sbInfo. */
@@ -708,6 +1230,14 @@ static void flushEvents ( CgState* cgs )
    Event*     ev;
    Event*     ev2;
    Event*     ev3;
+   IRAtom*    guard = NULL;
+
+   if (clo_sample_window > 0 && cgs->events_used > 0) {
+      guard = addStmts_sample(cgs);
+      /* The next insn may run in another sampling phase than the
+         previous one, so see addEvent_Ir. */
+      cgs->last_I1_block_valid = False;
+   }
 
    i = 0;
    while (i < cgs->events_used) {
@@ -737,7 +1267,8 @@ static void flushEvents ( CgState* cgs )
       switch (ev->tag) {
          case Ev_IrNoX:
             /* Merge an IrNoX with a following Dr/Dm. */
-            if (ev2 && (ev2->tag == Ev_Dr || ev2->tag == Ev_Dm)) {
+            if (ev2 && (ev2->tag == Ev_Dr || ev2->tag == Ev_Dm)
+                && !D_ext_helpers) {
                /* Why is this true?  It's because we're merging an Ir
                   with a following Dr or Dm.  The Ir derives from the
                   instruction's IMark and the Dr/Dm from data
@@ -757,7 +1288,7 @@ static void flushEvents ( CgState* cgs )
             }
             /* Merge an IrNoX with a following Dw. */
             else
-            if (ev2 && ev2->tag == Ev_Dw) {
+            if (ev2 && ev2->tag == Ev_Dw && !D_ext_helpers) {
                tl_assert(ev2->inode == ev->inode);
                helperName = "log_1IrNoX_1Dw_cache_access";
                helperAddr = &log_1IrNoX_1Dw_cache_access;
@@ -813,6 +1344,13 @@ static void flushEvents ( CgState* cgs )
                i++;
             }
             break;
+         case Ev_IrSame:
+            /* A guaranteed I1 hit which doesn't change the simulator
+               state, so only the access count is affected.  Bump it
+               inline rather than calling a helper. */
+            addStmts_inc_Ir( cgs->sbOut, ev->inode, guard );
+            i++;
+            continue;
          case Ev_IrGen:
             if (clo_cache_sim) {
 	       helperName = "log_1IrGen_0D_cache_access";
@@ -828,8 +1366,16 @@ static void flushEvents ( CgState* cgs )
          case Ev_Dr:
          case Ev_Dm:
             /* Data read or modify */
-            helperName = "log_0Ir_1Dr_cache_access";
-            helperAddr = &log_0Ir_1Dr_cache_access;
+            if (D_ext_helpers && ev->tag == Ev_Dm) {
+               helperName = "log_0Ir_1Dm_ext_access";
+               helperAddr = &log_0Ir_1Dm_ext_access;
+            } else if (D_ext_helpers) {
+               helperName = "log_0Ir_1Dr_ext_access";
+               helperAddr = &log_0Ir_1Dr_ext_access;
+            } else {
+               helperName = "log_0Ir_1Dr_cache_access";
+               helperAddr = &log_0Ir_1Dr_cache_access;
+            }
             argv = mkIRExprVec_3( i_node_expr, 
                                   get_Event_dea(ev), 
                                   mkIRExpr_HWord( get_Event_dszB(ev) ) );
@@ -838,8 +1384,13 @@ static void flushEvents ( CgState* cgs )
             break;
          case Ev_Dw:
             /* Data write */
-            helperName = "log_0Ir_1Dw_cache_access";
-            helperAddr = &log_0Ir_1Dw_cache_access;
+            if (D_ext_helpers) {
+               helperName = "log_0Ir_1Dw_ext_access";
+               helperAddr = &log_0Ir_1Dw_ext_access;
+            } else {
+               helperName = "log_0Ir_1Dw_cache_access";
+               helperAddr = &log_0Ir_1Dw_cache_access;
+            }
             argv = mkIRExprVec_3( i_node_expr,
                                   get_Event_dea(ev), 
                                   mkIRExpr_HWord( get_Event_dszB(ev) ) );
@@ -873,6 +1424,8 @@ static void flushEvents ( CgState* cgs )
       di = unsafeIRDirty_0_N( regparms, 
                               helperName, VG_(fnptr_to_fnentry)( helperAddr ), 
                               argv );
+      if (guard)
+         di->guard = guard;
       addStmtToIRSB( cgs->sbOut, IRStmt_Dirty(di) );
    }
 
@@ -889,12 +1442,30 @@ static void addEvent_Ir ( CgState* cgs, InstrInfo* inode )
    init_Event(evt);
    evt->inode    = inode;
    if (cachesim_is_IrNoX(inode->instr_addr, inode->instr_len)) {
-      evt->tag = Ev_IrNoX;
+      /* Within an SB, an insn only executes straight after the
+         previous one, whose last I1 line is then MRU in its set.  If
+         this insn lies entirely in that line, its fetch is an I1 hit
+         which doesn't touch the simulator state (or LL), and there is
+         no need to simulate it at run time.  Counts are unaffected.
+         With the short insns of most code this covers a good share
+         of all Irs. */
+      if (clo_cache_sim
+          && cgs->last_I1_block_valid
+          && cgs->last_I1_block
+             == cachesim_I1_last_block(inode->instr_addr, inode->instr_len)) {
+         evt->tag = Ev_IrSame;
+         distinct_instrsSame++;
+      } else {
+         evt->tag = Ev_IrNoX;
+      }
       distinct_instrsNoX++;
    } else {
       evt->tag = Ev_IrGen;
       distinct_instrsGen++;
    }
+   cgs->last_I1_block
+      = cachesim_I1_last_block(inode->instr_addr, inode->instr_len);
+   cgs->last_I1_block_valid = True;
    cgs->events_used++;
 }
 
@@ -988,10 +1559,17 @@ void addEvent_D_guarded ( CgState* cgs, InstrInfo* inode,
    Int          regparms;
    IRDirty*     di;
    i_node_expr = mkIRExpr_HWord( (HWord)inode );
-   helperName  = isWrite ? "log_0Ir_1Dw_cache_access"
-                         : "log_0Ir_1Dr_cache_access";
-   helperAddr  = isWrite ? &log_0Ir_1Dw_cache_access
-                         : &log_0Ir_1Dr_cache_access;
+   if (D_ext_helpers) {
+      helperName = isWrite ? "log_0Ir_1Dw_ext_access"
+                           : "log_0Ir_1Dr_ext_access";
+      helperAddr = isWrite ? &log_0Ir_1Dw_ext_access
+                           : &log_0Ir_1Dr_ext_access;
+   } else {
+      helperName = isWrite ? "log_0Ir_1Dw_cache_access"
+                           : "log_0Ir_1Dr_cache_access";
+      helperAddr = isWrite ? &log_0Ir_1Dw_cache_access
+                           : &log_0Ir_1Dr_cache_access;
+   }
    argv        = mkIRExprVec_3( i_node_expr,
                                 ea, mkIRExpr_HWord( datasize ) );
    regparms    = 3;
@@ -999,6 +1577,14 @@ void addEvent_D_guarded ( CgState* cgs, InstrInfo* inode,
                     regparms, 
                     helperName, VG_(fnptr_to_fnentry)( helperAddr ), 
                     argv );
+   if (clo_sample_window > 0) {
+      IRTemp both = newIRTemp(cgs->sbOut->tyenv, Ity_I1);
+      addStmtToIRSB( cgs->sbOut,
+                     IRStmt_WrTmp(both,
+                                  IRExpr_Binop(Iop_And1, guard,
+                                               addStmts_sample_running(cgs->sbOut))) );
+      guard = IRExpr_RdTmp(both);
+   }
    di->guard = guard;
    addStmtToIRSB( cgs->sbOut, IRStmt_Dirty(di) );
 }
@@ -1099,6 +1685,8 @@ IRSB* cg_instrument ( VgCallbackClosure* closure,
    cgs.events_used = 0;
    cgs.sbInfo      = get_SB_info(sbIn, (Addr)closure->readdr);
    cgs.sbInfo_i    = 0;
+   cgs.last_I1_block       = 0;
+   cgs.last_I1_block_valid = False;
 
    if (DEBUG_CG)
       VG_(printf)("\n\n---------- cg_instrument ----------\n");
@@ -1372,6 +1960,10 @@ static cache_t clo_I1_cache = UNDEFINED_CACHE;
 static cache_t clo_D1_cache = UNDEFINED_CACHE;
 static cache_t clo_LL_cache = UNDEFINED_CACHE;
 
+// Cachegrind's --L2 is an optional cache between L1 and LL.  (The --L2
+// handled by VG_(str_clo_cache_opt) is an old name of --LL.)
+static cache_t clo_L2_cache = UNDEFINED_CACHE;
+
 /*------------------------------------------------------------*/
 /*--- cg_fini() and related function                       ---*/
 /*------------------------------------------------------------*/
@@ -1383,10 +1975,14 @@ static CacheCC  Dr_total;
 static CacheCC  Dw_total;
 static BranchCC Bc_total;
 static BranchCC Bi_total;
+static CoherenceCC Co_total;
+static PrefetchCC  Pf_total;
 
 static void fprint_CC_table_and_calc_totals(void)
 {
    Int     i;
+   ULong   counts[N_CC_COUNTS];
+   ULong   totals[N_CC_COUNTS] = { 0 };
    VgFile  *fp;
    HChar   *currFile = NULL;
    const HChar *currFn = NULL;
@@ -1418,9 +2014,26 @@ static void fprint_CC_table_and_calc_totals(void)
       // "desc:" lines (giving I1/D1/LL cache configuration). The spaces after
       // the 2nd colon makes cg_annotate's output look nicer.
       VG_(fprintf)(fp,  "desc: I1 cache:         %s\n"
-                        "desc: D1 cache:         %s\n"
-                        "desc: LL cache:         %s\n",
-                        I1.desc_line, D1.desc_line, LL.desc_line);
+                        "desc: D1 cache:         %s\n",
+                        I1.desc_line, D1.desc_line);
+      if (have_L2)
+         VG_(fprintf)(fp, "desc: L2 cache:         %s\n", L2.desc_line);
+      VG_(fprintf)(fp,  "desc: LL cache:         %s\n", LL.desc_line);
+   }
+
+   if (clo_sample_window > 0) {
+      // The estimated error of each event total, for the events that
+      // are written below.
+      VG_(fprintf)(fp, "desc: Sampled:          %llu of %llu instructions, "
+                       "in %u windows\n",
+                       sampled_insns, sample_insns, n_sample_windows);
+      VG_(fprintf)(fp, "desc: 95%% confidence:   +-");
+      for (i = 0; i < N_CC_COUNTS; i++) {
+         if (!CC_count_is_used(i))
+            continue;
+         VG_(fprintf)(fp, " %s %llu", CC_count_names[i], sample_error(i));
+      }
+      VG_(fprintf)(fp, "\n");
    }
 
    // "cmd:" line
@@ -1430,20 +2043,12 @@ static void fprint_CC_table_and_calc_totals(void)
       VG_(fprintf)(fp, " %s", arg);
    }
    // "events:" line
-   if (clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir I1mr ILmr Dr D1mr DLmr Dw D1mw DLmw "
-                                  "Bc Bcm Bi Bim\n");
-   }
-   else if (clo_cache_sim && !clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir I1mr ILmr Dr D1mr DLmr Dw D1mw DLmw "
-                                  "\n");
-   }
-   else if (!clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir Bc Bcm Bi Bim\n");
-   }
-   else {
-      VG_(fprintf)(fp, "\nevents: Ir\n");
+   VG_(fprintf)(fp, "\nevents:");
+   for (i = 0; i < N_CC_COUNTS; i++) {
+      if (CC_count_is_used(i))
+         VG_(fprintf)(fp, " %s", CC_count_names[i]);
    }
+   VG_(fprintf)(fp, "\n");
 
    // Traverse every lineCC
    VG_(OSetGen_ResetIter)(CC_table);
@@ -1471,95 +2076,49 @@ static void fprint_CC_table_and_calc_totals(void)
       }
 
       // Print the LineCC
-      if (clo_cache_sim && clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, lineCC->Ir.m1, lineCC->Ir.mL, 
-                            lineCC->Dr.a, lineCC->Dr.m1, lineCC->Dr.mL,
-                            lineCC->Dw.a, lineCC->Dw.m1, lineCC->Dw.mL,
-                            lineCC->Bc.b, lineCC->Bc.mp, 
-                            lineCC->Bi.b, lineCC->Bi.mp);
-      }
-      else if (clo_cache_sim && !clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, lineCC->Ir.m1, lineCC->Ir.mL, 
-                            lineCC->Dr.a, lineCC->Dr.m1, lineCC->Dr.mL,
-                            lineCC->Dw.a, lineCC->Dw.m1, lineCC->Dw.mL);
-      }
-      else if (!clo_cache_sim && clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu"
-                             " %llu %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, 
-                            lineCC->Bc.b, lineCC->Bc.mp, 
-                            lineCC->Bi.b, lineCC->Bi.mp);
-      }
-      else {
-         VG_(fprintf)(fp,  "%d %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a);
+      get_LineCC_counts(lineCC, counts);
+      VG_(fprintf)(fp, "%d", lineCC->loc.line);
+      for (i = 0; i < N_CC_COUNTS; i++) {
+         if (CC_count_is_used(i))
+            VG_(fprintf)(fp, " %llu", counts[i]);
+         totals[i] += counts[i];
       }
+      VG_(fprintf)(fp, "\n");
 
       // Update summary stats
       Ir_total.a  += lineCC->Ir.a;
       Ir_total.m1 += lineCC->Ir.m1;
+      Ir_total.m2 += lineCC->Ir.m2;
       Ir_total.mL += lineCC->Ir.mL;
       Dr_total.a  += lineCC->Dr.a;
       Dr_total.m1 += lineCC->Dr.m1;
+      Dr_total.m2 += lineCC->Dr.m2;
       Dr_total.mL += lineCC->Dr.mL;
       Dw_total.a  += lineCC->Dw.a;
       Dw_total.m1 += lineCC->Dw.m1;
+      Dw_total.m2 += lineCC->Dw.m2;
       Dw_total.mL += lineCC->Dw.mL;
       Bc_total.b  += lineCC->Bc.b;
       Bc_total.mp += lineCC->Bc.mp;
       Bi_total.b  += lineCC->Bi.b;
       Bi_total.mp += lineCC->Bi.mp;
+      Co_total.m   += lineCC->Co.m;
+      Co_total.inv += lineCC->Co.inv;
+      Pf_total.a   += lineCC->Pf.a;
+      Pf_total.m2  += lineCC->Pf.m2;
+      Pf_total.mL  += lineCC->Pf.mL;
 
       distinct_lines++;
    }
 
    // Summary stats must come after rest of table, since we calculate them
    // during traversal.
-   if (clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu %llu\n", 
-                        Ir_total.a, Ir_total.m1, Ir_total.mL,
-                        Dr_total.a, Dr_total.m1, Dr_total.mL,
-                        Dw_total.a, Dw_total.m1, Dw_total.mL,
-                        Bc_total.b, Bc_total.mp, 
-                        Bi_total.b, Bi_total.mp);
-   }
-   else if (clo_cache_sim && !clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu\n",
-                        Ir_total.a, Ir_total.m1, Ir_total.mL,
-                        Dr_total.a, Dr_total.m1, Dr_total.mL,
-                        Dw_total.a, Dw_total.m1, Dw_total.mL);
-   }
-   else if (!clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu"
-                        " %llu %llu %llu %llu\n", 
-                        Ir_total.a,
-                        Bc_total.b, Bc_total.mp, 
-                        Bi_total.b, Bi_total.mp);
-   }
-   else {
-      VG_(fprintf)(fp, "summary:"
-                        " %llu\n", 
-                        Ir_total.a);
+   VG_(fprintf)(fp, "summary:");
+   for (i = 0; i < N_CC_COUNTS; i++) {
+      if (CC_count_is_used(i))
+         VG_(fprintf)(fp, " %llu", totals[i]);
    }
+   VG_(fprintf)(fp, "\n");
 
    VG_(fclose)(fp);
 }
@@ -1585,11 +2144,20 @@ static void cg_fini(Int exitcode)
          LL_total, LL_total_r, LL_total_w;
    Int l1, l2, l3;
 
+   if (clo_sample_window > 0)
+      sample_finish();
+
    fprint_CC_table_and_calc_totals();
 
    if (VG_(clo_verbosity) == 0) 
       return;
 
+   if (clo_sample_window > 0) {
+      VG_(umsg)("Sampled insns: %'llu of %'llu, in %u windows; "
+                "counts below are estimates\n",
+                sampled_insns, sample_insns, n_sample_windows);
+   }
+
    // Nb: this isn't called "MAX" because that overshadows a global on Darwin.
    #define CG_MAX(a, b)  ((a) >= (b) ? (a) : (b))
 
@@ -1609,11 +2177,16 @@ static void cg_fini(Int exitcode)
       miss numbers */
    if (clo_cache_sim) {
       VG_(umsg)(fmt, "I1  misses:   ", Ir_total.m1);
+      if (have_L2)
+         VG_(umsg)(fmt, "I2  misses:   ", Ir_total.m2);
       VG_(umsg)(fmt, "LLi misses:   ", Ir_total.mL);
 
       if (0 == Ir_total.a) Ir_total.a = 1;
       VG_(umsg)("I1  miss rate: %*.2f%%\n", l1,
                 Ir_total.m1 * 100.0 / Ir_total.a);
+      if (have_L2)
+         VG_(umsg)("I2  miss rate: %*.2f%%\n", l1,
+                   Ir_total.m2 * 100.0 / Ir_total.a);
       VG_(umsg)("LLi miss rate: %*.2f%%\n", l1,
                 Ir_total.mL * 100.0 / Ir_total.a);
       VG_(umsg)("\n");
@@ -1622,6 +2195,7 @@ static void cg_fini(Int exitcode)
        * determine the width of columns 2 & 3. */
       D_total.a  = Dr_total.a  + Dw_total.a;
       D_total.m1 = Dr_total.m1 + Dw_total.m1;
+      D_total.m2 = Dr_total.m2 + Dw_total.m2;
       D_total.mL = Dr_total.mL + Dw_total.mL;
 
       /* Make format string, getting width right for numbers */
@@ -1632,6 +2206,9 @@ static void cg_fini(Int exitcode)
                      D_total.a, Dr_total.a, Dw_total.a);
       VG_(umsg)(fmt, "D1  misses:   ",
                      D_total.m1, Dr_total.m1, Dw_total.m1);
+      if (have_L2)
+         VG_(umsg)(fmt, "D2  misses:   ",
+                        D_total.m2, Dr_total.m2, Dw_total.m2);
       VG_(umsg)(fmt, "LLd misses:   ",
                      D_total.mL, Dr_total.mL, Dw_total.mL);
 
@@ -1642,17 +2219,29 @@ static void cg_fini(Int exitcode)
                 l1, D_total.m1  * 100.0 / D_total.a,
                 l2, Dr_total.m1 * 100.0 / Dr_total.a,
                 l3, Dw_total.m1 * 100.0 / Dw_total.a);
+      if (have_L2)
+         VG_(umsg)("D2  miss rate: %*.1f%% (%*.1f%%     + %*.1f%%  )\n",
+                   l1, D_total.m2  * 100.0 / D_total.a,
+                   l2, Dr_total.m2 * 100.0 / Dr_total.a,
+                   l3, Dw_total.m2 * 100.0 / Dw_total.a);
       VG_(umsg)("LLd miss rate: %*.1f%% (%*.1f%%     + %*.1f%%  )\n",
                 l1, D_total.mL  * 100.0 / D_total.a,
                 l2, Dr_total.mL * 100.0 / Dr_total.a,
                 l3, Dw_total.mL * 100.0 / Dw_total.a);
       VG_(umsg)("\n");
 
-      /* LL overall results */
+      /* LL overall results.  LL is accessed on L2 misses if there is
+         an L2, and on L1 misses otherwise. */
 
-      LL_total   = Dr_total.m1 + Dw_total.m1 + Ir_total.m1;
-      LL_total_r = Dr_total.m1 + Ir_total.m1;
-      LL_total_w = Dw_total.m1;
+      if (have_L2) {
+         LL_total   = Dr_total.m2 + Dw_total.m2 + Ir_total.m2;
+         LL_total_r = Dr_total.m2 + Ir_total.m2;
+         LL_total_w = Dw_total.m2;
+      } else {
+         LL_total   = Dr_total.m1 + Dw_total.m1 + Ir_total.m1;
+         LL_total_r = Dr_total.m1 + Ir_total.m1;
+         LL_total_w = Dw_total.m1;
+      }
       VG_(umsg)(fmt, "LL refs:      ",
                      LL_total, LL_total_r, LL_total_w);
 
@@ -1666,6 +2255,26 @@ static void cg_fini(Int exitcode)
                 l1, LL_total_m  * 100.0 / (Ir_total.a + D_total.a),
                 l2, LL_total_mr * 100.0 / (Ir_total.a + Dr_total.a),
                 l3, LL_total_mw * 100.0 / Dw_total.a);
+
+      if (clo_multi_core) {
+         VG_(sprintf)(fmt, "%%s %%,%dllu\n", l1);
+         VG_(umsg)("\n");
+         VG_(umsg)(fmt, "D1c misses:   ", Co_total.m);
+         VG_(umsg)(fmt, "D1 invals:    ", Co_total.inv);
+      }
+
+      if (clo_prefetch != Prefetch_None) {
+         VG_(umsg)("\n");
+         if (have_L2) {
+            VG_(sprintf)(fmt, "%%s %%,%dllu  (%%,%dllu L2 + %%,%dllu LL misses)\n",
+                              l1, l2, l3);
+            VG_(umsg)(fmt, "D1 prefetches:", Pf_total.a, Pf_total.m2,
+                           Pf_total.mL);
+         } else {
+            VG_(sprintf)(fmt, "%%s %%,%dllu  (%%,%dllu LL misses)\n", l1, l2);
+            VG_(umsg)(fmt, "D1 prefetches:", Pf_total.a, Pf_total.mL);
+         }
+      }
    }
 
    /* If branch profiling is enabled, show branch overall results. */
@@ -1702,6 +2311,8 @@ static void cg_fini(Int exitcode)
       VG_(dmsg)("cachegrind: distinct functions : %d\n", distinct_fns);
       VG_(dmsg)("cachegrind: distinct lines     : %d\n", distinct_lines);
       VG_(dmsg)("cachegrind: distinct instrs NoX: %d\n", distinct_instrsNoX);
+      VG_(dmsg)("cachegrind:   of which in same line: %d\n",
+                distinct_instrsSame);
       VG_(dmsg)("cachegrind: distinct instrs Gen: %d\n", distinct_instrsGen);
       VG_(dmsg)("cachegrind: debug lookups      : %d\n", debug_lookups);
       
@@ -1761,7 +2372,12 @@ void cg_discard_superblock_info ( Addr orig_addr64, VexGuestExtents vge )
 
 static Bool cg_process_cmd_line_option(const HChar* arg)
 {
-   if (VG_(str_clo_cache_opt)(arg,
+   const HChar* tmp_str;
+
+   if VG_STR_CLO(arg, "--L2", tmp_str) {
+      VG_(parse_cache_opt)(&clo_L2_cache, arg, tmp_str);
+   }
+   else if (VG_(str_clo_cache_opt)(arg,
                               &clo_I1_cache,
                               &clo_D1_cache,
                               &clo_LL_cache)) {}
@@ -1770,6 +2386,25 @@ static Bool cg_process_cmd_line_option(const HChar* arg)
    else if VG_BOOL_CLO(arg, "--cache-sim",  clo_cache_sim)  {}
    else if VG_BOOL_CLO(arg, "--branch-sim", clo_branch_sim) {}
    else if VG_BOOL_CLO(arg, "--instr-at-start", clo_instr_at_start) {}
+   else if VG_XACT_CLO(arg, "--replacement-policy=lru",
+                            clo_replacement_policy, Repl_LRU) {}
+   else if VG_XACT_CLO(arg, "--replacement-policy=plru",
+                            clo_replacement_policy, Repl_PLRU) {}
+   else if VG_XACT_CLO(arg, "--replacement-policy=rrip",
+                            clo_replacement_policy, Repl_RRIP) {}
+   else if VG_BOOL_CLO(arg, "--multi-core", clo_multi_core) {}
+   else if VG_XACT_CLO(arg, "--prefetch=none",
+                            clo_prefetch, Prefetch_None) {}
+   else if VG_XACT_CLO(arg, "--prefetch=next-line",
+                            clo_prefetch, Prefetch_NextLine) {}
+   else if VG_XACT_CLO(arg, "--prefetch=stride",
+                            clo_prefetch, Prefetch_Stride) {}
+   else if VG_BINT_CLO(arg, "--sample-window", clo_sample_window,
+                       0, 1000000000000LL) {}
+   else if VG_BINT_CLO(arg, "--sample-interval", clo_sample_interval,
+                       1, 1000000000000LL) {}
+   else if VG_BINT_CLO(arg, "--sample-warmup", clo_sample_warmup,
+                       0, 1000000000000LL) {}
    else
       return False;
 
@@ -1783,8 +2418,20 @@ static void cg_print_usage(void)
 "    --cache-sim=yes|no               collect cache stats? [no]\n"
 "    --branch-sim=yes|no              collect branch prediction stats? [no]\n"
 "    --instr-at-start=yes|no          instrument at start? [yes]\n"
+"    --replacement-policy=lru|plru|rrip  cache replacement policy [lru]\n"
+"    --multi-core=yes|no              give each thread its own I1, D1 and L2,\n"
+"                                     kept coherent? [no]\n"
+"    --prefetch=none|next-line|stride  D1 prefetcher [none]\n"
+"    --sample-window=<number>         simulate only this many insns in each\n"
+"                                     sampling interval [0, no sampling]\n"
+"    --sample-interval=<number>       length of a sampling interval [10000000]\n"
+"    --sample-warmup=<number>         insns simulated but not counted before\n"
+"                                     each sample window [1000000]\n"
    );
    VG_(print_cache_clo_opts)();
+   VG_(printf)(
+"    --L2=<size>,<assoc>,<line_size>  add an L2 cache between L1 and LL\n"
+   );
 }
 
 static void cg_print_debug_usage(void)
@@ -1881,9 +2528,20 @@ static void cg_pre_clo_init(void)
    VG_(needs_client_requests)(cg_handle_client_request);
 }
 
+static void cg_start_client_code(ThreadId tid, ULong blocks_done)
+{
+   cachesim_switch_core(tid);
+}
+
+static void cg_thread_exit(ThreadId tid)
+{
+   cachesim_free_core(tid);
+}
+
 static void cg_post_clo_init(void)
 {
    cache_t I1c, D1c, LLc; 
+   Bool    l2_defined = clo_L2_cache.size != -1;
 
    CC_table =
       VG_(OSetGen_Create)(offsetof(LineCC, loc),
@@ -1912,6 +2570,9 @@ static void cg_post_clo_init(void)
       // cache lines at any cache level
       min_line_size = (I1c.line_size < D1c.line_size) ? I1c.line_size : D1c.line_size;
       min_line_size = (LLc.line_size < min_line_size) ? LLc.line_size : min_line_size;
+      if (l2_defined)
+         min_line_size = (clo_L2_cache.line_size < min_line_size)
+                         ? clo_L2_cache.line_size : min_line_size;
 
       Int largest_load_or_store_size
          = VG_(machine_get_size_of_largest_guest_register)();
@@ -1927,8 +2588,40 @@ static void cg_post_clo_init(void)
          VG_(exit)(1);
       }
 
-      cachesim_initcaches(I1c, D1c, LLc);
+      cachesim_initcaches(I1c, D1c, LLc, clo_replacement_policy);
+      if (l2_defined)
+         cachesim_init_L2(clo_L2_cache, clo_replacement_policy);
+
+      if (clo_multi_core) {
+         cachesim_init_multi_core(I1c, D1c, clo_L2_cache,
+                                  clo_replacement_policy);
+         VG_(track_start_client_code)(cg_start_client_code);
+         VG_(track_pre_thread_ll_exit)(cg_thread_exit);
+      }
+      cachesim_init_prefetch(clo_prefetch);
+      D_ext_helpers = clo_multi_core || clo_prefetch != Prefetch_None;
+   } else if (clo_multi_core) {
+      VG_(fmsg_bad_option)("--multi-core=yes",
+                           "It needs --cache-sim=yes.\n");
+      VG_(exit)(1);
+   } else if (l2_defined) {
+      VG_(fmsg_bad_option)("--L2", "It needs --cache-sim=yes.\n");
+      VG_(exit)(1);
+   } else if (clo_prefetch != Prefetch_None) {
+      VG_(fmsg_bad_option)("--prefetch", "It needs --cache-sim=yes.\n");
+      VG_(exit)(1);
+   }
+
+   if (clo_sample_window > 0
+       && clo_sample_warmup + clo_sample_window > clo_sample_interval) {
+      VG_(fmsg_bad_option)("--sample-window",
+         "--sample-warmup plus --sample-window must not be more than "
+         "--sample-interval.\n");
+      VG_(exit)(1);
    }
+   if (clo_sample_window > 0)
+      sample_dirty = VG_(newXA)(VG_(malloc), "cg.sample.1", VG_(free),
+                                sizeof(LineCC*));
 
    // When instrumentation client requests are enabled, we start with
    // instrumentation off.
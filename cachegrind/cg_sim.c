@@ -36,6 +36,30 @@
       - both blocks miss                 --> one miss (not two)
 */
 
+/* Replacement policies.
+  - LRU: exact least-recently-used.  Each set is kept in MRU to LRU
+    order; the victim is the last line.
+  - PLRU: bit-PLRU (also known as MRU-bit or NRU).  Each line has a bit
+    which is set when it is accessed; when that makes all the bits in
+    the set 1, all but the one just set are cleared.  The victim is the
+    first line whose bit is clear.  Works for any associativity.
+  - RRIP: static re-reference interval prediction (SRRIP-HP) with
+    2-bit prediction values.  Lines are inserted with a "long"
+    prediction and get "near-immediate" when hit.  The victim is the
+    first line with a "distant" prediction, ageing the whole set until
+    there is one.  Repeated references to the line last referenced in
+    its set count as one, so that a line is not promoted just because
+    it is read or written piecewise, as when streaming through an array.
+  For PLRU and RRIP lines never move within a set; the policy keeps
+  its state on the side, so a hit costs one store at most.
+*/
+typedef
+   enum { Repl_LRU, Repl_PLRU, Repl_RRIP }
+   ReplPolicy;
+
+#define RRIP_DISTANT 3
+#define RRIP_LONG    2
+
 typedef struct {
    Int          size;                   /* bytes */
    Int          assoc;
@@ -46,28 +70,54 @@ typedef struct {
    Int          tag_shift;
    HChar        desc_line[128];         /* large enough */
    UWord*       tags;
+   ReplPolicy   policy;
+   /* PLRU and RRIP only: way of the last access to each set.  Looked
+      at first, as that's where most hits are. */
+   UInt*        mru;
+   /* PLRU: MRU bit of each line.
+      RRIP: re-reference prediction value of each line. */
+   UChar*       state;
+   /* PLRU: number of MRU bits set in each set. */
+   UInt*        n_set;
+   /* Multi-core D1s: number of lines marked invalid.  Lines marked
+      invalid can be evicted without this noticing, so it is only an
+      upper bound. */
+   UInt         n_invalid;
 } cache_t2;
 
 /* By this point, the size/assoc/line_size has been checked. */
-static void cachesim_initcache(cache_t config, cache_t2* c)
+static void cachesim_initcache(cache_t config, ReplPolicy policy,
+                               cache_t2* c)
 {
    Int i;
+   const HChar* policy_desc;
 
    c->size      = config.size;
    c->assoc     = config.assoc;
    c->line_size = config.line_size;
+   c->policy    = policy;
 
    c->sets           = (c->size / c->line_size) / c->assoc;
    c->sets_min_1     = c->sets - 1;
    c->line_size_bits = VG_(log2)(c->line_size);
    c->tag_shift      = c->line_size_bits + VG_(log2)(c->sets);
 
+   /* The default policy isn't mentioned, so as not to change the
+      "desc:" lines of existing output files. */
+   switch (c->policy) {
+      case Repl_LRU:  policy_desc = "";        break;
+      case Repl_PLRU: policy_desc = ", PLRU";  break;
+      case Repl_RRIP: policy_desc = ", RRIP";  break;
+      default:        tl_assert(0);
+   }
+
    if (c->assoc == 1) {
       VG_(sprintf)(c->desc_line, "%d B, %d B, direct-mapped", 
                                  c->size, c->line_size);
    } else {
-      VG_(sprintf)(c->desc_line, "%d B, %d B, %d-way associative",
-                                 c->size, c->line_size, c->assoc);
+      VG_(sprintf)(c->desc_line, "%d B, %d B, %d-way associative%s",
+                                 c->size, c->line_size, c->assoc,
+                                 policy_desc);
    }
 
    c->tags = VG_(malloc)("cg.sim.ci.1",
@@ -75,16 +125,39 @@ static void cachesim_initcache(cache_t config, cache_t2* c)
 
    for (i = 0; i < c->sets * c->assoc; i++)
       c->tags[i] = 0;
+
+   c->mru       = NULL;
+   c->state     = NULL;
+   c->n_set     = NULL;
+   c->n_invalid = 0;
+   if (c->policy == Repl_LRU)
+      return;
+
+   c->mru   = VG_(malloc)("cg.sim.ci.2", sizeof(UInt) * c->sets);
+   c->state = VG_(malloc)("cg.sim.ci.3", sizeof(UChar) * c->sets * c->assoc);
+   for (i = 0; i < c->sets; i++)
+      c->mru[i] = 0;
+   for (i = 0; i < c->sets * c->assoc; i++)
+      c->state[i] = c->policy == Repl_RRIP ? RRIP_DISTANT : 0;
+
+   if (c->policy == Repl_PLRU) {
+      c->n_set = VG_(malloc)("cg.sim.ci.4", sizeof(UInt) * c->sets);
+      for (i = 0; i < c->sets; i++)
+         c->n_set[i] = 0;
+   }
+}
+
+static void cachesim_freecache(cache_t2* c)
+{
+   VG_(free)(c->tags);
+   if (c->mru)   VG_(free)(c->mru);
+   if (c->state) VG_(free)(c->state);
+   if (c->n_set) VG_(free)(c->n_set);
 }
 
-/* This attribute forces GCC to inline the function, getting rid of a
- * lot of indirection around the cache_t2 pointer, if it is known to be
- * constant in the caller (the caller is inlined itself).
- * Without inlining of simulator functions, cachegrind can get 40% slower.
- */
 __attribute__((always_inline))
 static __inline__
-Bool cachesim_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
+Bool cachesim_lru_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
 {
    int i, j;
    UWord *set;
@@ -119,6 +192,101 @@ Bool cachesim_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
    return True;
 }
 
+/* Set the MRU bit of a line for PLRU. */
+static void cachesim_plru_touch(cache_t2* c, UInt set_no, Int way)
+{
+   UChar* state = &(c->state[set_no * c->assoc]);
+   Int    i;
+
+   if (state[way])
+      return;
+   state[way] = 1;
+   if (++c->n_set[set_no] == c->assoc) {
+      for (i = 0; i < c->assoc; i++)
+         state[i] = 0;
+      state[way] = 1;
+      c->n_set[set_no] = 1;
+   }
+}
+
+/* Choose a PLRU or RRIP victim in a set, after a miss. */
+static Int cachesim_victim(cache_t2* c, UInt set_no)
+{
+   UChar* state = &(c->state[set_no * c->assoc]);
+   UChar  max   = 0;
+   Int    i, victim = 0;
+
+   if (c->policy == Repl_PLRU) {
+      /* There is a clear bit unless the cache is direct-mapped. */
+      for (i = 0; i < c->assoc; i++) {
+         if (!state[i])
+            return i;
+      }
+      return 0;
+   }
+
+   for (i = 0; i < c->assoc; i++) {
+      if (state[i] > max) {
+         max    = state[i];
+         victim = i;
+         if (max == RRIP_DISTANT)
+            return victim;
+      }
+   }
+   /* Age the set so that the victim's prediction is distant. */
+   for (i = 0; i < c->assoc; i++)
+      state[i] += RRIP_DISTANT - max;
+   return victim;
+}
+
+/* The PLRU and RRIP case of cachesim_setref_is_miss.  Kept out of
+   line so as not to slow down the LRU case. */
+static Bool cachesim_repl_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
+{
+   UWord* set   = &(c->tags[set_no * c->assoc]);
+   UChar* state = &(c->state[set_no * c->assoc]);
+   Int    i;
+   Bool   miss = True;
+
+   /* Re-referencing the line of the previous access to the set is the
+      most common case.  It doesn't change the replacement state. */
+   if (tag == set[c->mru[set_no]])
+      return False;
+
+   for (i = 0; i < c->assoc; i++) {
+      if (tag == set[i]) {
+         miss = False;
+         break;
+      }
+   }
+   if (miss) {
+      i = cachesim_victim(c, set_no);
+      set[i] = tag;
+   }
+
+   if (c->policy == Repl_PLRU)
+      cachesim_plru_touch(c, set_no, i);
+   else
+      state[i] = miss ? RRIP_LONG : 0;
+   c->mru[set_no] = i;
+
+   return miss;
+}
+
+/* This attribute forces GCC to inline the function, getting rid of a
+ * lot of indirection around the cache_t2 pointer, if it is known to be
+ * constant in the caller (the caller is inlined itself).
+ * Without inlining of simulator functions, cachegrind can get 40% slower.
+ */
+__attribute__((always_inline))
+static __inline__
+Bool cachesim_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
+{
+   if (UNLIKELY(c->policy != Repl_LRU))
+      return cachesim_repl_setref_is_miss(c, set_no, tag);
+   return cachesim_lru_setref_is_miss(c, set_no, tag);
+}
+
 __attribute__((always_inline))
 static __inline__
 Bool cachesim_ref_is_miss(cache_t2* c, Addr a, UChar size)
@@ -162,31 +330,57 @@ Bool cachesim_ref_is_miss(cache_t2* c, Addr a, UChar size)
 
 
 static cache_t2 LL;
+static cache_t2 L2;
 static cache_t2 I1;
 static cache_t2 D1;
 
-static void cachesim_initcaches(cache_t I1c, cache_t D1c, cache_t LLc)
+/* Is there an L2 cache, between I1/D1 and LL? */
+static Bool have_L2 = False;
+
+static void cachesim_initcaches(cache_t I1c, cache_t D1c, cache_t LLc,
+                                ReplPolicy policy)
 {
-   cachesim_initcache(I1c, &I1);
-   cachesim_initcache(D1c, &D1);
-   cachesim_initcache(LLc, &LL);
+   cachesim_initcache(I1c, policy, &I1);
+   cachesim_initcache(D1c, policy, &D1);
+   cachesim_initcache(LLc, policy, &LL);
 }
 
+static void cachesim_init_L2(cache_t L2c, ReplPolicy policy)
+{
+   cachesim_initcache(L2c, policy, &L2);
+   have_L2 = True;
+}
+
+/* The rest of an access that missed I1 or D1. */
 __attribute__((always_inline))
 static __inline__
-void cachesim_I1_doref_Gen(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_L1_miss(Addr a, UChar size, ULong* m2, ULong* mL)
+{
+   if (UNLIKELY(have_L2)) {
+      if (!cachesim_ref_is_miss(&L2, a, size))
+         return;
+      (*m2)++;
+   }
+   if (cachesim_ref_is_miss(&LL, a, size))
+      (*mL)++;
+}
+
+__attribute__((always_inline))
+static __inline__
+void cachesim_I1_doref_Gen(Addr a, UChar size,
+                           ULong* m1, ULong* m2, ULong* mL)
 {
    if (cachesim_ref_is_miss(&I1, a, size)) {
       (*m1)++;
-      if (cachesim_ref_is_miss(&LL, a, size))
-         (*mL)++;
+      cachesim_L1_miss(a, size, m2, mL);
    }
 }
 
 // common special case IrNoX
 __attribute__((always_inline))
 static __inline__
-void cachesim_I1_doref_NoX(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_I1_doref_NoX(Addr a, UChar size,
+                           ULong* m1, ULong* m2, ULong* mL)
 {
    UWord block  = a >> I1.line_size_bits;
    UInt  I1_set = block & I1.sets_min_1;
@@ -195,7 +389,12 @@ void cachesim_I1_doref_NoX(Addr a, UChar size, ULong* m1, ULong *mL)
    if (cachesim_setref_is_miss(&I1, I1_set, block)) {
       UInt  LL_set = block & LL.sets_min_1;
       (*m1)++;
-      // can use block as tag as L1I and LL cache line sizes are equal
+      // can use block as tag as L1I, L2 and LL cache line sizes are equal
+      if (UNLIKELY(have_L2)) {
+         if (!cachesim_setref_is_miss(&L2, block & L2.sets_min_1, block))
+            return;
+         (*m2)++;
+      }
       if (cachesim_setref_is_miss(&LL, LL_set, block))
          (*mL)++;
    }
@@ -203,15 +402,370 @@ void cachesim_I1_doref_NoX(Addr a, UChar size, ULong* m1, ULong *mL)
 
 __attribute__((always_inline))
 static __inline__
-void cachesim_D1_doref(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_D1_doref(Addr a, UChar size, ULong* m1, ULong* m2, ULong* mL)
 {
    if (cachesim_ref_is_miss(&D1, a, size)) {
       (*m1)++;
-      if (cachesim_ref_is_miss(&LL, a, size))
-         (*mL)++;
+      cachesim_L1_miss(a, size, m2, mL);
    }
 }
 
+/* Multi-core simulation.
+  - each thread runs on a core of its own, with private I1 and D1
+    caches, and a private L2 if there is one; LL is shared.  The I1,
+    D1 and L2 above are those of the running thread; they are swapped
+    with the other threads' ones by cachesim_switch_core.
+  - the D1s are kept coherent as with MESI, except that write-backs
+    and the E/S distinction aren't modelled: a write removes the line
+    from the D1s of all other threads, each removal counting as an
+    invalidation.  Since a thread only reads its own D1, it doesn't
+    matter which thread last wrote a line it holds.  The line is also
+    removed from the other threads' L2s, so that their next D1 miss on
+    it doesn't hit a stale copy, but that isn't counted.
+  - an invalidated line keeps its tag, marked with INVALID_TAG_BIT, so
+    that the next miss on it can be told apart as a coherence miss.
+    The line is then refilled into the same way.
+*/
+#define INVALID_TAG_BIT ((UWord)1 << (8 * sizeof(UWord) - 1))
+
+typedef struct {
+   cache_t2 I1;
+   cache_t2 D1;
+   cache_t2 L2;
+} core_t;
+
+static cache_t    I1_config, D1_config, L2_config;
+static ReplPolicy core_policy;
+static core_t**   cores;        /* indexed by ThreadId */
+static ThreadId*  core_tids;    /* threads having a core */
+static Int        n_cores      = 0;
+static ThreadId   running_core = VG_INVALID_THREADID;
+static Bool       initial_caches_taken = False;
+
+static void cachesim_init_multi_core(cache_t I1c, cache_t D1c, cache_t L2c,
+                                     ReplPolicy policy)
+{
+   I1_config   = I1c;
+   D1_config   = D1c;
+   L2_config   = L2c;
+   core_policy = policy;
+   cores       = VG_(calloc)("cg.sim.imc.1", VG_N_THREADS, sizeof(core_t*));
+   core_tids   = VG_(calloc)("cg.sim.imc.2", VG_N_THREADS, sizeof(ThreadId));
+   VG_(strcat)(I1.desc_line, ", per thread");
+   VG_(strcat)(D1.desc_line, ", per thread");
+   if (have_L2)
+      VG_(strcat)(L2.desc_line, ", per thread");
+}
+
+// Called before a thread runs.  The first thread gets the caches
+// that were set up by cachesim_initcaches.
+static void cachesim_switch_core(ThreadId tid)
+{
+   core_t* core;
+
+   if (tid == running_core)
+      return;
+   if (running_core != VG_INVALID_THREADID) {
+      cores[running_core]->I1 = I1;
+      cores[running_core]->D1 = D1;
+      cores[running_core]->L2 = L2;
+   }
+
+   core = cores[tid];
+   if (!core) {
+      core = VG_(malloc)("cg.sim.sc.1", sizeof(core_t));
+      if (initial_caches_taken) {
+         cachesim_initcache(I1_config, core_policy, &core->I1);
+         cachesim_initcache(D1_config, core_policy, &core->D1);
+         VG_(strcpy)(core->I1.desc_line, I1.desc_line);
+         VG_(strcpy)(core->D1.desc_line, D1.desc_line);
+         if (have_L2) {
+            cachesim_initcache(L2_config, core_policy, &core->L2);
+            VG_(strcpy)(core->L2.desc_line, L2.desc_line);
+         }
+      } else {
+         core->I1 = I1;
+         core->D1 = D1;
+         core->L2 = L2;
+         initial_caches_taken = True;
+      }
+      cores[tid] = core;
+      core_tids[n_cores++] = tid;
+   }
+   I1 = core->I1;
+   D1 = core->D1;
+   L2 = core->L2;
+   running_core = tid;
+}
+
+// Called when a thread exits.  I1, D1 and L2 keep the description lines,
+// but nothing can be simulated until another thread runs.
+static void cachesim_free_core(ThreadId tid)
+{
+   core_t* core = cores[tid];
+   Int     i;
+
+   if (!core)
+      return;
+   if (tid == running_core) {
+      core->I1 = I1;
+      core->D1 = D1;
+      core->L2 = L2;
+      running_core = VG_INVALID_THREADID;
+   }
+   cachesim_freecache(&core->I1);
+   cachesim_freecache(&core->D1);
+   if (have_L2)
+      cachesim_freecache(&core->L2);
+   VG_(free)(core);
+   cores[tid] = NULL;
+
+   for (i = 0; i < n_cores; i++) {
+      if (core_tids[i] == tid) {
+         core_tids[i] = core_tids[--n_cores];
+         break;
+      }
+   }
+}
+
+/* Remove a line from a D1 or L2 other than the running thread's, if
+   it's there.  The line is made the next victim of its set, as a real
+   cache would fill an invalid line first. */
+static Bool cachesim_invalidate(cache_t2* c, UWord block)
+{
+   UInt   set_no = block & c->sets_min_1;
+   UWord* set    = &(c->tags[set_no * c->assoc]);
+   UChar* state;
+   Int    i, j;
+
+   for (i = 0; i < c->assoc; i++) {
+      if (set[i] == block)
+         break;
+   }
+   if (i == c->assoc)
+      return False;
+
+   switch (c->policy) {
+      case Repl_LRU:
+         for (j = i; j < c->assoc - 1; j++)
+            set[j] = set[j + 1];
+         i = c->assoc - 1;
+         break;
+      case Repl_PLRU:
+         state = &(c->state[set_no * c->assoc]);
+         if (state[i]) {
+            state[i] = 0;
+            c->n_set[set_no]--;
+         }
+         break;
+      case Repl_RRIP:
+         c->state[set_no * c->assoc + i] = RRIP_DISTANT;
+         break;
+      default:
+         tl_assert(0);
+   }
+   set[i] = block | INVALID_TAG_BIT;
+   c->n_invalid++;
+   return True;
+}
+
+/* One line of a D1 access by the running thread.  Sets *coherence if
+   it is a miss on a line that was invalidated, and counts the
+   invalidations done by a write in *inv. */
+static Bool cachesim_D1_coherent_setref_is_miss(UWord block, Bool is_write,
+                                                Bool* coherence, ULong* inv)
+{
+   UInt   set_no = block & D1.sets_min_1;
+   UWord* set    = &(D1.tags[set_no * D1.assoc]);
+   Bool   miss   = False;
+   Int    i;
+
+   if (D1.n_invalid > 0) {
+      for (i = 0; i < D1.assoc; i++) {
+         if (set[i] == (block | INVALID_TAG_BIT)) {
+            set[i] = block;
+            D1.n_invalid--;
+            *coherence = True;
+            miss = True;
+            break;
+         }
+      }
+   }
+   /* After a refill this is a hit, which updates the replacement
+      state. */
+   if (cachesim_setref_is_miss(&D1, set_no, block))
+      miss = True;
+
+   if (is_write) {
+      /* The L2 lines covering the D1 line, in case their sizes
+         differ. */
+      Addr  start     = (Addr)block << D1.line_size_bits;
+      UWord L2_first  = start >> L2.line_size_bits;
+      UWord L2_last   = (start + D1.line_size - 1) >> L2.line_size_bits;
+      UWord L2_block;
+
+      for (i = 0; i < n_cores; i++) {
+         core_t* core = cores[core_tids[i]];
+
+         if (core_tids[i] == running_core)
+            continue;
+         if (cachesim_invalidate(&core->D1, block))
+            (*inv)++;
+         if (have_L2) {
+            for (L2_block = L2_first; L2_block <= L2_last; L2_block++)
+               cachesim_invalidate(&core->L2, L2_block);
+         }
+      }
+   }
+   return miss;
+}
+
+static Bool cachesim_D1_coherent_ref_is_miss(Addr a, UChar size,
+                                             Bool is_write,
+                                             Bool* coherence, ULong* inv)
+{
+   UWord block1 =  a         >> D1.line_size_bits;
+   UWord block2 = (a+size-1) >> D1.line_size_bits;
+   Bool  miss;
+
+   miss = cachesim_D1_coherent_setref_is_miss(block1, is_write,
+                                              coherence, inv);
+   if (block2 != block1
+       && cachesim_D1_coherent_setref_is_miss(block2, is_write,
+                                              coherence, inv))
+      miss = True;
+   return miss;
+}
+
+/* Prefetchers.  They bring lines into D1 (and so L2 and LL) ahead of
+   the data accesses.  Instruction fetches aren't prefetched.
+  - next-line: a D1 miss prefetches the line following the one missed.
+  - stride: a table indexed by instruction address holds the last
+    address accessed by each data access instruction and the stride
+    between its last two accesses.  Once the same non-zero stride has
+    been repeated STRIDE_CONFIDENT times in a row, the line holding the
+    address one stride ahead is prefetched, or, for strides shorter
+    than a line, the next line in the direction of the stride.  Each
+    line is prefetched only once in a row.
+  A prefetch of a line already in D1 doesn't count as one.
+*/
+typedef
+   enum { Prefetch_None, Prefetch_NextLine, Prefetch_Stride }
+   PrefetchKind;
+
+#define N_STRIDE_ENTRIES  256
+#define STRIDE_CONFIDENT  2
+
+typedef struct {
+   Addr  pc;
+   Addr  last;       /* last address accessed */
+   Word  stride;
+   UInt  confidence; /* number of times in a row stride was seen */
+   UWord last_pf;    /* last block prefetched */
+} stride_entry;
+
+static PrefetchKind  prefetch_kind = Prefetch_None;
+static stride_entry* stride_table  = NULL;
+
+static void cachesim_init_prefetch(PrefetchKind kind)
+{
+   Int i;
+
+   prefetch_kind = kind;
+   switch (kind) {
+      case Prefetch_None:
+         return;
+      case Prefetch_NextLine:
+         VG_(strcat)(D1.desc_line, ", next-line prefetch");
+         return;
+      case Prefetch_Stride:
+         VG_(strcat)(D1.desc_line, ", stride prefetch");
+         stride_table = VG_(malloc)("cg.sim.cip.1",
+                                    N_STRIDE_ENTRIES * sizeof(stride_entry));
+         for (i = 0; i < N_STRIDE_ENTRIES; i++) {
+            stride_table[i].pc         = 0;
+            stride_table[i].last       = 0;
+            stride_table[i].stride     = 0;
+            stride_table[i].confidence = 0;
+            stride_table[i].last_pf    = 0;
+         }
+         return;
+      default:
+         tl_assert(0);
+   }
+}
+
+/* Which block does the stride prefetcher fetch after an access by the
+   instruction at pc?  Returns False if none. */
+static Bool cachesim_stride_block(Addr pc, Addr a, UWord* block)
+{
+   stride_entry* e = &stride_table[(pc ^ (pc >> 8)) % N_STRIDE_ENTRIES];
+   Word          stride;
+   Addr          target;
+
+   if (e->pc != pc) {
+      e->pc         = pc;
+      e->last       = a;
+      e->stride     = 0;
+      e->confidence = 0;
+      return False;
+   }
+
+   stride  = (Word)(a - e->last);
+   e->last = a;
+   if (stride == 0 || stride != e->stride) {
+      e->stride     = stride;
+      e->confidence = 0;
+      return False;
+   }
+   if (e->confidence < STRIDE_CONFIDENT)
+      e->confidence++;
+   if (e->confidence < STRIDE_CONFIDENT)
+      return False;
+
+   if (stride >= D1.line_size || stride <= -D1.line_size)
+      target = a + stride;
+   else
+      target = stride > 0 ? a + D1.line_size : a - D1.line_size;
+   *block = target >> D1.line_size_bits;
+   if (*block == e->last_pf)
+      return False;
+   e->last_pf = *block;
+   return True;
+}
+
+/* Called after each data access to D1, by the instruction at pc, when
+   there is a prefetcher. */
+static void cachesim_D1_prefetch(Addr pc, Addr a, UChar size, Bool miss,
+                                 ULong* pf, ULong* pf2, ULong* pfL)
+{
+   UWord block;
+   Addr  pf_a;
+   Bool  pf_miss, coherence = False;
+   ULong inv = 0;
+
+   if (prefetch_kind == Prefetch_NextLine) {
+      if (!miss)
+         return;
+      block = ((a+size-1) >> D1.line_size_bits) + 1;
+   } else if (!cachesim_stride_block(pc, a, &block)) {
+      return;
+   }
+
+   /* A prefetch is a read, so doesn't invalidate anything. */
+   if (cores)
+      pf_miss = cachesim_D1_coherent_setref_is_miss(block, False,
+                                                    &coherence, &inv);
+   else
+      pf_miss = cachesim_setref_is_miss(&D1, block & D1.sets_min_1, block);
+   if (!pf_miss)
+      return;
+
+   (*pf)++;
+   pf_a = block << D1.line_size_bits;
+   cachesim_L1_miss(pf_a, 1, pf2, pfL);
+}
+
 /* Check for special case IrNoX. Called at instrumentation time.
  *
  * Does this Ir only touch one cache line, and are L1I/LL cache
@@ -224,6 +778,7 @@ static Bool cachesim_is_IrNoX(Addr a, UChar size)
    UWord block1, block2;
 
    if (I1.line_size_bits != LL.line_size_bits) return False;
+   if (have_L2 && I1.line_size_bits != L2.line_size_bits) return False;
    block1 =  a         >> I1.line_size_bits;
    block2 = (a+size-1) >> I1.line_size_bits;
    if (block1 != block2) return False;
@@ -231,6 +786,17 @@ static Bool cachesim_is_IrNoX(Addr a, UChar size)
    return True;
 }
 
+/* Which I1 line holds the last byte of this Ir?  Called at
+ * instrumentation time.
+ *
+ * Once the Ir has been simulated, this line is the MRU entry of its
+ * I1 set, whatever the outcome of the access was.
+ */
+static UWord cachesim_I1_last_block(Addr a, UChar size)
+{
+   return (a+size-1) >> I1.line_size_bits;
+}
+
 /*--------------------------------------------------------------------*/
 /*--- end                                                 cg_sim.c ---*/
 /*--------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+// Cachegrind doesn't simulate the fetch of an instruction that lies in the
+// same I1 line as the end of the previous instruction of a superblock, as
+// that fetch is known to hit.  Check that the counts are still exact for a
+// loop whose body straddles an I1 line boundary.
+//
+// The loop lives in its own 64-byte aligned lines, so that nothing else
+// fetches them.  Its body is 20 one-byte nops, starting 11 bytes before
+// a line boundary, plus a decrement and a conditional branch.  With 1000
+// iterations that gives 1 + 1000 * 22 + 1 = 22002 Irs and 2 I1/LL misses.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__ELF__)
+__asm__(
+"        .text\n"
+"        .p2align 6\n"
+"        .skip 48, 0x90\n"
+"        .globl irsame_loop\n"
+"        .type irsame_loop, @function\n"
+"irsame_loop:\n"
+"        movl $1000, %ecx\n"
+"1:      nop; nop; nop; nop; nop; nop; nop; nop; nop; nop\n"
+"        nop; nop; nop; nop; nop; nop; nop; nop; nop; nop\n"
+"        decl %ecx\n"
+"        jnz 1b\n"
+"        ret\n"
+"        .size irsame_loop, .-irsame_loop\n"
+"        .p2align 6\n"
+);
+
+void irsame_loop(void);
+#endif
+
+int main(void)
+{
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__ELF__)
+   irsame_loop();
+#endif
+   return 0;
+}
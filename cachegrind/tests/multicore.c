@@ -0,0 +1,35 @@
+// Two threads writing to adjacent counters, which share a cache line.
+// With --multi-core=yes each write invalidates the other thread's copy
+// of the line.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+static struct {
+   volatile long count[2];
+} shared __attribute__((aligned(64)));
+
+static void* worker(void* arg)
+{
+   long me = (long)arg;
+   int i;
+
+   for (i = 0; i < 1000; i++) {
+      shared.count[me]++;
+      sched_yield();
+   }
+   return NULL;
+}
+
+int main(void)
+{
+   pthread_t t[2];
+   long i;
+
+   for (i = 0; i < 2; i++)
+      pthread_create(&t[i], NULL, worker, (void*)i);
+   for (i = 0; i < 2; i++)
+      pthread_join(t[i], NULL);
+   return shared.count[0] + shared.count[1] == 2000 ? 0 : 1;
+}
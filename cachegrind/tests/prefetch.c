@@ -0,0 +1,36 @@
+// Walks arrays with a one-line stride, so that the stride prefetcher
+// fetches every line ahead of its use.  Each array is walked twice: on
+// the second walk the 128 KB one is still in L2, while the 512 KB one
+// has been evicted from L2 but is still in LL.
+
+#define LINE 64
+
+static char small[128 * 1024] __attribute__((aligned(LINE)));
+static char large[512 * 1024] __attribute__((aligned(LINE)));
+
+static volatile char sink;
+
+static void walk_small(void)
+{
+   unsigned long i;
+
+   for (i = 0; i < sizeof(small); i += LINE)
+      sink = small[i];
+}
+
+static void walk_large(void)
+{
+   unsigned long i;
+
+   for (i = 0; i < sizeof(large); i += LINE)
+      sink = large[i];
+}
+
+int main(void)
+{
+   walk_small();
+   walk_small();
+   walk_large();
+   walk_large();
+   return 0;
+}
@@ -46,6 +46,7 @@ void CLG_(init_bbcc_hash)(bbcc_hash* bbccs)
 
    bbccs->size    = N_BBCC_INITIAL_ENTRIES;
    bbccs->entries = 0;
+   bbccs->dirty   = 0;
    bbccs->table = (BBCC**) CLG_MALLOC("cl.bbcc.ibh.1",
                                       bbccs->size * sizeof(BBCC*));
 
@@ -59,6 +60,7 @@ void CLG_(copy_current_bbcc_hash)(bbcc_hash* dst)
   dst->size    = current_bbccs.size;
   dst->entries = current_bbccs.entries;
   dst->table   = current_bbccs.table;
+  dst->dirty   = current_bbccs.dirty;
 }
 
 bbcc_hash* CLG_(get_current_bbcc_hash)(void)
@@ -73,6 +75,7 @@ void CLG_(set_current_bbcc_hash)(bbcc_hash* h)
   current_bbccs.size    = h->size;
   current_bbccs.entries = h->entries;
   current_bbccs.table   = h->table;
+  current_bbccs.dirty   = h->dirty;
 }
 
 /*
@@ -131,6 +134,39 @@ void CLG_(forall_bbccs)(void (*func)(BBCC*))
 }
 
 
+/* BBCCs getting ecounter_sum or ret_counter > 0 are put into the dirty
+ * list of the current hash. Both counters are only reset when dumping or
+ * zeroing, so only these BBCCs have to be visited then, instead of
+ * walking the whole hash: for periodic dumps of long running programs,
+ * most BBCCs usually are not executed between two dumps.
+ * Call before incrementing a counter which was 0 before (for both).
+ */
+void CLG_(mark_bbcc_dirty)(BBCC* bbcc)
+{
+  CLG_ASSERT((bbcc->ecounter_sum == 0) && (bbcc->ret_counter == 0));
+
+  bbcc->next_dirty = current_bbccs.dirty;
+  current_bbccs.dirty = bbcc;
+}
+
+void CLG_(forall_dirty_bbccs)(void (*func)(BBCC*))
+{
+  BBCC *bbcc, *next;
+
+  for (bbcc = current_bbccs.dirty; bbcc; bbcc = next) {
+    /* func may reset the counters, making bbcc clean */
+    next = bbcc->next_dirty;
+    (*func)(bbcc);
+  }
+}
+
+/* To be called after the counters of all dirty BBCCs are reset */
+void CLG_(clear_dirty_bbccs)(void)
+{
+  current_bbccs.dirty = 0;
+}
+
+
 /* All BBCCs for recursion level 0 are inserted into a
  * thread specific hash table with key
  * - address of BB structure (unique, as never freed)
@@ -503,11 +539,11 @@ static void handleUnderflow(BB* bb)
   source_bbcc = CLG_(get_bbcc)(source_bb);
 
   /* seen_before can be true if RET from a signal handler */
-  if (!seen_before) {
-    source_bbcc->ecounter_sum = CLG_(current_state).collect ? 1 : 0;
-  }
-  else if (CLG_(current_state).collect)
+  if (CLG_(current_state).collect) {
+    if ((source_bbcc->ecounter_sum == 0) && (source_bbcc->ret_counter == 0))
+      CLG_(mark_bbcc_dirty)(source_bbcc);
     source_bbcc->ecounter_sum++;
+  }
   
   /* Force a new top context, will be set active by push_cxt() */
   CLG_(current_fn_stack).top--;
@@ -603,6 +639,8 @@ void CLG_(setup_bbcc)(BB* bb)
 
       if (CLG_(current_state).collect) {
 	if (!CLG_(current_state).nonskipped) {
+	  if ((last_bbcc->ecounter_sum == 0) && (last_bbcc->ret_counter == 0))
+	    CLG_(mark_bbcc_dirty)(last_bbcc);
 	  last_bbcc->ecounter_sum++;
 	  last_bbcc->jmp[passed].ecounter++;
 	  if (!CLG_(clo).simulate_cache) {
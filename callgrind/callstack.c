@@ -43,6 +43,10 @@
 
 call_stack CLG_(current_call_stack);
 
+/* Inclusive cost of calls with a context spilled due to --max-contexts,
+ * not counting nested ones twice */
+FullCost CLG_(spilled_cost) = 0;
+
 void CLG_(init_call_stack)(call_stack* s)
 {
   Int i;
@@ -53,6 +57,7 @@ void CLG_(init_call_stack)(call_stack* s)
   s->entry = (call_entry*) CLG_MALLOC("cl.callstack.ics.1",
                                       s->size * sizeof(call_entry));
   s->sp = 0;
+  s->spilled = 0;
   s->entry[0].cxt = 0; /* for assertion in push_cxt() */
 
   for(i=0; i<s->size; i++) s->entry[i].enter_cost = 0;
@@ -68,18 +73,20 @@ void CLG_(copy_current_call_stack)(call_stack* dst)
 {
   CLG_ASSERT(dst != 0);
 
-  dst->size  = CLG_(current_call_stack).size;
-  dst->entry = CLG_(current_call_stack).entry;
-  dst->sp    = CLG_(current_call_stack).sp;
+  dst->size    = CLG_(current_call_stack).size;
+  dst->entry   = CLG_(current_call_stack).entry;
+  dst->sp      = CLG_(current_call_stack).sp;
+  dst->spilled = CLG_(current_call_stack).spilled;
 }
 
 void CLG_(set_current_call_stack)(call_stack* s)
 {
   CLG_ASSERT(s != 0);
 
-  CLG_(current_call_stack).size  = s->size;
-  CLG_(current_call_stack).entry = s->entry;
-  CLG_(current_call_stack).sp    = s->sp;
+  CLG_(current_call_stack).size    = s->size;
+  CLG_(current_call_stack).entry   = s->entry;
+  CLG_(current_call_stack).sp      = s->sp;
+  CLG_(current_call_stack).spilled = s->spilled;
 }
 
 
@@ -197,6 +204,7 @@ void CLG_(push_call_stack)(BBCC* from, UInt jmp, BBCC* to, Addr sp, Bool skip)
 
     if (skip) {
 	jcc = 0;
+	current_entry->spilled = False;
     }
     else {
 	fn_node* to_fn = to->cxt->fn[0];
@@ -229,6 +237,11 @@ void CLG_(push_call_stack)(BBCC* from, UInt jmp, BBCC* to, Addr sp, Bool skip)
 	CLG_(stat).call_counter++;
 
 	if (*pdepth == 1) function_entered(to_fn);
+
+	if (current_entry->spilled) {
+	    CLG_(current_call_stack).spilled++;
+	    CLG_(stat).spilled_calls++;
+	}
     }
 
     /* return address is only is useful with a real call;
@@ -254,6 +267,7 @@ void CLG_(push_call_stack)(BBCC* from, UInt jmp, BBCC* to, Addr sp, Bool skip)
     CLG_ASSERT(CLG_(current_call_stack).sp < CLG_(current_call_stack).size);
     current_entry++;
     current_entry->cxt = 0;
+    current_entry->spilled = False;
 
     if (!skip)
 	CLG_(current_state).nonskipped = 0;
@@ -341,6 +355,18 @@ void CLG_(pop_call_stack)(void)
 	else (*pdepth)--;
 	depth = *pdepth;
 
+	/* outermost call with spilled context: sum up its cost.
+	 * Must be done before enter_cost is updated below */
+	if (lower_entry->spilled) {
+	    CLG_(current_call_stack).spilled--;
+	    if (CLG_(current_call_stack).spilled == 0) {
+		Int i;
+		for(i=0; i<CLG_(sets).full->size; i++)
+		    CLG_(spilled_cost)[i] += CLG_(current_state).cost[i] -
+					     lower_entry->enter_cost[i];
+	    }
+	}
+
 	/* add cost difference to sum */
 	if ( CLG_(add_diff_cost_lz)( CLG_(sets).full, &(jcc->cost),
 				    lower_entry->enter_cost,
@@ -349,6 +375,8 @@ void CLG_(pop_call_stack)(void)
 	  /* only count this call if it attributed some cost.
 	   * the ret_counter is used to check if a BBCC dump is needed.
 	   */
+	  if ((jcc->from->ecounter_sum == 0) && (jcc->from->ret_counter == 0))
+	    CLG_(mark_bbcc_dirty)(jcc->from);
 	  jcc->from->ret_counter++;
 	}
 	CLG_(stat).ret_counter++;
@@ -364,6 +392,7 @@ void CLG_(pop_call_stack)(void)
 
     /* To allow for an assertion in push_call_stack() */
     lower_entry->cxt = 0;
+    lower_entry->spilled = False;
 
     CLG_(current_call_stack).sp--;
 
@@ -480,6 +480,8 @@ Bool CLG_(process_cmd_line_option)(const HChar* arg)
                             CLG_(clo).separate_callers, CONFIG_AUTO) {}
    else if VG_INT_CLO( arg, "--separate-callers", 
                             CLG_(clo).separate_callers) {}
+   else if VG_BINT_CLO(arg, "--max-contexts",
+                            CLG_(clo).max_contexts, 0, 100000000) {}
 
    else if VG_STREQN(10, arg, "--fn-group") {
        fn_config* fnc;
@@ -519,8 +521,13 @@ Bool CLG_(process_cmd_line_option)(const HChar* arg)
    else if VG_BOOL_CLO(arg, "--dump-line",  CLG_(clo).dump_line) {}
    else if VG_BOOL_CLO(arg, "--dump-instr", CLG_(clo).dump_instr) {}
    else if VG_BOOL_CLO(arg, "--dump-bb",    CLG_(clo).dump_bb) {}
+   else if VG_XACT_CLO(arg, "--dump-format=text",
+                       CLG_(clo).dump_binary, False) {}
+   else if VG_XACT_CLO(arg, "--dump-format=binary",
+                       CLG_(clo).dump_binary, True) {}
 
    else if VG_INT_CLO( arg, "--dump-every-bb", CLG_(clo).dump_every_bb) {}
+   else if VG_INT_CLO( arg, "--dump-every-ms", CLG_(clo).dump_every_ms) {}
 
    else if VG_BOOL_CLO(arg, "--collect-alloc",   CLG_(clo).collect_alloc) {}
    else if VG_XACT_CLO(arg, "--collect-systime=no",
@@ -570,6 +577,7 @@ void CLG_(print_usage)(void)
 "    --compress-strings=no|yes Compress strings in profile dump? [yes]\n"
 "    --compress-pos=no|yes     Compress positions in profile dump? [yes]\n"
 "    --combine-dumps=no|yes    Concat all dumps into same file [no]\n"
+"    --dump-format=text|binary Format of profile dumps [text]\n"
 #if CLG_EXPERIMENTAL
 "    --compress-events=no|yes  Compress events in profile dump? [no]\n"
 "    --dump-bb=no|yes          Dump basic block address of costs? [no]\n"
@@ -580,6 +588,7 @@ void CLG_(print_usage)(void)
 
 "\n   activity options (for interactivity use callgrind_control):\n"
 "    --dump-every-bb=<count>   Dump every <count> basic blocks [0=never]\n"
+"    --dump-every-ms=<msecs>   Dump every <msecs> milliseconds [0=never]\n"
 "    --dump-before=<func>      Dump when entering function\n"
 "    --zero-before=<func>      Zero all costs when entering function\n"
 "    --dump-after=<func>       Dump when leaving function\n"
@@ -608,6 +617,7 @@ void CLG_(print_usage)(void)
 "    --separate-callers<n>=<f> Separate <n> callers for function <f>\n"
 "    --separate-recs=<n>       Separate function recursions up to level [2]\n"
 "    --separate-recs<n>=<f>    Separate <n> recursions for function <f>\n"
+"    --max-contexts=<n>        Limit number of contexts with callers [0=unlimited]\n"
 "    --skip-plt=no|yes         Ignore calls to/from PLT sections? [yes]\n"
 "    --skip-direct-rec=no|yes  Ignore direct recursions? [yes]\n"
 "    --fn-skip=<function>      Ignore calls to/from function?\n"
@@ -658,8 +668,10 @@ void CLG_(set_clo_defaults)(void)
   CLG_(clo).dump_instr       = False;
   CLG_(clo).dump_bb          = False;
   CLG_(clo).dump_bbs         = False;
+  CLG_(clo).dump_binary      = False;
 
   CLG_(clo).dump_every_bb    = 0;
+  CLG_(clo).dump_every_ms    = 0;
 
   /* Collection */
   CLG_(clo).separate_threads = False;
@@ -672,6 +684,7 @@ void CLG_(set_clo_defaults)(void)
   CLG_(clo).skip_plt         = True;
   CLG_(clo).separate_callers = 0;
   CLG_(clo).separate_recursions = 2;
+  CLG_(clo).max_contexts = 0;
   CLG_(clo).skip_direct_recursion = False;
 
   /* Instrumentation */
@@ -161,21 +161,20 @@ static Bool is_cxt(UWord hash, fn_node** fn, Context* cxt)
 }
 
 /**
- * Allocate new Context structure
+ * Allocate new Context structure for up to <size> functions
  */
-static Context* new_cxt(fn_node** fn)
+static Context* new_cxt(fn_node** fn, int size)
 {
     Context* cxt;
     UInt idx, offset;
     UWord hash;
-    int size, recs;
+    int recs;
     fn_node* top_fn;
 
     CLG_ASSERT(fn);
     top_fn = *fn;
     if (top_fn == 0) return 0;
 
-    size = top_fn->separate_callers +1;
     recs = top_fn->separate_recursions;
     if (recs<1) recs=1;
 
@@ -206,6 +205,7 @@ static Context* new_cxt(fn_node** fn)
 
     CLG_(stat).context_counter += recs;
     CLG_(stat).distinct_contexts++;
+    if (size > 1) CLG_(stat).caller_contexts++;
 
     /* insert into Context hash table */
     idx = (UInt) (hash % cxts.size);
@@ -222,6 +222,47 @@ static Context* new_cxt(fn_node** fn)
     return cxt;
 }
 
+/* With --max-contexts, the last 1/8 of contexts with callers are only
+ * given to call chains which were looked up CXT_ADMIT_COUNT times while
+ * being in a small direct-mapped table of candidates. Colliding chains
+ * age out an entry, thus only chains hot in the recent past get them.
+ * All other chains are spilled into the context with one caller less.
+ */
+#define CXT_CANDIDATES  4096
+#define CXT_ADMIT_COUNT 8
+
+static struct {
+    UWord hash;
+    UInt  count;
+} cxt_candidates[CXT_CANDIDATES];
+
+/* was the context returned by last get_cxt() spilled? */
+static Bool cxt_spilled = False;
+
+static Bool admit_cxt(UWord hash)
+{
+    Int limit = CLG_(clo).max_contexts;
+    UInt idx;
+
+    if (limit == 0) return True;
+    if (CLG_(stat).caller_contexts >= limit) return False;
+    if (CLG_(stat).caller_contexts < limit - limit/8) return True;
+
+    idx = (UInt) (hash % CXT_CANDIDATES);
+    if (cxt_candidates[idx].hash == hash) {
+	if (++cxt_candidates[idx].count < CXT_ADMIT_COUNT) return False;
+	cxt_candidates[idx].count = 0;
+	return True;
+    }
+    if (cxt_candidates[idx].count > 0) {
+	cxt_candidates[idx].count--;
+	return False;
+    }
+    cxt_candidates[idx].hash = hash;
+    cxt_candidates[idx].count = 1;
+    return False;
+}
+
 /* get the Context structure for current context */
 Context* CLG_(get_cxt)(fn_node** fn)
 {
@@ -245,17 +286,29 @@ Context* CLG_(get_cxt)(fn_node** fn)
     }
 
     CLG_(stat).cxt_lru_misses++;
-
-    idx = (UInt) (hash % cxts.size);
-    cxt = cxts.table[idx];
-
-    while(cxt) {
-        if (is_cxt(hash,fn,cxt)) break;
-        cxt = cxt->next;
+    cxt_spilled = False;
+
+    while(1) {
+	idx = (UInt) (hash % cxts.size);
+	cxt = cxts.table[idx];
+
+	while(cxt) {
+	    if (is_cxt(hash,fn,cxt)) break;
+	    cxt = cxt->next;
+	}
+	if (cxt) break;
+
+	if ((size == 1) || (*(fn-1) == 0) || admit_cxt(hash)) {
+	    cxt = new_cxt(fn, size);
+	    break;
+	}
+
+	/* merge into the context with one caller less */
+	size--;
+	hash = cxt_hash_val(fn, size);
+	cxt_spilled = True;
     }
-
-    if (!cxt)
-        cxt = new_cxt(fn);
+    if (cxt_spilled) CLG_(stat).cxt_spills++;
 
     (*fn)->last_cxt = cxt;
 
@@ -284,6 +337,7 @@ void CLG_(push_cxt)(fn_node* fn)
   CLG_ASSERT(cs->entry[cs->sp].cxt == 0);
   cs->entry[cs->sp].cxt = CLG_(current_state).cxt;
   cs->entry[cs->sp].fn_sp = CLG_(current_fn_stack).top - CLG_(current_fn_stack).bottom;
+  cs->entry[cs->sp].spilled = False;
 
   if (fn && (*(CLG_(current_fn_stack).top) == fn)) return;
   if (fn && (fn->group>0) &&
@@ -319,7 +373,9 @@ void CLG_(push_cxt)(fn_node* fn)
 
   CLG_(current_fn_stack).top++;
   *(CLG_(current_fn_stack).top) = fn;
+  cxt_spilled = False;
   CLG_(current_state).cxt = CLG_(get_cxt)(CLG_(current_fn_stack).top);
+  cs->entry[cs->sp].spilled = cxt_spilled;
 
   CLG_DEBUG(5, "- push_cxt(fn '%s'): new cxt %d, fn_sp %ld\n",
 	    fn ? fn->name : "0x0",
@@ -110,6 +110,230 @@ void free_dump_array(void)
 }
 
 
+/*------------------------------------------------------------*/
+/*--- Binary dump format                                   ---*/
+/*------------------------------------------------------------*/
+
+/* With --dump-format=binary, a dump file starts with BIN_MAGIC and
+ * the format version, followed by a stream of records starting
+ * with a tag byte. Numbers are unsigned base-128 varints, most
+ * significant group first (Perl's "w" pack format).
+ *
+ * Lines without a binary encoding (header, "totals:", rare lines)
+ * go into TEXT records, terminated by a 0 byte. Names always use
+ * the string table: the name is only written with the first NAME
+ * record of an ID. Each part ends with an INDEX record giving the
+ * position of name definitions and function blocks of the part,
+ * and of the INDEX record of the previous part, as backward
+ * distance from the start of the INDEX record. It is followed by
+ * an END record holding the INDEX record size as 8 byte little
+ * endian, to allow a reader to locate the index from the end of
+ * the file.
+ *
+ * See docs/cl-format.xml; callgrind_bin2txt converts back to text.
+ */
+
+#define BIN_MAGIC    "CLGB"
+#define BIN_VERSION  1
+#define BIN_REC_SIZE 512
+
+enum {
+    BinRec_Text = 1,
+    BinRec_Name,
+    BinRec_Cost,
+    BinRec_Calls,
+    BinRec_Jump,
+    BinRec_Jcnd,
+    BinRec_Index,
+    BinRec_End
+};
+
+/* Tags of NAME records, the index into this array is written */
+static const HChar* bin_tags[] = {
+    "ob", "cob", "fl", "fi", "fe", "cfi", "jfi", "fn", "cfn", "jfn", "frfn"
+};
+#define BIN_TAGS (sizeof(bin_tags)/sizeof(bin_tags[0]))
+
+typedef struct {
+    UInt  tag, id;
+    ULong offset;
+} BinName;
+
+typedef struct {
+    ULong offset;
+    UInt  obj, file, fn;
+} BinFn;
+
+static XArray* bin_names = 0;  /* name definitions of the current part */
+static XArray* bin_fns = 0;    /* function blocks of the current part */
+static ULong   bin_offset = 0; /* bytes written, only used for distances */
+static ULong   bin_index = 0;  /* offset of the last INDEX record, or 0 */
+static Bool    bin_in_text = False;
+static UChar   bin_rec[BIN_REC_SIZE+1];
+static Int     bin_rec_len = 0;
+
+/* Write <len> bytes from <buf>, which needs space for one more byte.
+ * VG_(fprintf) can not write 0 bytes via "%s", so these use "%c". */
+static void bin_write(VgFile *fp, UChar* buf, Int len)
+{
+    Int i, start = 0;
+    UChar c;
+
+    for(i=0; i<=len; i++) {
+	if ((i < len) && (buf[i] != 0)) continue;
+	if (i > start) {
+	    c = buf[i];
+	    buf[i] = 0;
+	    VG_(fprintf)(fp, "%s", (HChar*)buf + start);
+	    buf[i] = c;
+	}
+	if (i < len)
+	    VG_(fprintf)(fp, "%c", 0);
+	start = i+1;
+    }
+    bin_offset += len;
+}
+
+static void bin_text_end(VgFile *fp)
+{
+    if (!bin_in_text) return;
+    VG_(fprintf)(fp, "%c", 0);
+    bin_offset++;
+    bin_in_text = False;
+}
+
+static void bin_varint(ULong v)
+{
+    Int shift = 0;
+
+    while((shift < 63) && (v >> (shift+7))) shift += 7;
+    CLG_ASSERT(bin_rec_len + shift/7 + 1 <= BIN_REC_SIZE);
+    for(; shift > 0; shift -= 7)
+	bin_rec[bin_rec_len++] = 0x80 | ((v >> shift) & 0x7f);
+    bin_rec[bin_rec_len++] = v & 0x7f;
+}
+
+/* Start a new record. Returns the file offset of the record */
+static ULong bin_rec_start(VgFile *fp, UChar tag)
+{
+    bin_text_end(fp);
+    bin_rec_len = 0;
+    bin_rec[bin_rec_len++] = tag;
+    return bin_offset;
+}
+
+static void bin_flush(VgFile *fp)
+{
+    bin_write(fp, bin_rec, bin_rec_len);
+    bin_rec_len = 0;
+}
+
+/* All output to dump files goes through here to allow for TEXT records */
+static UInt dump_fprintf(VgFile *fp, const HChar *format, ...)
+    PRINTF_CHECK(2, 3);
+
+static UInt dump_fprintf(VgFile *fp, const HChar *format, ...)
+{
+    UInt ret;
+    va_list vargs;
+
+    if (CLG_(clo).dump_binary && !bin_in_text) {
+	VG_(fprintf)(fp, "%c", BinRec_Text);
+	bin_offset++;
+	bin_in_text = True;
+    }
+    va_start(vargs, format);
+    ret = VG_(vfprintf)(fp, format, vargs);
+    va_end(vargs);
+    bin_offset += ret;
+
+    return ret;
+}
+
+static UInt bin_tag(const HChar* tag)
+{
+    UInt i, len;
+
+    for(i=0; i<BIN_TAGS; i++) {
+	len = VG_(strlen)(bin_tags[i]);
+	if ((VG_(strncmp)(tag, bin_tags[i], len) == 0) &&
+	    ((tag[len] == 0) || (tag[len] == '=')))
+	    return i;
+    }
+    CLG_ASSERT(0);
+    return 0;
+}
+
+/* Write a NAME record; <name> is 0 if the ID was already defined */
+static void bin_name(VgFile *fp, const HChar* tag, UInt id, const HChar* name)
+{
+    BinName n;
+
+    n.tag = bin_tag(tag);
+    n.id = id;
+    n.offset = bin_rec_start(fp, BinRec_Name);
+    bin_varint(n.tag);
+    bin_varint(id);
+    bin_varint(name ? VG_(strlen)(name) + 1 : 0);
+    bin_flush(fp);
+    if (!name) return;
+
+    bin_offset += VG_(fprintf)(fp, "%s", name);
+    VG_(addToXA)(bin_names, &n);
+}
+
+/* Position of <curr> relative to <last>, with absolute value <abs> */
+static void bin_pos(Bool relative, Int diff, ULong abs)
+{
+    if (relative) {
+	/* zigzag encoding, 0 is reserved for absolute values */
+	bin_varint( (ULong)(UInt)((diff << 1) ^ (diff >> 31)) + 1);
+	return;
+    }
+    bin_varint(0);
+    bin_varint(abs);
+}
+
+static void bin_write_index(VgFile *fp)
+{
+    ULong start;
+    Word i, n;
+    UChar size[9];
+
+    start = bin_rec_start(fp, BinRec_Index);
+    bin_varint(bin_index ? start - bin_index : 0);
+    bin_index = start;
+    n = VG_(sizeXA)(bin_names);
+    bin_varint(n);
+    bin_flush(fp);
+    for(i=0; i<n; i++) {
+	BinName* e = VG_(indexXA)(bin_names, i);
+	bin_varint(e->tag);
+	bin_varint(e->id);
+	bin_varint(start - e->offset);
+	bin_flush(fp);
+    }
+    n = VG_(sizeXA)(bin_fns);
+    bin_varint(n);
+    bin_flush(fp);
+    for(i=0; i<n; i++) {
+	BinFn* e = VG_(indexXA)(bin_fns, i);
+	bin_varint(start - e->offset);
+	bin_varint(e->obj);
+	bin_varint(e->file);
+	bin_varint(e->fn);
+	bin_flush(fp);
+    }
+
+    n = bin_offset - start;
+    bin_rec_start(fp, BinRec_End);
+    bin_flush(fp);
+    for(i=0; i<8; i++)
+	size[i] = (n >> (8*i)) & 0xff;
+    bin_write(fp, size, 8);
+}
+
+
 /* Initialize to an invalid position */
 static __inline__
 void init_fpos(FnPos* p)
@@ -124,23 +348,27 @@ void init_fpos(FnPos* p)
 
 static void print_obj(VgFile *fp, const HChar* prefix, obj_node* obj)
 {
-    if (CLG_(clo).compress_strings) {
+    if (CLG_(clo).dump_binary) {
+	bin_name(fp, prefix, obj->number,
+		 obj_dumped[obj->number] ? 0 : obj->name);
+    }
+    else if (CLG_(clo).compress_strings) {
 	CLG_ASSERT(obj_dumped != 0);
 	if (obj_dumped[obj->number])
-            VG_(fprintf)(fp, "%s(%u)\n", prefix, obj->number);
+            dump_fprintf(fp, "%s(%u)\n", prefix, obj->number);
 	else {
-            VG_(fprintf)(fp, "%s(%u) %s\n", prefix, obj->number, obj->name);
+            dump_fprintf(fp, "%s(%u) %s\n", prefix, obj->number, obj->name);
 	}
     }
     else
-        VG_(fprintf)(fp, "%s%s\n", prefix, obj->name);
+        dump_fprintf(fp, "%s%s\n", prefix, obj->name);
 
 #if 0
     /* add mapping parameters the first time a object is dumped
      * format: mp=0xSTART SIZE 0xOFFSET */
     if (!obj_dumped[obj->number]) {
 	obj_dumped[obj->number];
-	VG_(fprintf)(fp, "mp=%p %p %p\n",
+	dump_fprintf(fp, "mp=%p %p %p\n",
 		     pos->obj->start, pos->obj->size, pos->obj->offset);
     }
 #else
@@ -150,17 +378,22 @@ static void print_obj(VgFile *fp, const HChar* prefix, obj_node* obj)
 
 static void print_file(VgFile *fp, const char *prefix, const file_node* file)
 {
-    if (CLG_(clo).compress_strings) {
+    if (CLG_(clo).dump_binary) {
+	bin_name(fp, prefix, file->number,
+		 file_dumped[file->number] ? 0 : file->name);
+	file_dumped[file->number] = True;
+    }
+    else if (CLG_(clo).compress_strings) {
 	CLG_ASSERT(file_dumped != 0);
 	if (file_dumped[file->number])
-            VG_(fprintf)(fp, "%s(%u)\n", prefix, file->number);
+            dump_fprintf(fp, "%s(%u)\n", prefix, file->number);
 	else {
-            VG_(fprintf)(fp, "%s(%u) %s\n", prefix, file->number, file->name);
+            dump_fprintf(fp, "%s(%u) %s\n", prefix, file->number, file->name);
 	    file_dumped[file->number] = True;
 	}
     }
     else
-        VG_(fprintf)(fp, "%s%s\n", prefix, file->name);
+        dump_fprintf(fp, "%s%s\n", prefix, file->name);
 }
 
 /*
@@ -168,18 +401,24 @@ static void print_file(VgFile *fp, const char *prefix, const file_node* file)
  */
 static void print_fn(VgFile *fp, const HChar* tag, const fn_node* fn)
 {
-    VG_(fprintf)(fp, "%s=",tag);
+    if (CLG_(clo).dump_binary) {
+	bin_name(fp, tag, fn->number, fn_dumped[fn->number] ? 0 : fn->name);
+	fn_dumped[fn->number] = True;
+	return;
+    }
+
+    dump_fprintf(fp, "%s=",tag);
     if (CLG_(clo).compress_strings) {
 	CLG_ASSERT(fn_dumped != 0);
 	if (fn_dumped[fn->number])
-	    VG_(fprintf)(fp, "(%u)\n", fn->number);
+	    dump_fprintf(fp, "(%u)\n", fn->number);
 	else {
-	    VG_(fprintf)(fp, "(%u) %s\n", fn->number, fn->name);
+	    dump_fprintf(fp, "(%u) %s\n", fn->number, fn->name);
 	    fn_dumped[fn->number] = True;
 	}
     }
     else
-        VG_(fprintf)(fp, "%s\n", fn->name);
+        dump_fprintf(fp, "%s\n", fn->name);
 }
 
 static void print_mangled_fn(VgFile *fp, const HChar* tag, 
@@ -194,7 +433,7 @@ static void print_mangled_fn(VgFile *fp, const HChar* tag,
 
 	CLG_ASSERT(cxt_dumped != 0);
 	if (cxt_dumped[cxt->base_number+rec_index]) {
-            VG_(fprintf)(fp, "%s=(%u)\n",
+            dump_fprintf(fp, "%s=(%u)\n",
 			     tag, cxt->base_number + rec_index);
 	    return;
 	}
@@ -205,7 +444,7 @@ static void print_mangled_fn(VgFile *fp, const HChar* tag,
 	    CLG_ASSERT(cxt->fn[i-1]->pure_cxt != 0);
 	    n = cxt->fn[i-1]->pure_cxt->base_number;
 	    if (cxt_dumped[n]) continue;
-	    VG_(fprintf)(fp, "%s=(%d) %s\n",
+	    dump_fprintf(fp, "%s=(%d) %s\n",
 			     tag, n, cxt->fn[i-1]->name);
 
 	    cxt_dumped[n] = True;
@@ -214,41 +453,62 @@ static void print_mangled_fn(VgFile *fp, const HChar* tag,
 	/* If the last context was the context to print, we are finished */
 	if ((last == cxt) && (rec_index == 0)) return;
 
-	VG_(fprintf)(fp, "%s=(%u) (%u)", tag,
+	dump_fprintf(fp, "%s=(%u) (%u)", tag,
 			 cxt->base_number + rec_index,
 			 cxt->fn[0]->pure_cxt->base_number);
 	if (rec_index >0)
-	    VG_(fprintf)(fp, "'%d", rec_index +1);
+	    dump_fprintf(fp, "'%d", rec_index +1);
 	for(i=1;i<cxt->size;i++)
-	    VG_(fprintf)(fp, "'(%u)", 
+	    dump_fprintf(fp, "'(%u)", 
 			      cxt->fn[i]->pure_cxt->base_number);
-	VG_(fprintf)(fp, "\n");
+	dump_fprintf(fp, "\n");
 
 	cxt_dumped[cxt->base_number+rec_index] = True;
 	return;
     }
 
+    if (CLG_(clo).dump_binary) {
+	UInt id = cxt->base_number + rec_index;
+	XArray* xa;
+
+	if (cxt_dumped[id]) {
+	    bin_name(fp, tag, id, 0);
+	    return;
+	}
+	xa = VG_(newXA)(VG_(malloc), "cl.dump.pmf.1", VG_(free), sizeof(HChar));
+	VG_(xaprintf)(xa, "%s", cxt->fn[0]->name);
+	if (rec_index >0)
+	    VG_(xaprintf)(xa, "'%d", rec_index +1);
+	for(i=1;i<cxt->size;i++)
+	    VG_(xaprintf)(xa, "'%s", cxt->fn[i]->name);
+	VG_(xaprintf)(xa, "%c", '\0');
+	bin_name(fp, tag, id, VG_(indexXA)(xa, 0));
+	VG_(deleteXA)(xa);
+	cxt_dumped[id] = True;
+	return;
+    }
+
 
-    VG_(fprintf)(fp, "%s=", tag);
+    dump_fprintf(fp, "%s=", tag);
     if (CLG_(clo).compress_strings) {
 	CLG_ASSERT(cxt_dumped != 0);
 	if (cxt_dumped[cxt->base_number+rec_index]) {
-	    VG_(fprintf)(fp, "(%u)\n", cxt->base_number + rec_index);
+	    dump_fprintf(fp, "(%u)\n", cxt->base_number + rec_index);
 	    return;
 	}
 	else {
-	    VG_(fprintf)(fp, "(%u) ", cxt->base_number + rec_index);
+	    dump_fprintf(fp, "(%u) ", cxt->base_number + rec_index);
 	    cxt_dumped[cxt->base_number+rec_index] = True;
 	}
     }
 
-    VG_(fprintf)(fp, "%s", cxt->fn[0]->name);
+    dump_fprintf(fp, "%s", cxt->fn[0]->name);
     if (rec_index >0)
-	VG_(fprintf)(fp, "'%d", rec_index +1);
+	dump_fprintf(fp, "'%d", rec_index +1);
     for(i=1;i<cxt->size;i++)
-	VG_(fprintf)(fp, "'%s", cxt->fn[i]->name);
+	dump_fprintf(fp, "'%s", cxt->fn[i]->name);
 
-    VG_(fprintf)(fp, "\n");
+    dump_fprintf(fp, "\n");
 }
 
 
@@ -271,7 +531,7 @@ static Bool print_fn_pos(VgFile *fp, FnPos* last, BBCC* bbcc)
 
     if (!CLG_(clo).mangle_names) {
 	if (last->rec_index != bbcc->rec_index) {
-	    VG_(fprintf)(fp, "rec=%u\n\n", bbcc->rec_index);
+	    dump_fprintf(fp, "rec=%u\n\n", bbcc->rec_index);
 	    last->rec_index = bbcc->rec_index;
 	    last->cxt = 0; /* reprint context */
 	    res = True;
@@ -285,7 +545,7 @@ static Bool print_fn_pos(VgFile *fp, FnPos* last, BBCC* bbcc)
 	    if (curr_from == 0) {
 		if (last_from != 0) {
 		    /* switch back to no context */
-		    VG_(fprintf)(fp, "frfn=(spontaneous)\n");
+		    dump_fprintf(fp, "frfn=(spontaneous)\n");
 		    res = True;
 		}
 	    }
@@ -450,13 +710,36 @@ static void fprint_apos(VgFile *fp, AddrPos* curr, AddrPos* last,
 
     if (CLG_(clo).dump_bbs) {
 	if (curr->line != last->line) {
-	    VG_(fprintf)(fp, "ln=%u\n", curr->line);
+	    dump_fprintf(fp, "ln=%u\n", curr->line);
 	}
     }
 }
 
 
 
+/**
+ * Print one part of a position, relative to the last one if
+ * <relative> is set
+ */
+static void fprint_pos_part(VgFile *fp, Bool relative, int diff,
+			    ULong abs, Bool hex)
+{
+    if (CLG_(clo).dump_binary)
+	bin_pos(relative, diff, abs);
+    else if (relative) {
+	if (diff >0)
+	    dump_fprintf(fp, "+%d ", diff);
+	else if (diff==0)
+	    dump_fprintf(fp, "* ");
+	else
+	    dump_fprintf(fp, "%d ", diff);
+    }
+    else if (hex)
+	dump_fprintf(fp, "%#llx ", abs);
+    else
+	dump_fprintf(fp, "%llu ", abs);
+}
+
 /**
  * Print a position.
  * This prints out differences if allowed
@@ -467,52 +750,27 @@ static
 void fprint_pos(VgFile *fp, const AddrPos* curr, const AddrPos* last)
 {
     if (0) //CLG_(clo).dump_bbs)
-	VG_(fprintf)(fp, "%lu ", curr->addr - curr->bb_addr);
+	dump_fprintf(fp, "%lu ", curr->addr - curr->bb_addr);
     else {
 	if (CLG_(clo).dump_instr) {
 	    int diff = curr->addr - last->addr;
-	    if ( CLG_(clo).compress_pos && (last->addr >0) && 
-		 (diff > -100) && (diff < 100)) {
-		if (diff >0)
-		    VG_(fprintf)(fp, "+%d ", diff);
-		else if (diff==0)
-		    VG_(fprintf)(fp, "* ");
-	        else
-		    VG_(fprintf)(fp, "%d ", diff);
-	    }
-	    else
-		VG_(fprintf)(fp, "%#lx ", curr->addr);
+	    fprint_pos_part(fp, CLG_(clo).compress_pos && (last->addr >0) &&
+			    (diff > -100) && (diff < 100),
+			    diff, curr->addr, True);
 	}
 
 	if (CLG_(clo).dump_bb) {
 	    int diff = curr->bb_addr - last->bb_addr;
-	    if ( CLG_(clo).compress_pos && (last->bb_addr >0) && 
-		 (diff > -100) && (diff < 100)) {
-		if (diff >0)
-		    VG_(fprintf)(fp, "+%d ", diff);
-		else if (diff==0)
-		    VG_(fprintf)(fp, "* ");
-	        else
-		    VG_(fprintf)(fp, "%d ", diff);
-	    }
-	    else
-		VG_(fprintf)(fp, "%#lx ", curr->bb_addr);
+	    fprint_pos_part(fp, CLG_(clo).compress_pos && (last->bb_addr >0) &&
+			    (diff > -100) && (diff < 100),
+			    diff, curr->bb_addr, True);
 	}
 
 	if (CLG_(clo).dump_line) {
 	    int diff = curr->line - last->line;
-	    if ( CLG_(clo).compress_pos && (last->line >0) && 
-		 (diff > -100) && (diff < 100)) {
-
-		if (diff >0)
-		    VG_(fprintf)(fp, "+%d ", diff);
-		else if (diff==0)
-		    VG_(fprintf)(fp, "* ");
-	        else
-		    VG_(fprintf)(fp, "%d ", diff);
-	    }
-	    else
-		VG_(fprintf)(fp, "%u ", curr->line);
+	    fprint_pos_part(fp, CLG_(clo).compress_pos && (last->line >0) &&
+			    (diff > -100) && (diff < 100),
+			    diff, curr->line, False);
 	}
     }
 }
@@ -525,8 +783,21 @@ void fprint_pos(VgFile *fp, const AddrPos* curr, const AddrPos* last)
 static
 void fprint_cost(VgFile *fp, const EventMapping* es, const ULong* cost)
 {
+  if (CLG_(clo).dump_binary) {
+    /* same as CLG_(mappingcost_as_string): skip trailing zeros */
+    Int i, n = 1;
+
+    for(i=1; i<es->size; i++)
+      if (cost[es->entry[i].offset] != 0) n = i+1;
+    bin_varint(n);
+    for(i=0; i<n; i++)
+      bin_varint(cost[es->entry[i].offset]);
+    bin_flush(fp);
+    return;
+  }
+
   HChar *mcost = CLG_(mappingcost_as_string)(es, cost);
-  VG_(fprintf)(fp, "%s\n", mcost);
+  dump_fprintf(fp, "%s\n", mcost);
   CLG_FREE(mcost);
 }
 
@@ -545,6 +816,7 @@ static void fprint_fcost(VgFile *fp, AddrCost* c, AddrPos* last)
     CLG_(print_cost)(-5, CLG_(sets).full, c->cost);
   }
     
+  if (CLG_(clo).dump_binary) bin_rec_start(fp, BinRec_Cost);
   fprint_pos(fp, &(c->p), last);
   copy_apos( last, &(c->p) ); /* update last to current position */
 
@@ -609,21 +881,39 @@ static void fprint_jcc(VgFile *fp, jCC* jcc, AddrPos* curr, AddrPos* last,
 		print_fn(fp, "jfn", jcc->to->cxt->fn[0]);
 	}
 	    
+	if (CLG_(clo).dump_binary) {
+	    if (jcc->jmpkind == jk_CondJump) {
+		bin_rec_start(fp, BinRec_Jcnd);
+		bin_varint(jcc->call_counter);
+		bin_varint(ecounter);
+	    }
+	    else {
+		bin_rec_start(fp, BinRec_Jump);
+		bin_varint(jcc->call_counter);
+	    }
+	    fprint_pos(fp, &target, last);
+	    fprint_pos(fp, curr, last);
+	    bin_flush(fp);
+
+	    jcc->call_counter = 0;
+	    return;
+	}
+
 	if (jcc->jmpkind == jk_CondJump) {
 	    /* format: jcnd=<followed>/<executions> <target> */
-	    VG_(fprintf)(fp, "jcnd=%llu/%llu ",
+	    dump_fprintf(fp, "jcnd=%llu/%llu ",
 			 jcc->call_counter, ecounter);
 	}
 	else {
 	    /* format: jump=<jump count> <target> */
-	    VG_(fprintf)(fp, "jump=%llu ",
+	    dump_fprintf(fp, "jump=%llu ",
 			 jcc->call_counter);
 	}
 		
 	fprint_pos(fp, &target, last);
-	VG_(fprintf)(fp, "\n");
+	dump_fprintf(fp, "\n");
 	fprint_pos(fp, curr, last);
-	VG_(fprintf)(fp, "\n");
+	dump_fprintf(fp, "\n");
 
 	jcc->call_counter = 0;
 	return;
@@ -648,11 +938,18 @@ static void fprint_jcc(VgFile *fp, jCC* jcc, AddrPos* curr, AddrPos* last,
 	print_fn(fp, "cfn", jcc->to->cxt->fn[0]);
 
     if (!CLG_(is_zero_cost)( CLG_(sets).full, jcc->cost)) {
-        VG_(fprintf)(fp, "calls=%llu ", 
-		   jcc->call_counter);
-
-	fprint_pos(fp, &target, last);
-        VG_(fprintf)(fp, "\n");
+	if (CLG_(clo).dump_binary) {
+	    bin_rec_start(fp, BinRec_Calls);
+	    bin_varint(jcc->call_counter);
+	    fprint_pos(fp, &target, last);
+	    bin_flush(fp);
+	    bin_rec_start(fp, BinRec_Cost);
+	}
+	else {
+	    dump_fprintf(fp, "calls=%llu ", jcc->call_counter);
+	    fprint_pos(fp, &target, last);
+	    dump_fprintf(fp, "\n");
+	}
 	fprint_pos(fp, curr, last);
 	fprint_cost(fp, CLG_(dumpmap), jcc->cost);
 
@@ -792,7 +1089,7 @@ static Bool fprint_bbcc(VgFile *fp, BBCC* bbcc, AddrPos* last)
       CLG_(add_and_zero_cost)( CLG_(sets).full,
 			      currCost->cost, bbcc->skipped );
 #if 0
-      VG_(fprintf)(fp, "# Skipped\n");
+      dump_fprintf(fp, "# Skipped\n");
 #endif
       fprint_fcost(fp, currCost, last);
     }
@@ -814,7 +1111,7 @@ static Bool fprint_bbcc(VgFile *fp, BBCC* bbcc, AddrPos* last)
       fprint_apos(fp, &(currCost->p), last, bbcc->cxt->fn[0]->file);
       fprint_fcost(fp, currCost, last);
     }
-    if (CLG_(clo).dump_bbs) VG_(fprintf)(fp, "\n");
+    if (CLG_(clo).dump_bbs) dump_fprintf(fp, "\n");
     
     /* when every cost was immediately written, we must have done so,
      * as this function is only called when there's cost in a BBCC
@@ -1017,17 +1314,14 @@ static Int    prepare_count;
 static BBCC** prepare_ptr;
 
 
-static void hash_addCount(BBCC* bbcc)
+static void dirty_addCount(BBCC* bbcc)
 {
-  if ((bbcc->ecounter_sum > 0) || (bbcc->ret_counter>0))
-    prepare_count++;
+  CLG_ASSERT((bbcc->ecounter_sum > 0) || (bbcc->ret_counter>0));
+  prepare_count++;
 }
 
-static void hash_addPtr(BBCC* bbcc)
+static void dirty_addPtr(BBCC* bbcc)
 {
-  if ((bbcc->ecounter_sum == 0) &&
-      (bbcc->ret_counter == 0)) return;
-
   *prepare_ptr = bbcc;
   prepare_ptr++;
 }
@@ -1100,8 +1394,9 @@ BBCC** prepare_dump(void)
     prepare_count = 0;
     
     /* if we do not separate among threads, this gives all */
-    /* count number of BBCCs with >0 executions */
-    CLG_(forall_bbccs)(hash_addCount);
+    /* count number of BBCCs with >0 executions: these are exactly
+     * the dirty ones, so there is no need to walk the whole hash */
+    CLG_(forall_dirty_bbccs)(dirty_addCount);
 
     /* even if we do not separate among threads,
      * call stacks are separated */
@@ -1117,7 +1412,7 @@ BBCC** prepare_dump(void)
       (BBCC**) CLG_MALLOC("cl.dump.pd.1",
                           (prepare_count+1) * sizeof(BBCC*));    
 
-    CLG_(forall_bbccs)(hash_addPtr);
+    CLG_(forall_dirty_bbccs)(dirty_addPtr);
 
     if (CLG_(clo).separate_threads)
       cs_addPtr(0);
@@ -1146,7 +1441,7 @@ static void fprint_cost_ln(VgFile *fp, const HChar* prefix,
 			   const EventMapping* em, const ULong* cost)
 {
     HChar *mcost = CLG_(mappingcost_as_string)(em, cost);
-    VG_(fprintf)(fp, "%s%s\n", prefix, mcost);
+    dump_fprintf(fp, "%s%s\n", prefix, mcost);
     CLG_FREE(mcost);
 }
 
@@ -1214,57 +1509,68 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
     if (!appending)
 	reset_dump_array();
 
+    if (CLG_(clo).dump_binary) {
+	if (!appending) {
+	    VG_(fprintf)(fp, BIN_MAGIC "%c", BIN_VERSION);
+	    bin_offset = VG_(strlen)(BIN_MAGIC) + 1;
+	    bin_index = 0;
+	}
+	bin_names = VG_(newXA)(VG_(malloc), "cl.dump.nd.1",
+			       VG_(free), sizeof(BinName));
+	bin_fns = VG_(newXA)(VG_(malloc), "cl.dump.nd.2",
+			     VG_(free), sizeof(BinFn));
+    }
 
     if (!appending) {
 	/* callgrind format specification, has to be on 1st line */
-	VG_(fprintf)(fp, "# callgrind format\n");
+	dump_fprintf(fp, "# callgrind format\n");
 
 	/* version */
-	VG_(fprintf)(fp, "version: 1\n");
+	dump_fprintf(fp, "version: 1\n");
 
 	/* creator */
-	VG_(fprintf)(fp, "creator: callgrind-" VERSION "\n");
+	dump_fprintf(fp, "creator: callgrind-" VERSION "\n");
 
 	/* "pid:" line */
-	VG_(fprintf)(fp, "pid: %d\n", VG_(getpid)());
+	dump_fprintf(fp, "pid: %d\n", VG_(getpid)());
 
 	/* "cmd:" line */
-	VG_(fprintf)(fp, "cmd: %s", cmdbuf);
+	dump_fprintf(fp, "cmd: %s", cmdbuf);
     }
 
-    VG_(fprintf)(fp, "\npart: %d\n", out_counter);
+    dump_fprintf(fp, "\npart: %d\n", out_counter);
     if (CLG_(clo).separate_threads) {
-	VG_(fprintf)(fp, "thread: %d\n", tid);
+	dump_fprintf(fp, "thread: %d\n", tid);
     }
 
     /* "desc:" lines */
     if (!appending) {
-        VG_(fprintf)(fp, "\n");
+        dump_fprintf(fp, "\n");
 
 #if 0
 	/* Global options changing the tracing behaviour */
-	VG_(fprintf)(fp, "\ndesc: Option: --skip-plt=%s\n",
+	dump_fprintf(fp, "\ndesc: Option: --skip-plt=%s\n",
 		     CLG_(clo).skip_plt ? "yes" : "no");
-	VG_(fprintf)(fp, "desc: Option: --collect-jumps=%s\n",
+	dump_fprintf(fp, "desc: Option: --collect-jumps=%s\n",
 		     CLG_(clo).collect_jumps ? "yes" : "no");
-	VG_(fprintf)(fp, "desc: Option: --separate-recs=%d\n",
+	dump_fprintf(fp, "desc: Option: --separate-recs=%d\n",
 		     CLG_(clo).separate_recursions);
-	VG_(fprintf)(fp, "desc: Option: --separate-callers=%d\n",
+	dump_fprintf(fp, "desc: Option: --separate-callers=%d\n",
 		     CLG_(clo).separate_callers);
 
-	VG_(fprintf)(fp, "desc: Option: --dump-bbs=%s\n",
+	dump_fprintf(fp, "desc: Option: --dump-bbs=%s\n",
 		     CLG_(clo).dump_bbs ? "yes" : "no");
-	VG_(fprintf)(fp, "desc: Option: --separate-threads=%s\n",
+	dump_fprintf(fp, "desc: Option: --separate-threads=%s\n",
 		     CLG_(clo).separate_threads ? "yes" : "no");
 #endif
 
 	(*CLG_(cachesim).dump_desc)(fp);
     }
 
-    VG_(fprintf)(fp, "\ndesc: Timerange: Basic block %llu - %llu\n",
+    dump_fprintf(fp, "\ndesc: Timerange: Basic block %llu - %llu\n",
 		 bbs_done, CLG_(stat).bb_executions);
 
-    VG_(fprintf)(fp, "desc: Trigger: %s\n",
+    dump_fprintf(fp, "desc: Trigger: %s\n",
 		 trigger ? trigger : "Program termination");
 
 #if 0
@@ -1274,22 +1580,22 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
        fnc = fnc_table[i];
        while (fnc) {
 	   if (fnc->skip) {
-	       VG_(fprintf)(fp, "desc: Option: --fn-skip=%s\n", fnc->name);
+	       dump_fprintf(fp, "desc: Option: --fn-skip=%s\n", fnc->name);
 	   }
 	   if (fnc->dump_at_enter) {
-	       VG_(fprintf)(fp, "desc: Option: --fn-dump-at-enter=%s\n",
+	       dump_fprintf(fp, "desc: Option: --fn-dump-at-enter=%s\n",
 			    fnc->name);
 	   }   
 	   if (fnc->dump_at_leave) {
-	       VG_(fprintf)(fp, "desc: Option: --fn-dump-at-leave=%s\n",
+	       dump_fprintf(fp, "desc: Option: --fn-dump-at-leave=%s\n",
 			    fnc->name);
 	   }
 	   if (fnc->separate_callers != CLG_(clo).separate_callers) {
-	       VG_(fprintf)(fp, "desc: Option: --separate-callers%d=%s\n",
+	       dump_fprintf(fp, "desc: Option: --separate-callers%d=%s\n",
 			    fnc->separate_callers, fnc->name);
 	   }   
 	   if (fnc->separate_recursions != CLG_(clo).separate_recursions) {
-	       VG_(fprintf)(fp, "desc: Option: --separate-recs%d=%s\n",
+	       dump_fprintf(fp, "desc: Option: --separate-recs%d=%s\n",
 			    fnc->separate_recursions, fnc->name);
 	   }   
 	   fnc = fnc->next;
@@ -1298,7 +1604,7 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
 #endif
 
    /* "positions:" line */
-   VG_(fprintf)(fp, "\npositions:%s%s%s\n",
+   dump_fprintf(fp, "\npositions:%s%s%s\n",
 		CLG_(clo).dump_instr ? " instr" : "",
 		CLG_(clo).dump_bb    ? " bb" : "",
 		CLG_(clo).dump_line  ? " line" : "");
@@ -1307,14 +1613,14 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
    switch (CLG_(clo).collect_systime) {
      case systime_no: break;
      case systime_msec:
-        VG_(fprintf)(fp, "event: sysTime : sysTime (elapsed ms)\n");
+        dump_fprintf(fp, "event: sysTime : sysTime (elapsed ms)\n");
         break;
      case systime_usec:
-        VG_(fprintf)(fp, "event: sysTime : sysTime (elapsed us)\n");
+        dump_fprintf(fp, "event: sysTime : sysTime (elapsed us)\n");
         break;
      case systime_nsec:
-        VG_(fprintf)(fp, "event: sysTime : sysTime (elapsed ns)\n");
-        VG_(fprintf)(fp, "event: sysCpuTime : sysCpuTime (system cpu ns)\n");
+        dump_fprintf(fp, "event: sysTime : sysTime (elapsed ns)\n");
+        dump_fprintf(fp, "event: sysCpuTime : sysCpuTime (system cpu ns)\n");
         break;
      default:
         tl_assert(0);
@@ -1325,7 +1631,7 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
       of the PartData.  In other words, this line is before the first line
       of the PartData body. */
    HChar *evmap = CLG_(eventmapping_as_string)(CLG_(dumpmap));
-   VG_(fprintf)(fp, "events: %s\n", evmap);
+   dump_fprintf(fp, "events: %s\n", evmap);
    VG_(free)(evmap);
 
    /* summary lines */
@@ -1355,7 +1661,7 @@ static VgFile *new_dumpfile(int tid, const HChar* trigger)
    /* all dumped cost will be added to total_fcc */
    CLG_(init_cost_lz)( CLG_(sets).full, &dump_total_cost );
 
-   VG_(fprintf)(fp, "\n\n");
+   dump_fprintf(fp, "\n\n");
 
    if (VG_(clo_verbosity) > 1)
        VG_(message)(Vg_DebugMsg, "Dump to %s\n", filename);
@@ -1371,6 +1677,13 @@ static void close_dumpfile(VgFile *fp)
     fprint_cost_ln(fp, "totals: ", CLG_(dumpmap),
 		   dump_total_cost);
     //fprint_fcc_ln(fp, "summary: ", &dump_total_fcc);
+    if (CLG_(clo).dump_binary) {
+	bin_write_index(fp);
+	VG_(deleteXA)(bin_names);
+	VG_(deleteXA)(bin_fns);
+	bin_names = 0;
+	bin_fns = 0;
+    }
     CLG_(add_cost_lz)(CLG_(sets).full, 
 		     &CLG_(total_cost), dump_total_cost);
 
@@ -1395,6 +1708,7 @@ static void print_bbccs_of_thread(thread_info* ti)
   BBCC **p, **array;
   FnPos lastFnPos;
   AddrPos lastAPos;
+  ULong fn_offset;
 
   CLG_DEBUG(1, "+ print_bbccs(tid %u)\n", CLG_(current_tid));
 
@@ -1425,13 +1739,29 @@ static void print_bbccs_of_thread(thread_info* ti)
 	/* switch back to file of function */
 	print_file(print_fp, "fe=", lastFnPos.cxt->fn[0]->file);
       }
-      VG_(fprintf)(print_fp, "\n");
+      dump_fprintf(print_fp, "\n");
     }
     
     if (*p == 0) break;
     
+    /* function blocks start with a new record in binary dumps */
+    bin_text_end(print_fp);
+    fn_offset = bin_offset;
+
     if (print_fn_pos(print_fp, &lastFnPos, *p)) {
       
+      if (CLG_(clo).dump_binary) {
+	BinFn fn;
+
+	fn.offset = fn_offset;
+	fn.obj    = (*p)->cxt->fn[0]->file->obj->number;
+	fn.file   = (*p)->cxt->fn[0]->file->number;
+	fn.fn     = CLG_(clo).mangle_names ?
+		    (*p)->cxt->base_number + (*p)->rec_index :
+		    (*p)->cxt->fn[0]->number;
+	VG_(addToXA)(bin_fns, &fn);
+      }
+
       /* new function */
       init_apos(&lastAPos, 0, 0, (*p)->cxt->fn[0]->file);
       init_fcost(&ccSum[0], 0, 0, 0);
@@ -1443,14 +1773,14 @@ static void print_bbccs_of_thread(thread_info* ti)
 	/* FIXME: Specify Object of BB if different to object of fn */
         int i;
 	ULong ecounter = (*p)->ecounter_sum;
-        VG_(fprintf)(print_fp, "bb=%#lx ", (UWord)(*p)->bb->offset);
+        dump_fprintf(print_fp, "bb=%#lx ", (UWord)(*p)->bb->offset);
 	for(i = 0; i<(*p)->bb->cjmp_count;i++) {
-	    VG_(fprintf)(print_fp, "%u %llu ", 
+	    dump_fprintf(print_fp, "%u %llu ", 
 				(*p)->bb->jmp[i].instr,
 				ecounter);
 	    ecounter -= (*p)->jmp[i].ecounter;
 	}
-	VG_(fprintf)(print_fp, "%u %llu\n", 
+	dump_fprintf(print_fp, "%u %llu\n", 
 		     (*p)->bb->instr_count,
 		     ecounter);
     }
@@ -1462,6 +1792,9 @@ static void print_bbccs_of_thread(thread_info* ti)
 
   close_dumpfile(print_fp);
   VG_(free)(array);
+
+  /* fprint_bbcc() has reset the counters of all dumped BBCCs */
+  CLG_(clear_dirty_bbccs)();
   
   /* set counters of last dump */
   CLG_(copy_cost)( CLG_(sets).full, ti->lastdump_cost,
@@ -93,14 +93,17 @@ struct _CommandLineOptions {
   Bool dump_instr;
   Bool dump_bb;
   Bool dump_bbs;         /* Dump basic block information? */
+  Bool dump_binary;      /* Write dumps in binary format? */
   
   /* Dump generation options */
   ULong dump_every_bb;     /* Dump every xxx BBs. */
+  UInt  dump_every_ms;     /* Dump every xxx milliseconds. */
   
   /* Collection options */
   Bool separate_threads; /* Separate threads in dump? */
   Int  separate_callers; /* Separate dependent on how many callers? */
   Int  separate_recursions; /* Max level of recursions to separate */
+  Int  max_contexts;     /* Max contexts with callers, 0 for no limit */
   Bool skip_plt;         /* Skip functions in PLT section? */
   Bool skip_direct_recursion; /* Increment direct recursions the level? */
 
@@ -154,6 +157,7 @@ struct _Statistics {
   Int  distinct_files;
   Int  distinct_fns;
   Int  distinct_contexts;
+  Int  caller_contexts;
   Int  distinct_bbs;
   Int  distinct_jccs;
   Int  distinct_bbccs;
@@ -175,6 +179,8 @@ struct _Statistics {
   Int  bbcc_lru_misses;
   Int  jcc_lru_misses;
   Int  cxt_lru_misses;
+  ULong cxt_spills;
+  ULong spilled_calls;
   Int  bbcc_clones;
 };
 
@@ -384,6 +390,7 @@ struct _BBCC {
 			    * jmp_addr. Allocated lazy */
     
     BBCC*    next;         /* entry chain in hash */
+    BBCC*    next_dirty;   /* chain of BBCCs with counters > 0, see below */
     ULong*   cost;         /* start of 64bit costs for this BBCC */
     ULong    ecounter_sum; /* execution counter for first instruction of BB */
     JmpData  jmp[0];
@@ -468,6 +475,7 @@ struct _call_entry {
     BBCC* nonskipped;   /* see above */
     Context* cxt;       /* context before call */
     Int fn_sp;          /* function stack index before call */
+    Bool spilled;       /* context of call merged due to --max-contexts */
 };
 
 
@@ -525,6 +533,7 @@ typedef struct _bbcc_hash bbcc_hash;
 struct _bbcc_hash {
   UInt size, entries;
   BBCC** table;
+  BBCC* dirty; /* BBCCs with ecounter_sum or ret_counter > 0 */
 };
 
 typedef struct _jcc_hash jcc_hash;
@@ -544,6 +553,7 @@ typedef struct _call_stack call_stack;
 struct _call_stack {
   UInt size;
   Int sp;
+  Int spilled; /* number of entries with spilled contexts */
   call_entry* entry;
 };
 
@@ -729,6 +739,9 @@ void CLG_(copy_current_bbcc_hash)(bbcc_hash* dst);
 bbcc_hash* CLG_(get_current_bbcc_hash)(void);
 void CLG_(set_current_bbcc_hash)(bbcc_hash*);
 void CLG_(forall_bbccs)(void (*func)(BBCC*));
+void CLG_(forall_dirty_bbccs)(void (*func)(BBCC*));
+void CLG_(clear_dirty_bbccs)(void);
+void CLG_(mark_bbcc_dirty)(BBCC* bbcc);
 void CLG_(zero_bbcc)(BBCC* bbcc);
 BBCC* CLG_(get_bbcc)(BB* bb);
 BBCC* CLG_(clone_bbcc)(BBCC* orig, Context* cxt, Int rec_index);
@@ -797,6 +810,7 @@ extern fn_stack   CLG_(current_fn_stack);
 extern exec_state CLG_(current_state);
 extern ThreadId   CLG_(current_tid);
 extern FullCost   CLG_(total_cost);
+extern FullCost   CLG_(spilled_cost);
 extern struct cachesim_if CLG_(cachesim);
 extern struct event_sets  CLG_(sets);
 
@@ -76,6 +76,7 @@ static void CLG_(init_statistics)(Statistics* s)
   s->distinct_files      = 0;
   s->distinct_fns        = 0;
   s->distinct_contexts   = 0;
+  s->caller_contexts     = 0;
   s->distinct_bbs        = 0;
   s->distinct_bbccs      = 0;
   s->distinct_instrs     = 0;
@@ -96,6 +97,8 @@ static void CLG_(init_statistics)(Statistics* s)
   s->bbcc_lru_misses     = 0;
   s->jcc_lru_misses      = 0;
   s->cxt_lru_misses      = 0;
+  s->cxt_spills          = 0;
+  s->spilled_calls       = 0;
   s->bbcc_clones         = 0;
 }
 
@@ -1403,7 +1406,8 @@ static void zero_thread_cost(thread_info* t)
     CLG_(current_call_stack).entry[i].jcc->call_counter = 0;
   }
 
-  CLG_(forall_bbccs)(CLG_(zero_bbcc));
+  CLG_(forall_dirty_bbccs)(CLG_(zero_bbcc));
+  CLG_(clear_dirty_bbccs)();
 
   /* set counter for last dump */
   CLG_(copy_cost)( CLG_(sets).full, 
@@ -1876,6 +1880,8 @@ void clg_print_stats(void)
 		CLG_(stat).distinct_fns);
    VG_(message)(Vg_DebugMsg, "Distinct contexts:%d\n",
 		CLG_(stat).distinct_contexts);
+   VG_(message)(Vg_DebugMsg, "  with callers:   %d\n",
+		CLG_(stat).caller_contexts);
    VG_(message)(Vg_DebugMsg, "Distinct BBs:     %d\n",
 		CLG_(stat).distinct_bbs);
    VG_(message)(Vg_DebugMsg, "Cost entries:     %u (Chunks %u)\n",
@@ -1911,6 +1917,12 @@ void clg_print_stats(void)
 
    VG_(message)(Vg_DebugMsg, "LRU Contxt Misses: %d\n",
 		CLG_(stat).cxt_lru_misses);
+   if (CLG_(clo).max_contexts > 0) {
+      VG_(message)(Vg_DebugMsg, "Contxt Spills:     %llu\n",
+		   CLG_(stat).cxt_spills);
+      VG_(message)(Vg_DebugMsg, "Spilled Calls:     %llu\n",
+		   CLG_(stat).spilled_calls);
+   }
    VG_(message)(Vg_DebugMsg, "LRU BBCC Misses:   %d\n",
 		CLG_(stat).bbcc_lru_misses);
    VG_(message)(Vg_DebugMsg, "LRU JCC Misses:    %d\n",
@@ -1961,6 +1973,13 @@ void finish(void)
   HChar *mcost = CLG_(mappingcost_as_string)(CLG_(dumpmap), CLG_(total_cost));
   VG_(message)(Vg_UserMsg, "Collected : %s\n", mcost);
   VG_(free)(mcost);
+  if (CLG_(clo).max_contexts > 0 && CLG_(stat).spilled_calls > 0) {
+    /* cost of calls whose call chain was merged due to --max-contexts */
+    mcost = CLG_(mappingcost_as_string)(CLG_(dumpmap), CLG_(spilled_cost));
+    VG_(message)(Vg_UserMsg, "Spilled   : %s (%llu calls)\n",
+                 mcost, CLG_(stat).spilled_calls);
+    VG_(free)(mcost);
+  }
   VG_(message)(Vg_UserMsg, "\n");
 
   /* determine value widths for statistics */
@@ -2087,6 +2106,7 @@ void CLG_(post_clo_init)(void)
    CLG_(init_eventsets)();
    CLG_(init_statistics)(& CLG_(stat));
    CLG_(init_cost_lz)( CLG_(sets).full, &CLG_(total_cost) );
+   CLG_(init_cost_lz)( CLG_(sets).full, &CLG_(spilled_cost) );
 
    /* initialize hash tables */
    CLG_(init_obj_table)();
@@ -0,0 +1,52 @@
+// Calls a leaf function along 32 different call chains: each of 8 top
+// functions calls each of 4 middle ones, which call the leaf.  All
+// chains are run once, then one of them many times, so that with
+// --max-contexts the hot chain is admitted after the others filled
+// the free contexts.
+
+static volatile int sink;
+
+__attribute__((noinline)) static void leaf(int n)
+{
+   int i;
+
+   for (i = 0; i < n; i++)
+      sink += i;
+}
+
+#define MID(m) \
+   __attribute__((noinline)) static void mid##m(int n) { leaf(n + m); }
+MID(0) MID(1) MID(2) MID(3)
+
+#define TOP(t) \
+   __attribute__((noinline)) static void top##t(int m) \
+   { \
+      switch (m) { \
+         case 0: mid0(t); break; \
+         case 1: mid1(t); break; \
+         case 2: mid2(t); break; \
+         default: mid3(t); break; \
+      } \
+   }
+TOP(0) TOP(1) TOP(2) TOP(3) TOP(4) TOP(5) TOP(6) TOP(7)
+
+static void (* const tops[8])(int) = {
+   top0, top1, top2, top3, top4, top5, top6, top7
+};
+
+__attribute__((noinline)) static void work(void)
+{
+   int t, m, i;
+
+   for (t = 0; t < 8; t++)
+      for (m = 0; m < 4; m++)
+         tops[t](m);
+   for (i = 0; i < 100; i++)
+      top7(3);
+}
+
+int main(void)
+{
+   work();
+   return 0;
+}
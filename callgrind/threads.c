@@ -180,6 +180,7 @@ void CLG_(run_thread)(ThreadId tid)
 {
     /* check for dumps needed */
     static ULong bbs_done = 0;
+    static UInt ms_done = 0;
     HChar buf[50];   // large enough
 
     if (CLG_(clo).dump_every_bb >0) {
@@ -190,6 +191,15 @@ void CLG_(run_thread)(ThreadId tid)
        }
     }
 
+    if (CLG_(clo).dump_every_ms >0) {
+       UInt now = VG_(read_millisecond_timer)();
+       if (now - ms_done >= CLG_(clo).dump_every_ms) {
+           VG_(sprintf)(buf, "--dump-every-ms=%u", CLG_(clo).dump_every_ms);
+	   CLG_(dump_profile)(buf, False);
+           ms_done = now;
+       }
+    }
+
     /* now check for thread switch */
     CLG_(switch_thread)(tid);
 }
@@ -991,6 +991,23 @@ UInt VG_(random)( /*MOD*/UInt* pSeed )
    return *pSeed;
 }
 
+UInt VG_(sample_slot) ( Addr base, UInt n_slots )
+{
+   vg_assert(n_slots > 0 && (n_slots & (n_slots - 1)) == 0);
+   return ((base >> 2) ^ (base >> 14)) & (n_slots - 1);
+}
+
+void VG_(select_sample_slots) ( /*OUT*/UChar* slots, UInt n_slots,
+                                ULong epoch, UInt percent )
+{
+   UInt i;
+   for (i = 0; i < n_slots; i++) {
+      UInt h = (i ^ (UInt)(epoch * 0x9E3779B9ULL)) * 0x85EBCA6B;
+      h ^= h >> 13;
+      slots[i] = (h % 100) < percent;
+   }
+}
+
 
 /* The following Adler-32 checksum code is taken from zlib-1.2.3, which
    has the following copyright notice. */
@@ -1021,7 +1021,7 @@ Bool VG_(machine_get_hwcaps)( void )
    }
 
 #elif defined(VGA_amd64)
-   { Bool have_sse3, have_ssse3, have_cx8, have_cx16;
+   { Bool have_sse3, have_ssse3, have_sse41, have_cx8, have_cx16;
      Bool have_lzcnt, have_avx, have_bmi, have_avx2;
      Bool have_fma3, have_fma4;
      Bool have_rdtscp, have_rdrand, have_f16c, have_rdseed;
@@ -1030,7 +1030,7 @@ Bool VG_(machine_get_hwcaps)( void )
      HChar vstr[13];
      vstr[0] = 0;
 
-     have_sse3 = have_ssse3 = have_cx8 = have_cx16
+     have_sse3 = have_ssse3 = have_sse41 = have_cx8 = have_cx16
                = have_lzcnt = have_avx = have_bmi = have_avx2
                = have_rdtscp = have_rdrand = have_f16c = have_rdseed
                = have_fma3 = have_fma4 = False;
@@ -1064,7 +1064,7 @@ Bool VG_(machine_get_hwcaps)( void )
      have_sse3  = (ecx & (1<<0)) != 0;  /* True => have sse3 insns */
      have_ssse3 = (ecx & (1<<9)) != 0;  /* True => have Sup SSE3 insns */
      have_fma3  = (ecx & (1<<12))!= 0;  /* True => have fma3 insns */
-     // sse41   is ecx:19
+     have_sse41 = (ecx & (1<<19)) != 0; /* True => have SSE4.1 insns */
      // sse42   is ecx:20
      // xsave   is ecx:26
      // osxsave is ecx:27
@@ -1155,6 +1155,7 @@ Bool VG_(machine_get_hwcaps)( void )
      vai.endness = VexEndnessLE;
      vai.hwcaps  = (have_sse3   ? VEX_HWCAPS_AMD64_SSE3   : 0)
                  | (have_ssse3  ? VEX_HWCAPS_AMD64_SSSE3  : 0)
+                 | (have_sse41  ? VEX_HWCAPS_AMD64_SSE41  : 0)
                  | (have_cx16   ? VEX_HWCAPS_AMD64_CX16   : 0)
                  | (have_lzcnt  ? VEX_HWCAPS_AMD64_LZCNT  : 0)
                  | (have_avx    ? VEX_HWCAPS_AMD64_AVX    : 0)
@@ -230,6 +230,8 @@ static void usage_NORETURN ( int need_help )
 "           more sectors may increase performance, but use more memory.\n"
 "    --avg-transtab-entry-size=<number> avg size in bytes of a translated\n"
 "           basic block [0, meaning use tool provided default]\n"
+"    --transtab-generations=no|yes keep translations that are still in\n"
+"           use when recycling the oldest sector of the code cache? [no]\n"
 "    --aspace-minaddr=0xPP     avoid mapping memory below 0xPP [guessed]\n"
 "    --valgrind-stacksize=<number> size of valgrind (host) thread's stack\n"
 "                               (in bytes) ["
@@ -296,7 +298,8 @@ static void usage_NORETURN ( int need_help )
 "    --vex-iropt-unroll-thresh=<0..400>     [120]\n"
 "    --vex-iropt-fold-expr=no|yes           [yes]\n"
 "    --vex-guest-max-insns=<1..100>         [50]\n"
-"    --vex-guest-chase=no|yes               [yes]\n"
+"    --vex-guest-chase=no|yes|profile       [yes]\n"
+"    --vex-remove-dead-cc=no|yes            [no]\n"
 "    Precise exception control.  Possible values for 'mode' are as follows\n"
 "      and specify the minimum set of registers guaranteed to be correct\n"
 "      immediately prior to memory access instructions:\n"
@@ -321,7 +324,9 @@ static void usage_NORETURN ( int need_help )
 "         0000 0000   show summary profile only\n"
 "        (Nb: you need --trace-notbelow and/or --trace-notabove\n"
 "             with --trace-flags for full details)\n"
-"    --vex-regalloc-version=2|3             [3]\n"
+"    --vex-regalloc-version=2|3|4           [3]\n"
+"    --vex-hot-cold-split=no|yes            [no]\n"
+"    --vex-indir-cache=no|yes               [no]\n"
 "\n"
 "  debugging options for Valgrind tools that report errors\n"
 "    --dump-error=<number>     show translation for basic block associated\n"
@@ -729,6 +734,8 @@ static void process_option (Clo_Mode mode,
    else if VG_BINT_CLO(arg, "--avg-transtab-entry-size",
                        VG_(clo_avg_transtab_entry_size),
                        50, 5000) {}
+   else if VG_BOOL_CLO(arg, "--transtab-generations",
+                       VG_(clo_transtab_generations)) {}
    else if VG_BINT_CLOM(cloPD, arg, "--merge-recursive-frames",
                         VG_(clo_merge_recursive_frames), 0,
                         VG_DEEPEST_BACKTRACE) {}
@@ -761,7 +768,13 @@ static void process_option (Clo_Mode mode,
    else if VG_BINT_CLO(arg, "--vex-iropt-level",
                        VG_(clo_vex_control).iropt_level, 0, 2) {}
    else if VG_BINT_CLO(arg, "--vex-regalloc-version",
-                       VG_(clo_vex_control).regalloc_version, 2, 3) {}
+                       VG_(clo_vex_control).regalloc_version, 2, 4) {}
+   else if VG_BOOL_CLO(arg, "--vex-remove-dead-cc",
+                       VG_(clo_vex_control).guest_remove_dead_cc) {}
+   else if VG_BOOL_CLO(arg, "--vex-hot-cold-split",
+                       VG_(clo_vex_control).hot_cold_split) {}
+   else if VG_BOOL_CLO(arg, "--vex-indir-cache",
+                       VG_(clo_vex_indir_cache)) {}
    else if VG_BOOL_CLOM(cloPD, arg, "--vex-iropt-fold-expr",
                         VG_(clo_vex_control).iropt_fold_expr) {}
 
@@ -790,8 +803,14 @@ static void process_option (Clo_Mode mode,
                        VG_(clo_vex_control).iropt_unroll_thresh, 0, 400) {}
    else if VG_BINT_CLO(arg, "--vex-guest-max-insns",
                        VG_(clo_vex_control).guest_max_insns, 1, 100) {}
+   else if VG_XACT_CLO(arg, "--vex-guest-chase=profile",
+                       VG_(clo_vex_guest_chase_profile), True) {
+      VG_(clo_vex_control).guest_chase = True;
+   }
    else if VG_BOOL_CLO(arg, "--vex-guest-chase",
-                       VG_(clo_vex_control).guest_chase) {}
+                       VG_(clo_vex_control).guest_chase) {
+      VG_(clo_vex_guest_chase_profile) = False;
+   }
 
    else if VG_INT_CLO(arg, "--log-fd", pos->tmp_log_fd) {
       pos->log_to = VgLogTo_Fd;
@@ -1087,6 +1106,13 @@ void main_process_cmd_line_options( void )
       VG_(fmsg_bad_option)("--exit-on-first-error=yes",
          "You must define a non nul exit error code, with --error-exitcode=...\n");
    }
+   /* gdbserver looks at the guest state between superblocks, where the
+      condition code can then be stale. */
+   if (VG_(clo_vex_control).guest_remove_dead_cc
+       && VG_(clo_vgdb) != Vg_VgdbNo) {
+      VG_(fmsg_bad_option)("--vex-remove-dead-cc=yes",
+                           "It can't be used with gdbserver; use --vgdb=no.\n");
+   }
 
 #  if !defined(VGO_darwin)
    if (VG_(clo_resync_filter) != 0) {
@@ -138,6 +138,8 @@ UChar  VG_(clo_trace_flags)    = 0; // 00000000b
 Bool   VG_(clo_profyle_sbs)    = False;
 UChar  VG_(clo_profyle_flags)  = 0; // 00000000b
 ULong  VG_(clo_profyle_interval) = 0;
+Bool   VG_(clo_vex_guest_chase_profile) = False;
+Bool   VG_(clo_vex_indir_cache) = False;
 Int    VG_(clo_trace_notbelow) = -1;  // unspecified
 Int    VG_(clo_trace_notabove) = -1;  // unspecified
 Bool   VG_(clo_trace_syscalls) = False;
@@ -296,6 +296,7 @@ const HChar* name_of_sched_event ( UInt event )
       case VG_TRC_INVARIANT_FAILED:    return "INVFAILED";
       case VG_TRC_CHAIN_ME_TO_SLOW_EP: return "CHAIN_ME_SLOW";
       case VG_TRC_CHAIN_ME_TO_FAST_EP: return "CHAIN_ME_FAST";
+      case VG_TRC_XINDIR_MISS:         return "XINDIR_MISS";
       default:                         return "??UNKNOWN??";
   }
 }
@@ -925,8 +926,9 @@ void VG_(force_vgdb_poll) ( void )
    translation.
 
    Return results are placed in two_words.  two_words[0] is set to the
-   TRC.  In the case where that is VG_TRC_CHAIN_ME_TO_{SLOW,FAST}_EP,
-   the address to patch is placed in two_words[1].
+   TRC.  In the case where that is VG_TRC_CHAIN_ME_TO_{SLOW,FAST}_EP
+   or VG_TRC_XINDIR_MISS, the address to patch is placed in
+   two_words[1].
 */
 static
 void run_thread_for_a_while ( /*OUT*/HWord* two_words,
@@ -1118,7 +1120,8 @@ void run_thread_for_a_while ( /*OUT*/HWord* two_words,
       VG_(run_innerloop). */
    /* Stay sane .. */
    if (two_words[0] == VG_TRC_CHAIN_ME_TO_SLOW_EP
-       || two_words[0] == VG_TRC_CHAIN_ME_TO_FAST_EP) {
+       || two_words[0] == VG_TRC_CHAIN_ME_TO_FAST_EP
+       || two_words[0] == VG_TRC_XINDIR_MISS) {
       vg_assert(two_words[1] != 0); /* we have a legit patch addr */
    } else {
       vg_assert(two_words[1] == 0); /* nobody messed with it */
@@ -1168,12 +1171,18 @@ void handle_chain_me ( ThreadId tid, void* place_to_chain, Bool toFastEP )
    found = VG_(search_transtab)( NULL, &to_sNo, &to_tteNo,
                                  ip, False/*dont_upd_fast_cache*/ );
    if (!found) {
-      /* Not found; we need to request a translation. */
+      /* Not found; we need to request a translation.  If making it
+         recycles a sector, the block containing place_to_chain may
+         have been dumped or moved, and something else put where it
+         was, so the patch point can no longer be trusted. */
+      ULong n_recycled = VG_(get_sectors_recycled)();
       if (VG_(translate)( tid, ip, /*debug*/False, 0/*not verbose*/, 
                           bbs_done, True/*allow redirection*/ )) {
          found = VG_(search_transtab)( NULL, &to_sNo, &to_tteNo,
                                        ip, False ); 
          vg_assert2(found, "handle_chain_me: missing tt_fast entry");
+         if (VG_(get_sectors_recycled)() != n_recycled)
+            return;
       } else {
 	 // If VG_(translate)() fails, it's because it had to throw a
 	 // signal because the client jumped to a bad address.  That
@@ -1194,6 +1203,40 @@ void handle_chain_me ( ThreadId tid, void* place_to_chain, Bool toFastEP )
                            to_sNo, to_tteNo, toFastEP );
 }
 
+/* An indirect jump's inline cache missed and has room for another
+   entry.  As for handle_chain_me, find or make the translation for
+   the destination and fill the entry in. */
+static
+void handle_xindir_miss ( ThreadId tid, void* place_to_patch )
+{
+   Bool found          = False;
+   Addr ip             = VG_(get_IP)(tid);
+   SECno to_sNo         = INV_SNO;
+   TTEno to_tteNo       = INV_TTE;
+
+   found = VG_(search_transtab)( NULL, &to_sNo, &to_tteNo,
+                                 ip, True/*upd_fast_cache*/ );
+   if (!found) {
+      ULong n_recycled = VG_(get_sectors_recycled)();
+      if (VG_(translate)( tid, ip, /*debug*/False, 0/*not verbose*/, 
+                          bbs_done, True/*allow redirection*/ )) {
+         found = VG_(search_transtab)( NULL, &to_sNo, &to_tteNo,
+                                       ip, True ); 
+         vg_assert2(found, "handle_xindir_miss: missing tt_fast entry");
+         if (VG_(get_sectors_recycled)() != n_recycled)
+            return;
+      } else {
+         // As for handle_chain_me.
+         return;
+      }
+   }
+   vg_assert(found);
+   vg_assert(to_sNo != INV_SNO);
+   vg_assert(to_tteNo != INV_TTE);
+
+   VG_(tt_tc_do_xindir_caching)( place_to_patch, to_sNo, to_tteNo );
+}
+
 static void handle_syscall(ThreadId tid, UInt trc)
 {
    ThreadState * volatile tst = VG_(get_ThreadState)(tid);
@@ -1541,7 +1584,8 @@ VgSchedReturnCode VG_(scheduler) ( ThreadId tid )
             request, since chaining in the no-redir cache is too
             complex. */
          vg_assert(trc[0] != VG_TRC_CHAIN_ME_TO_SLOW_EP
-                   && trc[0] != VG_TRC_CHAIN_ME_TO_FAST_EP);
+                   && trc[0] != VG_TRC_CHAIN_ME_TO_FAST_EP
+                   && trc[0] != VG_TRC_XINDIR_MISS);
       }
 
       switch (trc[0]) {
@@ -1569,6 +1613,12 @@ VgSchedReturnCode VG_(scheduler) ( ThreadId tid )
          break;
       }
 
+      case VG_TRC_XINDIR_MISS: {
+         if (0) VG_(printf)("sched: XINDIR_MISS: %p\n", (void*)trc[1] );
+         handle_xindir_miss(tid, (void*)trc[1]);
+         break;
+      }
+
       case VEX_TRC_JMP_CLIENTREQ:
 	 do_client_request(tid);
 	 break;
@@ -38,6 +38,8 @@
 #include "pub_core_libcassert.h"
 #include "pub_core_libcprint.h"
 #include "pub_core_options.h"
+#include "pub_core_hashtable.h"  // for the chase profiles
+#include "pub_core_mallocfree.h" // VG_(malloc)
 
 #include "pub_core_debuginfo.h"  // VG_(get_fnname_w_offset)
 #include "pub_core_redir.h"      // VG_(redir_do_lookup)
@@ -69,6 +71,21 @@ static ULong n_TRACE_total_guest_insns              = 0;
 static ULong n_TRACE_total_uncond_branches_followed = 0;
 static ULong n_TRACE_total_cond_branches_followed   = 0;
 
+static ULong n_RA_total_spills  = 0;
+static ULong n_RA_total_reloads = 0;
+static ULong n_RA_total_remats  = 0;
+static ULong n_RA_total_moves   = 0;
+static UInt  n_RA_max_spills_reloads = 0;
+
+static ULong n_LAYOUT_total_bytes = 0;
+static ULong n_LAYOUT_split_bytes = 0;
+static ULong n_LAYOUT_hot_bytes   = 0;
+
+static ULong n_CHASE_profiled   = 0;
+static ULong n_CHASE_hot        = 0;
+static ULong n_CHASE_not_hot    = 0;
+static ULong n_CHASE_freed      = 0;
+
 static ULong n_SP_updates_new_fast            = 0;
 static ULong n_SP_updates_new_generic_known   = 0;
 static ULong n_SP_updates_die_fast            = 0;
@@ -121,6 +138,37 @@ void VG_(print_translation_stats) ( void )
        "  AllRegs %'llu,  AllRegsAllInsns %'llu\n",
        n_PX_VexRegUpdSpAtMemAccess, n_PX_VexRegUpdUnwindregsAtMemAccess,
        n_PX_VexRegUpdAllregsAtMemAccess, n_PX_VexRegUpdAllregsAtEachInsn);
+
+   VG_(message)
+      (Vg_DebugMsg,
+       "translate: regalloc: %'llu spills, %'llu reloads, %'llu remats, "
+       "%'llu moves\n",
+       n_RA_total_spills, n_RA_total_reloads, n_RA_total_remats,
+       n_RA_total_moves);
+   VG_(message)
+      (Vg_DebugMsg,
+       "translate: regalloc: %.1f spills+reloads per trace (max %'u)\n",
+       n_TRACE_total_constructed == 0 ? 0.0
+          : (n_RA_total_spills + n_RA_total_reloads) * 1.0
+            / n_TRACE_total_constructed,
+       n_RA_max_spills_reloads);
+
+   if (n_LAYOUT_split_bytes > 0) {
+      VG_(message)
+         (Vg_DebugMsg,
+          "translate: layout: %'llu code bytes, %'llu in split traces, "
+          "of which %'llu hot (%3.1f%%)\n",
+          n_LAYOUT_total_bytes, n_LAYOUT_split_bytes, n_LAYOUT_hot_bytes,
+          n_LAYOUT_hot_bytes * 100.0 / n_LAYOUT_split_bytes);
+   }
+
+   if (VG_(clo_vex_guest_chase_profile)) {
+      VG_(message)
+         (Vg_DebugMsg,
+          "translate: chase profile: %'llu branches profiled, "
+          "%'llu dominated, %'llu not, %'llu profiles freed\n",
+          n_CHASE_profiled, n_CHASE_hot, n_CHASE_not_hot, n_CHASE_freed);
+   }
 }
 
 /*------------------------------------------------------------*/
@@ -1005,6 +1053,263 @@ static Bool chase_into_ok ( void* closureV, Addr addr )
 }
 
 
+/* --------------- profile-guided chasing --------------- */
+
+/* With --vex-guest-chase=profile, a translation which ends in a
+   conditional branch that Vex could chase into is first made with a
+   call to chase_profile_helper just before the branch, which counts
+   how often each destination is taken.  After CHASE_PROFILE_EXECS
+   executions the helper decides whether one destination dominates, and
+   makes the translation exit with VEX_TRC_JMP_INVALICACHE, so that it
+   is discarded.  When the code is translated again, chase_cond_hint
+   tells Vex to chase into the dominant destination.  The new
+   translation may end in another such branch, which is profiled in
+   the same way, up to CHASE_PROFILE_MAX_DECISIONS times per start
+   address.  There is at most one profile per translated start address,
+   and it is freed when the translation is thrown away, other than by
+   the discard which makes the profiled translation be redone. */
+
+#define CHASE_PROFILE_EXECS          1000
+#define CHASE_PROFILE_MAX_DECISIONS  2
+
+typedef
+   struct _ChaseProfile {
+      struct _ChaseProfile* next;
+      UWord  key;        /* guest address the translation starts at */
+      /* The branch currently being profiled, if profiling. */
+      Bool   profiling;
+      Addr   sx;         /* side exit destination */
+      Addr   ft;         /* fall through destination */
+      ULong  n_execs;
+      ULong  n_sx;       /* how many of n_execs took the side exit */
+      /* The decisions made so far.  hot is the dominant destination, or
+         zero if there was none. */
+      UInt   n_decisions;
+      struct { Addr sx; Addr ft; Addr hot; }
+             decisions[CHASE_PROFILE_MAX_DECISIONS];
+      /* Set when the helper has asked for the translation to be
+         discarded, so as to keep the profile over that discard. */
+      Bool   retranslate;
+   }
+   ChaseProfile;
+
+static VgHashTable* chase_profiles = NULL;
+
+/* Is profile-guided chasing being done for this translation?  Set by
+   VG_(translate). */
+static Bool chase_profile_this_translation = False;
+
+/* Called from generated code.  Returns nonzero when the profile of
+   the branch is complete, in which case the translation must be
+   discarded. */
+static UWord chase_profile_helper ( ChaseProfile* cp, UWord taken )
+{
+   if (!cp->profiling) {
+      cp->retranslate = True;
+      return 1;
+   }
+   cp->n_execs++;
+   cp->n_sx += taken;
+   if (cp->n_execs < CHASE_PROFILE_EXECS)
+      return 0;
+
+   /* A destination dominates if it is taken at least 7 times in 8. */
+   Addr hot = 0;
+   if (cp->n_sx * 8 >= cp->n_execs * 7)
+      hot = cp->sx;
+   else if ((cp->n_execs - cp->n_sx) * 8 >= cp->n_execs * 7)
+      hot = cp->ft;
+   if (hot != 0)
+      n_CHASE_hot++;
+   else
+      n_CHASE_not_hot++;
+
+   vg_assert(cp->n_decisions < CHASE_PROFILE_MAX_DECISIONS);
+   cp->decisions[cp->n_decisions].sx  = cp->sx;
+   cp->decisions[cp->n_decisions].ft  = cp->ft;
+   cp->decisions[cp->n_decisions].hot = hot;
+   cp->n_decisions++;
+   cp->profiling   = False;
+   cp->retranslate = True;
+   if (0) VG_(printf)("chase profile 0x%lx: sx 0x%lx %llu/%llu -> 0x%lx\n",
+                      cp->key, cp->sx, cp->n_sx, cp->n_execs, hot);
+   return 1;
+}
+
+/* The translation starting at guest address orig_addr is being thrown
+   away.  Free its profile, unless the profile asked for that. */
+void VG_(discard_chase_profile) ( Addr orig_addr )
+{
+   if (chase_profiles == NULL)
+      return;
+   ChaseProfile* cp = VG_(HT_lookup)(chase_profiles, (UWord)orig_addr);
+   if (cp == NULL)
+      return;
+   if (cp->retranslate) {
+      cp->retranslate = False;
+      return;
+   }
+   VG_(HT_remove)(chase_profiles, (UWord)orig_addr);
+   VG_(free)(cp);
+   n_CHASE_freed++;
+}
+
+/* This is a callback passed to LibVEX_Translate.  It returns the
+   destination of the branch to chase into, if profiling found one. */
+static Addr chase_cond_hint ( void* closureV, Addr sx, Addr ft )
+{
+   VgCallbackClosure* closure = (VgCallbackClosure*)closureV;
+   const ChaseProfile* cp
+      = VG_(HT_lookup)(chase_profiles, (UWord)closure->readdr);
+   if (cp == NULL)
+      return 0;
+   for (UInt i = 0; i < cp->n_decisions; i++) {
+      if (cp->decisions[i].sx == sx && cp->decisions[i].ft == ft)
+         return cp->decisions[i].hot;
+   }
+   return 0;
+}
+
+static Addr irconst_to_Addr ( const IRConst* con )
+{
+   switch (con->tag) {
+      case Ico_U32: return (Addr)con->Ico.U32;
+      case Ico_U64: return (Addr)con->Ico.U64;
+      default:      vg_assert(0);
+   }
+}
+
+/* If sb_in ends in a conditional branch that has not been profiled yet,
+   add the profiling code described above. */
+static
+IRSB* chase_profile_pass ( IRSB* sb_in, const VexGuestExtents* vge,
+                           IRType gWordTy )
+{
+   Int i, ix;
+
+   if (sb_in->jumpkind != Ijk_Boring || sb_in->next->tag != Iex_Const)
+      return sb_in;
+   /* Find the branch.  The tool may have added code after it, such as
+      checks on the block's final destination, but there must be no
+      other instruction after it. */
+   for (ix = sb_in->stmts_used - 1; ix >= 0; ix--) {
+      IRStmtTag tag = sb_in->stmts[ix]->tag;
+      if (tag == Ist_Exit || tag == Ist_IMark)
+         break;
+   }
+   if (ix < 0)
+      return sb_in;
+   IRStmt* exit = sb_in->stmts[ix];
+   if (exit->tag != Ist_Exit || exit->Ist.Exit.jk != Ijk_Boring
+       || exit->Ist.Exit.guard->tag != Iex_RdTmp)
+      return sb_in;
+
+   /* Vex cannot extend the trace any further, or would not chase into
+      the destinations anyway. */
+   Addr sx = irconst_to_Addr(exit->Ist.Exit.dst);
+   Addr ft = irconst_to_Addr(sb_in->next->Iex.Const.con);
+   if (vge->n_used >= sizeof(vge->base) / sizeof(vge->base[0])
+       || sx == ft
+       || !chase_into_ok(NULL, sx) || !chase_into_ok(NULL, ft))
+      return sb_in;
+
+   ChaseProfile* cp = VG_(HT_lookup)(chase_profiles, (UWord)vge->base[0]);
+   if (cp == NULL) {
+      cp = VG_(malloc)("translate.chase_profile_pass.1", sizeof(*cp));
+      VG_(memset)(cp, 0, sizeof(*cp));
+      cp->key = (UWord)vge->base[0];
+      VG_(HT_add_node)(chase_profiles, cp);
+   }
+   if (cp->n_decisions == CHASE_PROFILE_MAX_DECISIONS)
+      return sb_in;
+   for (UInt d = 0; d < cp->n_decisions; d++) {
+      if (cp->decisions[d].sx == sx && cp->decisions[d].ft == ft)
+         return sb_in;
+   }
+   if (!cp->profiling || cp->sx != sx || cp->ft != ft) {
+      cp->profiling = True;
+      cp->sx        = sx;
+      cp->ft        = ft;
+      cp->n_execs   = 0;
+      cp->n_sx      = 0;
+   }
+   n_CHASE_profiled++;
+
+   /* Copy the statements, adding the profiling code just before the
+      branch. */
+   IRSB*    sb    = deepCopyIRSBExceptStmts(sb_in);
+   IRExpr*  guard = exit->Ist.Exit.guard;
+   Bool     is64  = gWordTy == Ity_I64;
+   IRTemp   taken = newIRTemp(sb->tyenv, gWordTy);
+   IRTemp   done  = newIRTemp(sb->tyenv, gWordTy);
+   IRTemp   toSX  = newIRTemp(sb->tyenv, gWordTy);
+   IRTemp   exSX  = newIRTemp(sb->tyenv, Ity_I1);
+   IRTemp   exFT  = newIRTemp(sb->tyenv, Ity_I1);
+   IRExpr*  zero  = IRExpr_Const(is64 ? IRConst_U64(0) : IRConst_U32(0));
+   IRDirty* di;
+
+   for (i = 0; i < ix; i++)
+      addStmtToIRSB(sb, sb_in->stmts[i]);
+   addStmtToIRSB(sb, IRStmt_WrTmp(taken, IRExpr_Unop(is64 ? Iop_1Uto64
+                                                           : Iop_1Uto32,
+                                                     guard)));
+   di = unsafeIRDirty_1_N(done, 0/*regparms*/, "chase_profile_helper",
+                          VG_(fnptr_to_fnentry)(&chase_profile_helper),
+                          mkIRExprVec_2(mkIRExpr_HWord((HWord)cp),
+                                        IRExpr_RdTmp(taken)));
+   addStmtToIRSB(sb, IRStmt_Dirty(di));
+
+   /* Exit via VEX_TRC_JMP_INVALICACHE, to the same destination, when
+      the profile is complete. */
+   addStmtToIRSB(sb, IRStmt_Put(offsetof(VexGuestArchState, guest_CMSTART),
+                                mkIRExpr_HWord(vge->base[0])));
+   addStmtToIRSB(sb, IRStmt_Put(offsetof(VexGuestArchState, guest_CMLEN),
+                                mkIRExpr_HWord(1)));
+   addStmtToIRSB(sb, IRStmt_WrTmp(toSX, IRExpr_Binop(is64 ? Iop_And64
+                                                          : Iop_And32,
+                                                     IRExpr_RdTmp(done),
+                                                     IRExpr_RdTmp(taken))));
+   addStmtToIRSB(sb, IRStmt_WrTmp(exSX, IRExpr_Binop(is64 ? Iop_CmpNE64
+                                                          : Iop_CmpNE32,
+                                                     IRExpr_RdTmp(toSX),
+                                                     zero)));
+   addStmtToIRSB(sb, IRStmt_Exit(IRExpr_RdTmp(exSX), Ijk_InvalICache,
+                                 deepCopyIRConst(exit->Ist.Exit.dst),
+                                 exit->Ist.Exit.offsIP));
+   for (i = ix; i < sb_in->stmts_used; i++)
+      addStmtToIRSB(sb, sb_in->stmts[i]);
+
+   /* The fall-through exit goes last, so that the statements the tool
+      added after the branch are run as they would be without it.  Only
+      the fall-through path gets here. */
+   addStmtToIRSB(sb, IRStmt_WrTmp(exFT, IRExpr_Binop(is64 ? Iop_CmpNE64
+                                                          : Iop_CmpNE32,
+                                                     IRExpr_RdTmp(done),
+                                                     deepCopyIRExpr(zero))));
+   addStmtToIRSB(sb, IRStmt_Exit(IRExpr_RdTmp(exFT), Ijk_InvalICache,
+                                 deepCopyIRConst(sb->next->Iex.Const.con),
+                                 sb->offsIP));
+   return sb;
+}
+
+/* Vex's second instrumentation pass when chase profiling: the SP
+   update pass, if needed, followed by the profiling pass. */
+static
+IRSB* vg_SP_update_then_chase_profile_pass ( void*             closureV,
+                                             IRSB*             sb_in,
+                                             const VexGuestLayout*  layout,
+                                             const VexGuestExtents* vge,
+                                             const VexArchInfo*     vai,
+                                             IRType            gWordTy,
+                                             IRType            hWordTy )
+{
+   IRSB* sb = sb_in;
+   if (need_to_handle_SP_assignment())
+      sb = vg_SP_update_pass(closureV, sb, layout, vge, vai, gWordTy, hWordTy);
+   return chase_profile_pass(sb, vge, gWordTy);
+}
+
+
 /* --------------- helpers for with-TOC platforms --------------- */
 
 /* NOTE: with-TOC platforms are: ppc64-linux. */
@@ -1754,6 +2059,15 @@ Bool VG_(translate) ( ThreadId tid,
    vex_abiinfo.guest__use_fallback_LLSC = True;
 #  endif
 
+   /* Profile conditional branches, so as to chase into the dominant
+      destination later?  Not for redirected translations, as their
+      start address is not that of the translation. */
+   chase_profile_this_translation
+      = VG_(clo_vex_guest_chase_profile) && VG_(clo_vex_control).guest_chase
+        && kind == T_Normal;
+   if (chase_profile_this_translation && chase_profiles == NULL)
+      chase_profiles = VG_(HT_construct)("translate.chase_profiles");
+
    /* Set up closure args. */
    closure.tid    = tid;
    closure.nraddr = nraddr;
@@ -1769,6 +2083,8 @@ Bool VG_(translate) ( ThreadId tid,
    vta.guest_bytes      = (UChar*)addr;
    vta.guest_bytes_addr = addr;
    vta.chase_into_ok    = chase_into_ok;
+   vta.chase_cond_hint  = chase_profile_this_translation
+                             ? chase_cond_hint : NULL;
    vta.guest_extents    = &vge;
    vta.host_bytes       = tmpbuf;
    vta.host_bytes_size  = N_TMPBUF;
@@ -1791,7 +2107,9 @@ Bool VG_(translate) ( ThreadId tid,
      vta.instrument1     = g;
    }
    /* No need for type kludgery here. */
-   vta.instrument2       = need_to_handle_SP_assignment()
+   vta.instrument2       = chase_profile_this_translation
+                              ? vg_SP_update_then_chase_profile_pass
+                              : need_to_handle_SP_assignment()
                               ? vg_SP_update_pass
                               : NULL;
    vta.finaltidy         = VG_(needs).final_IR_tidy_pass
@@ -1822,10 +2140,18 @@ Bool VG_(translate) ( ThreadId tid,
          = VG_(fnptr_to_fnentry)( &VG_(disp_cp_chain_me_to_fastEP) );
       vta.disp_cp_xindir
          = VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir) );
+#     if defined(VGA_amd64)
+      vta.disp_cp_xindir_miss
+         = VG_(clo_vex_indir_cache)
+              ? VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir_miss) ) : NULL;
+#     else
+      vta.disp_cp_xindir_miss        = NULL;
+#     endif
    } else {
       vta.disp_cp_chain_me_to_slowEP = NULL;
       vta.disp_cp_chain_me_to_fastEP = NULL;
       vta.disp_cp_xindir             = NULL;
+      vta.disp_cp_xindir_miss        = NULL;
    }
    /* This doesn't involve chaining and so is always allowable. */
    vta.disp_cp_xassisted
@@ -1843,6 +2169,17 @@ Bool VG_(translate) ( ThreadId tid,
    n_TRACE_total_guest_insns += tres.n_guest_instrs;
    n_TRACE_total_uncond_branches_followed += tres.n_uncond_in_trace;
    n_TRACE_total_cond_branches_followed   += tres.n_cond_in_trace;
+   n_RA_total_spills  += tres.n_spills;
+   n_RA_total_reloads += tres.n_reloads;
+   n_RA_total_remats  += tres.n_remats;
+   n_RA_total_moves   += tres.n_moves;
+   if (tres.n_spills + tres.n_reloads > n_RA_max_spills_reloads)
+      n_RA_max_spills_reloads = tres.n_spills + tres.n_reloads;
+   n_LAYOUT_total_bytes += tmpbuf_used;
+   if (tres.n_hot_bytes > 0) {
+      n_LAYOUT_split_bytes += tmpbuf_used;
+      n_LAYOUT_hot_bytes   += tres.n_hot_bytes;
+   }
    } /* END new scope specially for 'seg' */
 
    /* Tell aspacem of all segments that have had translations taken
@@ -38,6 +38,7 @@
 #include "pub_core_options.h"
 #include "pub_core_tooliface.h"  // For VG_(details).avg_translation_sizeB
 #include "pub_core_transtab.h"
+#include "pub_core_translate.h"  // VG_(discard_chase_profile)
 #include "pub_core_aspacemgr.h"
 #include "pub_core_mallocfree.h" // VG_(out_of_memory_NORETURN)
 #include "pub_core_xarray.h"
@@ -61,6 +62,10 @@ static SECno n_sectors = 0;
    provided default. */
 UInt VG_(clo_avg_transtab_entry_size) = 0;
 
+/* Keep re-entered translations in a tenured sector when recycling
+   the oldest sector? */
+Bool VG_(clo_transtab_generations) = False;
+
 /*------------------ CONSTANTS ------------------*/
 /* Number of entries in hash table of each sector.  This needs to be a prime
    number to work properly, it must be <= 65535 (so that a TTE index
@@ -107,9 +112,10 @@ typedef
    struct {
       SECno from_sNo;   /* sector number */
       TTEno from_tteNo; /* TTE number in given sector */
-      UInt  from_offs: (sizeof(UInt)*8)-1;  /* code offset from TCEntry::tcptr
+      UInt  from_offs: (sizeof(UInt)*8)-2;  /* code offset from TCEntry::tcptr
                                                where the patch is */
       Bool  to_fastEP:1; /* Is the patch to a fast or slow entry point? */
+      Bool  is_xindir:1; /* Is the patch an indir inline cache entry? */
    }
    InEdge;
 
@@ -174,6 +180,12 @@ typedef
                are profiling. */
             ULong    count;
             UShort   weight;
+            /* Not only for profiling: the number of times the
+               translation has been found by the scheduler, or had a
+               jump chained to it, since it was made or last moved
+               between sectors.  Saturates at 0xFFFF.  Used to decide
+               which translations to keep when a sector is recycled. */
+            UShort   reentries;
          } prof; // if status == InUse
          TTEno next_empty_tte; // if status != InUse
       } usage;
@@ -251,7 +263,10 @@ typedef
          assigned to the PC in the VEX state. Control is returned
          to the scheduler. N will be translated. This can erase the
          translation E (in case of sector full). VG_(tt_tc_do_chaining)
-         will not do the chaining to a non found translation E.
+         will not do the chaining to a non found translation E, and
+         the scheduler does not ask for it at all if a sector was
+         recycled meanwhile, since another translation may by then be
+         where E was.
          The execution will continue at the current guest PC
          (i.e. the translation N).
          => it is safe to erase the current translation being executed.
@@ -391,6 +406,10 @@ typedef
          its load limit (SECTOR_TT_LIMIT_PERCENT). */
       ULong* tc;
 
+      /* The number of ULongs in tc.  Fixed when the sector is first
+         allocated. */
+      Int tc_szQ;
+
       /* An hash table, mapping guest address to an index in the tt array.
          htt is a fixed size, always containing
          exactly N_HTTES_PER_SECTOR entries. */
@@ -439,13 +458,40 @@ typedef
    When running, youngest sector should be between >= 0 and <
    N_TC_SECTORS.  The initial  value indicates the TT/TC system is
    not yet initialised. 
+
+   Throwing away the whole of the oldest sector also throws away the
+   translations in it that are still in use, which then have to be
+   made again straight away.  So when VG_(clo_transtab_generations)
+   is True, the last sector is kept out of the round robin as a
+   "tenured" sector.  When the oldest sector is recycled, the
+   translations in it which have been re-entered since they were made
+   are moved into the tenured sector rather than being thrown away.
+   When the tenured sector is full, it is itself emptied, keeping only
+   those translations which have been re-entered since they were moved
+   there.
 */
 static Sector sectors[MAX_N_SECTORS];
 static Int    youngest_sector = INV_SNO;
+static SECno  tenured_sector  = INV_SNO;
 
-/* The number of ULongs in each TCEntry area.  This is computed once
-   at startup and does not change. */
+/* The number of ULongs in a TCEntry area, computed once at startup
+   from the expected average translation size.  Sectors allocated
+   after some translations have been made are instead sized from the
+   average seen so far (see new_sector_szQ), within a budget of
+   tc_budgetQ ULongs for all the TCEntry areas together. */
 static Int    tc_sector_szQ = 0;
+static Long   tc_budgetQ    = 0;
+static Long   tc_allocQ     = 0;
+
+/* A translation needs to have been re-entered this many times before
+   it is moved to the tenured sector. */
+#define TT_PROMOTE_REENTRIES 2
+
+/* Entry addresses of recently dumped translations, so as to notice
+   when they are made again.  Direct mapped; a miss only means that a
+   retranslation is not counted. */
+#define N_DUMPED_FILTER 8192
+static Addr dumped_filter[N_DUMPED_FILTER];
 
 
 /* A list of sector numbers, in the order which they should be
@@ -513,10 +559,24 @@ static ULong n_dump_count = 0;
 static ULong n_dump_osize = 0;
 static ULong n_sectors_recycled = 0;
 
+/* Number of translations made again after being dumped. */
+static ULong n_retrans_count = 0;
+
+/* Number/tsize of translations moved to the tenured sector, and the
+   number kept there when it was emptied. */
+static ULong n_promote_count = 0;
+static ULong n_promote_tsize = 0;
+static ULong n_tenured_kept  = 0;
+static ULong n_tenured_collections = 0;
+
 /* Number/osize of translations discarded due to requests to do so. */
 static ULong n_disc_count = 0;
 static ULong n_disc_osize = 0;
 
+/* Number of indir inline cache entries filled in and emptied again. */
+static ULong n_xindir_fills   = 0;
+static ULong n_xindir_empties = 0;
+
 
 /*-------------------------------------------------------------*/
 /*--- Misc                                                  ---*/
@@ -560,12 +620,20 @@ static inline TTEntryH* index_tteH ( SECno sNo, TTEno tteNo )
    return tteH;
 }
 
+/* Note that a translation has been entered again. */
+static inline void note_reentry ( TTEntryC* tteC )
+{
+   if (tteC->usage.prof.reentries < 0xFFFF)
+      tteC->usage.prof.reentries++;
+}
+
 static void InEdge__init ( InEdge* ie )
 {
    ie->from_sNo   = INV_SNO; /* invalid */
    ie->from_tteNo = 0;
    ie->from_offs  = 0;
    ie->to_fastEP  = False;
+   ie->is_xindir  = False;
 }
 
 static void OutEdge__init ( OutEdge* oe )
@@ -911,6 +979,7 @@ void VG_(tt_tc_do_chaining) ( void* from__patch_addr,
    }
 
    TTEntryC* from_tteC = index_tteC(from_sNo, from_tteNo);
+   note_reentry(to_tteC);
 
    /* Get VEX to do the patching itself.  We have to hand it off
       since it is host-dependent. */
@@ -954,6 +1023,76 @@ void VG_(tt_tc_do_chaining) ( void* from__patch_addr,
 }
 
 
+/* Fill in an entry of the inline cache of an indirect jump, whose
+   miss call is at from__patch_addr, so that it goes to the slow entry
+   point of the given translation.  As for chaining, record admin info
+   so that the entry can be emptied if the translation is deleted. */
+void VG_(tt_tc_do_xindir_caching) ( void* from__patch_addr,
+                                    SECno to_sNo,
+                                    TTEno to_tteNo )
+{
+   VexArch     arch_host = VexArch_INVALID;
+   VexArchInfo archinfo_host;
+   VG_(bzero_inline)(&archinfo_host, sizeof(archinfo_host));
+   VG_(machine_get_VexArchInfo)( &arch_host, &archinfo_host );
+   VexEndness endness_host = archinfo_host.endness;
+
+   TTEntryC* to_tteC   = index_tteC(to_sNo, to_tteNo);
+   void*     host_code = to_tteC->tcptr;
+
+   vg_assert( (UChar*)host_code >= (UChar*)sectors[to_sNo].tc );
+   vg_assert( (UChar*)host_code <= (UChar*)sectors[to_sNo].tc_next
+                                   + sizeof(ULong) - 1 );
+
+   SECno from_sNo   = INV_SNO;
+   TTEno from_tteNo = INV_TTE;
+   Bool from_found
+      = find_TTEntry_from_hcode( &from_sNo, &from_tteNo,
+                                 from__patch_addr );
+   if (!from_found) {
+      VG_(debugLog)(1,"transtab",
+                    "host code %p not found (discarded? sector recycled?)"
+                    " => no indir caching done\n",
+                    from__patch_addr);
+      return;
+   }
+
+   TTEntryC* from_tteC = index_tteC(from_sNo, from_tteNo);
+
+   void* entry = NULL;
+   VexInvalRange vir
+      = LibVEX_PatchXIndirIC(
+           arch_host, endness_host,
+           from__patch_addr,
+           VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir_miss) ),
+           VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir) ),
+           to_tteC->entry, host_code, &entry
+        );
+   VG_(invalidate_icache)( (void*)vir.start, vir.len );
+   n_xindir_fills++;
+
+   /* Record the link as for a chained jump, but with the entry as the
+      place that was patched. */
+   InEdge ie;
+   InEdge__init(&ie);
+   ie.from_sNo   = from_sNo;
+   ie.from_tteNo = from_tteNo;
+   ie.is_xindir  = True;
+   HWord from_offs = (HWord)( (UChar*)entry - (UChar*)from_tteC->tcptr );
+   vg_assert(from_offs < 100000/* let's say */);
+   ie.from_offs  = (UInt)from_offs;
+
+   OutEdge oe;
+   OutEdge__init(&oe);
+   oe.to_sNo    = to_sNo;
+   oe.to_tteNo  = to_tteNo;
+   oe.from_offs = (UInt)from_offs;
+
+   InEdgeArr__add(&to_tteC->in_edges, &ie);
+   OutEdgeArr__add(&from_tteC->out_edges, &oe);
+}
+
+
 /* Unchain one patch, as described by the specified InEdge.  For
    sanity check purposes only (to check that the patched location is
    as expected) it also requires the fast and slow entry point
@@ -969,6 +1108,18 @@ static void unchain_one ( VexArch arch_host, VexEndness endness_host,
       = index_tteC(ie->from_sNo, ie->from_tteNo);
    UChar* place_to_patch
       = ((UChar*)tteC->tcptr) + ie->from_offs;
+   if (ie->is_xindir) {
+      vg_assert( is_in_the_main_TC(place_to_patch) );
+      vg_assert( is_in_the_main_TC(to_slowEPaddr) );
+      VexInvalRange vir
+         = LibVEX_UnPatchXIndirIC(
+              arch_host, endness_host, place_to_patch, to_slowEPaddr,
+              VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir) ),
+              VG_(fnptr_to_fnentry)( &VG_(disp_cp_xindir_miss) ) );
+      VG_(invalidate_icache)( (void*)vir.start, vir.len );
+      n_xindir_empties++;
+      return;
+   }
    UChar* disp_cp_chain_me
       = VG_(fnptr_to_fnentry)(
            ie->to_fastEP ? &VG_(disp_cp_chain_me_to_fastEP)
@@ -1057,6 +1208,44 @@ void unchain_in_preparation_for_deletion ( VexArch arch_host,
 }
 
 
+/* The specified block is about to be moved to another sector.  Undo
+   its own patched jumps, which unchain_in_preparation_for_deletion
+   leaves alone, so that its code is once more as VEX made it and
+   hence position independent.  Its out_edges are removed, along with
+   the matching in_edges of the blocks it jumped to. */
+static
+void unchain_out_edges ( VexArch arch_host, VexEndness endness_host,
+                         SECno here_sNo, TTEno here_tteNo )
+{
+   UWord     i, j, n, m;
+   Int       evCheckSzB = LibVEX_evCheckSzB(arch_host);
+   TTEntryC* here_tteC  = index_tteC(here_sNo, here_tteNo);
+
+   n = OutEdgeArr__size(&here_tteC->out_edges);
+   for (i = 0; i < n; i++) {
+      OutEdge* oe = OutEdgeArr__index(&here_tteC->out_edges, i);
+      TTEntryC* to_tteC = index_tteC(oe->to_sNo, oe->to_tteNo);
+      m = InEdgeArr__size(&to_tteC->in_edges);
+      vg_assert(m > 0); // it must have at least one entry
+      for (j = 0; j < m; j++) {
+         InEdge* ie = InEdgeArr__index(&to_tteC->in_edges, j);
+         if (ie->from_sNo == here_sNo && ie->from_tteNo == here_tteNo
+             && ie->from_offs == oe->from_offs)
+           break;
+      }
+      vg_assert(j < m); // "ie must be findable"
+      UChar* to_slow_EP = (UChar*)to_tteC->tcptr;
+      UChar* to_fast_EP = to_slow_EP + evCheckSzB;
+      unchain_one(arch_host, endness_host,
+                  InEdgeArr__index(&to_tteC->in_edges, j),
+                  to_fast_EP, to_slow_EP);
+      InEdgeArr__deleteIndex(&to_tteC->in_edges, j);
+   }
+
+   OutEdgeArr__makeEmpty(&here_tteC->out_edges);
+}
+
+
 /*-------------------------------------------------------------*/
 /*--- Address-range equivalence class stuff                 ---*/
 /*-------------------------------------------------------------*/
@@ -1225,7 +1414,7 @@ static Bool sanity_check_eclasses_in_sector ( const Sector* sec )
    if (sec->tt_n_inuse < 0 || sec->tt_n_inuse > N_TTES_PER_SECTOR)
       BAD("invalid sec->tt_n_inuse");
    tce = sec->tc_next;
-   if (tce < &sec->tc[0] || tce > &sec->tc[tc_sector_szQ])
+   if (tce < &sec->tc[0] || tce > &sec->tc[sec->tc_szQ])
       BAD("sec->tc_next points outside tc");
 
    /* For each eclass ... */
@@ -1541,6 +1730,58 @@ static void add_to_empty_tt_list (SECno sNo, TTEno tteno)
    sectors[sNo].empty_tt_list = tteno;
 }
 
+static inline UWord dumped_filter_ix ( Addr entry )
+{
+   return (entry ^ (entry >> 13)) % N_DUMPED_FILTER;
+}
+
+/* How big should the TCEntry area of a newly allocated sector be?
+   Returns zero if the budget has not enough left for one. */
+static Int new_sector_szQ ( SECno sno )
+{
+   Long szQ    = tc_sector_szQ;
+   Long availQ = tc_budgetQ - tc_allocQ;
+
+   /* The tenured sector gets the default size, and it is set aside
+      from the budget until it is allocated. */
+   if (sno == tenured_sector)
+      return tc_sector_szQ;
+   if (tenured_sector != INV_SNO && sectors[tenured_sector].tc == NULL)
+      availQ -= tc_sector_szQ;
+
+   /* Otherwise, once there is a decent sample, size the sector so
+      that it fills up at about the same time as its tt does, as
+      VG_(init_tt_tc) does using the expected average. */
+   if (n_in_count >= N_TTES_PER_SECTOR / 4) {
+      Long avg_codeszQ = (n_in_tsize / n_in_count + 7) / 8;
+      szQ = N_TTES_PER_SECTOR * (1 + avg_codeszQ);
+      if (szQ < tc_sector_szQ / 2)
+         szQ = tc_sector_szQ / 2;
+      if (szQ > 2 * (Long)tc_sector_szQ)
+         szQ = 2 * (Long)tc_sector_szQ;
+   }
+
+   if (szQ > availQ)
+      szQ = availQ;
+   if (szQ < tc_sector_szQ / 2)
+      return 0;
+   return (Int)szQ;
+}
+
+/* Which sector follows sno in the round robin? */
+static SECno next_young_sector ( SECno sno )
+{
+   sno++;
+   if (sno >= n_sectors || sno == tenured_sector
+       || (sectors[sno].tc == NULL && new_sector_szQ(sno) == 0))
+      sno = 0;
+   return sno;
+}
+
+static void promote_reentered_translations ( SECno sno,
+                                             VexArch arch_host,
+                                             VexEndness endness_host );
+
 static void initialiseSector ( SECno sno )
 {
    UInt i;
@@ -1568,13 +1809,19 @@ static void initialiseSector ( SECno sno )
       }
       vg_assert(sec->host_extents == NULL);
 
+      sec->tc_szQ = new_sector_szQ(sno);
+      vg_assert(sec->tc_szQ > 0);
+      tc_allocQ += sec->tc_szQ;
+
       if (VG_(clo_stats) || VG_(debugLog_getLevel)() >= 1)
-         VG_(dmsg)("transtab: " "allocate sector %d\n", sno);
+         VG_(dmsg)("transtab: " "allocate sector %d (%s, TC %'d bytes)\n",
+                   sno, sno == tenured_sector ? "tenured" : "young",
+                   8 * sec->tc_szQ);
 
-      sres = VG_(am_mmap_anon_float_valgrind)( 8 * tc_sector_szQ );
+      sres = VG_(am_mmap_anon_float_valgrind)( 8 * sec->tc_szQ );
       if (sr_isError(sres)) {
          VG_(out_of_memory_NORETURN)("initialiseSector(TC)", 
-                                     8 * tc_sector_szQ, sr_Err(sres) );
+                                     8 * sec->tc_szQ, sr_Err(sres) );
 	 /*NOTREACHED*/
       }
       sec->tc = (ULong*)(Addr)sr_Res(sres);
@@ -1645,7 +1892,6 @@ static void initialiseSector ( SECno sno )
       vg_assert(sec->ttC != NULL);
       vg_assert(sec->ttH != NULL);
       vg_assert(sec->tc_next != NULL);
-      n_dump_count += sec->tt_n_inuse;
 
       VexArch     arch_host = VexArch_INVALID;
       VexArchInfo archinfo_host;
@@ -1653,6 +1899,11 @@ static void initialiseSector ( SECno sno )
       VG_(machine_get_VexArchInfo)( &arch_host, &archinfo_host );
       VexEndness endness_host = archinfo_host.endness;
 
+      /* Save what is still in use from being thrown away. */
+      if (tenured_sector != INV_SNO && sno != tenured_sector)
+         promote_reentered_translations(sno, arch_host, endness_host);
+      n_dump_count += sec->tt_n_inuse;
+
       /* Visit each just-about-to-be-abandoned translation. */
       if (DEBUG_TRANSTAB) VG_(printf)("QQQ unlink-entire-sector: %d START\n",
                                       sno);
@@ -1662,6 +1913,9 @@ static void initialiseSector ( SECno sno )
             vg_assert(sec->ttC[ei].n_tte2ec >= 1);
             vg_assert(sec->ttC[ei].n_tte2ec <= 3);
             n_dump_osize += TTEntryH__osize(&sec->ttH[ei]);
+            dumped_filter[dumped_filter_ix(sec->ttC[ei].entry)]
+               = sec->ttC[ei].entry;
+            VG_(discard_chase_profile)(sec->ttC[ei].entry);
             /* Tell the tool too. */
             if (VG_(needs).superblock_discards) {
                VexGuestExtents vge_tmp;
@@ -1726,97 +1980,44 @@ static void initialiseSector ( SECno sno )
    }
 }
 
-/* Add a translation of vge to TT/TC.  The translation is temporarily
-   in code[0 .. code_len-1].
-
-   pre: youngest_sector points to a valid (although possibly full)
-   sector.
-*/
-void VG_(add_to_transtab)( const VexGuestExtents* vge,
-                           Addr             entry,
-                           Addr             code,
-                           UInt             code_len,
-                           Bool             is_self_checking,
-                           Int              offs_profInc,
-                           UInt             n_guest_instrs )
+/* Does sector sno have room for another translation of code_len
+   bytes? */
+static Bool sector_has_room ( SECno sno, UInt code_len )
 {
-   Int    tcAvailQ, reqdQ, y;
+   const Sector* sec = &sectors[sno];
+   Int tcAvailQ = ((ULong*)(&sec->tc[sec->tc_szQ]))
+                  - ((ULong*)(sec->tc_next));
+   vg_assert(tcAvailQ >= 0);
+   vg_assert(tcAvailQ <= sec->tc_szQ);
+   return tcAvailQ >= (code_len + 7) >> 3
+          && sec->tt_n_inuse < N_TTES_PER_SECTOR;
+}
+
+/* Put a translation of vge, whose code is in code[0 .. code_len-1],
+   into sector y, which must have room for it.  Returns the index of
+   the new tt entry. */
+static TTEno add_to_sector ( SECno y,
+                             const VexGuestExtents* vge,
+                             Addr  entry,
+                             Addr  code,
+                             UInt  code_len,
+                             Int   offs_profInc,
+                             UInt  n_guest_instrs )
+{
+   Int    reqdQ;
    ULong  *tcptr, *tcptr2;
    UChar* srcP;
    UChar* dstP;
 
-   vg_assert(init_done);
-   vg_assert(vge->n_used >= 1 && vge->n_used <= 3);
-
-   /* 60000: should agree with N_TMPBUF in m_translate.c. */
-   vg_assert(code_len > 0 && code_len < 60000);
-
-   /* Generally stay sane */
-   vg_assert(n_guest_instrs < 200); /* it can be zero, tho */
-
-   if (DEBUG_TRANSTAB)
-      VG_(printf)("add_to_transtab(entry = 0x%lx, len = %u) ...\n",
-                  entry, code_len);
-
-   n_in_count++;
-   n_in_tsize += code_len;
-   n_in_osize += vge_osize(vge);
-   if (is_self_checking)
-      n_in_sc_count++;
-
-   y = youngest_sector;
    vg_assert(isValidSector(y));
-
-   if (sectors[y].tc == NULL)
-      initialiseSector(y);
-
-   /* Try putting the translation in this sector. */
-   reqdQ = (code_len + 7) >> 3;
-
-   /* Will it fit in tc? */
-   tcAvailQ = ((ULong*)(&sectors[y].tc[tc_sector_szQ]))
-              - ((ULong*)(sectors[y].tc_next));
-   vg_assert(tcAvailQ >= 0);
-   vg_assert(tcAvailQ <= tc_sector_szQ);
-
-   if (tcAvailQ < reqdQ 
-       || sectors[y].tt_n_inuse >= N_TTES_PER_SECTOR) {
-      /* No.  So move on to the next sector.  Either it's never been
-         used before, in which case it will get its tt/tc allocated
-         now, or it has been used before, in which case it is set to be
-         empty, hence throwing out the oldest sector. */
-      vg_assert(tc_sector_szQ > 0);
-      Int tt_loading_pct = (100 * sectors[y].tt_n_inuse) 
-                           / N_HTTES_PER_SECTOR;
-      Int tc_loading_pct = (100 * (tc_sector_szQ - tcAvailQ)) 
-                           / tc_sector_szQ;
-      if (VG_(clo_stats) || VG_(debugLog_getLevel)() >= 1) {
-         VG_(dmsg)("transtab: "
-                   "declare  sector %d full "
-                   "(TT loading %2d%%, TC loading %2d%%, avg tce size %d)\n",
-                   y, tt_loading_pct, tc_loading_pct,
-                   8 * (tc_sector_szQ - tcAvailQ)/sectors[y].tt_n_inuse);
-      }
-      youngest_sector++;
-      if (youngest_sector >= n_sectors)
-         youngest_sector = 0;
-      y = youngest_sector;
-      initialiseSector(y);
-   }
-
-   /* Be sure ... */
-   tcAvailQ = ((ULong*)(&sectors[y].tc[tc_sector_szQ]))
-              - ((ULong*)(sectors[y].tc_next));
-   vg_assert(tcAvailQ >= 0);
-   vg_assert(tcAvailQ <= tc_sector_szQ);
-   vg_assert(tcAvailQ >= reqdQ);
-   vg_assert(sectors[y].tt_n_inuse < N_TTES_PER_SECTOR);
+   vg_assert(sector_has_room(y, code_len));
    vg_assert(sectors[y].tt_n_inuse >= 0);
+   reqdQ = (code_len + 7) >> 3;
  
    /* Copy into tc. */
    tcptr = sectors[y].tc_next;
    vg_assert(tcptr >= &sectors[y].tc[0]);
-   vg_assert(tcptr <= &sectors[y].tc[tc_sector_szQ]);
+   vg_assert(tcptr <= &sectors[y].tc[sectors[y].tc_szQ]);
 
    dstP = (UChar*)tcptr;
    srcP = (UChar*)code;
@@ -1827,7 +2028,7 @@ void VG_(add_to_transtab)( const VexGuestExtents* vge,
    /* more paranoia */
    tcptr2 = sectors[y].tc_next;
    vg_assert(tcptr2 >= &sectors[y].tc[0]);
-   vg_assert(tcptr2 <= &sectors[y].tc[tc_sector_szQ]);
+   vg_assert(tcptr2 <= &sectors[y].tc[sectors[y].tc_szQ]);
 
    /* Find an empty tt slot, and use it.  There must be such a slot
       since tt is never allowed to get completely full. */
@@ -1836,6 +2037,7 @@ void VG_(add_to_transtab)( const VexGuestExtents* vge,
    TTEntryH__init(&sectors[y].ttH[tteix]);
    sectors[y].ttC[tteix].tcptr  = tcptr;
    sectors[y].ttC[tteix].usage.prof.count  = 0;
+   sectors[y].ttC[tteix].usage.prof.reentries = 0;
 
    sectors[y].ttC[tteix].usage.prof.weight
       = False
@@ -1903,6 +2105,89 @@ void VG_(add_to_transtab)( const VexGuestExtents* vge,
 
    /* Note the eclass numbers for this translation. */
    upd_eclasses_after_add( &sectors[y], tteix );
+
+   return tteix;
+}
+
+/* Add a translation of vge to TT/TC.  The translation is temporarily
+   in code[0 .. code_len-1].
+
+   pre: youngest_sector points to a valid (although possibly full)
+   sector.
+*/
+void VG_(add_to_transtab)( const VexGuestExtents* vge,
+                           Addr             entry,
+                           Addr             code,
+                           UInt             code_len,
+                           Bool             is_self_checking,
+                           Int              offs_profInc,
+                           UInt             n_guest_instrs )
+{
+   Int y;
+
+   vg_assert(init_done);
+   vg_assert(vge->n_used >= 1 && vge->n_used <= 3);
+
+   /* 60000: should agree with N_TMPBUF in m_translate.c. */
+   vg_assert(code_len > 0 && code_len < 60000);
+
+   /* Generally stay sane */
+   vg_assert(n_guest_instrs < 200); /* it can be zero, tho */
+
+   if (DEBUG_TRANSTAB)
+      VG_(printf)("add_to_transtab(entry = 0x%lx, len = %u) ...\n",
+                  entry, code_len);
+
+   n_in_count++;
+   n_in_tsize += code_len;
+   n_in_osize += vge_osize(vge);
+   if (is_self_checking)
+      n_in_sc_count++;
+
+   y = youngest_sector;
+   vg_assert(isValidSector(y));
+
+   if (sectors[y].tc == NULL)
+      initialiseSector(y);
+
+   /* Try putting the translation in this sector. */
+   if (!sector_has_room(y, code_len)) {
+      /* No.  So move on to the next sector.  Either it's never been
+         used before, in which case it will get its tt/tc allocated
+         now, or it has been used before, in which case it is set to be
+         empty, hence throwing out the oldest sector. */
+      Int tc_szQ   = sectors[y].tc_szQ;
+      Int tcAvailQ = ((ULong*)(&sectors[y].tc[tc_szQ]))
+                     - ((ULong*)(sectors[y].tc_next));
+      vg_assert(tc_szQ > 0);
+      Int tt_loading_pct = (100 * sectors[y].tt_n_inuse) 
+                           / N_HTTES_PER_SECTOR;
+      Int tc_loading_pct = (100 * (tc_szQ - tcAvailQ)) 
+                           / tc_szQ;
+      if (VG_(clo_stats) || VG_(debugLog_getLevel)() >= 1) {
+         VG_(dmsg)("transtab: "
+                   "declare  sector %d full "
+                   "(TT loading %2d%%, TC loading %2d%%, avg tce size %d)\n",
+                   y, tt_loading_pct, tc_loading_pct,
+                   8 * (tc_szQ - tcAvailQ)/sectors[y].tt_n_inuse);
+      }
+      youngest_sector = next_young_sector(youngest_sector);
+      y = youngest_sector;
+      initialiseSector(y);
+   }
+
+   TTEno tteix = add_to_sector(y, vge, entry, code, code_len,
+                               offs_profInc, n_guest_instrs);
+
+   /* If this was thrown away not long ago, it is not only needed but
+      likely to be needed again, so it is as good as re-entered
+      already. */
+   UWord fix = dumped_filter_ix(entry);
+   if (dumped_filter[fix] == entry) {
+      dumped_filter[fix] = 0;
+      n_retrans_count++;
+      sectors[y].ttC[tteix].usage.prof.reentries = TT_PROMOTE_REENTRIES;
+   }
 }
 
 
@@ -1942,9 +2227,11 @@ Bool VG_(search_transtab) ( /*OUT*/Addr*  res_hcode,
          if (tti < N_TTES_PER_SECTOR
              && sectors[sno].ttC[tti].entry == guest_addr) {
             /* found it */
-            if (upd_cache)
+            if (upd_cache) {
                setFastCacheEntry( 
                   guest_addr, sectors[sno].ttC[tti].tcptr );
+               note_reentry(&sectors[sno].ttC[tti]);
+            }
             if (res_hcode)
                *res_hcode = (Addr)sectors[sno].ttC[tti].tcptr;
             if (res_sNo)
@@ -2017,30 +2304,17 @@ Bool overlaps ( Addr start, ULong range, const TTEntryH* tteH )
 }
 
 
-/* Delete a tt entry, and update all the eclass data accordingly. */
-
-static void delete_tte ( /*OUT*/Addr* ga_deleted,
-                         /*MOD*/Sector* sec, SECno secNo, TTEno tteno,
-                         VexArch arch_host, VexEndness endness_host )
+/* Remove the specified entry, whose chaining has already been undone,
+   from its sector's eclass lists and hash table, and make its tt slot
+   available for re-use. */
+static void unlink_tte ( /*MOD*/Sector* sec, SECno secNo, TTEno tteno )
 {
    Int      i, ec_idx;
    EClassNo ec_num;
 
-   /* sec and secNo are mutually redundant; cross-check. */
-   vg_assert(sec == &sectors[secNo]);
-
-   vg_assert(tteno < N_TTES_PER_SECTOR);
    TTEntryC* tteC = &sec->ttC[tteno];
    TTEntryH* tteH = &sec->ttH[tteno];
    vg_assert(tteH->status == InUse);
-   vg_assert(tteC->n_tte2ec >= 1 && tteC->n_tte2ec <= 3);
-
-   vg_assert(tteH->vge_n_used >= 1 && tteH->vge_n_used <= 3);
-   vg_assert(tteH->vge_base[0] != TRANSTAB_BOGUS_GUEST_ADDR);
-   *ga_deleted = tteH->vge_base[0];
-
-   /* Unchain .. */
-   unchain_in_preparation_for_deletion(arch_host, endness_host, secNo, tteno);
 
    /* Deal with the ec-to-tte links first. */
    for (i = 0; i < tteC->n_tte2ec; i++) {
@@ -2074,12 +2348,40 @@ static void delete_tte ( /*OUT*/Addr* ga_deleted,
    tteH->status   = Deleted;
    tteC->n_tte2ec = 0;
    add_to_empty_tt_list(secNo, tteno);
+   sec->tt_n_inuse--;
+}
+
+
+/* Delete a tt entry, and update all the eclass data accordingly. */
+
+static void delete_tte ( /*OUT*/Addr* ga_deleted,
+                         /*MOD*/Sector* sec, SECno secNo, TTEno tteno,
+                         VexArch arch_host, VexEndness endness_host )
+{
+   /* sec and secNo are mutually redundant; cross-check. */
+   vg_assert(sec == &sectors[secNo]);
+
+   vg_assert(tteno < N_TTES_PER_SECTOR);
+   TTEntryC* tteC = &sec->ttC[tteno];
+   TTEntryH* tteH = &sec->ttH[tteno];
+   vg_assert(tteH->status == InUse);
+   vg_assert(tteC->n_tte2ec >= 1 && tteC->n_tte2ec <= 3);
+
+   vg_assert(tteH->vge_n_used >= 1 && tteH->vge_n_used <= 3);
+   vg_assert(tteH->vge_base[0] != TRANSTAB_BOGUS_GUEST_ADDR);
+   *ga_deleted = tteH->vge_base[0];
+
+   /* Unchain .. */
+   unchain_in_preparation_for_deletion(arch_host, endness_host, secNo, tteno);
+
+   unlink_tte(sec, secNo, tteno);
 
    /* Stats .. */
-   sec->tt_n_inuse--;
    n_disc_count++;
    n_disc_osize += TTEntryH__osize(tteH);
 
+   VG_(discard_chase_profile)(tteC->entry);
+
    /* Tell the tool too. */
    if (VG_(needs).superblock_discards) {
       VexGuestExtents vge_tmp;
@@ -2326,6 +2628,167 @@ void VG_(discard_translations_safely) ( Addr  start, SizeT len,
    VG_(discard_translations)(start, len, who);
 }
 
+/*-------------------------------------------------------------*/
+/*--- Generational eviction.                                ---*/
+/*-------------------------------------------------------------*/
+
+/* Is hx the host code of a translation that is still in use and has
+   been re-entered at least min_reentries times? */
+static Bool is_reentered ( const HostExtent* hx, const Sector* sec,
+                           UInt min_reentries )
+{
+   if (HostExtent__is_dead(hx, sec))
+      return False;
+   vg_assert(sec->ttH[hx->tteNo].status == InUse);
+   return sec->ttC[hx->tteNo].usage.prof.reentries >= min_reentries;
+}
+
+/* Move the specified translation, whose code is code_len bytes long,
+   to sector dst_sNo, which must have room for it.  Chaining to and
+   from it is undone, and gets redone in the usual way if it is used
+   again.  The tool is not told, since the translation itself does not
+   change. */
+static void move_tte ( VexArch arch_host, VexEndness endness_host,
+                       SECno sNo, TTEno tteNo, UInt code_len,
+                       SECno dst_sNo )
+{
+   Sector*         sec  = &sectors[sNo];
+   TTEntryC*       tteC = &sec->ttC[tteNo];
+   VexGuestExtents vge;
+
+   vg_assert(sNo != dst_sNo);
+   unchain_out_edges(arch_host, endness_host, sNo, tteNo);
+   unchain_in_preparation_for_deletion(arch_host, endness_host, sNo, tteNo);
+   TTEntryH__to_VexGuestExtents( &vge, &sec->ttH[tteNo] );
+   add_to_sector(dst_sNo, &vge, tteC->entry, (Addr)tteC->tcptr, code_len,
+                 -1/*no ProfInc*/, 0);
+   unlink_tte(sec, sNo, tteNo);
+}
+
+/* Empty the tenured sector, keeping those translations in it which
+   have been re-entered since they were put there, but only up to half
+   its capacity, so as to leave room for more.  The rest are dumped,
+   as for any other sector that is recycled. */
+static void collect_tenured_sector ( VexArch arch_host,
+                                     VexEndness endness_host )
+{
+   typedef
+      struct {
+         VexGuestExtents vge;
+         Addr            entry;
+         UInt            code_len;
+         UInt            offs;
+      }
+      Kept;
+
+   SECno   sno    = tenured_sector;
+   Sector* sec    = &sectors[sno];
+   Word    i, n   = VG_(sizeXA)(sec->host_extents);
+   Int     k, n_kept = 0;
+   UInt    keptB  = 0;
+   UInt    maxB   = 8 * (sec->tc_szQ / 2);
+   Kept*   kept   = NULL;
+   UChar*  code   = NULL;
+
+   /* Find out how much is to be kept, ... */
+   for (i = 0; i < n; i++) {
+      const HostExtent* hx = VG_(indexXA)(sec->host_extents, i);
+      if (!is_reentered(hx, sec, 1))
+         continue;
+      UInt szB = 8 * ((hx->len + 7) >> 3);
+      if (keptB + szB > maxB || n_kept >= N_TTES_PER_SECTOR / 2)
+         break;
+      keptB += szB;
+      n_kept++;
+   }
+
+   /* ... copy it out of the way, ... */
+   if (n_kept > 0) {
+      kept = ttaux_malloc("transtab.collect_tenured_sector.1",
+                          n_kept * sizeof(Kept));
+      code = ttaux_malloc("transtab.collect_tenured_sector.2", keptB);
+   }
+   UInt offs = 0;
+   for (i = 0, k = 0; i < n && k < n_kept; i++) {
+      const HostExtent* hx = VG_(indexXA)(sec->host_extents, i);
+      if (!is_reentered(hx, sec, 1))
+         continue;
+      TTEno tteNo = hx->tteNo;
+      unchain_out_edges(arch_host, endness_host, sno, tteNo);
+      unchain_in_preparation_for_deletion(arch_host, endness_host,
+                                          sno, tteNo);
+      TTEntryH__to_VexGuestExtents( &kept[k].vge, &sec->ttH[tteNo] );
+      kept[k].entry    = sec->ttC[tteNo].entry;
+      kept[k].code_len = hx->len;
+      kept[k].offs     = offs;
+      VG_(memcpy)(code + offs, hx->start, hx->len);
+      offs += 8 * ((hx->len + 7) >> 3);
+      unlink_tte(sec, sno, tteNo);
+      k++;
+   }
+   vg_assert(k == n_kept);
+   vg_assert(offs == keptB);
+
+   /* ... dump the rest, and put it back. */
+   initialiseSector(sno);
+   for (k = 0; k < n_kept; k++)
+      add_to_sector(sno, &kept[k].vge, kept[k].entry,
+                    (Addr)(code + kept[k].offs), kept[k].code_len,
+                    -1/*no ProfInc*/, 0);
+
+   if (n_kept > 0) {
+      ttaux_free(kept);
+      ttaux_free(code);
+   }
+   n_tenured_kept += n_kept;
+   n_tenured_collections++;
+}
+
+/* Sector sno is about to be recycled.  Move those translations in it
+   which have been re-entered often enough to the tenured sector,
+   emptying that first if they would not all fit. */
+static void promote_reentered_translations ( SECno sno,
+                                             VexArch arch_host,
+                                             VexEndness endness_host )
+{
+   Sector* sec   = &sectors[sno];
+   Word    i, n  = VG_(sizeXA)(sec->host_extents);
+   Long    hotQ  = 0;
+   Int     n_hot = 0;
+
+   vg_assert(tenured_sector != INV_SNO && sno != tenured_sector);
+
+   for (i = 0; i < n; i++) {
+      const HostExtent* hx = VG_(indexXA)(sec->host_extents, i);
+      if (is_reentered(hx, sec, TT_PROMOTE_REENTRIES)) {
+         hotQ += (hx->len + 7) >> 3;
+         n_hot++;
+      }
+   }
+   if (n_hot == 0)
+      return;
+
+   if (sectors[tenured_sector].tc == NULL)
+      initialiseSector(tenured_sector);
+   const Sector* ten = &sectors[tenured_sector];
+   if (ten->tc_szQ - (ten->tc_next - ten->tc) < hotQ
+       || N_TTES_PER_SECTOR - ten->tt_n_inuse <= n_hot)
+      collect_tenured_sector(arch_host, endness_host);
+
+   for (i = 0; i < n; i++) {
+      const HostExtent* hx = VG_(indexXA)(sec->host_extents, i);
+      if (!is_reentered(hx, sec, TT_PROMOTE_REENTRIES))
+         continue;
+      if (!sector_has_room(tenured_sector, hx->len))
+         break;
+      move_tte(arch_host, endness_host, sno, hx->tteNo, hx->len,
+               tenured_sector);
+      n_promote_count++;
+      n_promote_tsize += hx->len;
+   }
+}
+
+
 /*------------------------------------------------------------*/
 /*--- AUXILIARY: the unredirected TT/TC                    ---*/
 /*------------------------------------------------------------*/
@@ -2595,6 +3058,20 @@ void VG_(init_tt_tc) ( void )
    vg_assert(n_sectors >= MIN_N_SECTORS);
    vg_assert(n_sectors <= MAX_N_SECTORS);
 
+   /* Sectors may end up bigger or smaller than tc_sector_szQ, but not
+      more than this in total. */
+   tc_budgetQ = (Long)n_sectors * tc_sector_szQ;
+   tc_allocQ  = 0;
+
+   /* The tenured sector needs at least two others to go round.
+      Profiled translations can't be moved, since they refer to their
+      own counters. */
+   if (VG_(clo_transtab_generations) && n_sectors >= 3
+       && !VG_(clo_profyle_sbs))
+      tenured_sector = n_sectors - 1;
+   else
+      tenured_sector = INV_SNO;
+
    /* Initialise the sectors, even the ones we aren't going to use.
       Set all fields to zero. */
    youngest_sector = 0;
@@ -2625,6 +3102,9 @@ void VG_(init_tt_tc) ( void )
          "TT/TC: cache: %d sectors of %'d bytes each = %'d total TC\n", 
           n_sectors, 8 * tc_sector_szQ,
           n_sectors * 8 * tc_sector_szQ );
+      if (tenured_sector != INV_SNO)
+         VG_(message)(Vg_DebugMsg,
+            "TT/TC: cache: sector %d is tenured\n", tenured_sector);
       VG_(message)(Vg_DebugMsg,
          "TT/TC: table: %'d tables[%d] of C %'d + H %'d bytes each "
          "= %'d total TT\n",
@@ -2677,6 +3157,11 @@ ULong VG_(get_bbs_discarded_or_dumped) ( void )
    return n_disc_count + n_dump_count;
 }
 
+ULong VG_(get_sectors_recycled) ( void )
+{
+   return n_sectors_recycled;
+}
+
 void VG_(print_tt_tc_stats) ( void )
 {
    VG_(message)(Vg_DebugMsg,
@@ -2701,6 +3186,17 @@ void VG_(print_tt_tc_stats) ( void )
    VG_(message)(Vg_DebugMsg,
                 " transtab: discarded  %'llu (%'llu -> ?" "?)\n",
                 n_disc_count, n_disc_osize );
+   VG_(message)(Vg_DebugMsg,
+                " transtab: promoted   %'llu (-> %'llu) "
+                "(tenured kept %'llu over %'llu collections)\n",
+                n_promote_count, n_promote_tsize,
+                n_tenured_kept, n_tenured_collections );
+   VG_(message)(Vg_DebugMsg,
+                " transtab: retranslated %'llu of those dumped\n",
+                n_retrans_count );
+   VG_(message)(Vg_DebugMsg,
+                " transtab: indir cache entries filled %'llu, emptied %'llu\n",
+                n_xindir_fills, n_xindir_empties );
 
    if (DEBUG_TRANSTAB) {
       VG_(printf)("\n");
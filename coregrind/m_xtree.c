@@ -895,6 +895,14 @@ void VG_(XT_massif_close)(MsFile* fp)
    VG_(fclose)(fp);
 }
 
+void VG_(XT_massif_flush)(MsFile* fp)
+{
+   if (fp == NULL)
+      return; // Error should have been reported by  VG_(XT_massif_open)
+
+   VG_(fflush)(fp);
+}
+
 void VG_(XT_massif_print) 
      (MsFile* fp,
       XTree* xt,
@@ -57,7 +57,8 @@
 
    two_words holds the return values (two words).  First is
    a TRC value.  Second is generally unused, except in the case
-   where we have to return a chain-me request.
+   where we have to return a chain-me request or an inline cache
+   miss.
 */
 void VG_(disp_run_translations)( HWord* two_words,
                                  volatile void*  guest_state, 
@@ -70,6 +71,7 @@ void VG_(disp_run_translations)( HWord* two_words,
 void VG_(disp_cp_chain_me_to_slowEP)(void);
 void VG_(disp_cp_chain_me_to_fastEP)(void);
 void VG_(disp_cp_xindir)(void);
+void VG_(disp_cp_xindir_miss)(void);
 void VG_(disp_cp_xassisted)(void);
 void VG_(disp_cp_evcheck_fail)(void);
 
@@ -189,6 +189,15 @@ extern UChar VG_(clo_profyle_flags);
    profiling results only at the end of the run. */
 extern ULong VG_(clo_profyle_interval);
 
+/* Chase into the dominant destination of conditional branches, as
+   found by profiling them?  Set by --vex-guest-chase=profile.  default:
+   False */
+extern Bool  VG_(clo_vex_guest_chase_profile);
+
+/* Give indirect jumps an inline cache of destinations, where the host
+   supports it?  Set by --vex-indir-cache.  default: False */
+extern Bool  VG_(clo_vex_indir_cache);
+
 /* DEBUG: if tracing codegen, be quiet until after this bb */
 extern Int   VG_(clo_trace_notbelow);
 /* DEBUG: if tracing codegen, be quiet after this bb  */
@@ -341,6 +350,10 @@ extern UInt VG_(clo_num_transtab_sectors);
    provided default. */
 extern UInt VG_(clo_avg_transtab_entry_size);
 
+/* Keep re-entered translations in a tenured sector when recycling
+   the oldest sector? */
+extern Bool VG_(clo_transtab_generations);
+
 /* Only client requested fixed mapping can be done below 
    VG_(clo_aspacem_minAddr). */
 extern Addr VG_(clo_aspacem_minAddr);
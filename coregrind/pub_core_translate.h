@@ -46,6 +46,10 @@ Bool VG_(translate) ( ThreadId tid,
 
 extern void VG_(print_translation_stats) ( void );
 
+/* Called by m_transtab when the translation of the code at orig_addr
+   is thrown away. */
+extern void VG_(discard_chase_profile) ( Addr orig_addr );
+
 #endif   // __PUB_CORE_TRANSLATE_H
 
 /*--------------------------------------------------------------------*/
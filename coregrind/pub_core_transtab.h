@@ -190,6 +190,11 @@ void VG_(tt_tc_do_chaining) ( void* from__patch_addr,
                               TTEno to_tteNo,
                               Bool  to_fastEP );
 
+extern
+void VG_(tt_tc_do_xindir_caching) ( void* from__patch_addr,
+                                    SECno to_sNo,
+                                    TTEno to_tteNo );
+
 extern Bool VG_(search_transtab) ( /*OUT*/Addr*  res_hcode,
                                    /*OUT*/SECno* res_sNo,
                                    /*OUT*/TTEno* res_tteNo,
@@ -204,6 +209,11 @@ extern void VG_(print_tt_tc_stats) ( void );
 extern ULong VG_(get_bbs_translated) ( void );
 extern ULong VG_(get_bbs_discarded_or_dumped) ( void );
 
+/* The number of times a sector has been emptied for re-use.  When
+   this changes, host code addresses obtained before may now point at
+   other translations, or at nothing. */
+extern ULong VG_(get_sectors_recycled) ( void );
+
 /* Add to / search the auxiliary, small, unredirected translation
    table. */
 
@@ -30,6 +30,7 @@
 #include "pub_tool_basics.h"
 #include "pub_tool_clientstate.h"
 #include "pub_tool_clreq.h"
+#include "pub_tool_hashtable.h"
 #include "pub_tool_libcbase.h"
 #include "pub_tool_libcassert.h"
 #include "pub_tool_libcfile.h"
@@ -115,7 +116,7 @@ static void dh_print_debug_usage(void)
 }
 
 //------------------------------------------------------------//
-//--- an Interval Tree of live blocks                      ---//
+//--- a page table and an Interval Tree of live blocks     ---//
 //------------------------------------------------------------//
 
 /* Tracks information about live blocks. */
@@ -134,9 +135,38 @@ typedef
    }
    Block;
 
-/* May not contain zero-sized blocks.  May not contain
-   overlapping blocks. */
+/* Live blocks are found by address in one of two ways.
+
+   Blocks spanning at most LARGE_BLOCK_PAGES pages are entered into a
+   page table: for every page they overlap, a PageInfo keeps them in an
+   array sorted by address.  Finding the block containing an address is
+   then a hash lookup plus a binary search in a small array, no matter how
+   many blocks are live.  This matters for pointer-chasing code, for which
+   the cache below hardly ever hits.
+
+   Larger blocks would need too many page entries, so they are kept in an
+   interval tree instead.  The tree only has to be searched if the page
+   table has no match and any large blocks are live at all.
+
+   Neither may contain zero-sized or overlapping blocks. */
+
+#define DH_PAGE_BITS       12
+#define LARGE_BLOCK_PAGES  16
+
+typedef
+   struct _PageInfo {
+      struct _PageInfo* next;  // for VgHashTable
+      UWord    page;           // key: address >> DH_PAGE_BITS
+      UInt     n_blocks;
+      UInt     max_blocks;
+      Block**  blocks;         // [0 .. n_blocks-1], sorted by payload
+   }
+   PageInfo;
+
+static VgHashTable* page_table = NULL;  /* PageInfo */
+
 static WordFM* interval_tree = NULL;  /* WordFM* Block* void */
+static UWord   n_large_blocks = 0;    /* number of blocks in interval_tree */
 
 /* Here's the comparison function.  Since the tree is required
 to contain non-zero sized, non-overlapping blocks, it's good
@@ -152,6 +182,35 @@ static Word interval_tree_Cmp ( UWord k1, UWord k2 )
    return 0;
 }
 
+static inline UWord first_page ( const Block* bk )
+{
+   return bk->payload >> DH_PAGE_BITS;
+}
+
+static inline UWord last_page ( const Block* bk )
+{
+   return (bk->payload + bk->req_szB - 1) >> DH_PAGE_BITS;
+}
+
+static inline Bool is_large_Block ( const Block* bk )
+{
+   return last_page(bk) - first_page(bk) >= LARGE_BLOCK_PAGES;
+}
+
+// Index of the first block in pi not starting below a.
+static UInt page_lower_bound ( const PageInfo* pi, Addr a )
+{
+   UInt lo = 0, hi = pi->n_blocks;
+   while (lo < hi) {
+      UInt mid = (lo + hi) / 2;
+      if (pi->blocks[mid]->payload < a)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
 // 3-entry cache for find_Block_containing
 static Block* fbc_cache0 = NULL;
 static Block* fbc_cache1 = NULL;
@@ -160,7 +219,8 @@ static Block* fbc_cache2 = NULL;
 static UWord stats__n_fBc_cached0 = 0;
 static UWord stats__n_fBc_cached1 = 0;
 static UWord stats__n_fBc_cached2 = 0;
-static UWord stats__n_fBc_uncached = 0;
+static UWord stats__n_fBc_paged = 0;
+static UWord stats__n_fBc_tree = 0;
 static UWord stats__n_fBc_notfound = 0;
 
 static Block* find_Block_containing ( Addr a )
@@ -195,41 +255,113 @@ static Block* find_Block_containing ( Addr a )
       return tmp;
    }
 
-   Block fake;
-   fake.payload = a;
-   fake.req_szB = 1;
-   UWord foundkey = 1;
-   UWord foundval = 1;
-   Bool found = VG_(lookupFM)( interval_tree,
-                               &foundkey, &foundval, (UWord)&fake );
-   if (!found) {
+   Block* res = NULL;
+   PageInfo* pi = VG_(HT_lookup)( page_table, a >> DH_PAGE_BITS );
+   if (pi) {
+      // The candidate is the last block starting at or below a.
+      UInt i = page_lower_bound(pi, a + 1);
+      if (i > 0) {
+         Block* bk = pi->blocks[i-1];
+         if (a < bk->payload + bk->req_szB) {
+            res = bk;
+            stats__n_fBc_paged++;
+         }
+      }
+   }
+
+   if (!res && n_large_blocks > 0) {
+      Block fake;
+      fake.payload = a;
+      fake.req_szB = 1;
+      UWord foundkey = 1;
+      UWord foundval = 1;
+      Bool found = VG_(lookupFM)( interval_tree,
+                                  &foundkey, &foundval, (UWord)&fake );
+      if (found) {
+         tl_assert(foundval == 0); // we don't store vals in the interval tree
+         tl_assert(foundkey != 1);
+         res = (Block*)foundkey;
+         tl_assert(res != &fake);
+         stats__n_fBc_tree++;
+      }
+   }
+
+   if (!res) {
       stats__n_fBc_notfound++;
       return NULL;
    }
-   tl_assert(foundval == 0); // we don't store vals in the interval tree
-   tl_assert(foundkey != 1);
-   Block* res = (Block*)foundkey;
-   tl_assert(res != &fake);
    // put at the top position
    fbc_cache2 = fbc_cache1;
    fbc_cache1 = fbc_cache0;
    fbc_cache0 = res;
-   stats__n_fBc_uncached++;
    return res;
 }
 
-// delete a block; asserts if not found.  (viz, 'a' must be
-// known to be present.)
-static void delete_Block_starting_at ( Addr a )
+// add a block, which must not overlap any other live block.
+static void add_Block ( Block* bk )
 {
    tl_assert(clo_mode == Heap);
+   tl_assert(bk->req_szB > 0);
 
-   Block fake;
-   fake.payload = a;
-   fake.req_szB = 1;
-   Bool found = VG_(delFromFM)( interval_tree,
-                                NULL, NULL, (Addr)&fake );
-   tl_assert(found);
+   if (is_large_Block(bk)) {
+      Bool present = VG_(addToFM)( interval_tree, (UWord)bk, (UWord)0/*no val*/);
+      tl_assert(!present);
+      n_large_blocks++;
+   } else {
+      UWord page;
+      for (page = first_page(bk); page <= last_page(bk); page++) {
+         PageInfo* pi = VG_(HT_lookup)( page_table, page );
+         if (!pi) {
+            pi = VG_(malloc)("dh.add_Block.1", sizeof(PageInfo));
+            pi->page       = page;
+            pi->n_blocks   = 0;
+            pi->max_blocks = 4;
+            pi->blocks     = VG_(malloc)("dh.add_Block.2",
+                                         pi->max_blocks * sizeof(Block*));
+            VG_(HT_add_node)( page_table, pi );
+         } else if (pi->n_blocks == pi->max_blocks) {
+            pi->max_blocks *= 2;
+            pi->blocks = VG_(realloc)("dh.add_Block.3", pi->blocks,
+                                      pi->max_blocks * sizeof(Block*));
+         }
+         UInt i = page_lower_bound(pi, bk->payload);
+         VG_(memmove)(&pi->blocks[i+1], &pi->blocks[i],
+                      (pi->n_blocks - i) * sizeof(Block*));
+         pi->blocks[i] = bk;
+         pi->n_blocks++;
+      }
+   }
+   fbc_cache0 = fbc_cache1 = fbc_cache2 = NULL;
+}
+
+// delete a block; asserts if not found.  (viz, 'bk' must be
+// known to be present, with the payload and size it was added with.)
+static void delete_Block ( Block* bk )
+{
+   tl_assert(clo_mode == Heap);
+
+   if (is_large_Block(bk)) {
+      Bool found = VG_(delFromFM)( interval_tree,
+                                   NULL, NULL, (UWord)bk );
+      tl_assert(found);
+      n_large_blocks--;
+   } else {
+      UWord page;
+      for (page = first_page(bk); page <= last_page(bk); page++) {
+         PageInfo* pi = VG_(HT_lookup)( page_table, page );
+         tl_assert(pi);
+         UInt i = page_lower_bound(pi, bk->payload);
+         tl_assert(i < pi->n_blocks && pi->blocks[i] == bk);
+         pi->n_blocks--;
+         VG_(memmove)(&pi->blocks[i], &pi->blocks[i+1],
+                      (pi->n_blocks - i) * sizeof(Block*));
+         if (pi->n_blocks == 0) {
+            VG_(HT_remove)( page_table, page );
+            VG_(free)( pi->blocks );
+            VG_(free)( pi );
+         }
+      }
+   }
    fbc_cache0 = fbc_cache1 = fbc_cache2 = NULL;
 }
 
@@ -581,7 +713,7 @@ void* new_block ( ThreadId tid, void* p, SizeT req_szB, SizeT req_alignB,
    if ((SSizeT)req_szB < 0) return NULL;
 
    if (req_szB == 0) {
-      req_szB = 1;  /* can't allow zero-sized blocks in the interval tree */
+      req_szB = 1;  /* can't allow zero-sized blocks in the page table */
    }
 
    // Allocate and zero if necessary
@@ -599,7 +731,7 @@ void* new_block ( ThreadId tid, void* p, SizeT req_szB, SizeT req_alignB,
       return p;
    }
 
-   // Make new Block, add to interval_tree.
+   // Make new Block, add to the page table or interval_tree.
    Block* bk = VG_(malloc)("dh.new_block.1", sizeof(Block));
    bk->payload      = (Addr)p;
    bk->req_szB      = req_szB;
@@ -614,9 +746,7 @@ void* new_block ( ThreadId tid, void* p, SizeT req_szB, SizeT req_alignB,
       VG_(memset)(bk->histoW, 0, req_szB * sizeof(UShort));
    }
 
-   Bool present = VG_(addToFM)( interval_tree, (UWord)bk, (UWord)0/*no val*/);
-   tl_assert(!present);
-   fbc_cache0 = fbc_cache1 = fbc_cache2 = NULL;
+   add_Block(bk);
 
    intro_Block(bk);
 
@@ -648,7 +778,7 @@ void die_block ( void* p )
 
    retire_Block(bk, True/*because_freed*/);
 
-   delete_Block_starting_at( bk->payload );
+   delete_Block(bk);
    if (bk->histoW) {
       VG_(free)( bk->histoW );
       bk->histoW = NULL;
@@ -698,9 +828,12 @@ void* renew_block ( ThreadId tid, void* p_old, SizeT new_req_szB )
 
    // Actually do the allocation, if necessary.
    if (new_req_szB <= bk->req_szB) {
-      // New size is smaller or same; block not moved.
+      // New size is smaller or same; block not moved.  It may cover
+      // fewer pages now, so re-add it.
+      delete_Block(bk);
       resize_Block(bk->ec, bk->req_szB, new_req_szB);
       bk->req_szB = new_req_szB;
+      add_Block(bk);
 
       // Update reads/writes for the implicit copy. Even though we didn't
       // actually do a copy, we act like we did, to match up with the fact
@@ -724,10 +857,10 @@ void* renew_block ( ThreadId tid, void* p_old, SizeT new_req_szB )
       VG_(cli_free)(p_old);
 
       // Since the block has moved, we need to re-insert it into the
-      // interval tree at the new place.  Do this by removing
-      // and re-adding it.
-      delete_Block_starting_at( (Addr)p_old );
-      // Now 'bk' is no longer in the tree, but the Block itself
+      // page table or interval tree at the new place.  Do this by
+      // removing and re-adding it.
+      delete_Block(bk);
+      // Now 'bk' is no longer in the table or tree, but the Block itself
       // is still alive.
 
       // Update reads/writes for the copy.
@@ -739,11 +872,8 @@ void* renew_block ( ThreadId tid, void* p_old, SizeT new_req_szB )
       bk->payload = (Addr)p_new;
       bk->req_szB = new_req_szB;
 
-      // And re-add it to the interval tree.
-      Bool present
-         = VG_(addToFM)( interval_tree, (UWord)bk, (UWord)0/*no val*/);
-      tl_assert(!present);
-      fbc_cache0 = fbc_cache1 = fbc_cache2 = NULL;
+      // And re-add it.
+      add_Block(bk);
    }
 
    return p_new;
@@ -1668,19 +1798,34 @@ static void dh_fini(Int exit_status)
       }
       VG_(doneIterFM)( interval_tree );
 
+      // Blocks in the page table are retired via their first page.
+      PageInfo* pi;
+      VG_(HT_ResetIter)( page_table );
+      while ((pi = VG_(HT_Next)( page_table ))) {
+         UInt i;
+         for (i = 0; i < pi->n_blocks; i++) {
+            Block* bk = pi->blocks[i];
+            if (first_page(bk) == pi->page)
+               retire_Block(bk, False/*!because_freed*/);
+         }
+      }
+
       // Stats.
       if (VG_(clo_stats)) {
          VG_(dmsg)(" dhat: find_Block_containing:\n");
          VG_(dmsg)(" dhat:   found: %'lu\n",
                    stats__n_fBc_cached0 + stats__n_fBc_cached1
                                         + stats__n_fBc_cached2
-                                        + stats__n_fBc_uncached);
+                                        + stats__n_fBc_paged
+                                        + stats__n_fBc_tree);
          VG_(dmsg)(" dhat:     at cache0 %'14lu     at cache1 %'14lu\n",
                    stats__n_fBc_cached0,
                    stats__n_fBc_cached1);
-         VG_(dmsg)(" dhat:     at cache2 %'14lu     uncached  %'14lu\n",
+         VG_(dmsg)(" dhat:     at cache2 %'14lu     in pages  %'14lu\n",
                    stats__n_fBc_cached2,
-                   stats__n_fBc_uncached);
+                   stats__n_fBc_paged);
+         VG_(dmsg)(" dhat:     in tree   %'14lu\n",
+                   stats__n_fBc_tree);
          VG_(dmsg)(" dhat: notfound: %'lu\n", stats__n_fBc_notfound);
          VG_(dmsg)("\n");
       }
@@ -1877,11 +2022,14 @@ static void dh_pre_clo_init(void)
                                  dh_malloc_usable_size,
                                  0 );
 
+   tl_assert(!page_table);
    tl_assert(!interval_tree);
    tl_assert(!fbc_cache0);
    tl_assert(!fbc_cache1);
    tl_assert(!fbc_cache2);
 
+   page_table = VG_(HT_construct)( "dh.page_table.1" );
+
    interval_tree = VG_(newFM)( VG_(malloc),
                                "dh.interval_tree.1",
                                VG_(free),
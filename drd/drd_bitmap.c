@@ -185,6 +185,7 @@ void DRD_(bm_access_range_load)(struct bitmap* const bm, Addr a1, Addr a2)
          {
             bm2->bm1.bm0_r[k] = ~(UWord)0;
          }
+         bm1_summary_set_all(&bm2->bm1);
       }
       else
       {
@@ -192,6 +193,8 @@ void DRD_(bm_access_range_load)(struct bitmap* const bm, Addr a1, Addr a2)
          {
             bm0_set(bm2->bm1.bm0_r, b0);
          }
+         bm1_summary_set_range(&bm2->bm1,
+                               address_lsb(b_start), address_lsb(b_end - 1));
       }
    }
 }
@@ -282,6 +285,7 @@ void DRD_(bm_access_range_store)(struct bitmap* const bm,
          {
             bm2->bm1.bm0_w[k] = ~(UWord)0;
          }
+         bm1_summary_set_all(&bm2->bm1);
       }
       else
       {
@@ -289,6 +293,8 @@ void DRD_(bm_access_range_store)(struct bitmap* const bm,
          {
             bm0_set(bm2->bm1.bm0_w, b0);
          }
+         bm1_summary_set_range(&bm2->bm1,
+                               address_lsb(b_start), address_lsb(b_end - 1));
       }
    }
 }
@@ -327,6 +333,31 @@ void DRD_(bm_access_store_8)(struct bitmap* const bm, const Addr a1)
       DRD_(bm_access_range)(bm, a1, a1 + 8, eStore);
 }
 
+/**
+ * Return True if any of the bits corresponding to the address LSBs in range
+ * [ a_first .. a_last ] is set in p1->bm0_r[] (if test_r) or in p1->bm0_w[]
+ * (if test_w). UWord's for which no summary bit has been set are skipped.
+ */
+static __inline__
+Bool bm1_has_any(const struct bitmap1* const p1,
+                 const UWord a_first, const UWord a_last,
+                 const Bool test_r, const Bool test_w)
+{
+   UWord k;
+
+   for (k = uword_msb(a_first); k <= uword_msb(a_last); k++)
+   {
+      UWord bits;
+
+      if (! bm1_summary_is_set(p1, k))
+         continue;
+      bits = (test_r ? p1->bm0_r[k] : 0) | (test_w ? p1->bm0_w[k] : 0);
+      if (bits & bm0_word_mask(k, a_first, a_last))
+         return True;
+   }
+   return False;
+}
+
 Bool DRD_(bm_has)(struct bitmap* const bm, const Addr a1, const Addr a2,
                   const BmAccessTypeT access_type)
 {
@@ -346,17 +377,8 @@ Bool DRD_(bm_has_any_load_g)(struct bitmap* const bm)
 
    VG_(OSetGen_ResetIter)(bm->oset);
    for ( ; (bm2 = VG_(OSetGen_Next)(bm->oset)) != NULL; ) {
-      Addr b_start;
-      Addr b_end;
-      UWord b0;
-      const struct bitmap1* const p1 = &bm2->bm1;
-
-      b_start = make_address(bm2->addr, 0);
-      b_end = make_address(bm2->addr + 1, 0);
-
-      for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
-         if (bm0_is_set(p1->bm0_r, b0))
-            return True;
+      if (bm1_has_any(&bm2->bm1, 0, ADDR_LSB_MASK, True, False))
+         return True;
    }
    return False;
 }
@@ -382,7 +404,6 @@ DRD_(bm_has_any_load)(struct bitmap* const bm, const Addr a1, const Addr a2)
       {
          Addr b_start;
          Addr b_end;
-         UWord b0;
          const struct bitmap1* const p1 = &bm2->bm1;
 
          if (make_address(bm2->addr, 0) < a1)
@@ -402,12 +423,10 @@ DRD_(bm_has_any_load)(struct bitmap* const bm, const Addr a1, const Addr a2)
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         if (bm1_has_any(p1, address_lsb(b_start), address_lsb(b_end - 1),
+                         True, False))
          {
-            if (bm0_is_set(p1->bm0_r, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -435,7 +454,6 @@ Bool DRD_(bm_has_any_store)(struct bitmap* const bm,
       {
          Addr b_start;
          Addr b_end;
-         UWord b0;
          const struct bitmap1* const p1 = &bm2->bm1;
 
          if (make_address(bm2->addr, 0) < a1)
@@ -455,12 +473,10 @@ Bool DRD_(bm_has_any_store)(struct bitmap* const bm,
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         if (bm1_has_any(p1, address_lsb(b_start), address_lsb(b_end - 1),
+                         False, True))
          {
-            if (bm0_is_set(p1->bm0_w, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -490,7 +506,6 @@ Bool DRD_(bm_has_any_access)(struct bitmap* const bm,
       {
          Addr b_start;
          Addr b_end;
-         UWord b0;
          const struct bitmap1* const p1 = &bm2->bm1;
 
          if (make_address(bm2->addr, 0) < a1)
@@ -510,16 +525,10 @@ Bool DRD_(bm_has_any_access)(struct bitmap* const bm,
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         if (bm1_has_any(p1, address_lsb(b_start), address_lsb(b_end - 1),
+                         True, True))
          {
-            /*
-             * Note: the statement below uses a binary or instead of a logical
-             * or on purpose.
-             */
-            if (bm0_is_set(p1->bm0_r, b0) | bm0_is_set(p1->bm0_w, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -808,6 +817,7 @@ Bool DRD_(bm_has_conflict_with)(struct bitmap* const bm,
    Addr b, b_next;
 
    tl_assert(bm);
+   tl_assert(access_type == eLoad || access_type == eStore);
 
    for (b = a1; b < a2; b = b_next)
    {
@@ -823,7 +833,6 @@ Bool DRD_(bm_has_conflict_with)(struct bitmap* const bm,
       {
          Addr b_start;
          Addr b_end;
-         UWord b0;
          const struct bitmap1* const p1 = &bm2->bm1;
 
          if (make_address(bm2->addr, 0) < a1)
@@ -843,24 +852,11 @@ Bool DRD_(bm_has_conflict_with)(struct bitmap* const bm,
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         /* A load conflicts with stores, a store with loads and stores. */
+         if (bm1_has_any(p1, address_lsb(b_start), address_lsb(b_end - 1),
+                         access_type == eStore, True))
          {
-            if (access_type == eLoad)
-            {
-               if (bm0_is_set(p1->bm0_w, b0))
-               {
-                  return True;
-               }
-            }
-            else
-            {
-               tl_assert(access_type == eStore);
-               if (bm0_is_set(p1->bm0_r, b0)
-                   | bm0_is_set(p1->bm0_w, b0))
-               {
-                  return True;
-               }
-            }
+            return True;
          }
       }
    }
@@ -981,9 +977,13 @@ Bool DRD_(bm_equal)(struct bitmap* const lhs, struct bitmap* const rhs)
                                         make_address(bm2r->addr, 0),
                                         make_address(bm2r->addr + 1, 0)));
 
+      /* Note: the summaries are not compared since these are conservative. */
       if (bm2l != bm2r
           && (bm2l->addr != bm2r->addr
-              || VG_(memcmp)(&bm2l->bm1, &bm2r->bm1, sizeof(bm2l->bm1)) != 0))
+              || VG_(memcmp)(bm2l->bm1.bm0_r, bm2r->bm1.bm0_r,
+                             sizeof(bm2l->bm1.bm0_r)) != 0
+              || VG_(memcmp)(bm2l->bm1.bm0_w, bm2r->bm1.bm0_w,
+                             sizeof(bm2l->bm1.bm0_w)) != 0))
       {
          return False;
       }
@@ -1186,6 +1186,17 @@ int DRD_(bm_has_races)(struct bitmap* const lhs, struct bitmap* const rhs)
       for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
       {
          unsigned b;
+         UWord racy;
+
+         if (! bm1_summary_is_set(bm1l, k) || ! bm1_summary_is_set(bm1r, k))
+            continue;
+
+         /* Word-wise version of HAS_RACE(). */
+         racy = (bm1r->bm0_w[k] & (bm1l->bm0_r[k] | bm1l->bm0_w[k]))
+            | (bm1l->bm0_w[k] & (bm1r->bm0_r[k] | bm1r->bm0_w[k]));
+         if (racy == 0)
+            continue;
+
          for (b = 0; b < BITS_PER_UWORD; b++)
          {
             UWord const access_mask
@@ -1194,6 +1205,8 @@ int DRD_(bm_has_races)(struct bitmap* const lhs, struct bitmap* const rhs)
                | ((bm1r->bm0_r[k] & bm0_mask(b)) ? RHS_R : 0)
                | ((bm1r->bm0_w[k] & bm0_mask(b)) ? RHS_W : 0);
             Addr const a = make_address(bm2l->addr, k * BITS_PER_UWORD | b);
+            if ((racy & bm0_mask(b)) == 0)
+               continue;
             if (HAS_RACE(access_mask) && ! DRD_(is_suppressed)(a, a + 1))
             {
                return 1;
@@ -1255,11 +1268,16 @@ ULong DRD_(bm_get_bitmap2_merge_count)(void)
    return s_bitmap2_merge_count;
 }
 
-/** Compute *bm2l |= *bm2r. */
+/**
+ * Compute *bm2l |= *bm2r. Only the UWord's for which a summary bit has been
+ * set in *bm2r are visited. The loop over fully populated summary words has
+ * no data dependencies between iterations such that the compiler can
+ * vectorize it.
+ */
 static
 void bm2_merge(struct bitmap2* const bm2l, const struct bitmap2* const bm2r)
 {
-   unsigned k;
+   unsigned i;
 
    tl_assert(bm2l);
    tl_assert(bm2r);
@@ -1267,12 +1285,33 @@ void bm2_merge(struct bitmap2* const bm2l, const struct bitmap2* const bm2r)
 
    s_bitmap2_merge_count++;
 
-   for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+   for (i = 0; i < BITMAP1_SUMMARY_COUNT; i++)
    {
-      bm2l->bm1.bm0_r[k] |= bm2r->bm1.bm0_r[k];
-   }
-   for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
-   {
-      bm2l->bm1.bm0_w[k] |= bm2r->bm1.bm0_w[k];
+      const UWord s = bm2r->bm1.summary[i];
+      const unsigned k0 = i * BITS_PER_UWORD;
+      unsigned j;
+
+      if (s == 0)
+         continue;
+
+      bm2l->bm1.summary[i] |= s;
+      if (s == ~(UWord)0 && k0 + BITS_PER_UWORD <= BITMAP1_UWORD_COUNT)
+      {
+         for (j = 0; j < BITS_PER_UWORD; j++)
+            bm2l->bm1.bm0_r[k0 + j] |= bm2r->bm1.bm0_r[k0 + j];
+         for (j = 0; j < BITS_PER_UWORD; j++)
+            bm2l->bm1.bm0_w[k0 + j] |= bm2r->bm1.bm0_w[k0 + j];
+      }
+      else
+      {
+         for (j = 0; j < BITS_PER_UWORD && k0 + j < BITMAP1_UWORD_COUNT; j++)
+         {
+            if (s & ((UWord)1 << j))
+            {
+               bm2l->bm1.bm0_r[k0 + j] |= bm2r->bm1.bm0_r[k0 + j];
+               bm2l->bm1.bm0_w[k0 + j] |= bm2r->bm1.bm0_w[k0 + j];
+            }
+         }
+      }
    }
 }
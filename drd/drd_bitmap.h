@@ -149,6 +149,13 @@ Addr make_address(const UWord a1, const UWord a0)
 /** Number of UWord's needed to store one bit per address LSB. */
 #define BITMAP1_UWORD_COUNT (1U << (ADDR_LSB_BITS - BITS_PER_BITS_PER_UWORD))
 
+/**
+ * Number of UWord's needed to store one summary bit per UWord of a
+ * bm0_r[] / bm0_w[] array.
+ */
+#define BITMAP1_SUMMARY_COUNT                                           \
+   ((BITMAP1_UWORD_COUNT + BITS_PER_UWORD - 1) / BITS_PER_UWORD)
+
 /**
  * Mask that has to be applied to an (Addr >> ADDR_IGNORED_BITS) expression
  * in order to compute the least significant part of an UWord.
@@ -220,11 +227,19 @@ static ULong s_bitmap2_creation_count;
 /*********************************************************************/
 
 
-/* Lowest level, corresponding to the lowest ADDR_LSB_BITS of an address. */
+/*
+ * Lowest level, corresponding to the lowest ADDR_LSB_BITS of an address.
+ *
+ * Bit k of summary[] is set if bm0_r[k] or bm0_w[k] may be nonzero. The
+ * summary is conservative: clearing bits in bm0_r[] / bm0_w[] does not
+ * clear the corresponding summary bit. Functions that scan a bitmap1 use
+ * the summary to skip UWord's in which no access has been recorded.
+ */
 struct bitmap1
 {
    UWord bm0_r[BITMAP1_UWORD_COUNT];
    UWord bm0_w[BITMAP1_UWORD_COUNT];
+   UWord summary[BITMAP1_SUMMARY_COUNT];
 };
 
 static __inline__ UWord bm0_mask(const UWord a)
@@ -296,6 +311,22 @@ static __inline__ void bm0_clear_range(UWord* bm0,
    }
 }
 
+/**
+ * Return the mask of the bits in bm0[idx] that correspond to the addresses
+ * in range [ a_first << ADDR_IGNORED_BITS .. a_last << ADDR_IGNORED_BITS ].
+ */
+static __inline__ UWord bm0_word_mask(const UWord idx,
+                                      const UWord a_first, const UWord a_last)
+{
+   const UWord lo = uword_msb(a_first) == idx ? uword_lsb(a_first) : 0;
+   const UWord hi = uword_msb(a_last) == idx
+      ? uword_lsb(a_last) : BITS_PER_UWORD - 1;
+#ifdef ENABLE_DRD_CONSISTENCY_CHECKS
+   tl_assert(uword_msb(a_first) <= idx && idx <= uword_msb(a_last));
+#endif
+   return (~(UWord)0 >> (BITS_PER_UWORD - 1 - hi)) & (~(UWord)0 << lo);
+}
+
 /** Test whether the bit corresponding to address a is set in bitmap bm0. */
 static __inline__ UWord bm0_is_set(const UWord* bm0, const UWord a)
 {
@@ -324,6 +355,39 @@ static __inline__ UWord bm0_is_any_set(const UWord* bm0,
 
 
 
+/**
+ * Set the summary bits of all bm0 UWord's that hold the addresses in range
+ * [ a_first << ADDR_IGNORED_BITS .. a_last << ADDR_IGNORED_BITS ].
+ */
+static __inline__ void bm1_summary_set_range(struct bitmap1* const bm1,
+                                             const UWord a_first,
+                                             const UWord a_last)
+{
+   UWord k;
+
+#ifdef ENABLE_DRD_CONSISTENCY_CHECKS
+   tl_assert(a_first <= a_last);
+   tl_assert(address_msb(make_address(0, a_last)) == 0);
+#endif
+   for (k = uword_msb(a_first); k <= uword_msb(a_last); k++)
+      bm0_set(bm1->summary, k);
+}
+
+/** Mark all bm0 UWord's of bm1 as possibly nonzero. */
+static __inline__ void bm1_summary_set_all(struct bitmap1* const bm1)
+{
+   VG_(memset)(bm1->summary, 0xff, sizeof(bm1->summary));
+}
+
+/** Return True if an access may have been recorded in bm0_r[k] or bm0_w[k]. */
+static __inline__ UWord bm1_summary_is_set(const struct bitmap1* const bm1,
+                                           const UWord k)
+{
+   return bm0_is_set(bm1->summary, k);
+}
+
+
+
 /*********************************************************************/
 /*           Functions for manipulating a struct bitmap.             */
 /*********************************************************************/
@@ -669,6 +733,8 @@ void bm_access_aligned_load(struct bitmap* const bm,
    bm0_set_range(bm2->bm1.bm0_r,
                  (a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK,
                  SCALED_SIZE(size));
+   bm0_set(bm2->bm1.summary,
+           uword_msb((a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK));
 }
 
 static __inline__
@@ -685,6 +751,8 @@ void bm_access_aligned_store(struct bitmap* const bm,
    bm0_set_range(bm2->bm1.bm0_w,
                  (a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK,
                  SCALED_SIZE(size));
+   bm0_set(bm2->bm1.summary,
+           uword_msb((a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK));
 }
 
 static __inline__
@@ -60,10 +60,22 @@
 #endif
 
 
+/*
+ * Number of sampling slots. Each superblock is mapped onto one of these slots
+ * via its guest address, and its memory accesses are only checked while the
+ * flag of that slot is set.
+ */
+#define DRD_SAMPLE_SLOTS 4096
+
+
 /* Local variables. */
 
 static Bool s_check_stack_accesses = False;
 static Bool s_first_race_only      = False;
+static int  s_sample_percent       = 100;
+static ULong s_sample_epoch_length = 1000000;
+static ULong s_sample_epoch        = ~0ULL;
+static UChar s_sample_slots[DRD_SAMPLE_SLOTS];
 
 
 /* Function definitions. */
@@ -90,6 +102,38 @@ void DRD_(set_first_race_only)(const Bool fro)
    s_first_race_only = fro;
 }
 
+void DRD_(set_sample_percent)(const int p)
+{
+   tl_assert(1 <= p && p <= 100);
+   s_sample_percent = p;
+}
+
+void DRD_(set_sample_epoch)(const ULong e)
+{
+   tl_assert(e > 0);
+   s_sample_epoch_length = e;
+}
+
+/**
+ * Select which sampling slots are enabled during the epoch bbs_done falls in.
+ * A different subset of s_sample_percent percent of the slots is selected for
+ * every epoch such that all code gets checked over time.
+ */
+void DRD_(update_sample_slots)(const ULong bbs_done)
+{
+   ULong epoch;
+
+   if (s_sample_percent >= 100)
+      return;
+
+   epoch = bbs_done / s_sample_epoch_length;
+   if (epoch == s_sample_epoch)
+      return;
+   s_sample_epoch = epoch;
+   VG_(select_sample_slots)(s_sample_slots, DRD_SAMPLE_SLOTS, epoch,
+                            s_sample_percent);
+}
+
 void DRD_(trace_mem_access)(const Addr addr, const SizeT size,
                             const BmAccessTypeT access_type,
                             const HWord stored_value_hi,
@@ -470,6 +514,54 @@ static void instr_trace_mem_store(IRSB* const bb, IRExpr* const addr_expr,
    addStmtToIRSB(bb, IRStmt_Dirty(di) );
 }
 
+/**
+ * Generate code that evaluates to True if the memory accesses of the
+ * superblock starting at guest address 'base' are checked during the current
+ * sampling epoch. Returns NULL if sampling has been disabled.
+ */
+static IRExpr* instr_sample_guard(IRSB* const bb, const Addr base)
+{
+   UInt slot;
+   IRTemp flag, res;
+
+   if (s_sample_percent >= 100)
+      return NULL;
+
+   slot = VG_(sample_slot)(base, DRD_SAMPLE_SLOTS);
+   flag = newIRTemp(bb->tyenv, Ity_I8);
+   res = newIRTemp(bb->tyenv, Ity_I1);
+   addStmtToIRSB(bb,
+                 IRStmt_WrTmp(flag,
+                              IRExpr_Load(
+#if defined(VG_BIGENDIAN)
+                                          Iend_BE,
+#else
+                                          Iend_LE,
+#endif
+                                          Ity_I8,
+                                          mkIRExpr_HWord((HWord)
+                                                  &s_sample_slots[slot]))));
+   addStmtToIRSB(bb,
+                 IRStmt_WrTmp(res, IRExpr_Binop(Iop_CmpNE8, IRExpr_RdTmp(flag),
+                                                IRExpr_Const(IRConst_U8(0)))));
+   return IRExpr_RdTmp(res);
+}
+
+/** Combine the sampling guard 'sampled' with the guard of an access. */
+static IRExpr* instr_and_guard(IRSB* const bb, IRExpr* const sampled,
+                               IRExpr* const guard/* NULL => True */)
+{
+   IRTemp res;
+
+   if (!sampled)
+      return guard;
+   if (!guard)
+      return sampled;
+   res = newIRTemp(bb->tyenv, Ity_I1);
+   addStmtToIRSB(bb, IRStmt_WrTmp(res, IRExpr_Binop(Iop_And1, sampled, guard)));
+   return IRExpr_RdTmp(res);
+}
+
 static void instrument_load(IRSB* const bb, IRExpr* const addr_expr,
                             const HWord size,
                             IRExpr* const guard/* NULL => True */)
@@ -600,6 +692,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
    Int      i;
    IRSB*    bb;
    IRExpr** argv;
+   IRExpr*  sampled;
    Bool     instrument = True;
 
    /* Set up BB */
@@ -609,6 +702,8 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
    bb->jumpkind = bb_in->jumpkind;
    bb->offsIP   = bb_in->offsIP;
 
+   sampled = instr_sample_guard(bb, vge->base[0]);
+
    for (i = 0; i < bb_in->stmts_used; i++)
    {
       IRStmt* const st = bb_in->stmts[i];
@@ -645,7 +740,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
       case Ist_Store:
          if (instrument)
             instrument_store(bb, st->Ist.Store.addr, st->Ist.Store.data,
-                             NULL/* no guard */);
+                             sampled);
          addStmtToIRSB(bb, st);
          break;
 
@@ -654,7 +749,8 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
          IRExpr*   data = sg->data;
          IRExpr*   addr = sg->addr;
          if (instrument)
-            instrument_store(bb, addr, data, sg->guard);
+            instrument_store(bb, addr, data,
+                             instr_and_guard(bb, sampled, sg->guard));
          addStmtToIRSB(bb, st);
          break;
       }
@@ -670,8 +766,8 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
             addr_expr = instr_trace_mem_load(bb, addr_expr,
                                              sizeofIRType(type), lg->guard);
          }
-         instrument_load(bb, lg->addr,
-                         sizeofIRType(type), lg->guard);
+         instrument_load(bb, lg->addr, sizeofIRType(type),
+                         instr_and_guard(bb, sampled, lg->guard));
          addStmtToIRSB(bb, st);
          break;
       }
@@ -687,7 +783,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                                        NULL/* no guard */);
                }
                instrument_load(bb, addr_expr, sizeofIRType(data->Iex.Load.ty),
-                               NULL/* no guard */);
+                               sampled);
             }
          }
          addStmtToIRSB(bb, st);
@@ -712,6 +808,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                           "drd_trace_load",
                           VG_(fnptr_to_fnentry)(DRD_(trace_load)),
                           argv);
+                  if (sampled) di->guard = sampled;
                   addStmtToIRSB(bb, IRStmt_Dirty(di));
                }
                if (mFx == Ifx_Write || mFx == Ifx_Modify)
@@ -721,6 +818,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                           "drd_trace_store",
                           VG_(fnptr_to_fnentry)(DRD_(trace_store)),
                           argv);
+                  if (sampled) di->guard = sampled;
                   addStmtToIRSB(bb, IRStmt_Dirty(di));
                }
                break;
@@ -754,7 +852,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                instr_trace_mem_store(bb, cas->addr, cas->dataHi, cas->dataLo,
                                      NULL/* no guard */);
 
-            instrument_load(bb, cas->addr, dataSize, NULL/*no guard*/);
+            instrument_load(bb, cas->addr, dataSize, sampled);
          }
          addStmtToIRSB(bb, st);
          break;
@@ -777,7 +875,7 @@ IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                                                    NULL /* no guard */);
 
                instrument_load(bb, addr_expr, sizeofIRType(dataTy),
-                               NULL/*no guard*/);
+                               sampled);
             }
          } else {
             /* SC */
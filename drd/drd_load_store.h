@@ -37,6 +37,9 @@ Bool DRD_(get_check_stack_accesses)(void);
 void DRD_(set_check_stack_accesses)(const Bool c);
 Bool DRD_(get_first_race_only)(void);
 void DRD_(set_first_race_only)(const Bool fro);
+void DRD_(set_sample_percent)(const int p);
+void DRD_(set_sample_epoch)(const ULong e);
+void DRD_(update_sample_slots)(const ULong bbs_done);
 IRSB* DRD_(instrument)(VgCallbackClosure* const closure,
                        IRSB* const bb_in,
                        const VexGuestLayout* const layout,
@@ -72,6 +72,8 @@ static Bool DRD_(process_cmd_line_option)(const HChar* arg)
    Bool report_signal_unlocked = False;
    Bool segment_merging        = False;
    int segment_merge_interval  = -1;
+   int sample_percent          = -1;
+   Long sample_epoch           = -1;
    int shared_threshold_ms     = -1;
    Bool show_confl_seg         = False;
    Bool trace_barrier          = False;
@@ -107,6 +109,9 @@ static Bool DRD_(process_cmd_line_option)(const HChar* arg)
    }
    else if VG_INT_CLO (arg, "--segment-merging-interval", segment_merge_interval)
    {}
+   else if VG_BINT_CLO(arg, "--sample-percent", sample_percent, 1, 100) {}
+   else if VG_BINT_CLO(arg, "--sample-epoch", sample_epoch,
+                       1000, 1000*1000*1000) {}
    else if VG_BOOL_CLO(arg, "--show-confl-seg",      show_confl_seg) {
       DRD_(set_show_conflicting_segments)(show_confl_seg);
    }
@@ -177,6 +182,10 @@ static Bool DRD_(process_cmd_line_option)(const HChar* arg)
    }
    if (segment_merge_interval != -1)
       DRD_(thread_set_segment_merge_interval)(segment_merge_interval);
+   if (sample_percent != -1)
+      DRD_(set_sample_percent)(sample_percent);
+   if (sample_epoch != -1)
+      DRD_(set_sample_epoch)(sample_epoch);
    if (trace_address) {
       const Addr addr = VG_(strtoll16)(trace_address, 0);
       DRD_(start_tracing_address_range)(addr, addr + 1, False);
@@ -211,6 +220,10 @@ static void DRD_(print_usage)(void)
 "                              pthread_cond_signal() where the mutex associated\n"
 "                              with the signal via pthread_cond_wait() is not\n"
 "                              locked at the time the signal is sent [yes].\n"
+"    --sample-percent=<n>      Only check the memory accesses of about n%%\n"
+"                              of the code for data races [100].\n"
+"    --sample-epoch=<n>        Select other code to be checked every time n\n"
+"                              superblocks have been executed [1000000].\n"
 "    --segment-merging=yes|no  Controls segment merging [yes].\n"
 "        Segment merging is an algorithm to limit memory usage of the\n"
 "        data race detection algorithm. Disabling segment merging may\n"
@@ -755,6 +768,7 @@ static void drd_start_client_code(const ThreadId tid, const ULong bbs_done)
 {
    tl_assert(tid == VG_(get_running_tid)());
    DRD_(thread_set_vg_running_tid)(tid);
+   DRD_(update_sample_slots)(bbs_done);
 }
 
 static void DRD_(fini)(Int exitcode)
@@ -775,6 +789,10 @@ static void DRD_(fini)(Int exitcode)
                    "confl set: %llu full updates and %llu partial updates;\n",
                    DRD_(thread_get_compute_conflict_set_count)(),
                    pu);
+      VG_(message)(Vg_UserMsg,
+                   "           %llu incremental updates after a context"
+                   " switch,\n",
+                   DRD_(thread_get_restore_conflict_set_count)());
       VG_(message)(Vg_UserMsg,
                    "           %llu partial updates during segment creation,\n",
                    pu_seg_cr);
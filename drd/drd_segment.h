@@ -47,6 +47,8 @@ typedef struct segment
    DrdThreadId        tid;
    /** Reference count: number of pointers that point to this segment. */
    int                refcnt;
+   /** Creation sequence number, unique for each segment. */
+   ULong              serial;
    /** Stack trace of the first instruction of the segment. */
    ExeContext*        stacktrace;
    /** Vector clock associated with the segment. */
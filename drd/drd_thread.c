@@ -47,6 +47,9 @@ static void thread_append_segment(const DrdThreadId tid, Segment* const sg);
 static void thread_discard_segment(const DrdThreadId tid, Segment* const sg);
 static void thread_compute_conflict_set(struct bitmap** conflict_set,
                                         const DrdThreadId tid);
+static void thread_save_conflict_set(const DrdThreadId tid);
+static Bool thread_restore_conflict_set(const DrdThreadId tid);
+static void thread_invalidate_saved_conflict_sets(void);
 static Bool thread_conflict_set_up_to_date(const DrdThreadId tid);
 
 
@@ -55,12 +58,20 @@ static Bool thread_conflict_set_up_to_date(const DrdThreadId tid);
 static ULong    s_context_switch_count;
 static ULong    s_discard_ordered_segments_count;
 static ULong    s_compute_conflict_set_count;
+static ULong    s_restore_conflict_set_count;
 static ULong    s_update_conflict_set_count;
 static ULong    s_update_conflict_set_new_sg_count;
 static ULong    s_update_conflict_set_sync_count;
 static ULong    s_update_conflict_set_join_count;
 static ULong    s_conflict_set_bitmap_creation_count;
 static ULong    s_conflict_set_bitmap2_creation_count;
+/**
+ * Saved conflict sets are only valid if they have been saved at or after this
+ * context switch count.
+ */
+static ULong    s_saved_conflict_sets_valid_from;
+/** Number of segments created when the last conflict set was saved. */
+static ULong    s_saved_conflict_set_sg_created;
 static ThreadId s_vg_running_tid  = VG_INVALID_THREADID;
 DrdThreadId     DRD_(g_drd_running_tid) = DRD_INVALID_THREADID;
 ThreadInfo*     DRD_(g_threadinfo);
@@ -211,8 +222,11 @@ static DrdThreadId DRD_(VgThreadIdToNewDrdThreadId)(const ThreadId tid)
          DRD_(g_threadinfo)[i].bind_guard_flag = 0;
 #endif /* VGO_solaris */
 
+         DRD_(g_threadinfo)[i].switched_out_at = 0;
+
          tl_assert(DRD_(g_threadinfo)[i].sg_first == NULL);
          tl_assert(DRD_(g_threadinfo)[i].sg_last == NULL);
+         tl_assert(DRD_(g_threadinfo)[i].saved_conflict_set == NULL);
 
          tl_assert(DRD_(IsValidDrdThreadId)(i));
 
@@ -544,6 +558,12 @@ void DRD_(thread_delete)(const DrdThreadId tid, const Bool detached)
       tl_assert(!DRD_(g_threadinfo)[tid].detached_posix_thread);
    DRD_(g_threadinfo)[tid].sg_first = NULL;
    DRD_(g_threadinfo)[tid].sg_last = NULL;
+   if (DRD_(g_threadinfo)[tid].saved_conflict_set) {
+      DRD_(bm_delete)(DRD_(g_threadinfo)[tid].saved_conflict_set);
+      DRD_(g_threadinfo)[tid].saved_conflict_set = NULL;
+   }
+   /* The saved conflict sets may contain accesses of the deleted segments. */
+   thread_invalidate_saved_conflict_sets();
 
    tl_assert(!DRD_(IsValidDrdThreadId)(tid));
 }
@@ -773,7 +793,9 @@ void DRD_(thread_set_vg_running_tid)(const ThreadId vg_tid)
 
 /**
  * Update s_vg_running_tid, DRD_(g_drd_running_tid) and recalculate the
- * conflict set.
+ * conflict set. The conflict set of the thread that is switched out is saved
+ * such that it can be brought up to date incrementally when that thread is
+ * scheduled again.
  */
 void DRD_(thread_set_running_tid)(const ThreadId vg_tid,
                                   const DrdThreadId drd_tid)
@@ -792,10 +814,14 @@ void DRD_(thread_set_running_tid)(const ThreadId vg_tid,
                       DRD_(g_drd_running_tid), drd_tid,
                       DRD_(sg_get_segments_alive_count)());
       }
+      if (DRD_(g_drd_running_tid) != DRD_INVALID_THREADID)
+         thread_save_conflict_set(DRD_(g_drd_running_tid));
       s_vg_running_tid = vg_tid;
       DRD_(g_drd_running_tid) = drd_tid;
-      thread_compute_conflict_set(&DRD_(g_conflict_set), drd_tid);
+      if (!thread_restore_conflict_set(drd_tid))
+         thread_compute_conflict_set(&DRD_(g_conflict_set), drd_tid);
       s_context_switch_count++;
+      tl_assert(thread_conflict_set_up_to_date(drd_tid));
    }
 
    tl_assert(s_vg_running_tid != VG_INVALID_THREADID);
@@ -1197,6 +1223,7 @@ void DRD_(thread_combine_vc_join)(DrdThreadId joiner, DrdThreadId joinee)
    } else {
       DRD_(vc_combine)(DRD_(thread_get_vc)(joiner),
                        DRD_(thread_get_vc)(joinee));
+      thread_invalidate_saved_conflict_sets();
    }
 
    thread_discard_ordered_segments();
@@ -1284,10 +1311,16 @@ void DRD_(thread_stop_using_mem)(const Addr a1, const Addr a2)
 {
    Segment* p;
 
+   unsigned i;
+
    for (p = DRD_(g_sg_list); p; p = p->g_next)
       DRD_(bm_clear)(DRD_(sg_bm)(p), a1, a2);
 
    DRD_(bm_clear)(DRD_(g_conflict_set), a1, a2);
+
+   for (i = 0; i < DRD_N_THREADS; i++)
+      if (DRD_(g_threadinfo)[i].saved_conflict_set)
+         DRD_(bm_clear)(DRD_(g_threadinfo)[i].saved_conflict_set, a1, a2);
 }
 
 /** Specify whether memory loads should be recorded. */
@@ -1553,6 +1586,131 @@ static void thread_compute_conflict_set(struct bitmap** conflict_set,
    }
 }
 
+/**
+ * Save the conflict set of thread tid, which is being switched out. The saved
+ * conflict set remains usable as long as the vector clock of this thread
+ * does not change and as long as the vector clock of no segment that existed
+ * at the time of saving is modified in place.
+ */
+static void thread_save_conflict_set(const DrdThreadId tid)
+{
+   ThreadInfo* const ti = &DRD_(g_threadinfo)[tid];
+
+   tl_assert(0 <= (int)tid && tid < DRD_N_THREADS
+             && tid != DRD_INVALID_THREADID);
+
+   ti->switched_out_at = s_context_switch_count;
+
+   if (!DRD_(IsValidDrdThreadId)(tid) || !ti->sg_last
+       || !DRD_(g_conflict_set))
+      return;
+
+   tl_assert(ti->saved_conflict_set == NULL);
+   ti->saved_conflict_set = DRD_(g_conflict_set);
+   ti->saved_conflict_set_sg = ti->sg_last->serial;
+   ti->saved_conflict_set_sg_created = DRD_(sg_get_segments_created_count)();
+   s_saved_conflict_set_sg_created = ti->saved_conflict_set_sg_created;
+   DRD_(g_conflict_set) = NULL;
+}
+
+/**
+ * Make the conflict set that was saved when thread tid was switched out the
+ * conflict set of the running thread, and bring it up to date by merging the
+ * segments that have been created or that received memory accesses since.
+ * Segments that already existed are ordered in the same way with respect to
+ * the last segment of thread tid as when the conflict set was saved, since
+ * the vector clock of neither changed. Segment merging preserves the
+ * ordering with respect to the last segment of every thread, hence it does
+ * not invalidate the saved conflict set either.
+ *
+ * @return True if the conflict set has been restored and False if it has to
+ *   be recomputed.
+ */
+static Bool thread_restore_conflict_set(const DrdThreadId tid)
+{
+   ThreadInfo* const ti = &DRD_(g_threadinfo)[tid];
+   struct bitmap* const saved = ti->saved_conflict_set;
+   Segment* p;
+   unsigned j;
+
+   tl_assert(0 <= (int)tid && tid < DRD_N_THREADS
+             && tid != DRD_INVALID_THREADID);
+   tl_assert(tid == DRD_(g_drd_running_tid));
+
+   if (!saved)
+      return False;
+
+   ti->saved_conflict_set = NULL;
+   if (DRD_(g_conflict_set))
+      DRD_(bm_delete)(DRD_(g_conflict_set));
+   DRD_(g_conflict_set) = saved;
+
+   p = ti->sg_last;
+   if (ti->switched_out_at < s_saved_conflict_sets_valid_from
+       || !p || p->serial != ti->saved_conflict_set_sg)
+      return False;
+
+   s_restore_conflict_set_count++;
+   s_conflict_set_bitmap_creation_count
+      -= DRD_(bm_get_bitmap_creation_count)();
+   s_conflict_set_bitmap2_creation_count
+      -= DRD_(bm_get_bitmap2_creation_count)();
+
+   if (s_trace_conflict_set)
+      VG_(message)(Vg_DebugMsg,
+                   "restoring conflict set for thread %u\n", tid);
+
+   /*
+    * Only segments created after the conflict set was saved and the segment
+    * that was the last segment of a thread at that time can have been
+    * modified since. The latter only if that thread has been running.
+    */
+   for (j = 0; j < DRD_N_THREADS; j++) {
+      const ThreadInfo* const tj = &DRD_(g_threadinfo)[j];
+      Bool has_run;
+      Segment* q;
+
+      if (j == tid || !DRD_(IsValidDrdThreadId)(j))
+         continue;
+
+      has_run = tj->switched_out_at > ti->switched_out_at;
+      for (q = tj->sg_last; q; q = q->thr_prev) {
+         const Bool is_new = q->serial > ti->saved_conflict_set_sg_created;
+
+         if (!is_new && !has_run)
+            break;
+         if (!DRD_(vc_lte)(&q->vc, &p->vc)
+             && !DRD_(vc_lte)(&p->vc, &q->vc)) {
+            if (s_trace_conflict_set) {
+               HChar* str;
+
+               str = DRD_(vc_aprint)(&q->vc);
+               VG_(message)(Vg_DebugMsg,
+                            "conflict set: [%u] merging segment %s\n",
+                            j, str);
+               VG_(free)(str);
+            }
+            DRD_(bm_merge2)(DRD_(g_conflict_set), DRD_(sg_bm)(q));
+         }
+         if (!is_new)
+            break;
+      }
+   }
+
+   s_conflict_set_bitmap_creation_count
+      += DRD_(bm_get_bitmap_creation_count)();
+   s_conflict_set_bitmap2_creation_count
+      += DRD_(bm_get_bitmap2_creation_count)();
+
+   return True;
+}
+
+/** Prevent that any of the saved conflict sets is restored. */
+static void thread_invalidate_saved_conflict_sets(void)
+{
+   s_saved_conflict_sets_valid_from = s_context_switch_count + 1;
+}
+
 /**
  * Update the conflict set after the vector clock of thread tid has been
  * updated from old_vc to its current value, either because a new segment has
@@ -1584,6 +1742,15 @@ void DRD_(thread_update_conflict_set)(const DrdThreadId tid,
    new_vc = DRD_(thread_get_vc)(tid);
    tl_assert(DRD_(vc_lte)(old_vc, new_vc));
 
+   /*
+    * The vector clock of the last segment of thread tid has been modified in
+    * place. If that segment already existed when a conflict set was saved,
+    * that conflict set can no longer be brought up to date incrementally.
+    */
+   if (DRD_(g_threadinfo)[tid].sg_last->serial
+       <= s_saved_conflict_set_sg_created)
+      thread_invalidate_saved_conflict_sets();
+
    DRD_(bm_unmark)(DRD_(g_conflict_set));
 
    for (j = 0; j < DRD_N_THREADS; j++)
@@ -1686,6 +1853,15 @@ ULong DRD_(thread_get_compute_conflict_set_count)(void)
    return s_compute_conflict_set_count;
 }
 
+/**
+ * Return how many times the conflict set has been brought up to date
+ * incrementally after a context switch instead of being recomputed.
+ */
+ULong DRD_(thread_get_restore_conflict_set_count)(void)
+{
+   return s_restore_conflict_set_count;
+}
+
 /** Return how many times the conflict set has been updated partially. */
 ULong DRD_(thread_get_update_conflict_set_count)(void)
 {
@@ -101,6 +101,17 @@ typedef struct
     * thread is fully created. Then the creator thread lives its own life again.
     */
    DrdThreadId creator_thread;
+   /**
+    * Conflict set of this thread, saved when it was switched out. Is NULL
+    * while the thread is running and if nothing has been saved.
+    */
+   struct bitmap* saved_conflict_set;
+   /** Context switch count at the time this thread was last switched out. */
+   ULong     switched_out_at;
+   /** Serial number of sg_last at the time the conflict set was saved. */
+   ULong     saved_conflict_set_sg;
+   /** Number of segments created at the time the conflict set was saved. */
+   ULong     saved_conflict_set_sg_created;
 
 #if defined(VGO_solaris)
    Int       bind_guard_flag; /**< Bind flag from the runtime linker. */
@@ -207,6 +218,7 @@ ULong DRD_(thread_get_context_switch_count)(void);
 ULong DRD_(thread_get_report_races_count)(void);
 ULong DRD_(thread_get_discard_ordered_segments_count)(void);
 ULong DRD_(thread_get_compute_conflict_set_count)(void);
+ULong DRD_(thread_get_restore_conflict_set_count)(void);
 ULong DRD_(thread_get_update_conflict_set_count)(void);
 ULong DRD_(thread_get_update_conflict_set_new_sg_count)(void);
 ULong DRD_(thread_get_update_conflict_set_sync_count)(void);
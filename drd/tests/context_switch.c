@@ -0,0 +1,53 @@
+/*
+ * Threads that yield the CPU many times without synchronizing with each
+ * other, such that their vector clocks do not change between context
+ * switches. Each thread modifies its own data, such that the conflict set of
+ * each thread holds the accesses of all other threads.
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+
+#define NTHREADS 4
+#define NYIELDS  200
+
+
+static int s_data[NTHREADS][16];
+
+
+static void* thread_func(void* arg)
+{
+  const int n = *(int*)arg;
+  int i, j;
+
+  for (i = 0; i < NYIELDS; i++)
+  {
+    for (j = 0; j < 16; j++)
+      s_data[n][j] += i;
+    sched_yield();
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  pthread_t tid[NTHREADS];
+  int arg[NTHREADS];
+  int i;
+
+  for (i = 0; i < NTHREADS; i++)
+  {
+    arg[i] = i;
+    assert(pthread_create(&tid[i], 0, thread_func, &arg[i]) == 0);
+  }
+  for (i = 0; i < NTHREADS; i++)
+    assert(pthread_join(tid[i], 0) == 0);
+
+  fprintf(stderr, "Done.\n");
+
+  return 0;
+}
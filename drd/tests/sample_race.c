@@ -0,0 +1,38 @@
+/*
+ * Test that sampling memory accesses does not hide a race that is repeated
+ * over many sampling epochs: two threads increment a shared counter without
+ * synchronization. Since the code to be checked is only selected again when
+ * a thread starts running, each thread yields after every increment.
+ */
+
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+
+static volatile int s_counter;
+
+
+static void* thread_func(void* arg)
+{
+  int i;
+
+  for (i = 0; i < 2000; i++)
+  {
+    s_counter++;
+    sched_yield();
+  }
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  pthread_t tid;
+
+  pthread_create(&tid, NULL, thread_func, NULL);
+  thread_func(NULL);
+  pthread_join(tid, NULL);
+  fprintf(stderr, "Done.\n");
+  return 0;
+}
@@ -319,6 +319,63 @@ void bm_test3(const int outer_loop_step, const int inner_loop_step)
   DRD_(bm_delete)(bm1);
 }
 
+/**
+ * Test whether the conflict checks and bm_merge2() are consistent with
+ * bm_has_1(), including for the second level bitmap summaries.
+ */
+void bm_test4(void)
+{
+  const Addr lb = make_address(3, 0) - 3 * BITS_PER_UWORD;
+  const Addr ub = make_address(3, 0) + 3 * BITS_PER_UWORD;
+  struct bitmap* bm1;
+  struct bitmap* bm2;
+  struct bitmap* bm3;
+  Addr a, b;
+
+  bm1 = DRD_(bm_new)();
+  bm2 = DRD_(bm_new)();
+  bm3 = DRD_(bm_new)();
+  for (a = lb; a < ub; a += 7)
+    DRD_(bm_access_load_1)(bm1, a);
+  for (a = lb + 3; a < ub; a += 11 * ADDR_GRANULARITY)
+    DRD_(bm_access_store_1)(bm2, a);
+  DRD_(bm_access_range_load)(bm1, make_address(4, 0), make_address(5, 0));
+  DRD_(bm_merge2)(bm3, bm1);
+  DRD_(bm_merge2)(bm3, bm2);
+
+  for (a = lb; a < ub; a++)
+  {
+    assert(DRD_(bm_has_1)(bm3, a, eLoad) == DRD_(bm_has_1)(bm1, a, eLoad));
+    assert(DRD_(bm_has_1)(bm3, a, eStore) == DRD_(bm_has_1)(bm2, a, eStore));
+  }
+  assert(DRD_(bm_has_any_load)(bm3, make_address(5, 0) - 1,
+                               make_address(5, 0)));
+
+  for (a = lb; a < ub; a++)
+  {
+    Bool has_r = False, has_w = False;
+
+    for (b = a + 1; b <= ub && b <= a + BITS_PER_UWORD + 5; b++)
+    {
+      has_r |= DRD_(bm_has_1)(bm3, b - 1, eLoad);
+      has_w |= DRD_(bm_has_1)(bm3, b - 1, eStore);
+      assert(DRD_(bm_load_has_conflict_with)(bm3, a, b) == has_w);
+      assert(DRD_(bm_store_has_conflict_with)(bm3, a, b) == (has_r || has_w));
+      assert(DRD_(bm_has_any_load)(bm3, a, b) == has_r);
+      assert(DRD_(bm_has_any_store)(bm3, a, b) == has_w);
+      assert(DRD_(bm_has_any_access)(bm3, a, b) == (has_r || has_w));
+    }
+  }
+
+  DRD_(bm_clear)(bm3, lb, ub);
+  assert(! DRD_(bm_has_any_access)(bm3, lb, ub));
+  assert(! DRD_(bm_store_has_conflict_with)(bm3, lb, ub));
+
+  DRD_(bm_delete)(bm3);
+  DRD_(bm_delete)(bm2);
+  DRD_(bm_delete)(bm1);
+}
+
 int main(int argc, char** argv)
 {
   int outer_loop_step = ADDR_GRANULARITY;
@@ -352,6 +409,7 @@ int main(int argc, char** argv)
   bm_test1();
   bm_test2();
   bm_test3(outer_loop_step, inner_loop_step);
+  bm_test4();
   DRD_(bm_module_cleanup)();
 
   fprintf(stderr, "End of DRD BM unit test.\n");
@@ -82,6 +82,16 @@ Bool  HG_(clo_delta_stacktrace) = False;
 
 UWord HG_(clo_conflict_cache_size) = 2000000;
 
+UWord HG_(clo_filter_lines) = 1024;
+
+UWord HG_(clo_filter_ways) = 1;
+
+UWord HG_(clo_filter_initial_gen) = 0;
+
+UWord HG_(clo_sample_percent) = 100;
+
+ULong HG_(clo_sample_epoch) = 1000000;
+
 UWord HG_(clo_sanity_flags) = 0;
 
 Bool  HG_(clo_free_is_write) = False;
@@ -110,6 +110,28 @@ extern Bool  HG_(clo_delta_stacktrace);
    amd 10 million.  Default is 1 million. */
 extern UWord HG_(clo_conflict_cache_size);
 
+/* Geometry of the per-thread filter that removes memory references
+   known not to change the shadow state nor to report a race.  The
+   filter has HG_(clo_filter_lines) lines of 32 bytes, grouped into sets
+   of HG_(clo_filter_ways) lines.  Both must be powers of 2.  Defaults
+   are 1024 lines, direct mapped (1 way). */
+extern UWord HG_(clo_filter_lines);
+extern UWord HG_(clo_filter_ways);
+
+/* Generation a new filter starts in.  Only for testing: setting it
+   just short of 2^32 makes the filter's generation counter wrap
+   around soon after startup.  Default is 0. */
+extern UWord HG_(clo_filter_initial_gen);
+
+/* Sampling of memory references.  When HG_(clo_sample_percent) is
+   below 100, memory references are only race-checked in roughly that
+   percentage of the superblocks.  Which superblocks are checked
+   changes every HG_(clo_sample_epoch) executed superblocks.
+   Synchronisation events are always tracked.  Default is 100, that is,
+   no sampling. */
+extern UWord HG_(clo_sample_percent);
+extern ULong HG_(clo_sample_epoch);
+
 /* Sanity check level.  This is an or-ing of
    SCE_{THREADS,LOCKS,BIGRANGE,ACCESS,LAOG}. */
 extern UWord HG_(clo_sanity_flags);
@@ -1438,8 +1438,12 @@ void evhH__pre_thread_releases_lock ( Thread* thr,
 static Thread *current_Thread      = NULL,
               *current_Thread_prev = NULL;
 
+static void hg_update_sample_slots ( ULong nDisp ); /* fwds */
+
 static void evh__start_client_code ( ThreadId tid, ULong nDisp ) {
    if (0) VG_(printf)("start %d %llu\n", (Int)tid, nDisp);
+   if (HG_(clo_sample_percent) < 100)
+      hg_update_sample_slots( nDisp );
    tl_assert(current_Thread == NULL);
    current_Thread = map_threads_lookup( tid );
    tl_assert(current_Thread != NULL);
@@ -4727,6 +4731,61 @@ static void instrument_mem_access ( IRSB*   sbOut,
 }
 
 
+/* Sampling (--sample-percent < 100).  Each superblock is hashed on
+   its guest address to one of N_SAMPLE_SLOTS slots.  The instrumented
+   code loads the slot's flag at the start of the superblock and uses
+   it as a guard on all memory access helper calls in the superblock.
+   At the start of each epoch, a different subset of the slots is
+   enabled, so that over time all code gets checked, without any
+   retranslation. */
+#define N_SAMPLE_SLOTS 4096
+
+static UChar hg_sample_slots[N_SAMPLE_SLOTS];
+static ULong hg_sample_epoch     = ~0ULL;
+static UWord stats__sample_epochs = 0;
+
+static void hg_update_sample_slots ( ULong nDisp )
+{
+   const ULong epoch = nDisp / HG_(clo_sample_epoch);
+
+   if (LIKELY(epoch == hg_sample_epoch))
+      return;
+   hg_sample_epoch = epoch;
+   stats__sample_epochs++;
+   VG_(select_sample_slots)(hg_sample_slots, N_SAMPLE_SLOTS, epoch,
+                            HG_(clo_sample_percent));
+}
+
+/* Returns an Ity_I1 atom which is True if the superblock starting at
+   guest address BASE is sampled in the current epoch, or NULL if
+   sampling is disabled. */
+static IRExpr* mk_sample_guard ( IRSB* sbOut, Addr base )
+{
+   UInt    slot;
+   IRTemp  flag, res;
+
+   if (HG_(clo_sample_percent) >= 100)
+      return NULL;
+
+   slot = VG_(sample_slot)(base, N_SAMPLE_SLOTS);
+   flag = newIRTemp(sbOut->tyenv, Ity_I8);
+   res  = newIRTemp(sbOut->tyenv, Ity_I1);
+   addStmtToIRSB(sbOut,
+                 assign(flag,
+                        IRExpr_Load(
+#                          if defined(VG_BIGENDIAN)
+                           Iend_BE,
+#                          else
+                           Iend_LE,
+#                          endif
+                           Ity_I8,
+                           mkIRExpr_HWord((HWord)&hg_sample_slots[slot]))));
+   addStmtToIRSB(sbOut,
+                 assign(res, binop(Iop_CmpNE8, mkexpr(flag),
+                                   IRExpr_Const(IRConst_U8(0)))));
+   return mkexpr(res);
+}
+
 /* Figure out if GA is a guest code address in the dynamic linker, and
    if so return True.  Otherwise (and in case of any doubt) return
    False.  (sidedly safe w/ False as the safe value) */
@@ -4772,6 +4831,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
    IRStmt* st;
    Bool    inLDSO = False;
    Addr    inLDSOmask4K = 1; /* mismatches on first check */
+   IRExpr* sampled; /* guard for sampling, or NULL if not sampling */
 
    // Set to True when SP must be fixed up when taking a stack trace for the
    // mem accesses in the rest of the instruction
@@ -4814,6 +4874,8 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
    cia = st->Ist.IMark.addr;
    st = NULL;
 
+   sampled = mk_sample_guard(bbOut, vge->base[0]);
+
    for (/*use current i*/; i < bbIn->stmts_used; i++) {
       st = bbIn->stmts[i];
       tl_assert(st);
@@ -4905,7 +4967,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                      * sizeofIRType(typeOfIRExpr(bbIn->tyenv, cas->dataLo)),
                   False/*!isStore*/, fixupSP_needed,
                   hWordTy_szB, goff_SP, goff_SP_s1,
-                  NULL/*no-guard*/
+                  sampled
                );
             }
             break;
@@ -4926,7 +4988,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                      sizeofIRType(dataTy),
                      False/*!isStore*/, fixupSP_needed,
                      hWordTy_szB, goff_SP, goff_SP_s1,
-                     NULL/*no-guard*/
+                     sampled
                   );
                }
             } else {
@@ -4944,7 +5006,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                   sizeofIRType(typeOfIRExpr(bbIn->tyenv, st->Ist.Store.data)),
                   True/*isStore*/, fixupSP_needed,
                   hWordTy_szB, goff_SP, goff_SP_s1,
-                  NULL/*no-guard*/
+                  sampled
                );
             }
             break;
@@ -4958,7 +5020,10 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
             instrument_mem_access( bbOut, addr, sizeofIRType(type),
                                    True/*isStore*/, fixupSP_needed,
                                    hWordTy_szB,
-                                   goff_SP, goff_SP_s1, sg->guard );
+                                   goff_SP, goff_SP_s1,
+                                   sampled
+                                      ? mk_And1(bbOut, sampled, sg->guard)
+                                      : sg->guard );
             break;
          }
 
@@ -4972,7 +5037,10 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
             instrument_mem_access( bbOut, addr, sizeofIRType(type),
                                    False/*!isStore*/, fixupSP_needed,
                                    hWordTy_szB,
-                                   goff_SP, goff_SP_s1, lg->guard );
+                                   goff_SP, goff_SP_s1,
+                                   sampled
+                                      ? mk_And1(bbOut, sampled, lg->guard)
+                                      : lg->guard );
             break;
          }
 
@@ -4986,7 +5054,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                      sizeofIRType(data->Iex.Load.ty),
                      False/*!isStore*/, fixupSP_needed,
                      hWordTy_szB, goff_SP, goff_SP_s1,
-                     NULL/*no-guard*/
+                     sampled
                   );
                }
             }
@@ -5008,7 +5076,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                         bbOut, d->mAddr, dataSize,
                         False/*!isStore*/, fixupSP_needed,
                         hWordTy_szB, goff_SP, goff_SP_s1,
-                        NULL/*no-guard*/
+                        sampled
                      );
                   }
                }
@@ -5018,7 +5086,7 @@ IRSB* hg_instrument ( VgCallbackClosure* closure,
                         bbOut, d->mAddr, dataSize,
                         True/*isStore*/, fixupSP_needed,
                         hWordTy_szB, goff_SP, goff_SP_s1,
-                        NULL/*no-guard*/
+                        sampled
                      );
                   }
                }
@@ -5779,6 +5847,11 @@ Bool hg_handle_client_request ( ThreadId tid, UWord* args, UWord* ret)
 /*--- Setup                                                    ---*/
 /*----------------------------------------------------------------*/
 
+static Bool is_power_of_2 ( UWord n )
+{
+   return n != 0 && (n & (n - 1)) == 0;
+}
+
 static Bool hg_process_cmd_line_option ( const HChar* arg )
 {
    const HChar* tmp_str;
@@ -5806,6 +5879,24 @@ static Bool hg_process_cmd_line_option ( const HChar* arg )
    else if VG_BINT_CLO(arg, "--conflict-cache-size",
                        HG_(clo_conflict_cache_size), 10*1000, 150*1000*1000) {}
 
+   else if VG_BINT_CLO(arg, "--filter-lines",
+                       HG_(clo_filter_lines), 16, 1024*1024) {
+      if (!is_power_of_2(HG_(clo_filter_lines)))
+         VG_(fmsg_bad_option)(arg, "must be a power of 2\n");
+   }
+   else if VG_BINT_CLO(arg, "--filter-ways",
+                       HG_(clo_filter_ways), 1, 16) {
+      if (!is_power_of_2(HG_(clo_filter_ways)))
+         VG_(fmsg_bad_option)(arg, "must be a power of 2\n");
+   }
+   else if VG_BINT_CLO(arg, "--filter-initial-gen",
+                       HG_(clo_filter_initial_gen), 0, 0xFFFFFFFFULL) {}
+
+   else if VG_BINT_CLO(arg, "--sample-percent",
+                       HG_(clo_sample_percent), 1, 100) {}
+   else if VG_BINT_CLO(arg, "--sample-epoch",
+                       HG_(clo_sample_epoch), 1000, 1000*1000*1000) {}
+
    /* "stuvwx" --> stuvwx (binary) */
    else if VG_STR_CLO(arg, "--hg-sanity-flags", tmp_str) {
       Int j;
@@ -5865,6 +5956,14 @@ static void hg_print_usage ( void )
 "        yes: derive a stacktrace from the previous stacktrace\n"
 "          if there was no call/return or similar instruction\n"
 "    --conflict-cache-size=N   size of 'full' history cache [2000000]\n"
+"    --filter-lines=N          nr of 32 byte lines in the per-thread\n"
+"                              access filter (power of 2) [1024]\n"
+"    --filter-ways=N           associativity of the access filter\n"
+"                              (power of 2) [1]\n"
+"    --sample-percent=N        race-check memory accesses in only\n"
+"                              about N%% of the code [100]\n"
+"    --sample-epoch=N          change the sampled code every N\n"
+"                              executed superblocks [1000000]\n"
 "    --check-stack-refs=no|yes race-check reads and writes on the\n"
 "                              main stack and thread stacks? [yes]\n"
 "    --ignore-thread-creation=yes|no Ignore activities during thread\n"
@@ -5892,6 +5991,8 @@ static void hg_print_debug_usage ( void )
                "ranges >= %d bytes\n", SCE_BIGRANGE_T);
    VG_(printf)("       000010   at lock/unlock events\n");
    VG_(printf)("       000001   at thread create/join events\n");
+   VG_(printf)("    --filter-initial-gen=<number> generation the access "
+               "filters start in [0]\n");
    VG_(printf)(
 "    --vts-pruning=never|auto|always [auto]\n"
 "       never:   is never done (may cause big space leaks in Helgrind)\n"
@@ -5959,6 +6060,8 @@ static void hg_print_stats (void)
                stats__lockN_releases
               );
    VG_(printf)("   sanity checks: %'8lu\n", stats__sanity_checks);
+   if (HG_(clo_sample_percent) < 100)
+      VG_(printf)("   sample epochs: %'8lu\n", stats__sample_epochs);
 
    VG_(printf)("\n");
    libhb_shutdown(True); // This in fact only print stats.
@@ -6026,6 +6129,10 @@ static void hg_post_clo_init ( void )
 {
    Thr* hbthr_root;
 
+   if (HG_(clo_filter_ways) > HG_(clo_filter_lines))
+      VG_(fmsg_bad_option)("--filter-ways",
+                           "must not be larger than --filter-lines\n");
+
    if (HG_(clo_delta_stacktrace) && VG_(clo_vex_control).guest_chase) {
       if (VG_(clo_verbosity) >= 2)
          VG_(message)(Vg_UserMsg,
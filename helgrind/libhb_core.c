@@ -212,18 +212,24 @@ typedef
 /////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////
 
-// baseline: 5, 9
+/* The filter is set-associative: it holds fi_num_sets sets of
+   fi_ways lines each, both powers of two fixed at libhb_init from
+   --filter-lines and --filter-ways.  With the default single way it
+   is the direct mapped filter it always was. */
 #define FI_LINE_SZB_LOG2  5
-#define FI_NUM_LINES_LOG2 10
 
 #define FI_LINE_SZB       (1 << FI_LINE_SZB_LOG2)
-#define FI_NUM_LINES      (1 << FI_NUM_LINES_LOG2)
 
 #define FI_TAG_MASK        (~(Addr)(FI_LINE_SZB - 1))
 #define FI_GET_TAG(_a)     ((_a) & FI_TAG_MASK)
 
-#define FI_GET_LINENO(_a)  ( ((_a) >> FI_LINE_SZB_LOG2) \
-                             & (Addr)(FI_NUM_LINES-1) )
+static UWord fi_num_sets  = 0;
+static UWord fi_ways      = 0;
+static UWord fi_ways_log2 = 0;
+
+/* Index of way 0 of the set that holds 'a'. */
+#define FI_GET_SET_BASE(_a)  ( ( ((_a) >> FI_LINE_SZB_LOG2) \
+                                 & (Addr)(fi_num_sets-1) ) << fi_ways_log2 )
 
 
 /* In the lines, each 8 bytes are treated individually, and are mapped
@@ -242,17 +248,32 @@ typedef
 */
 
 /* tags are separated from lines.  tags are Addrs and are
-   the base address of the line. */
+   the base address of the line.
+
+   A line is only valid if its generation equals the filter's current
+   generation.  This makes clearing the whole filter (which happens at
+   every synchronisation event) a matter of bumping 'gen'.  The lines
+   are only really invalidated when 'gen' wraps around. */
 typedef
    struct {
       UShort u16s[FI_LINE_SZB / 8]; /* each UShort covers 8 bytes */
    }
    FiLine;
 
+/* A line's tag and generation are kept together, so that checking
+   for a hit touches a single cache line. */
+typedef
+   struct {
+      Addr tag;
+      UInt gen;
+   }
+   FiTag;
+
 typedef
    struct {
-      Addr   tags[FI_NUM_LINES];
-      FiLine lines[FI_NUM_LINES];
+      UInt    gen;
+      FiTag*  tags;  /* [fi_num_sets * fi_ways] */
+      FiLine* lines; /* [fi_num_sets * fi_ways] */
    }
    Filter;
 
@@ -3572,28 +3593,111 @@ static Thr* VtsID__findFirst_notLEQ ( VtsID vi1, VtsID vi2 )
 //                                                     //
 /////////////////////////////////////////////////////////
 
+static UWord stats__filter_fills       = 0; // # lines (re)filled
+static UWord stats__filter_evictions   = 0; // # valid lines evicted
+static UWord stats__filter_clears      = 0; // # calls to Filter__clear
+static UWord stats__filter_clears_full = 0; // # clears on gen wraparound
+
+static Filter* Filter__new ( const HChar* cc )
+{
+   UWord   n  = fi_num_sets * fi_ways;
+   Filter* fi = HG_(zalloc)( cc, sizeof(Filter) );
+   fi->tags  = HG_(zalloc)( cc, n * sizeof(FiTag) );
+   fi->lines = HG_(zalloc)( cc, n * sizeof(FiLine) );
+   /* All tags and generations are zero.  In generation 0 that makes
+      the lines for address 0 valid, which is harmless since they
+      record no accesses.  HG_(clo_filter_initial_gen) is only
+      changed to test the wraparound in Filter__clear. */
+   fi->gen   = (UInt)HG_(clo_filter_initial_gen);
+   return fi;
+}
+
+static void Filter__delete ( Filter* fi )
+{
+   HG_(free)( fi->tags );
+   HG_(free)( fi->lines );
+   HG_(free)( fi );
+}
+
 /* Forget everything we know -- clear the filter and let everything
    through.  This needs to be as fast as possible, since it is called
    every time the running thread changes, and every time a thread's
-   vector clocks change, which can be quite frequent.  The obvious
-   fast way to do this is simply to stuff in tags which we know are
-   not going to match anything, since they're not aligned to the start
-   of a line. */
+   vector clocks change, which can be quite frequent.  Starting a new
+   generation invalidates all the lines at once; only when the
+   generation counter wraps around do the lines have to be visited. */
 static void Filter__clear ( Filter* fi, const HChar* who )
 {
-   UWord i;
    if (0) VG_(printf)("  Filter__clear(%p, %s)\n", fi, who);
-   for (i = 0; i < FI_NUM_LINES; i += 8) {
-      fi->tags[i+0] = 1; /* impossible value -- cannot match */
-      fi->tags[i+1] = 1;
-      fi->tags[i+2] = 1;
-      fi->tags[i+3] = 1;
-      fi->tags[i+4] = 1;
-      fi->tags[i+5] = 1;
-      fi->tags[i+6] = 1;
-      fi->tags[i+7] = 1;
+   stats__filter_clears++;
+   fi->gen++;
+   if (UNLIKELY(fi->gen == 0)) {
+      UWord i;
+      stats__filter_clears_full++;
+      for (i = 0; i < fi_num_sets * fi_ways; i++)
+         fi->tags[i].gen = 0;
+      fi->gen = 1;
+   }
+}
+
+static inline Bool Filter__valid ( Filter* fi, UWord ix, Addr atag )
+{
+   return fi->tags[ix].tag == atag && fi->tags[ix].gen == fi->gen;
+}
+
+static inline void Filter__move ( Filter* fi, UWord dst, UWord src )
+{
+   fi->tags[dst]  = fi->tags[src];
+   fi->lines[dst] = fi->lines[src];
+}
+
+/* Returns the index of the line holding 'atag', or -1 if the filter
+   does not hold it.  If 'promote', a hit in another way is swapped
+   into way 0, so that the ways of a set stay in approximate MRU
+   order. */
+static inline Word Filter__find ( Filter* fi, Addr atag, Bool promote )
+{
+   UWord base = FI_GET_SET_BASE(atag);
+   UWord w;
+   if (LIKELY( Filter__valid(fi, base, atag) ))
+      return base;
+   for (w = 1; w < fi_ways; w++) {
+      UWord ix = base + w;
+      if (Filter__valid(fi, ix, atag)) {
+         if (promote) {
+            FiTag  t = fi->tags[ix];
+            FiLine l = fi->lines[ix];
+            Filter__move(fi, ix, base);
+            fi->tags[base]  = t;
+            fi->lines[base] = l;
+            return base;
+         }
+         return ix;
+      }
    }
-   tl_assert(i == FI_NUM_LINES);
+   return -1;
+}
+
+/* Miss: claim way 0 of the set for 'atag', with an empty line.  The
+   other lines are pushed down up to the first stale one, or else the
+   last (least recently used) line of the set is evicted. */
+static inline UWord Filter__fill ( Filter* fi, Addr atag )
+{
+   UWord base = FI_GET_SET_BASE(atag);
+   UWord w;
+   UWord i;
+   stats__filter_fills++;
+   for (w = 0; w < fi_ways - 1; w++)
+      if (fi->tags[base + w].gen != fi->gen)
+         break;
+   if (w == fi_ways - 1 && fi->tags[base + w].gen == fi->gen)
+      stats__filter_evictions++;
+   for (; w > 0; w--)
+      Filter__move(fi, base + w, base + w - 1);
+   fi->tags[base].tag = atag;
+   fi->tags[base].gen = fi->gen;
+   for (i = 0; i < FI_LINE_SZB / 8; i++)
+      fi->lines[base].u16s[i] = 0;
+   return base;
 }
 
 /* Clearing an arbitrary range in the filter.  Unfortunately
@@ -3602,15 +3706,13 @@ static void Filter__clear ( Filter* fi, const HChar* who )
 static void Filter__clear_1byte ( Filter* fi, Addr a )
 {
    Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-   UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-   FiLine* line   = &fi->lines[lineno];
+   Word    ix     = Filter__find(fi, atag, False);
    UWord   loff   = (a - atag) / 8;
    UShort  mask   = 0x3 << (2 * (a & 7));
    /* mask is C000, 3000, 0C00, 0300, 00C0, 0030, 000C or 0003 */
-   if (LIKELY( fi->tags[lineno] == atag )) {
+   if (LIKELY( ix >= 0 )) {
       /* hit.  clear the bits. */
-      UShort  u16  = line->u16s[loff];
-      line->u16s[loff] = u16 & ~mask; /* clear them */
+      fi->lines[ix].u16s[loff] &= ~mask;
    } else {
       /* miss.  The filter doesn't hold this address, so ignore. */
    }
@@ -3619,11 +3721,10 @@ static void Filter__clear_1byte ( Filter* fi, Addr a )
 static void Filter__clear_8bytes_aligned ( Filter* fi, Addr a )
 {
    Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-   UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-   FiLine* line   = &fi->lines[lineno];
+   Word    ix     = Filter__find(fi, atag, False);
    UWord   loff   = (a - atag) / 8;
-   if (LIKELY( fi->tags[lineno] == atag )) {
-      line->u16s[loff] = 0;
+   if (LIKELY( ix >= 0 )) {
+      fi->lines[ix].u16s[loff] = 0;
    } else {
     /* miss.  The filter doesn't hold this address, so ignore. */
    }
@@ -3655,150 +3756,118 @@ static void Filter__clear_range_SLOW ( Filter* fi, Addr a, UWord len )
    }
 }
 
+/* Clear the bits of the bytes [a, end] that fall in the line starting
+   at ltag. */
+static inline void Filter__clear_in_line ( FiLine* line, Addr ltag,
+                                           Addr a, Addr end )
+{
+   UWord lo = a <= ltag ? 0 : a - ltag;
+   UWord hi = end - ltag >= FI_LINE_SZB - 1 ? FI_LINE_SZB - 1 : end - ltag;
+   UWord i;
+   for (i = lo / 8; i <= hi / 8; i++) {
+      UWord  blo  = i == lo / 8 ? lo & 7 : 0;
+      UWord  bhi  = i == hi / 8 ? hi & 7 : 7;
+      /* 2 bits for each of the bytes blo..bhi */
+      UShort mask = (UShort)((0xFFFF >> (2 * (7 - bhi))) & (0xFFFF << (2 * blo)));
+      line->u16s[i] &= ~mask;
+   }
+}
+
 static void Filter__clear_range ( Filter* fi, Addr a, UWord len )
 {
 #  if CHECK_ZSM > 0
    /* We check the below more complex algorithm with the simple one.
       This check is very expensive : we do first the slow way on a
-      copy of the data, then do it the fast way. On RETURN, we check
-      the two values are equal. */
-   Filter fi_check = *fi;
-   Filter__clear_range_SLOW(&fi_check, a, len);
-#  define RETURN goto check_and_return
-#  else
-#  define RETURN return
+      copy of the data, then do it the fast way, and check the two
+      results are equal. */
+   UWord   n_check  = fi_num_sets * fi_ways;
+   Filter* fi_check = Filter__new( "libhb.Filter__clear_range.1" );
+   fi_check->gen = fi->gen;
+   VG_(memcpy)(fi_check->tags,  fi->tags,  n_check * sizeof(FiTag));
+   VG_(memcpy)(fi_check->lines, fi->lines, n_check * sizeof(FiLine));
+   Filter__clear_range_SLOW(fi_check, a, len);
 #  endif
 
-   Addr    begtag = FI_GET_TAG(a);       /* tag of range begin */
-
-   Addr    end = a + len - 1;
-   Addr    endtag = FI_GET_TAG(end); /* tag of range end. */
-
-   UWord rlen = len; /* remaining length to clear */
-
-   Addr    c = a; /* Current position we are clearing. */
-   UWord   clineno = FI_GET_LINENO(c); /* Current lineno we are clearing */
-   FiLine* cline; /* Current line we are clearing */
-   UWord   cloff; /* Current offset in line we are clearing, when clearing
-                     partial lines. */
-
-   UShort u16;
-
-   STATIC_ASSERT (FI_LINE_SZB == 32);
-   // Below assumes filter lines are 32 bytes
-
-   if (LIKELY(fi->tags[clineno] == begtag)) {
-      /* LIKELY for the heavy caller VG_(unknown_SP_update). */
-      /* First filter line matches begtag.
-         If c is not at the filter line begin, the below will clear
-         the filter line bytes starting from c. */
-      cline = &fi->lines[clineno];
-      cloff = (c - begtag) / 8;
-
-      /* First the byte(s) needed to reach 8-alignment */
-      if (UNLIKELY(!VG_IS_8_ALIGNED(c))) {
-         /* hiB is the nr of bytes (higher addresses) from c to reach
-            8-aligment. */
-         UWord hiB = 8 - (c & 7);
-         /* Compute 2-bit/byte mask representing hiB bytes [c..c+hiB[
-            mask is  C000 , F000, FC00, FF00, FFC0, FFF0 or FFFC for the byte
-            range    7..7   6..7  5..7  4..7  3..7  2..7    1..7 */
-         UShort mask = 0xFFFF << (16 - 2*hiB);
-
-         u16  = cline->u16s[cloff];
-         if (LIKELY(rlen >= hiB)) {
-            cline->u16s[cloff] = u16 & ~mask; /* clear all hiB from c */
-            rlen -= hiB;
-            c += hiB;
-            cloff += 1;
-         } else {
-            /* Only have the bits for rlen bytes bytes. */
-            mask = mask & ~(0xFFFF << (16 - 2*(hiB-rlen)));
-            cline->u16s[cloff] = u16 & ~mask; /* clear rlen bytes from c. */
-            RETURN;  // We have cleared all what we can.
+   if (LIKELY(len > 0)) {
+      Addr  end    = a + len - 1;
+      Addr  begtag = FI_GET_TAG(a);   /* tag of range begin */
+      Addr  endtag = FI_GET_TAG(end); /* tag of range end */
+      UWord nlines = ((endtag - begtag) >> FI_LINE_SZB_LOG2) + 1;
+
+      if (LIKELY(nlines <= fi_num_sets)) {
+         /* Look up each line of the range.  This is the usual case,
+            and the one for the heavy caller VG_(unknown_SP_update). */
+         Addr  c;
+         UWord n;
+         for (n = 0, c = begtag; n < nlines; n++, c += FI_LINE_SZB) {
+            Word ix = Filter__find(fi, c, False);
+            if (ix >= 0)
+               Filter__clear_in_line(&fi->lines[ix], c, a, end);
          }
-      }
-      /* c is now 8 aligned. Clear by 8 aligned bytes, 
-         till c is filter-line aligned */
-      while (!VG_IS_32_ALIGNED(c) && rlen >= 8) {
-         cline->u16s[cloff] = 0;
-         c += 8;
-         rlen -= 8;
-         cloff += 1;
-      }
-   } else {
-      c = begtag + FI_LINE_SZB;
-      if (c > end)
-         RETURN;   // We have cleared all what we can.
-      rlen -= c - a;
-   }
-   // We have changed c, so re-establish clineno.
-   clineno = FI_GET_LINENO(c);
-
-   if (rlen >= FI_LINE_SZB) {
-      /* Here, c is filter line-aligned. Clear all full lines that
-         overlap with the range starting at c, made of a full lines */
-      UWord nfull = rlen / FI_LINE_SZB;
-      UWord full_len = nfull * FI_LINE_SZB;
-      rlen -= full_len;
-      if (nfull > FI_NUM_LINES)
-         nfull = FI_NUM_LINES; // no need to check several times the same entry.
-
-      for (UWord n = 0; n < nfull; n++) {
-         if (UNLIKELY(address_in_range(fi->tags[clineno], c, full_len))) {
-            cline = &fi->lines[clineno];
-            cline->u16s[0] = 0;
-            cline->u16s[1] = 0;
-            cline->u16s[2] = 0;
-            cline->u16s[3] = 0;
-            STATIC_ASSERT (4 == sizeof(cline->u16s)/sizeof(cline->u16s[0]));
+      } else {
+         /* The range is larger than the filter: rather visit each
+            valid filter line once. */
+         UWord ix;
+         for (ix = 0; ix < fi_num_sets * fi_ways; ix++) {
+            if (fi->tags[ix].gen == fi->gen
+                && address_in_range(fi->tags[ix].tag, begtag,
+                                    endtag - begtag + FI_LINE_SZB))
+               Filter__clear_in_line(&fi->lines[ix], fi->tags[ix].tag,
+                                     a, end);
          }
-         clineno++;
-         if (UNLIKELY(clineno == FI_NUM_LINES))
-            clineno = 0;
       }
-
-      c += full_len;
-      clineno = FI_GET_LINENO(c);
    }
 
-   if (CHECK_ZSM) {
-      tl_assert(VG_IS_8_ALIGNED(c));
-      tl_assert(clineno == FI_GET_LINENO(c));
-   }
+#  if CHECK_ZSM > 0
+   tl_assert (VG_(memcmp)(fi_check->lines, fi->lines,
+                          n_check * sizeof(FiLine)) == 0);
+   Filter__delete(fi_check);
+#  endif
+}
 
-   /* Do the last filter line, if it was not cleared as a full filter line */
-   if (UNLIKELY(rlen > 0) && fi->tags[clineno] == endtag) {
-      cline = &fi->lines[clineno];
-      cloff = (c - endtag) / 8;
-      if (CHECK_ZSM) tl_assert(FI_GET_TAG(c) == endtag);
+/* Set the bits of 'mask' in group 'loff' of line 'ix', returning
+   True if they were all set already. */
+static inline Bool Filter__check_and_set ( Filter* fi, UWord ix,
+                                           UWord loff, UShort mask )
+{
+   FiLine* line = &fi->lines[ix];
+   UShort  u16  = line->u16s[loff];
+   Bool    ok   = (u16 & mask) == mask; /* all mask bits set? */
+   line->u16s[loff] = u16 | mask; /* set them */
+   return ok;
+}
 
-      /* c is 8 aligned. Clear by 8 aligned bytes, till we have less than
-         8 bytes. */
-      while (rlen >= 8) {
-         cline->u16s[cloff] = 0;
-         c += 8;
-         rlen -= 8;
-         cloff += 1;
-      }
-      /* Then the remaining byte(s) */
-      if (rlen > 0) {
-         /* nr of bytes from c to reach end. */
-         UWord loB = rlen;
-         /* Compute mask representing loB bytes [c..c+loB[ :
-            mask is 0003, 000F, 003F, 00FF, 03FF, 0FFF or 3FFF */
-         UShort mask = 0xFFFF >> (16 - 2*loB);
-
-         u16  = cline->u16s[cloff];
-         cline->u16s[cloff] = u16 & ~mask; /* clear all loB from c */
-      }
+/* Filter__ok_to_skip when way 0 of the set does not hold 'atag'.  Kept
+   out of line so that the way 0 check inlines into each handler. */
+static __attribute__((noinline))
+Bool Filter__ok_to_skip_other_ways ( Filter* fi, Addr atag,
+                                     UWord loff, UShort mask )
+{
+   Word ix = Filter__find(fi, atag, True);
+   if (ix >= 0) {
+      /* hit in another way, now promoted to way 0. */
+      return Filter__check_and_set(fi, ix, loff, mask);
+   } else {
+      /* miss.  claim a line and re-use it. */
+      fi->lines[Filter__fill(fi, atag)].u16s[loff] = mask;
+      return False;
    }
+}
 
-#  if CHECK_ZSM > 0
-   check_and_return:
-   tl_assert (VG_(memcmp)(&fi_check, fi, sizeof(fi_check)) == 0);
-#  endif
-#  undef RETURN
+/* Look up 'a' and set the bits of 'mask' in its 8-byte group.
+   Returns True if those bits were all already set, meaning the
+   access can be skipped.  On a miss, the line is (re)claimed for
+   'a' and False is returned. */
+static inline Bool Filter__ok_to_skip ( Filter* fi, Addr a, UShort mask )
+{
+   Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
+   UWord   base   = FI_GET_SET_BASE(atag);
+   UWord   loff   = (a - atag) / 8;
+   if (LIKELY( Filter__valid(fi, base, atag) )) {
+      /* hit.  check line and update. */
+      return Filter__check_and_set(fi, base, loff, mask);
+   }
+   return Filter__ok_to_skip_other_ways(fi, atag, loff, mask);
 }
 
 /* ------ Read handlers for the filter. ------ */
@@ -3807,112 +3876,29 @@ static inline Bool Filter__ok_to_skip_crd64 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_8_ALIGNED(a) ))
       return False;
-   { 
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xAAAA;
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort u16  = line->u16s[loff];
-        Bool   ok   = (u16 & mask) == mask; /* all R bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   return Filter__ok_to_skip( fi, a, 0xAAAA ); /* all R bits */
 }
 
 static inline Bool Filter__ok_to_skip_crd32 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_4_ALIGNED(a) ))
       return False;
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xAA << (2 * (a & 4)); /* 0xAA00 or 0x00AA */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 4 x R bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is AA00 or 00AA */
+   return Filter__ok_to_skip( fi, a, 0xAA << (2 * (a & 4)) );
 }
 
 static inline Bool Filter__ok_to_skip_crd16 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_2_ALIGNED(a) ))
       return False;
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xA << (2 * (a & 6));
-     /* mask is A000, 0A00, 00A0 or 000A */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 2 x R bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is A000, 0A00, 00A0 or 000A */
+   return Filter__ok_to_skip( fi, a, 0xA << (2 * (a & 6)) );
 }
 
 static inline Bool Filter__ok_to_skip_crd08 ( Filter* fi, Addr a )
 {
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0x2 << (2 * (a & 7));
-     /* mask is 8000, 2000, 0800, 0200, 0080, 0020, 0008 or 0002 */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 1 x R bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is 8000, 2000, 0800, 0200, 0080, 0020, 0008 or 0002 */
+   return Filter__ok_to_skip( fi, a, 0x2 << (2 * (a & 7)) );
 }
 
 
@@ -3922,112 +3908,29 @@ static inline Bool Filter__ok_to_skip_cwr64 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_8_ALIGNED(a) ))
       return False;
-   { 
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xFFFF;
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort u16  = line->u16s[loff];
-        Bool   ok   = (u16 & mask) == mask; /* all R & W bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   return Filter__ok_to_skip( fi, a, 0xFFFF ); /* all R & W bits */
 }
 
 static inline Bool Filter__ok_to_skip_cwr32 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_4_ALIGNED(a) ))
       return False;
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xFF << (2 * (a & 4)); /* 0xFF00 or 0x00FF */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 4 x R & W bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is FF00 or 00FF */
+   return Filter__ok_to_skip( fi, a, 0xFF << (2 * (a & 4)) );
 }
 
 static inline Bool Filter__ok_to_skip_cwr16 ( Filter* fi, Addr a )
 {
    if (UNLIKELY( !VG_IS_2_ALIGNED(a) ))
       return False;
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0xF << (2 * (a & 6));
-     /* mask is F000, 0F00, 00F0 or 000F */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 2 x R & W bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is F000, 0F00, 00F0 or 000F */
+   return Filter__ok_to_skip( fi, a, 0xF << (2 * (a & 6)) );
 }
 
 static inline Bool Filter__ok_to_skip_cwr08 ( Filter* fi, Addr a )
 {
-   {
-     Addr    atag   = FI_GET_TAG(a);     /* tag of 'a' */
-     UWord   lineno = FI_GET_LINENO(a);  /* lineno for 'a' */
-     FiLine* line   = &fi->lines[lineno];
-     UWord   loff   = (a - atag) / 8;
-     UShort  mask   = 0x3 << (2 * (a & 7));
-     /* mask is C000, 3000, 0C00, 0300, 00C0, 0030, 000C or 0003 */
-     if (LIKELY( fi->tags[lineno] == atag )) {
-        /* hit.  check line and update. */
-        UShort  u16  = line->u16s[loff];
-        Bool    ok   = (u16 & mask) == mask; /* 1 x R bits set? */
-        line->u16s[loff] = u16 | mask; /* set them */
-        return ok;
-     } else {
-        /* miss.  nuke existing line and re-use it. */
-        UWord   i;
-        fi->tags[lineno] = atag;
-        for (i = 0; i < FI_LINE_SZB / 8; i++)
-           line->u16s[i] = 0;
-        line->u16s[loff] = mask;
-        return False;
-     }
-   }
+   /* mask is C000, 3000, 0C00, 0300, 00C0, 0030, 000C or 0003 */
+   return Filter__ok_to_skip( fi, a, 0x3 << (2 * (a & 7)) );
 }
 
 
@@ -4080,7 +3983,7 @@ static Thr* Thr__new ( void )
    thr->viW = VtsID_INVALID;
    thr->llexit_done = False;
    thr->joinedwith_done = False;
-   thr->filter = HG_(zalloc)( "libhb.Thr__new.2", sizeof(Filter) );
+   thr->filter = Filter__new( "libhb.Thr__new.2" );
    if (HG_(clo_history_level) == 1)
       thr->local_Kws_n_stacks
          = VG_(newXA)( HG_(zalloc),
@@ -6587,6 +6490,16 @@ Thr* libhb_init (
    main_get_stacktrace   = get_stacktrace;
    main_get_EC           = get_EC;
 
+   /* Filter geometry, for all threads. */
+   tl_assert(HG_(clo_filter_ways) >= 1);
+   tl_assert(HG_(clo_filter_lines) >= HG_(clo_filter_ways));
+   fi_ways     = HG_(clo_filter_ways);
+   fi_num_sets = HG_(clo_filter_lines) / HG_(clo_filter_ways);
+   while (((UWord)1 << fi_ways_log2) < fi_ways)
+      fi_ways_log2++;
+   tl_assert(fi_num_sets * fi_ways == HG_(clo_filter_lines));
+   tl_assert((fi_num_sets & (fi_num_sets - 1)) == 0);
+
    // No need to initialise hg_wordfm.
    // No need to initialise hg_wordset.
 
@@ -6729,6 +6642,17 @@ void libhb_shutdown ( Bool show_stats )
                   (Word)sizeof(LineZ),
                   (Word)N_LINE_ARANGE);
 
+      VG_(printf)("%s","\n");
+      VG_(printf)("  filter: %'lu sets x %'lu ways\n",
+                  fi_num_sets, fi_ways);
+      VG_(printf)("  filter: %'14lu accesses, %'14lu skipped (%lu%%)\n",
+                  stats__f_ac, stats__f_sk,
+                  stats__f_ac == 0 ? 0 : (100 * stats__f_sk) / stats__f_ac);
+      VG_(printf)("  filter: %'14lu fills,    %'14lu evictions\n",
+                  stats__filter_fills, stats__filter_evictions);
+      VG_(printf)("  filter: %'14lu clears    (%'lu full)\n",
+                  stats__filter_clears, stats__filter_clears_full);
+
       VG_(printf)("%s","\n");
 
       VG_(printf)("   libhb: %'13llu msmcread  (%'llu dragovers)\n",
@@ -6908,7 +6832,7 @@ void libhb_async_exit ( Thr* thr )
    /* free up Filter and local_Kws_n_stacks (well, actually not the
       latter ..) */
    tl_assert(thr->filter);
-   HG_(free)(thr->filter);
+   Filter__delete(thr->filter);
    thr->filter = NULL;
 
    /* Tell the VTS mechanism this thread has exited, so it can
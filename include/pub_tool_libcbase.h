@@ -235,6 +235,18 @@ extern Int VG_(log2_64)( ULong x );
 // non-NULL, it uses and updates whatever pSeed points at.
 extern UInt VG_(random) ( /*MOD*/UInt* pSeed );
 
+/* Sampling of code, as done by the race detectors' --sample-percent.
+   Each superblock is hashed on its guest address to one of n_slots
+   slots (a power of 2) by VG_(sample_slot), and its memory accesses
+   are only checked while the flag of that slot is set.
+   VG_(select_sample_slots) sets the flags of a different subset of
+   about percent percent of the slots for each epoch, so that over time
+   all code gets checked.  Every slot is equally likely to be chosen;
+   there is no bias towards rarely executed code. */
+extern UInt VG_(sample_slot) ( Addr base, UInt n_slots );
+extern void VG_(select_sample_slots) ( /*OUT*/UChar* slots, UInt n_slots,
+                                       ULong epoch, UInt percent );
+
 /* Update a running Adler-32 checksum with the bytes buf[0..len-1] and
    return the updated checksum. If buf is NULL, this function returns
    the required initial value for the checksum. An Adler-32 checksum is
@@ -203,6 +203,10 @@ extern MsFile* VG_(XT_massif_open)(const HChar* outfilename,
 
 extern void VG_(XT_massif_close)(MsFile* fp);
 
+/* Write out what was printed so far to a file opened with
+   VG_(XT_massif_open), e.g. after each snapshot when streaming. */
+extern void VG_(XT_massif_flush)(MsFile* fp);
+
 typedef 
    struct {
       int snapshot_n; // starting at 0.
@@ -401,6 +401,7 @@ static double clo_peak_inaccuracy = 1.0;  // percentage
 static Int    clo_time_unit       = TimeI;
 static Int    clo_detailed_freq   = 10;
 static Int    clo_max_snapshots   = 100;
+static Time   clo_stream_interval = 0;    // 0 means: no streaming
 static const HChar* clo_massif_out_file = "massif.out.%p";
 
 static XArray* args_for_massif;
@@ -445,6 +446,9 @@ static Bool ms_process_cmd_line_option(const HChar* arg)
 
    else if VG_BINT_CLO(arg, "--max-snapshots",  clo_max_snapshots, 10, 1000) {}
 
+   else if VG_BINT_CLO(arg, "--stream-interval", clo_stream_interval,
+                       0, 0x7fffffffffffffffLL) {}
+
    else if VG_STR_CLO(arg, "--massif-out-file", clo_massif_out_file) {}
 
    else
@@ -470,6 +474,9 @@ static void ms_print_usage(void)
 "                              or heap bytes alloc'd/dealloc'd [i]\n"
 "    --detailed-freq=<N>       every Nth snapshot should be detailed [10]\n"
 "    --max-snapshots=<N>       maximum number of snapshots recorded [100]\n"
+"    --stream-interval=<t>     write each snapshot to the output file when\n"
+"                              taken, at least <t> time units apart;\n"
+"                              0 keeps snapshots in memory instead [0]\n"
 "    --massif-out-file=<file>  output file name [massif.out.%%p]\n"
    );
 }
@@ -695,6 +702,13 @@ static void sub_heap_xt(Xecu where, SizeT req_szB, Bool exclude_first_entry)
 // some (eg. half), and start taking them more slowly.  Once we hit the
 // limit again, we again cull and then take them even more slowly, and so
 // on.
+//
+// With --stream-interval, snapshots are instead taken at a fixed minimum
+// interval, and each one is written to the output file (and deleted)
+// right away.  So memory use does not depend on the run length, nothing
+// is culled, and the snapshots taken so far survive a crash.  Downsampling
+// for display is left to ms_print.  The peak is written as a detailed
+// snapshot when taken, and repeated at the end of the file as the peak.
 
 #define UNUSED_SNAPSHOT_TIME  -333  // A conspicuous negative number.
 
@@ -720,6 +734,9 @@ typedef
 static UInt      next_snapshot_i = 0;  // Index of where next snapshot will go.
 static Snapshot* snapshots;            // Array of snapshots.
 
+// Forward declaration.
+static void stream_snapshot(Snapshot* snapshot);
+
 static Bool is_snapshot_in_use(Snapshot* snapshot)
 {
    if (Unused == snapshot->kind) {
@@ -1114,6 +1131,15 @@ maybe_take_snapshot(SnapshotKind kind, const HChar* what)
    VERB_snapshot(2, what, next_snapshot_i);
    n_skipped_snapshots_since_last_snapshot = 0;
 
+   // When streaming, write the snapshot out and forget about it, so the
+   // array always stays empty and never needs culling.
+   if (clo_stream_interval > 0) {
+      stream_snapshot(snapshot);
+      delete_snapshot(snapshot);
+      earliest_possible_time_of_next_snapshot = my_time + clo_stream_interval;
+      return;
+   }
+
    // Cull the entries, if our snapshot table is full.
    next_snapshot_i++;
    if (clo_max_snapshots == next_snapshot_i) {
@@ -1909,6 +1935,90 @@ static void write_snapshots_array_to_file(void)
    VG_(free)(massif_out_file);
 }
 
+// The output file when streaming, opened when the first snapshot is taken.
+static MsFile* stream_fp = NULL;
+static HChar*  stream_file_name = NULL;
+static Int     n_streamed_snapshots = 0;
+static Bool    stream_disabled = False;   // Open failed, or forked child.
+
+// Which snapshot is the peak is only known at the end, so each new peak is
+// written as a detailed snapshot, and kept here.  stream_finish writes the
+// last one again, with the same number, as the peak.
+static Snapshot stream_peak = { .kind = Unused,
+                                .time = UNUSED_SNAPSHOT_TIME };
+static Int      stream_peak_n = -1;
+
+static void stream_snapshot(Snapshot* snapshot)
+{
+   if (stream_fp == NULL) {
+      if (stream_disabled) return;
+
+      // As in write_snapshots_array_to_file, expand the name as late as
+      // possible; a forked child gets a new file, see stream_atfork_child.
+      stream_file_name =
+         VG_(expand_file_name)("--massif-out-file", clo_massif_out_file);
+      stream_fp = VG_(XT_massif_open)(stream_file_name,
+                                      NULL,
+                                      args_for_massif,
+                                      TimeUnit_to_string(clo_time_unit));
+      if (stream_fp == NULL) {
+         stream_disabled = True;  // Error reported by VG_(XT_massif_open)
+         return;
+      }
+   }
+
+   if (Peak == snapshot->kind) {
+      snapshot->kind = Normal;
+      pp_snapshot(stream_fp, snapshot, n_streamed_snapshots);
+      delete_snapshot(&stream_peak);
+      stream_peak      = *snapshot;
+      stream_peak.kind = Peak;
+      stream_peak_n    = n_streamed_snapshots++;
+      clear_snapshot(snapshot, /*do_sanity_check*/True);
+   } else {
+      pp_snapshot(stream_fp, snapshot, n_streamed_snapshots++);
+   }
+   VG_(XT_massif_flush)(stream_fp);
+}
+
+static void stream_finish(void)
+{
+   if (stream_fp != NULL && is_snapshot_in_use(&stream_peak))
+      pp_snapshot(stream_fp, &stream_peak, stream_peak_n);
+   delete_snapshot(&stream_peak);
+   VG_(XT_massif_close)(stream_fp);
+   stream_fp = NULL;
+}
+
+static void stream_atfork_pre(ThreadId tid)
+{
+   // Don't let the child inherit buffered output.
+   VG_(XT_massif_flush)(stream_fp);
+}
+
+static void stream_atfork_child(ThreadId tid)
+{
+   HChar* child_file_name;
+
+   if (stream_fp == NULL) return;
+
+   // The file (offset) is shared with the parent, so the child has to use
+   // its own file.  Without %p in --massif-out-file, it would be the same
+   // one, so the child does not write snapshots at all.
+   VG_(XT_massif_close)(stream_fp);
+   stream_fp = NULL;
+   n_streamed_snapshots = 0;
+   delete_snapshot(&stream_peak);
+   stream_peak_n = -1;
+   child_file_name =
+      VG_(expand_file_name)("--massif-out-file", clo_massif_out_file);
+   if (VG_STREQ(child_file_name, stream_file_name))
+      stream_disabled = True;
+   VG_(free)(child_file_name);
+   VG_(free)(stream_file_name);
+   stream_file_name = NULL;
+}
+
 static void handle_snapshot_monitor_command (const HChar *filename,
                                              Bool detailed)
 {
@@ -1939,6 +2049,13 @@ static void handle_all_snapshots_monitor_command (const HChar *filename)
       return;
    }
 
+   if (clo_stream_interval > 0) {
+      VG_(gdb_printf)
+         ("error: with --stream-interval, all snapshots are in %s\n",
+          stream_file_name ? stream_file_name : "the output file");
+      return;
+   }
+
    write_snapshots_to_file ((filename == NULL) ? 
                             "massif.vgdb.out" : filename,
                             snapshots, next_snapshot_i);
@@ -2043,7 +2160,11 @@ static void ms_fini(Int exit_status)
    ms_xtmemory_report(VG_(clo_xtree_memory_file), True);
 
    // Output.
-   write_snapshots_array_to_file();
+   if (clo_stream_interval > 0) {
+      stream_finish();
+   } else {
+      write_snapshots_array_to_file();
+   }
 
    if (VG_(clo_stats))
       ms_print_stats();
@@ -2163,6 +2284,9 @@ static void ms_post_clo_init(void)
    }
    sanity_check_snapshots_array();
 
+   if (clo_stream_interval > 0)
+      VG_(atfork)(stream_atfork_pre, NULL, stream_atfork_child);
+
    if (VG_(clo_xtree_memory) == Vg_XTMemory_Full)
       // Activate full xtree memory profiling.
       // As massif already filters one top function, use as filter
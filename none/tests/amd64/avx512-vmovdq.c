@@ -0,0 +1,59 @@
+// The EVEX-encoded forms of VMOVDQA32/64 and VMOVDQU32/64, without
+// masking, at 128 and 256 bits.  The memory forms check that the
+// "compressed" disp8 is scaled by the vector length.
+
+#include"avx_tests.h"
+
+GEN_test_RandM(VMOVDQA32_6F_256,
+               "vmovdqa32 %%ymm7, %%ymm8",
+               "vmovdqa32 (%%rsi), %%ymm8")
+
+GEN_test_RandM(VMOVDQA64_7F_256,
+               "%{store%} vmovdqa64 %%ymm9, %%ymm7",
+               "vmovdqa64 %%ymm8, 32(%%rsi)")
+
+GEN_test_RandM(VMOVDQU64_6F_256,
+               "vmovdqu64 %%ymm6, %%ymm9",
+               "vmovdqu64 64(%%rsi), %%ymm7")
+
+GEN_test_RandM(VMOVDQU32_7F_256,
+               "%{store%} vmovdqu32 %%ymm8, %%ymm6",
+               "vmovdqu32 %%ymm9, 96(%%rsi)")
+
+GEN_test_RandM(VMOVDQA64_6F_128,
+               "vmovdqa64 %%xmm9, %%xmm8",
+               "vmovdqa64 48(%%rsi), %%xmm9")
+
+GEN_test_RandM(VMOVDQA32_7F_128,
+               "%{store%} vmovdqa32 %%xmm6, %%xmm7",
+               "vmovdqa32 %%xmm7, 16(%%rsi)")
+
+GEN_test_RandM(VMOVDQU32_6F_128,
+               "vmovdqu32 %%xmm8, %%xmm7",
+               "vmovdqu32 80(%%rsi), %%xmm8")
+
+GEN_test_RandM(VMOVDQU64_7F_128,
+               "%{store%} vmovdqu64 %%xmm7, %%xmm9",
+               "vmovdqu64 %%xmm8, 112(%%rsi)")
+
+// A negative disp8, and a disp8 with an index register.
+GEN_test_Monly(VMOVDQU64_NEG_DISP8,
+               "leaq 128(%%rsi), %%rax; vmovdqu64 -96(%%rax), %%ymm9")
+
+GEN_test_Monly(VMOVDQU32_SIB_DISP8,
+               "movq $4, %%rdx; vmovdqu32 32(%%rsi,%%rdx,8), %%ymm8")
+
+int main ( void )
+{
+   DO_D( VMOVDQA32_6F_256 );
+   DO_D( VMOVDQA64_7F_256 );
+   DO_D( VMOVDQU64_6F_256 );
+   DO_D( VMOVDQU32_7F_256 );
+   DO_D( VMOVDQA64_6F_128 );
+   DO_D( VMOVDQA32_7F_128 );
+   DO_D( VMOVDQU32_6F_128 );
+   DO_D( VMOVDQU64_7F_128 );
+   DO_D( VMOVDQU64_NEG_DISP8 );
+   DO_D( VMOVDQU32_SIB_DISP8 );
+   return 0;
+}
@@ -0,0 +1,151 @@
+/* Checks the condition code seen after a conditional branch to code
+   which starts by overwriting it (--vex-remove-dead-cc).  The first
+   part reads the flags with pushf at various branch destinations,
+   some of which overwrite the flags and some of which read them.  The
+   second part, given the argument "signals", checks the flags seen by
+   a signal handler interrupting the program at such a destination,
+   which are only guaranteed to be right without --vex-remove-dead-cc. */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+typedef  unsigned long long int  ULong;
+
+#define CC_MASK_OSZACP  0x8D5ULL
+
+/* Compare a with b, branch on the result, and run |head| on either
+   path, then read the flags. */
+#define GEN_test(_name, _head)                                   \
+   static void test_##_name ( ULong a, ULong b, ULong c, ULong d ) \
+   {                                                            \
+      ULong flags;                                              \
+      __asm__ __volatile__(                                     \
+         "cmpq %2, %1"  "\n\t"                                  \
+         "jne 1f"       "\n\t"                                  \
+         "nop"          "\n"                                    \
+         "1:"           "\n\t"                                  \
+         _head          "\n\t"                                  \
+         "pushfq"       "\n\t"                                  \
+         "popq %0"      "\n\t"                                  \
+         : /*OUT*/ "=&r"(flags), "+r"(a), "+r"(b), "+r"(d)      \
+         : /*IN*/  "r"(c)                                       \
+         : /*TRASH*/ "cc" );                                    \
+      printf("%-8s %016llx %016llx: %03llx %016llx\n", #_name,   \
+             a, c, flags & CC_MASK_OSZACP, d);                  \
+   }
+
+/* These overwrite the flags. */
+GEN_test(add,     "addq %4, %3")
+GEN_test(sub,     "subq %4, %3")
+GEN_test(cmp,     "cmpq %4, %3")
+GEN_test(movtest, "movq %4, %3 ; testq %3, %3")
+GEN_test(xor,     "xorl %k4, %k3")
+/* These read them. */
+GEN_test(adc,     "adcq %4, %3")
+GEN_test(inc,     "incq %3")
+GEN_test(setb,    "setb %b3")
+GEN_test(cmovl,   "cmovlq %4, %3")
+GEN_test(pushf,   "")
+
+static const ULong vals[] = {
+   0, 1, 3, 0x7fffffffffffffffULL, 0x8000000000000000ULL, ~0ULL
+};
+#define N_VALS (sizeof(vals) / sizeof(vals[0]))
+
+static void run_tests ( void )
+{
+   unsigned i, j;
+   for (i = 0; i < N_VALS; i++) {
+      for (j = 0; j < N_VALS; j++) {
+         test_add    (vals[i], vals[j], vals[j], vals[i]);
+         test_sub    (vals[i], vals[j], vals[j], vals[i]);
+         test_cmp    (vals[i], vals[j], vals[j], vals[i]);
+         test_movtest(vals[i], vals[j], vals[j], vals[i]);
+         test_xor    (vals[i], vals[j], vals[j], vals[i]);
+         test_adc    (vals[i], vals[j], vals[j], vals[i]);
+         test_inc    (vals[i], vals[j], vals[j], vals[i]);
+         test_setb   (vals[i], vals[j], vals[j], vals[i]);
+         test_cmovl  (vals[i], vals[j], vals[j], vals[i]);
+         test_pushf  (vals[i], vals[j], vals[j], vals[i]);
+      }
+   }
+}
+
+/* A loop which ends by comparing 3 with 5 and branching back to
+   cc_head, which starts with an add. */
+extern void cc_loop ( ULong n );
+extern char cc_head[];
+__asm__(
+"        .text\n"
+"        .globl cc_loop\n"
+"        .type cc_loop, @function\n"
+"cc_loop:\n"
+"        movq $3, %rsi\n"
+"        movq $5, %rdx\n"
+"        xorl %eax, %eax\n"
+"        .globl cc_head\n"
+"cc_head:\n"
+"        addq $1, %rax\n"
+"        subq $1, %rdi\n"
+"        jz 1f\n"
+"        cmpq %rdx, %rsi\n"
+"        jne cc_head\n"
+"        xorl %eax, %eax\n"
+"1:      ret\n"
+"        .size cc_loop, .-cc_loop\n"
+);
+
+static ULong expected_flags;
+static volatile int n_signals;
+static volatile int n_bad;
+
+static void handler ( int sig, siginfo_t* info, void* ucV )
+{
+   ucontext_t* uc = ucV;
+   n_signals++;
+   if (uc->uc_mcontext.gregs[REG_RIP] == (greg_t)cc_head
+       && (uc->uc_mcontext.gregs[REG_EFL] & CC_MASK_OSZACP)
+          != expected_flags)
+      n_bad++;
+}
+
+static void run_signals ( void )
+{
+   struct sigaction sa;
+   struct itimerval it;
+   ULong flags;
+
+   __asm__ __volatile__(
+      "movq $3, %%rsi ; movq $5, %%rdx ; cmpq %%rdx, %%rsi"  "\n\t"
+      "pushfq ; popq %0"
+      : "=r"(flags) : : "rsi", "rdx", "cc" );
+   expected_flags = flags & CC_MASK_OSZACP;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_sigaction = handler;
+   sa.sa_flags     = SA_SIGINFO | SA_RESTART;
+   sigaction(SIGALRM, &sa, NULL);
+
+   memset(&it, 0, sizeof(it));
+   it.it_interval.tv_usec = 1000;
+   it.it_value.tv_usec    = 1000;
+   setitimer(ITIMER_REAL, &it, NULL);
+   while (n_signals < 200)
+      cc_loop(100000);
+   memset(&it, 0, sizeof(it));
+   setitimer(ITIMER_REAL, &it, NULL);
+
+   printf("signals: %s\n", n_bad == 0 ? "flags ok" : "flags WRONG");
+}
+
+int main ( int argc, char** argv )
+{
+   run_tests();
+   if (argc > 1 && 0 == strcmp(argv[1], "signals"))
+      run_signals();
+   return 0;
+}
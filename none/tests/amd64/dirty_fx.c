@@ -0,0 +1,78 @@
+/* Checks that guest state read both before and after an insn done
+   with a dirty helper which writes it (FXRSTOR, CPUID) is read again
+   after the call, rather than the value read before being reused.
+   The IR optimiser relies on the guest state effects declared by the
+   call for this.  Each test is a single asm block, so that the reads
+   end up in the same superblock as the call. */
+
+#include <stdio.h>
+#include <string.h>
+
+typedef  unsigned long long int  ULong;
+
+static unsigned char fx_buf[512] __attribute__((aligned(16)));
+
+static ULong  xmm_a[2] __attribute__((aligned(16))) =
+   { 0x0123456789abcdefULL, 0x1111111111111111ULL };
+static ULong  xmm_b[2] __attribute__((aligned(16))) =
+   { 0xfedcba9876543210ULL, 0x2222222222222222ULL };
+static double st_a = 1.5, st_b = 2.5;
+
+static void test_fxrstor ( void )
+{
+   ULong  xmm_before, xmm_after;
+   double st_before, st_after;
+
+   /* Save a state with %xmm0 = xmm_b and %st(0) = st_b. */
+   __asm__ __volatile__(
+      "fninit"                    "\n\t"
+      "fldl %1"                   "\n\t"
+      "movdqa %2, %%xmm0"         "\n\t"
+      "fxsave %0"                 "\n\t"
+      "fstp %%st(0)"              "\n\t"
+      : "=m"(fx_buf) : "m"(st_b), "m"(xmm_b) : "xmm0", "st" );
+
+   /* Load xmm_a and st_a, read them, restore the saved state and read
+      them again. */
+   __asm__ __volatile__(
+      "fninit"                    "\n\t"
+      "fldl %5"                   "\n\t"
+      "movdqa %6, %%xmm0"         "\n\t"
+      "movq %%xmm0, %%rax"        "\n\t"
+      "movq %%rax, %0"            "\n\t"
+      "fstl %1"                   "\n\t"
+      "fxrstor %4"                "\n\t"
+      "movq %%xmm0, %%rax"        "\n\t"
+      "movq %%rax, %2"            "\n\t"
+      "fstl %3"                   "\n\t"
+      "fstp %%st(0)"              "\n\t"
+      : "=m"(xmm_before), "=m"(st_before), "=m"(xmm_after), "=m"(st_after)
+      : "m"(fx_buf), "m"(st_a), "m"(xmm_a)
+      : "rax", "xmm0", "st" );
+
+   printf("fxrstor: xmm0 %016llx -> %016llx, st0 %g -> %g\n",
+          xmm_before, xmm_after, st_before, st_after);
+}
+
+static void test_cpuid ( void )
+{
+   ULong before, after;
+
+   /* CPUID leaf 0 returns the highest leaf, which isn't 0, in %eax. */
+   __asm__ __volatile__(
+      "xorl %%eax, %%eax"         "\n\t"
+      "xorl %%ecx, %%ecx"         "\n\t"
+      "movq %%rax, %0"            "\n\t"
+      "cpuid"                     "\n\t"
+      "movq %%rax, %1"            "\n\t"
+      : "=m"(before), "=m"(after) : : "rax", "rbx", "rcx", "rdx" );
+
+   printf("cpuid: rax %s\n", before != after ? "changed" : "NOT CHANGED");
+}
+
+int main ( void )
+{
+   test_fxrstor();
+   test_cpuid();
+   return 0;
+}
@@ -0,0 +1,49 @@
+/* Runs code with conditional branches taken always, never and about
+   half of the time, which Vex turns into side exits of the enclosing
+   superblocks, so as to check that the translations behave the same
+   with and without --vex-hot-cold-split. */
+
+#include <stdio.h>
+
+typedef  unsigned long long int  ULong;
+
+static ULong step ( ULong x )
+{
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   return x;
+}
+
+__attribute__((noinline))
+static ULong mix ( ULong x, unsigned i )
+{
+   ULong r = x;
+   if (x & 1)              /* about half of the time */
+      r += i;
+   else
+      r -= 3 * i;
+   if ((x & 0xFFF) == 0)   /* rarely */
+      r ^= 0x5555;
+   if (i < 1000000000U)    /* always */
+      r = r * 5 + 1;
+   if (r == 0)             /* never */
+      r = 1;
+   return r;
+}
+
+int main ( void )
+{
+   ULong x = 88172645463325252ULL, acc = 0;
+   unsigned i, n_odd = 0, n_rare = 0;
+   for (i = 0; i < 1000000; i++) {
+      x = step(x);
+      if (x & 1)
+         n_odd++;
+      if ((x & 0xFFF) == 0)
+         n_rare++;
+      acc += mix(x, i);
+   }
+   printf("acc %016llx, %u odd, %u rare\n", acc, n_odd, n_rare);
+   return 0;
+}
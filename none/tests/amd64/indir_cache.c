@@ -0,0 +1,55 @@
+/* Check indirect calls and returns through sites with one, two and
+   many destinations, which exercise the inline caches of indirect
+   jumps as they are filled, and calls to generated code whose
+   translations are discarded and remade, which empties the cache
+   entries that point at them. */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "../../../include/valgrind.h"
+
+typedef int (*Fn)(int);
+
+static int f0 ( int x ) { return x + 1; }
+static int f1 ( int x ) { return x * 3; }
+static int f2 ( int x ) { return x ^ 0x55; }
+static int f3 ( int x ) { return x - 7; }
+
+static Fn fns[4] = { f0, f1, f2, f3 };
+
+/* Not inlined, so that each has its own indirect call site. */
+__attribute__((noinline)) static int call_a ( Fn f, int x ) { return f(x); }
+__attribute__((noinline)) static int call_b ( Fn f, int x ) { return f(x); }
+__attribute__((noinline)) static int call_c ( Fn f, int x ) { return f(x); }
+
+int main ( void )
+{
+   int i, k;
+   unsigned int mono = 0, poly2 = 0, mega = 0, jit = 0;
+
+   for (i = 0; i < 100000; i++) {
+      mono  = mono * 7 + call_a(fns[0], i);
+      poly2 = poly2 * 7 + call_b(fns[i & 1], i);
+      mega  = mega * 7 + call_c(fns[(i ^ (i >> 3)) & 3], i);
+   }
+   printf("mono %u poly2 %u mega %u\n", mono, poly2, mega);
+
+   /* movl $imm32, %eax; ret */
+   unsigned char* code = mmap(NULL, 4096, PROT_READ|PROT_WRITE|PROT_EXEC,
+                              MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+   if (code == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+   }
+   for (k = 0; k < 50; k++) {
+      code[0] = 0xB8;
+      memcpy(&code[1], &k, 4);
+      code[5] = 0xC3;
+      VALGRIND_DISCARD_TRANSLATIONS(code, 6);
+      for (i = 0; i < 1000; i++)
+         jit = jit * 3 + ((int(*)(void))code)();
+   }
+   printf("jit %u\n", jit);
+   return 0;
+}
@@ -0,0 +1,141 @@
+/* Check that the IR optimiser's folding of SIMD operations on
+   constants, and its simplification of SIMD operations on identical
+   operands, don't change results.  The constants are made with the
+   pxor and pcmpeqd idioms, which the front end turns into constant
+   vectors, and the rest of each sequence is in the same block so that
+   it can be folded. */
+
+#include <stdio.h>
+
+typedef unsigned char V128[16];
+
+static V128 in = { 0x01, 0x80, 0x7f, 0xff, 0x00, 0x12, 0x34, 0x56,
+                   0x9a, 0xbc, 0xde, 0xf0, 0x55, 0xaa, 0x00, 0xff };
+
+#define N_CONST 20
+#define N_IDENT 6
+
+static V128 out_const[N_CONST];
+static V128 out_ident[N_IDENT];
+
+static void show ( const char* name, int i, const V128 v )
+{
+   int j;
+   printf("%s %2d ", name, i);
+   for (j = 15; j >= 0; j--)
+      printf("%02x", v[j]);
+   printf("\n");
+}
+
+int main ( void )
+{
+   int i;
+
+   __asm__ __volatile__(
+      "pxor      %%xmm0, %%xmm0\n\t"      /* 0...0 */
+      "pcmpeqd   %%xmm1, %%xmm1\n\t"      /* 1...1 */
+
+      "movdqa    %%xmm1, %%xmm2\n\t"
+      "punpcklbw %%xmm0, %%xmm2\n\t"      /* 00ff00ff.. */
+      "movdqu    %%xmm2, 0(%0)\n\t"
+      "movdqa    %%xmm0, %%xmm3\n\t"
+      "punpckhwd %%xmm2, %%xmm3\n\t"
+      "movdqu    %%xmm3, 16(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "packsswb  %%xmm3, %%xmm4\n\t"
+      "movdqu    %%xmm4, 32(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "packuswb  %%xmm1, %%xmm4\n\t"
+      "movdqu    %%xmm4, 48(%0)\n\t"
+      "movdqa    %%xmm1, %%xmm4\n\t"
+      "packssdw  %%xmm2, %%xmm4\n\t"
+      "movdqu    %%xmm4, 64(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "pcmpgtb   %%xmm0, %%xmm4\n\t"      /* signed: 0xff < 0 */
+      "movdqu    %%xmm4, 80(%0)\n\t"
+      "movdqa    %%xmm0, %%xmm4\n\t"
+      "pcmpgtw   %%xmm2, %%xmm4\n\t"
+      "movdqu    %%xmm4, 96(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "pcmpeqb   %%xmm3, %%xmm4\n\t"
+      "movdqu    %%xmm4, 112(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "paddb     %%xmm1, %%xmm4\n\t"      /* 00+ff, ff+ff */
+      "movdqu    %%xmm4, 128(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "psubq     %%xmm1, %%xmm4\n\t"
+      "movdqu    %%xmm4, 144(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "pmaxsw    %%xmm1, %%xmm4\n\t"
+      "movdqu    %%xmm4, 160(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "pminub    %%xmm3, %%xmm4\n\t"
+      "movdqu    %%xmm4, 176(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "psllq     $8, %%xmm4\n\t"
+      "movdqu    %%xmm4, 192(%0)\n\t"
+      "movdqa    %%xmm3, %%xmm4\n\t"
+      "psrld     $16, %%xmm4\n\t"
+      "movdqu    %%xmm4, 208(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "psraw     $8, %%xmm4\n\t"
+      "movdqu    %%xmm4, 224(%0)\n\t"
+      "movdqa    %%xmm3, %%xmm4\n\t"
+      "punpckhqdq %%xmm1, %%xmm4\n\t"
+      "movdqu    %%xmm4, 240(%0)\n\t"
+      "movq      %%xmm3, %%xmm4\n\t"
+      "movdqu    %%xmm4, 256(%0)\n\t"
+      "movdqa    %%xmm2, %%xmm4\n\t"
+      "pandn     %%xmm3, %%xmm4\n\t"
+      "movdqu    %%xmm4, 272(%0)\n\t"
+      "movq      %%xmm2, %%rax\n\t"
+      "movq      %%rax, %%xmm4\n\t"
+      "movdqu    %%xmm4, 288(%0)\n\t"
+      "movdqa    %%xmm3, %%xmm4\n\t"
+      "pshufd    $0x1b, %%xmm4, %%xmm4\n\t"
+      "movdqu    %%xmm4, 304(%0)\n\t"
+      : : "r"(out_const) : "memory", "rax", "xmm0", "xmm1", "xmm2",
+                           "xmm3", "xmm4"
+   );
+
+   __asm__ __volatile__(
+      "movdqu    (%1), %%xmm0\n\t"        /* x */
+      "pcmpeqd   %%xmm1, %%xmm1\n\t"
+      "movdqa    %%xmm0, %%xmm2\n\t"
+      "pandn     %%xmm1, %%xmm2\n\t"      /* ~x */
+      "pandn     %%xmm1, %%xmm2\n\t"      /* ~~x */
+      "movdqu    %%xmm2, 0(%0)\n\t"
+      "movdqa    %%xmm0, %%xmm2\n\t"
+      "pmaxsw    %%xmm0, %%xmm2\n\t"
+      "pminub    %%xmm0, %%xmm2\n\t"
+      "movdqu    %%xmm2, 16(%0)\n\t"
+      "pshufd    $0x4e, %%xmm0, %%xmm3\n\t"
+      "movdqa    %%xmm0, %%xmm2\n\t"
+      "punpcklqdq %%xmm3, %%xmm2\n\t"
+      "movdqa    %%xmm3, %%xmm4\n\t"
+      "punpcklqdq %%xmm0, %%xmm4\n\t"
+      "punpckhqdq %%xmm4, %%xmm2\n\t"
+      "movdqu    %%xmm2, 32(%0)\n\t"
+      "movdqa    %%xmm0, %%xmm2\n\t"
+      "pand      %%xmm3, %%xmm2\n\t"
+      "por       %%xmm0, %%xmm2\n\t"      /* x | (x & y) */
+      "movdqu    %%xmm2, 48(%0)\n\t"
+      "movdqa    %%xmm0, %%xmm2\n\t"
+      "por       %%xmm3, %%xmm2\n\t"
+      "pand      %%xmm0, %%xmm2\n\t"      /* x & (x | y) */
+      "movdqu    %%xmm2, 64(%0)\n\t"
+      "movq      %%xmm0, %%rax\n\t"
+      "pextrw    $7, %%xmm0, %%ecx\n\t"
+      "movq      %%rax, %%xmm2\n\t"
+      "pinsrw    $7, %%ecx, %%xmm2\n\t"
+      "movdqu    %%xmm2, 80(%0)\n\t"
+      : : "r"(out_ident), "r"(in) : "memory", "rax", "rcx", "xmm0",
+                                    "xmm1", "xmm2", "xmm3", "xmm4"
+   );
+
+   for (i = 0; i < N_CONST; i++)
+      show("const", i, out_const[i]);
+   for (i = 0; i < N_IDENT; i++)
+      show("ident", i, out_ident[i]);
+   return 0;
+}
@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+/* Loops with heavily biased branches, run long enough for
+   --vex-guest-chase=profile to profile them and retranslate the blocks
+   with their hot successors chased.  The result must not change. */
+
+static unsigned int step ( unsigned int x, unsigned int i )
+{
+   if ((i & 1023) != 0)
+      x = x * 33 + i;
+   else
+      x ^= x >> 7;
+   if (i % 7919 == 0)
+      x += 12345;
+   return x;
+}
+
+int main ( void )
+{
+   unsigned int i, x = 1, n_rare = 0;
+   for (i = 0; i < 200000; i++) {
+      x = step(x, i);
+      if ((x & 0xFFFF) == 0x1234)
+         n_rare++;
+   }
+   printf("x = %u, rare = %u\n", x, n_rare);
+   return 0;
+}
@@ -249,6 +249,7 @@ int main(int argc, char **argv)
    vta.guest_bytes                = (UChar*) get_guest_arch;
    vta.guest_bytes_addr           = (Addr) get_guest_arch;
    vta.chase_into_ok              = return_false;
+   vta.chase_cond_hint            = NULL;
    vta.guest_extents              = &vge;
    vta.host_bytes                 = host_bytes;
    vta.host_bytes_size            = sizeof host_bytes;
@@ -265,6 +266,7 @@ int main(int argc, char **argv)
    vta.disp_cp_chain_me_to_fastEP = failure_dispcalled;
    vta.disp_cp_xindir             = failure_dispcalled;
    vta.disp_cp_xassisted          = failure_dispcalled;
+   vta.disp_cp_xindir_miss        = NULL;
 
    
    show_vta("host == guest", &vta);
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// linked-list builds a list of many small heap nodes, linked in a
+// random order, and walks it repeatedly.  Consecutive loads hit
+// different heap blocks, which defeats small caches of recently used
+// blocks in tools that track which heap block every access is to, such
+// as DHAT.  Memcheck and the cache simulators can be run on it too.
+//
+// usage: linked-list [-n nr_nodes default 200000]
+//                    [-w nr_walks default 20]
+
+struct node {
+   struct node *next;
+   long         value;
+};
+
+int main (int argc, char *argv[])
+{
+   int a, i, w;
+   int nr_nodes, nr_walks;
+   struct node **nodes;
+   struct node *head, *n;
+   long sum = 0;
+
+   nr_nodes = 200000;
+   nr_walks = 20;
+   for (a = 1; a + 1 < argc; a += 2) {
+      if        (strcmp(argv[a], "-n") == 0) {
+         nr_nodes = atoi(argv[a+1]);
+      } else if (strcmp(argv[a], "-w") == 0) {
+         nr_walks = atoi(argv[a+1]);
+      } else {
+         printf("unknown arg %s\n", argv[a]);
+      }
+   }
+   if (nr_nodes < 1)
+      nr_nodes = 1;
+
+   nodes = malloc(nr_nodes * sizeof(struct node *));
+   for (i = 0; i < nr_nodes; i++) {
+      nodes[i] = malloc(sizeof(struct node));
+      nodes[i]->value = i;
+   }
+
+   // Shuffle with a fixed seed, so that every run does the same work.
+   srand(1);
+   for (i = nr_nodes - 1; i > 0; i--) {
+      int j = rand() % (i + 1);
+      n = nodes[i];
+      nodes[i] = nodes[j];
+      nodes[j] = n;
+   }
+   for (i = 0; i + 1 < nr_nodes; i++)
+      nodes[i]->next = nodes[i+1];
+   nodes[nr_nodes - 1]->next = NULL;
+   head = nodes[0];
+
+   for (w = 0; w < nr_walks; w++)
+      for (n = head; n != NULL; n = n->next)
+         sum += n->value;
+
+   if (sum != (long)nr_walks * ((long)nr_nodes * (nr_nodes - 1) / 2))
+      printf("unexpected sum %ld\n", sum);
+
+   for (i = 0; i < nr_nodes; i++)
+      free(nodes[i]);
+   free(nodes);
+   return 0;
+}
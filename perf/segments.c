@@ -0,0 +1,92 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// segments simulates a program in which many threads each work on
+// their own memory and synchronise often via a single mutex.  Every
+// lock or unlock starts a new segment for the thread race detectors,
+// and the memory touched between two synchronisations is spread over
+// many pages, so that each segment has a large bitmap.  The cost of
+// this program under DRD is dominated by the computation of the
+// conflict set of the running thread.  Helgrind can be run on it
+// too, to stress the per thread access filter.
+//
+// usage: segments [-t nr_threads default 8]
+//                 [-l nr_loops default 2000]
+//                 [-p nr_pages touched per loop default 16]
+
+#define PAGE_SZB 4096
+
+static int nr_thr;
+static int nr_loops;
+static int nr_pages;
+
+static pthread_mutex_t mx = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long shared_counter;
+
+static void *segments_fn(void *v)
+{
+   unsigned char *mem = v;
+   int loops, p, b;
+
+   for (loops = 0; loops < nr_loops; loops++) {
+      // Private work, spread over nr_pages pages.
+      for (p = 0; p < nr_pages; p++)
+         for (b = 0; b < 64; b += 8)
+            mem[p * PAGE_SZB + (loops % 64) * 8 + b] += b + loops;
+
+      pthread_mutex_lock(&mx);
+      shared_counter++;
+      pthread_mutex_unlock(&mx);
+   }
+   return NULL;
+}
+
+int main (int argc, char *argv[])
+{
+   int a, i;
+   pthread_t *thr;
+   unsigned char **mem;
+
+   nr_thr = 8;
+   nr_loops = 2000;
+   nr_pages = 16;
+   for (a = 1; a + 1 < argc; a += 2) {
+      if        (strcmp(argv[a], "-t") == 0) {
+         nr_thr = atoi(argv[a+1]);
+      } else if (strcmp(argv[a], "-l") == 0) {
+         nr_loops = atoi(argv[a+1]);
+      } else if (strcmp(argv[a], "-p") == 0) {
+         nr_pages = atoi(argv[a+1]);
+      } else {
+         printf("unknown arg %s\n", argv[a]);
+      }
+   }
+
+   thr = malloc(nr_thr * sizeof(pthread_t));
+   mem = malloc(nr_thr * sizeof(unsigned char *));
+   for (i = 0; i < nr_thr; i++) {
+      mem[i] = calloc(nr_pages, PAGE_SZB);
+      if (mem[i] == NULL) {
+         perror("calloc");
+         return 1;
+      }
+   }
+
+   for (i = 0; i < nr_thr; i++)
+      if (pthread_create(&thr[i], NULL, segments_fn, mem[i]) != 0)
+         perror("pthread_create");
+   for (i = 0; i < nr_thr; i++)
+      if (pthread_join(thr[i], NULL) != 0)
+         perror("pthread_join");
+
+   if (shared_counter != (unsigned long)nr_thr * nr_loops)
+      printf("unexpected counter value %lu\n", shared_counter);
+
+   for (i = 0; i < nr_thr; i++)
+      free(mem[i]);
+   free(mem);
+   free(thr);
+   return 0;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// simd runs integer vector kernels of the kind found in vectorised
+// numeric code: lane-wise 32 bit multiplies, clamping with signed and
+// unsigned min/max, 64 bit compares, narrowing and permutes.  On amd64
+// it uses SSE4.1 and, if available, AVX2; elsewhere it runs the same
+// computation as plain C.  Run it with Memcheck too, as its shadow
+// computations use many of the same vector operations.
+//
+// usage: simd [-n nr_elems default 4096]
+//             [-l nr_loops default 50000]
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+static int nr_elems;
+static int nr_loops;
+
+static int *src_a, *src_b;
+static unsigned short *dst16, *ref16;
+
+// For each group of 8 elements: multiply, clamp, rotate by 3 and narrow
+// with unsigned saturation to dst16.  Returns the sum of the results,
+// of the unsigned distances between the inputs, and the number of equal
+// pairs of inputs, modulo 2^32.
+static unsigned int kernel_c(void)
+{
+   unsigned int sum = 0;
+   int i, j;
+   for (i = 0; i < nr_elems; i += 8) {
+      int v[8];
+      for (j = 0; j < 8; j++) {
+         unsigned int ua = src_a[i+j], ub = src_b[i+j];
+         int x = src_a[i+j] * src_b[i+j];
+         x = x < -100000 ? -100000 : x;
+         x = x > 100000 ? 100000 : x;
+         v[j] = x;
+         sum += (ua > ub ? ua : ub) - (ua < ub ? ua : ub);
+      }
+      for (j = 0; j < 8; j++) {
+         int x = v[(j + 3) & 7];
+         unsigned short y = x < 0 ? 0 : x > 0xFFFF ? 0xFFFF : x;
+         dst16[i+j] = y;
+         sum += y;
+      }
+      for (j = 0; j < 8; j += 2)
+         if (src_a[i+j] == src_b[i+j] && src_a[i+j+1] == src_b[i+j+1])
+            sum++;
+   }
+   return sum;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse4.1")))
+static unsigned int kernel_sse41(void)
+{
+   const __m128i lo = _mm_set1_epi32(-100000);
+   const __m128i hi = _mm_set1_epi32(100000);
+   const __m128i zero = _mm_setzero_si128();
+   __m128i acc = zero;
+   __m128i eqs = zero;
+   unsigned int w[4];
+   int i;
+   for (i = 0; i < nr_elems; i += 8) {
+      __m128i a0 = _mm_loadu_si128((const __m128i*)&src_a[i]);
+      __m128i a1 = _mm_loadu_si128((const __m128i*)&src_a[i+4]);
+      __m128i b0 = _mm_loadu_si128((const __m128i*)&src_b[i]);
+      __m128i b1 = _mm_loadu_si128((const __m128i*)&src_b[i+4]);
+      __m128i x0 = _mm_min_epi32(_mm_max_epi32(_mm_mullo_epi32(a0, b0), lo),
+                                 hi);
+      __m128i x1 = _mm_min_epi32(_mm_max_epi32(_mm_mullo_epi32(a1, b1), lo),
+                                 hi);
+      __m128i y  = _mm_packus_epi32(_mm_alignr_epi8(x1, x0, 12),
+                                    _mm_alignr_epi8(x0, x1, 12));
+      _mm_storeu_si128((__m128i*)&dst16[i], y);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(y, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(y, zero));
+      acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_max_epu32(a0, b0),
+                                             _mm_min_epu32(a0, b0)));
+      acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_max_epu32(a1, b1),
+                                             _mm_min_epu32(a1, b1)));
+      eqs = _mm_sub_epi64(eqs, _mm_cmpeq_epi64(a0, b0));
+      eqs = _mm_sub_epi64(eqs, _mm_cmpeq_epi64(a1, b1));
+   }
+   acc = _mm_add_epi32(acc, eqs);
+   _mm_storeu_si128((__m128i*)w, acc);
+   return w[0] + w[1] + w[2] + w[3];
+}
+
+__attribute__((target("avx2")))
+static unsigned int kernel_avx2(void)
+{
+   const __m256i lo  = _mm256_set1_epi32(-100000);
+   const __m256i hi  = _mm256_set1_epi32(100000);
+   const __m256i rot = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+   __m256i acc = _mm256_setzero_si256();
+   __m256i eqs = _mm256_setzero_si256();
+   unsigned int w[8];
+   int i;
+   for (i = 0; i < nr_elems; i += 8) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)&src_a[i]);
+      __m256i b = _mm256_loadu_si256((const __m256i*)&src_b[i]);
+      __m256i x = _mm256_min_epi32(_mm256_max_epi32(_mm256_mullo_epi32(a, b),
+                                                    lo), hi);
+      x = _mm256_permutevar8x32_epi32(x, rot);
+      __m128i y = _mm_packus_epi32(_mm256_castsi256_si128(x),
+                                   _mm256_extracti128_si256(x, 1));
+      _mm_storeu_si128((__m128i*)&dst16[i], y);
+      acc = _mm256_add_epi32(acc, _mm256_cvtepu16_epi32(y));
+      acc = _mm256_add_epi32(acc, _mm256_sub_epi32(_mm256_max_epu32(a, b),
+                                                   _mm256_min_epu32(a, b)));
+      eqs = _mm256_sub_epi64(eqs, _mm256_cmpeq_epi64(a, b));
+   }
+   acc = _mm256_add_epi32(acc, eqs);
+   _mm256_storeu_si256((__m256i*)w, acc);
+   return w[0] + w[1] + w[2] + w[3] + w[4] + w[5] + w[6] + w[7];
+}
+#endif
+
+int main (int argc, char *argv[])
+{
+   int a, i, loops;
+   unsigned int expected, sum;
+
+   nr_elems = 4096;
+   nr_loops = 50000;
+   for (a = 1; a + 1 < argc; a += 2) {
+      if        (strcmp(argv[a], "-n") == 0) {
+         nr_elems = atoi(argv[a+1]);
+      } else if (strcmp(argv[a], "-l") == 0) {
+         nr_loops = atoi(argv[a+1]);
+      } else {
+         printf("unknown arg %s\n", argv[a]);
+      }
+   }
+   nr_elems = (nr_elems + 7) & ~7;
+
+   src_a = malloc(nr_elems * sizeof(int));
+   src_b = malloc(nr_elems * sizeof(int));
+   dst16 = malloc(nr_elems * sizeof(unsigned short));
+   ref16 = malloc(nr_elems * sizeof(unsigned short));
+   srand(1);
+   for (i = 0; i < nr_elems; i++) {
+      // Small values, so that some inputs are equal.
+      src_a[i] = rand() % 41 - 20;
+      src_b[i] = (i % 3 == 0) ? src_a[i] : rand() % 41 - 20;
+      src_a[i] *= 50;
+      src_b[i] *= 50;
+   }
+
+   expected = kernel_c();
+   memcpy(ref16, dst16, nr_elems * sizeof(unsigned short));
+   for (loops = 0; loops < nr_loops; loops++) {
+#ifdef HAVE_X86_KERNELS
+      if (__builtin_cpu_supports("avx2") && (loops & 1))
+         sum = kernel_avx2();
+      else if (__builtin_cpu_supports("sse4.1"))
+         sum = kernel_sse41();
+      else
+#endif
+         sum = kernel_c();
+      if (sum != expected
+          || memcmp(ref16, dst16, nr_elems * sizeof(unsigned short)) != 0) {
+         printf("unexpected result %u (expected %u)\n", sum, expected);
+         return 1;
+      }
+   }
+
+   free(src_a);
+   free(src_b);
+   free(dst16);
+   free(ref16);
+   return 0;
+}
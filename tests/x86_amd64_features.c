@@ -48,7 +48,8 @@ static Bool vendorStringEquals ( char* str )
    return 0 == strcmp(vstr, str);
 }
 
-static Bool have_xgetbv ( void )
+/* Does the OS save the state given by xcr0_mask (in XCR0)? */
+static Bool have_xgetbv ( unsigned long long int xcr0_mask )
 {
 #if defined(VGA_amd64)
    unsigned long long int w;
@@ -57,8 +58,8 @@ static Bool have_xgetbv ( void )
                         "movq %%rax,%0"
                         :/*OUT*/"=r"(w) :/*IN*/
                         :/*TRASH*/"rdx","rcx");
-   if ((w & 6) == 6) {
-      /* OS has enabled both XMM and YMM state support */
+   if ((w & xcr0_mask) == xcr0_mask) {
+      /* OS has enabled all of the requested state support */
       return True;
    } else {
       return False;
@@ -74,7 +75,9 @@ static Bool go(char* cpu)
    unsigned int amask = 0, bmask = 0, cmask = 0, dmask = 0;
    unsigned int a, b, c, d;
    Bool require_amd = False;
-   Bool require_xgetbv = False;
+   /* XCR0 bits which must be set, if any: 6 is XMM and YMM state,
+      0xE6 adds the opmask and ZMM state. */
+   unsigned long long int require_xgetbv = 0;
    if        ( strcmp( cpu, "x86-fpu" ) == 0 ) {
      level = 1;
      dmask = 1 << 0;
@@ -124,7 +127,7 @@ static Bool go(char* cpu)
    } else if ( strcmp( cpu, "amd64-avx" ) == 0 ) {
      level = 1;
      cmask = (1 << 27) | (1 << 28);
-     require_xgetbv = True;
+     require_xgetbv = 6;
    } else if (strcmp (cpu,  "amd64-fma4" ) == 0) {
      level = 0x80000001;
      cmask = 1 << 16;
@@ -138,6 +141,10 @@ static Bool go(char* cpu)
    } else if (strcmp (cpu,  "amd64-rdseed" ) == 0) {
       level = 7;
       bmask = 1 << 18;
+   } else if (strcmp (cpu,  "amd64-avx512f" ) == 0) {
+      level = 7;
+      bmask = 1 << 16;
+      require_xgetbv = 0xE6;
 #endif
    } else {
      return UNRECOGNISED_FEATURE;
@@ -158,17 +165,21 @@ static Bool go(char* cpu)
       if (amask > 0 && (a & amask) == amask)
          return FEATURE_PRESENT;
 
-      if (bmask > 0 && (b & bmask) == bmask)
-         return FEATURE_PRESENT;
+      if (bmask > 0 && (b & bmask) == bmask) {
+         if (require_xgetbv && !have_xgetbv(require_xgetbv))
+            return FEATURE_NOT_PRESENT;
+         else
+            return FEATURE_PRESENT;
+      }
 
       if (dmask > 0 && (d & dmask) == dmask) {
-         if (require_xgetbv && !have_xgetbv())
+         if (require_xgetbv && !have_xgetbv(require_xgetbv))
             return FEATURE_NOT_PRESENT;
          else
             return FEATURE_PRESENT;
       }
       if (cmask > 0 && (c & cmask) == cmask) {
-         if (require_xgetbv && !have_xgetbv())
+         if (require_xgetbv && !have_xgetbv(require_xgetbv))
             return FEATURE_NOT_PRESENT;
          else
             return FEATURE_PRESENT;